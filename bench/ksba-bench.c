@@ -0,0 +1,1369 @@
+/* ksba-bench.c - Benchmarks for the parsers and builders
+ * Copyright (C) 2026 g10 Code GmbH
+ *
+ * This file is part of KSBA.
+ *
+ * KSBA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KSBA is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Each benchmark runs its operation until the requested time has
+   passed and prints one line of JSON to stdout:
+
+     {"bench":"crl-parse-1k","iterations":N,"seconds":S,
+      "bytes_per_op":B,"ops_per_sec":O,"bytes_per_sec":R,
+      "allocs_per_op":A}
+
+   The input objects are taken from tests/samples or created by
+   synth.c from a fixed seed so that runs are comparable.  CMS
+   payloads are not stored in memory but fed through callback readers
+   and the output of the builders is discarded; thus the figures show
+   the cost of Libksba alone.  */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/time.h>
+
+#include "../src/ksba.h"
+#include "synth.h"
+
+#define PGM "ksba-bench"
+
+#define fail_if_err(a) do { if(a) {                                       \
+                              fprintf (stderr, "%s:%d: KSBA error: %s\n", \
+                              __FILE__, __LINE__, gpg_strerror(a));   \
+                              exit (1); }                              \
+                           } while(0)
+
+#define fail(s)  do { fprintf (stderr, "%s:%d: %s\n", __FILE__,__LINE__, (s));\
+                      exit (1); } while(0)
+
+#define DIM(v) (sizeof(v)/sizeof((v)[0]))
+
+/* The byte used for all payloads.  See tape_write_cb.  */
+#define FILL_BYTE 0x5a
+#define CHUNK_SIZE 65536
+
+/* The payload length of the synthetic CMS messages.  */
+#define SYNTH_PAYLOAD 1024
+
+static int verbose;
+static double min_time = 0.5;
+static unsigned long seed = 1;
+static const char *samples_dir = "../tests/samples";
+static unsigned long alloc_count;
+
+/* The certificate samples used as seeds.  */
+static const char *sample_certs[] = {
+  "cert_dfn_pca01.der", "cert_dfn_pca15.der", "cert_g10code_test1.der",
+  "authority.crt", "betsy.crt", "bull.crt", "ov-ocsp-server.crt",
+  "ov-userrev.crt", "ov-root-ca-cert.crt", "ov-serverrev.crt",
+  "ov-user.crt", "ov-server.crt", "ov2-root-ca-cert.crt",
+  "ov2-ocsp-server.crt", "ov2-user.crt", "ov2-userrev.crt",
+  "secp256r1-sha384_cert.crt", "secp256r1-sha512_cert.crt",
+  "secp384r1-sha512_cert.crt", "openssl-secp256r1ca.cert.crt",
+  "ed25519-rfc8410.crt", "ed25519-ossl-1.crt", "ed448-ossl-1.crt",
+  "ct-precert.crt"
+};
+
+static const char *sample_oids[] = {
+  "1.2.840.113549.1.1.11", "1.2.840.113549.1.7.2", "2.5.29.15",
+  "2.5.29.17", "2.5.29.35", "1.3.6.1.5.5.7.48.1.1", "2.16.840.1.101.3.4.2.1",
+  "1.2.840.10045.4.3.2", "1.3.101.112", "1.3.6.1.4.1.11591.2.1.1",
+  "2.5.4.3", "1.2.840.113549.1.9.16.2.47"
+};
+
+
+
+static void *
+count_malloc (size_t n)
+{
+  alloc_count++;
+  return malloc (n);
+}
+
+static void *
+count_realloc (void *p, size_t n)
+{
+  alloc_count++;
+  return realloc (p, n);
+}
+
+
+static double
+timer_now (void)
+{
+#ifdef HAVE_CLOCK_GETTIME
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+#else
+  struct timeval tv;
+
+  gettimeofday (&tv, NULL);
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+#endif
+}
+
+
+static void *
+xcalloc (size_t n, size_t m)
+{
+  void *p = calloc (n, m);
+  if (!p)
+    fail ("out of core");
+  return p;
+}
+
+
+/* Read the sample FNAME into an allocated buffer.  Returns NULL if
+   the file does not exist.  */
+static unsigned char *
+read_sample (const char *fname, size_t *r_length)
+{
+  char *name;
+  FILE *fp;
+  unsigned char *buf = NULL;
+  size_t buflen = 0, n;
+
+  name = xcalloc (1, strlen (samples_dir) + 1 + strlen (fname) + 1);
+  strcpy (stpcpy (stpcpy (name, samples_dir), "/"), fname);
+  fp = fopen (name, "rb");
+  if (!fp)
+    {
+      if (verbose)
+        fprintf (stderr, PGM": can't open `%s': %s\n", name, strerror (errno));
+      free (name);
+      return NULL;
+    }
+  do
+    {
+      buf = realloc (buf, buflen + 8192);
+      if (!buf)
+        fail ("out of core");
+      n = fread (buf + buflen, 1, 8192, fp);
+      buflen += n;
+    }
+  while (n == 8192);
+  fclose (fp);
+  free (name);
+  *r_length = buflen;
+  return buf;
+}
+
+
+static ksba_cert_t
+load_cert (const char *fname)
+{
+  gpg_error_t err;
+  unsigned char *image;
+  size_t imagelen;
+  ksba_cert_t cert;
+
+  image = read_sample (fname, &imagelen);
+  if (!image)
+    {
+      fprintf (stderr, PGM": sample `%s' not found - use --samples\n", fname);
+      exit (1);
+    }
+  err = ksba_cert_new (&cert);
+  fail_if_err (err);
+  err = ksba_cert_init_from_mem (cert, image, imagelen);
+  fail_if_err (err);
+  free (image);
+  return cert;
+}
+
+
+/* A hash function for ksba_set_hash_buffer_function.  OCSP requests
+   need a SHA-1 but as we only compare against our own requests any
+   function will do.  */
+static gpg_error_t
+dummy_hash_buffer (void *arg, const char *oid,
+                   const void *buffer, size_t length,
+                   size_t resultsize, unsigned char *result, size_t *resultlen)
+{
+  const unsigned char *p = buffer;
+  unsigned int h = 2166136261u;
+  size_t i;
+
+  (void)arg;
+  (void)oid;
+  if (resultsize < 20)
+    return gpg_error (GPG_ERR_TOO_SHORT);
+  for (i=0; i < length; i++)
+    h = (h ^ p[i]) * 16777619u;
+  for (i=0; i < 20; i++, h = h * 16777619u + 1)
+    result[i] = h >> 24;
+  *resultlen = 20;
+  return 0;
+}
+
+
+static void
+dummy_hash_fnc (void *arg, const void *buffer, size_t length)
+{
+  (void)buffer;
+  if (arg)
+    *(unsigned long long *)arg += length;
+}
+
+
+/* A writer callback which discards everything.  */
+static int
+null_write_cb (void *arg, const void *buffer, size_t length)
+{
+  (void)buffer;
+  if (arg)
+    *(unsigned long long *)arg += length;
+  return 0;
+}
+
+
+
+/* A tape records the output of a CMS build so that it can be replayed
+   to the parser.  Runs of the payload byte are only counted which
+   allows to replay objects of any size.  */
+struct tape_segment_s
+{
+  size_t off;    /* Offset into the tape's buffer.  */
+  size_t len;
+  int fill;      /* The segment is a run of FILL_BYTE.  */
+};
+
+struct tape_s
+{
+  struct tape_segment_s *segs;
+  size_t nsegs, segsize;
+  unsigned char *buf;
+  size_t buflen, bufsize;
+  unsigned long long total;
+
+  /* The read position.  */
+  size_t rseg;
+  size_t rpos;
+};
+typedef struct tape_s *tape_t;
+
+
+static struct tape_segment_s *
+tape_append (tape_t t, int fill)
+{
+  if (t->nsegs && t->segs[t->nsegs-1].fill == fill)
+    return &t->segs[t->nsegs-1];
+  if (t->nsegs == t->segsize)
+    {
+      t->segsize = t->segsize? 2*t->segsize : 64;
+      t->segs = realloc (t->segs, t->segsize * sizeof *t->segs);
+      if (!t->segs)
+        fail ("out of core");
+    }
+  t->segs[t->nsegs].off = t->buflen;
+  t->segs[t->nsegs].len = 0;
+  t->segs[t->nsegs].fill = fill;
+  return &t->segs[t->nsegs++];
+}
+
+
+static int
+tape_write_cb (void *arg, const void *buffer, size_t length)
+{
+  tape_t t = arg;
+  const unsigned char *p = buffer;
+  struct tape_segment_s *seg;
+  size_t n;
+
+  /* Headers are short; thus any longer run of the payload byte is
+     payload.  */
+  for (n=0; n < length && p[n] == FILL_BYTE; n++)
+    ;
+  if (length >= 16 && n == length)
+    {
+      seg = tape_append (t, 1);
+      seg->len += length;
+    }
+  else
+    {
+      seg = tape_append (t, 0);
+      if (t->buflen + length > t->bufsize)
+        {
+          t->bufsize = 2 * (t->buflen + length);
+          t->buf = realloc (t->buf, t->bufsize);
+          if (!t->buf)
+            fail ("out of core");
+        }
+      memcpy (t->buf + t->buflen, buffer, length);
+      t->buflen += length;
+      seg->len += length;
+    }
+  t->total += length;
+  return 0;
+}
+
+
+static int
+tape_read_cb (void *arg, char *buffer, size_t count, size_t *r_nread)
+{
+  tape_t t = arg;
+  struct tape_segment_s *seg;
+  size_t n;
+
+  if (t->rseg >= t->nsegs)
+    return -1;  /* EOF.  */
+  seg = &t->segs[t->rseg];
+  n = seg->len - t->rpos;
+  if (n > count)
+    n = count;
+  if (seg->fill)
+    memset (buffer, FILL_BYTE, n);
+  else
+    memcpy (buffer, t->buf + seg->off + t->rpos, n);
+  t->rpos += n;
+  if (t->rpos == seg->len)
+    {
+      t->rseg++;
+      t->rpos = 0;
+    }
+  *r_nread = n;
+  return 0;
+}
+
+
+static void
+tape_release (tape_t t)
+{
+  if (!t)
+    return;
+  free (t->segs);
+  free (t->buf);
+  free (t);
+}
+
+
+/* A reader callback delivering LEFT payload bytes.  */
+static int
+payload_read_cb (void *arg, char *buffer, size_t count, size_t *r_nread)
+{
+  unsigned long long *left = arg;
+
+  if (!*left)
+    return -1;
+  if (count > *left)
+    count = *left;
+  memset (buffer, FILL_BYTE, count);
+  *left -= count;
+  *r_nread = count;
+  return 0;
+}
+
+
+
+/* The context used by all benchmarks.  */
+struct ctx_s
+{
+  unsigned long long param;
+  unsigned int idx;
+
+  int nitems;
+  unsigned char **items;
+  size_t *itemlens;
+  char **strings;
+  ksba_cert_t *certs;
+
+  unsigned char *object;
+  size_t objectlen;
+  ksba_ocsp_t ocsp;
+  ksba_der_t der;
+  ksba_writer_t writer;
+  tape_t tape;
+  unsigned char *payload;
+  unsigned long long counter;
+};
+typedef struct ctx_s *ctx_t;
+
+
+static void
+release_ctx (ctx_t ctx)
+{
+  int i;
+
+  for (i=0; i < ctx->nitems; i++)
+    {
+      if (ctx->items)
+        ksba_free (ctx->items[i]);
+      if (ctx->strings)
+        ksba_free (ctx->strings[i]);
+      if (ctx->certs)
+        ksba_cert_release (ctx->certs[i]);
+    }
+  free (ctx->items);
+  free (ctx->itemlens);
+  free (ctx->strings);
+  free (ctx->certs);
+  ksba_free (ctx->object);
+  ksba_ocsp_release (ctx->ocsp);
+  ksba_der_release (ctx->der);
+  ksba_writer_release (ctx->writer);
+  tape_release (ctx->tape);
+  free (ctx->payload);
+  free (ctx);
+}
+
+
+/* Load the sample certificates into CTX.  The images are stored as
+   items and the certificates in CERTS.  */
+static void
+setup_certs (ctx_t ctx)
+{
+  gpg_error_t err;
+  unsigned char *image;
+  size_t imagelen;
+  int i;
+
+  ctx->items = xcalloc (DIM (sample_certs), sizeof *ctx->items);
+  ctx->itemlens = xcalloc (DIM (sample_certs), sizeof *ctx->itemlens);
+  ctx->certs = xcalloc (DIM (sample_certs), sizeof *ctx->certs);
+  for (i=0; i < (int)DIM (sample_certs); i++)
+    {
+      image = read_sample (sample_certs[i], &imagelen);
+      if (!image)
+        continue;
+      err = ksba_cert_new (&ctx->certs[ctx->nitems]);
+      fail_if_err (err);
+      err = ksba_cert_init_from_mem (ctx->certs[ctx->nitems],
+                                     image, imagelen);
+      if (err)
+        {
+          fprintf (stderr, PGM": skipping `%s': %s\n",
+                   sample_certs[i], gpg_strerror (err));
+          ksba_cert_release (ctx->certs[ctx->nitems]);
+          ctx->certs[ctx->nitems] = NULL;
+          free (image);
+          continue;
+        }
+      /* Keep a copy owned by Libksba so that release_ctx can use
+         ksba_free for all items.  */
+      ctx->items[ctx->nitems] = ksba_malloc (imagelen);
+      if (!ctx->items[ctx->nitems])
+        fail ("out of core");
+      memcpy (ctx->items[ctx->nitems], image, imagelen);
+      ctx->itemlens[ctx->nitems] = imagelen;
+      ctx->nitems++;
+      free (image);
+    }
+  if (!ctx->nitems)
+    fail ("no sample certificates found - use --samples");
+}
+
+
+static ctx_t
+setup_cert (unsigned long long param)
+{
+  ctx_t ctx = xcalloc (1, sizeof *ctx);
+
+  ctx->param = param;
+  setup_certs (ctx);
+  return ctx;
+}
+
+
+/* Parse one certificate.  */
+static size_t
+run_cert_parse (ctx_t ctx)
+{
+  gpg_error_t err;
+  ksba_cert_t cert;
+  int i = ctx->idx++ % ctx->nitems;
+
+  err = ksba_cert_new (&cert);
+  fail_if_err (err);
+  err = ksba_cert_init_from_mem (cert, ctx->items[i], ctx->itemlens[i]);
+  fail_if_err (err);
+  ksba_cert_release (cert);
+  return ctx->itemlens[i];
+}
+
+
+/* Parse one certificate and use the common accessors.  */
+static size_t
+run_cert_access (ctx_t ctx)
+{
+  gpg_error_t err;
+  ksba_cert_t cert;
+  int i = ctx->idx++ % ctx->nitems;
+  int idx, crit;
+  char *p;
+  const char *oid;
+  size_t off, len;
+  ksba_isotime_t t;
+
+  err = ksba_cert_new (&cert);
+  fail_if_err (err);
+  err = ksba_cert_init_from_mem (cert, ctx->items[i], ctx->itemlens[i]);
+  fail_if_err (err);
+
+  ksba_free (ksba_cert_get_serial (cert));
+  for (idx=0; (p = ksba_cert_get_issuer (cert, idx)); idx++)
+    ksba_free (p);
+  for (idx=0; (p = ksba_cert_get_subject (cert, idx)); idx++)
+    ksba_free (p);
+  ksba_cert_get_validity (cert, 0, t);
+  ksba_cert_get_validity (cert, 1, t);
+  ksba_cert_get_digest_algo (cert);
+  ksba_free (ksba_cert_get_public_key (cert));
+  ksba_free (ksba_cert_get_sig_val (cert));
+  for (idx=0; !ksba_cert_get_extension (cert, idx, &oid, &crit, &off, &len);
+       idx++)
+    ;
+  ksba_cert_release (cert);
+  return ctx->itemlens[i];
+}
+
+
+/* Use a synthetic certificate with PARAM subjectAltNames.  */
+static ctx_t
+setup_cert_sans (unsigned long long param)
+{
+  gpg_error_t err;
+  ctx_t ctx = xcalloc (1, sizeof *ctx);
+
+  ctx->param = param;
+  ctx->items = xcalloc (1, sizeof *ctx->items);
+  ctx->itemlens = xcalloc (1, sizeof *ctx->itemlens);
+  err = synth_cert (param, 0, seed, &ctx->items[0], &ctx->itemlens[0]);
+  fail_if_err (err);
+  ctx->nitems = 1;
+  return ctx;
+}
+
+
+static ctx_t
+setup_dn (unsigned long long param)
+{
+  gpg_error_t err;
+  ctx_t ctx = xcalloc (1, sizeof *ctx);
+  int i, n;
+  char *s;
+
+  ctx->param = param;
+  setup_certs (ctx);
+
+  /* Replace the items by the subjects' DNs.  */
+  n = ctx->nitems;
+  ctx->strings = xcalloc (n, sizeof *ctx->strings);
+  for (i=0; i < n; i++)
+    {
+      ksba_free (ctx->items[i]);
+      ctx->items[i] = NULL;
+      s = ksba_cert_get_subject (ctx->certs[i], 0);
+      if (!s)
+        fail ("certificate without subject");
+      err = ksba_dn_str2der (s, &ctx->items[i], &ctx->itemlens[i]);
+      fail_if_err (err);
+      ctx->strings[i] = s;
+    }
+  return ctx;
+}
+
+
+static size_t
+run_dn_der2str (ctx_t ctx)
+{
+  gpg_error_t err;
+  int i = ctx->idx++ % ctx->nitems;
+  char *s;
+
+  err = ksba_dn_der2str (ctx->items[i], ctx->itemlens[i], &s);
+  fail_if_err (err);
+  ksba_free (s);
+  return ctx->itemlens[i];
+}
+
+
+static size_t
+run_dn_str2der (ctx_t ctx)
+{
+  gpg_error_t err;
+  int i = ctx->idx++ % ctx->nitems;
+  unsigned char *der;
+  size_t derlen;
+
+  err = ksba_dn_str2der (ctx->strings[i], &der, &derlen);
+  fail_if_err (err);
+  ksba_free (der);
+  return strlen (ctx->strings[i]);
+}
+
+
+static ctx_t
+setup_oid (unsigned long long param)
+{
+  gpg_error_t err;
+  ctx_t ctx = xcalloc (1, sizeof *ctx);
+  int i, n;
+
+  ctx->param = param;
+  n = DIM (sample_oids);
+  ctx->items = xcalloc (n, sizeof *ctx->items);
+  ctx->itemlens = xcalloc (n, sizeof *ctx->itemlens);
+  ctx->strings = xcalloc (n, sizeof *ctx->strings);
+  for (i=0; i < n; i++)
+    {
+      err = ksba_oid_from_str (sample_oids[i],
+                               &ctx->items[i], &ctx->itemlens[i]);
+      fail_if_err (err);
+      ctx->strings[i] = ksba_oid_to_str ((char*)ctx->items[i],
+                                         ctx->itemlens[i]);
+      if (!ctx->strings[i] || strcmp (ctx->strings[i], sample_oids[i]))
+        fail ("OID conversion mismatch");
+    }
+  ctx->nitems = n;
+  return ctx;
+}
+
+
+static size_t
+run_oid_to_str (ctx_t ctx)
+{
+  int i = ctx->idx++ % ctx->nitems;
+  char *s;
+
+  s = ksba_oid_to_str ((char*)ctx->items[i], ctx->itemlens[i]);
+  if (!s)
+    fail ("ksba_oid_to_str failed");
+  ksba_free (s);
+  return ctx->itemlens[i];
+}
+
+
+static size_t
+run_oid_from_str (ctx_t ctx)
+{
+  gpg_error_t err;
+  int i = ctx->idx++ % ctx->nitems;
+  unsigned char *der;
+  size_t derlen;
+
+  err = ksba_oid_from_str (ctx->strings[i], &der, &derlen);
+  fail_if_err (err);
+  ksba_free (der);
+  return strlen (ctx->strings[i]);
+}
+
+
+/* Create a CRL with PARAM entries issued by the OV test root.  */
+static ctx_t
+setup_crl (unsigned long long param)
+{
+  gpg_error_t err;
+  ctx_t ctx = xcalloc (1, sizeof *ctx);
+  ksba_cert_t issuer;
+  ksba_writer_t w;
+  unsigned char *name;
+  size_t namelen;
+  char *s;
+
+  ctx->param = param;
+  issuer = load_cert ("ov-root-ca-cert.crt");
+  s = ksba_cert_get_subject (issuer, 0);
+  err = ksba_dn_str2der (s, &name, &namelen);
+  fail_if_err (err);
+  ksba_free (s);
+  ksba_cert_release (issuer);
+
+  err = ksba_writer_new (&w);
+  fail_if_err (err);
+  err = ksba_writer_set_mem (w, 64 * param + 1024);
+  fail_if_err (err);
+  err = synth_crl (w, name, namelen, param, seed, NULL);
+  fail_if_err (err);
+  ctx->object = ksba_writer_snatch_mem (w, &ctx->objectlen);
+  if (!ctx->object)
+    fail ("error creating the CRL");
+  ksba_writer_release (w);
+  ksba_free (name);
+  return ctx;
+}
+
+
+/* Parse a CRL and retrieve all entries.  */
+static size_t
+run_crl_parse (ctx_t ctx)
+{
+  gpg_error_t err;
+  ksba_reader_t r;
+  ksba_crl_t crl;
+  ksba_stop_reason_t stopreason;
+  ksba_sexp_t serial;
+  ksba_isotime_t rdate;
+  ksba_crl_reason_t reason;
+  unsigned long long count = 0;
+
+  err = ksba_reader_new (&r);
+  fail_if_err (err);
+  err = ksba_reader_set_mem (r, ctx->object, ctx->objectlen);
+  fail_if_err (err);
+  err = ksba_crl_new (&crl);
+  fail_if_err (err);
+  err = ksba_crl_set_reader (crl, r);
+  fail_if_err (err);
+  ksba_crl_set_hash_function (crl, dummy_hash_fnc, NULL);
+  do
+    {
+      err = ksba_crl_parse (crl, &stopreason);
+      fail_if_err (err);
+      if (stopreason == KSBA_SR_GOT_ITEM)
+        {
+          err = ksba_crl_get_item (crl, &serial, rdate, &reason);
+          fail_if_err (err);
+          ksba_free (serial);
+          count++;
+        }
+    }
+  while (stopreason != KSBA_SR_READY);
+  if (count != ctx->param)
+    fail ("CRL entry count mismatch");
+  ksba_crl_release (crl);
+  ksba_reader_release (r);
+  return ctx->objectlen;
+}
+
+
+/* Create a request for the OV server certificate and a matching
+   response from the OV OCSP server.  */
+static ctx_t
+setup_ocsp (unsigned long long param)
+{
+  gpg_error_t err;
+  ctx_t ctx = xcalloc (1, sizeof *ctx);
+  ksba_cert_t cert, issuer, responder;
+  unsigned char *request;
+  size_t requestlen;
+
+  ctx->param = param;
+  cert = load_cert ("ov-server.crt");
+  issuer = load_cert ("ov-root-ca-cert.crt");
+  responder = load_cert ("ov-ocsp-server.crt");
+  err = ksba_ocsp_new (&ctx->ocsp);
+  fail_if_err (err);
+  err = ksba_ocsp_add_target (ctx->ocsp, cert, issuer);
+  fail_if_err (err);
+  err = ksba_ocsp_build_request (ctx->ocsp, &request, &requestlen);
+  fail_if_err (err);
+  err = synth_ocsp_response (request, requestlen, responder, seed,
+                             &ctx->object, &ctx->objectlen);
+  fail_if_err (err);
+  ksba_free (request);
+  ksba_cert_release (issuer);
+  ksba_cert_release (responder);
+
+  ctx->certs = xcalloc (1, sizeof *ctx->certs);
+  ctx->certs[0] = cert;
+  ctx->nitems = 1;
+  return ctx;
+}
+
+
+static size_t
+run_ocsp_parse (ctx_t ctx)
+{
+  gpg_error_t err;
+  ksba_ocsp_response_status_t response_status;
+  ksba_status_t status;
+  ksba_isotime_t this_update, next_update, revocation_time;
+  ksba_crl_reason_t reason;
+  char *name;
+  ksba_sexp_t keyid;
+
+  err = ksba_ocsp_parse_response (ctx->ocsp, ctx->object, ctx->objectlen,
+                                  &response_status);
+  fail_if_err (err);
+  if (response_status != KSBA_OCSP_RSPSTATUS_SUCCESS)
+    fail ("unexpected OCSP response status");
+  err = ksba_ocsp_get_responder_id (ctx->ocsp, &name, &keyid);
+  fail_if_err (err);
+  ksba_free (name);
+  ksba_free (keyid);
+  err = ksba_ocsp_get_status (ctx->ocsp, ctx->certs[0], &status,
+                              this_update, next_update,
+                              revocation_time, &reason);
+  fail_if_err (err);
+  return ctx->objectlen;
+}
+
+
+
+/* Build a signed or enveloped message with a payload of PARAM bytes
+   and write it to W.  */
+static void
+build_cms (ctx_t ctx, int enveloped, ksba_writer_t w)
+{
+  gpg_error_t err;
+  ksba_cms_t cms;
+  ksba_reader_t r = NULL;
+  ksba_stop_reason_t stopreason;
+  unsigned long long left, n;
+
+  err = ksba_cms_new (&cms);
+  fail_if_err (err);
+  if (enveloped)
+    {
+      left = ctx->param;
+      err = ksba_reader_new (&r);
+      fail_if_err (err);
+      err = ksba_reader_set_cb (r, payload_read_cb, &left);
+      fail_if_err (err);
+      err = ksba_cms_set_reader_writer (cms, r, w);
+      fail_if_err (err);
+      err = ksba_cms_set_content_type (cms, 0, KSBA_CT_ENVELOPED_DATA);
+      fail_if_err (err);
+      err = ksba_cms_set_content_type (cms, 1, KSBA_CT_DATA);
+      fail_if_err (err);
+      err = ksba_cms_set_content_enc_algo (cms, "2.16.840.1.101.3.4.1.2",
+                                           "0123456789abcdef", 16);
+      fail_if_err (err);
+      err = ksba_cms_add_recipient (cms, ctx->certs[0]);
+      fail_if_err (err);
+      err = ksba_cms_set_enc_val
+        (cms, 0, (const unsigned char*)"(7:enc-val(3:rsa(1:a4:KEY!)))");
+      fail_if_err (err);
+    }
+  else
+    {
+      err = ksba_cms_set_reader_writer (cms, NULL, w);
+      fail_if_err (err);
+      ksba_cms_set_hash_function (cms, dummy_hash_fnc, NULL);
+      err = ksba_cms_set_content_type (cms, 0, KSBA_CT_SIGNED_DATA);
+      fail_if_err (err);
+      err = ksba_cms_set_content_type (cms, 1, KSBA_CT_DATA);
+      fail_if_err (err);
+      err = ksba_cms_add_digest_algo (cms, "2.16.840.1.101.3.4.2.1");
+      fail_if_err (err);
+      err = ksba_cms_add_signer (cms, ctx->certs[0]);
+      fail_if_err (err);
+      err = ksba_cms_add_cert (cms, ctx->certs[0]);
+      fail_if_err (err);
+    }
+
+  do
+    {
+      err = ksba_cms_build (cms, &stopreason);
+      fail_if_err (err);
+      if (stopreason == KSBA_SR_BEGIN_DATA && !enveloped)
+        {
+          for (left = ctx->param; left; left -= n)
+            {
+              n = left < CHUNK_SIZE? left : CHUNK_SIZE;
+              err = ksba_writer_write_octet_string (w, ctx->payload, n, 0);
+              fail_if_err (err);
+            }
+          err = ksba_writer_write_octet_string (w, NULL, 0, 1);
+          fail_if_err (err);
+          err = ksba_cms_set_message_digest
+            (cms, 0, (const unsigned char*)"0123456789abcdef"
+                                           "0123456789abcdef", 32);
+          fail_if_err (err);
+        }
+      else if (stopreason == KSBA_SR_NEED_SIG)
+        {
+          err = ksba_cms_hash_signed_attrs (cms, 0);
+          fail_if_err (err);
+          err = ksba_cms_set_sig_val
+            (cms, 0, (const unsigned char*)"(7:sig-val(3:rsa(1:s4:SIGN)))");
+          fail_if_err (err);
+        }
+    }
+  while (stopreason != KSBA_SR_READY);
+
+  ksba_cms_release (cms);
+  ksba_reader_release (r);
+}
+
+
+static ctx_t
+setup_cms (unsigned long long param, int enveloped)
+{
+  gpg_error_t err;
+  ctx_t ctx = xcalloc (1, sizeof *ctx);
+  ksba_writer_t w;
+
+  ctx->param = param;
+  ctx->certs = xcalloc (1, sizeof *ctx->certs);
+  ctx->certs[0] = load_cert ("cert_g10code_test1.der");
+  ctx->nitems = 1;
+  ctx->payload = xcalloc (1, CHUNK_SIZE);
+  memset (ctx->payload, FILL_BYTE, CHUNK_SIZE);
+
+  /* Record the message for the parser.  */
+  ctx->tape = xcalloc (1, sizeof *ctx->tape);
+  err = ksba_writer_new (&w);
+  fail_if_err (err);
+  err = ksba_writer_set_cb (w, tape_write_cb, ctx->tape);
+  fail_if_err (err);
+  build_cms (ctx, enveloped, w);
+  ksba_writer_release (w);
+  if (verbose)
+    fprintf (stderr, PGM": message of %llu bytes in %u segments\n",
+             ctx->tape->total, (unsigned int)ctx->tape->nsegs);
+  return ctx;
+}
+
+static ctx_t
+setup_signed (unsigned long long param)
+{
+  return setup_cms (param, 0);
+}
+
+static ctx_t
+setup_enveloped (unsigned long long param)
+{
+  return setup_cms (param, 1);
+}
+
+
+static size_t
+run_cms_build (ctx_t ctx, int enveloped)
+{
+  gpg_error_t err;
+  ksba_writer_t w;
+
+  ctx->counter = 0;
+  err = ksba_writer_new (&w);
+  fail_if_err (err);
+  err = ksba_writer_set_cb (w, null_write_cb, &ctx->counter);
+  fail_if_err (err);
+  build_cms (ctx, enveloped, w);
+  ksba_writer_release (w);
+  if (ctx->counter != ctx->tape->total)
+    fail ("CMS build length mismatch");
+  return ctx->param;
+}
+
+static size_t
+run_signed_build (ctx_t ctx)
+{
+  return run_cms_build (ctx, 0);
+}
+
+static size_t
+run_enveloped_build (ctx_t ctx)
+{
+  return run_cms_build (ctx, 1);
+}
+
+
+/* Parse the recorded message and check that the entire payload has
+   been seen.  */
+static size_t
+run_cms_parse (ctx_t ctx)
+{
+  gpg_error_t err;
+  ksba_reader_t r;
+  ksba_writer_t w;
+  ksba_cms_t cms;
+  ksba_stop_reason_t stopreason;
+
+  ctx->tape->rseg = ctx->tape->rpos = 0;
+  ctx->counter = 0;
+  err = ksba_reader_new (&r);
+  fail_if_err (err);
+  err = ksba_reader_set_cb (r, tape_read_cb, ctx->tape);
+  fail_if_err (err);
+  err = ksba_writer_new (&w);
+  fail_if_err (err);
+  err = ksba_writer_set_cb (w, null_write_cb, &ctx->counter);
+  fail_if_err (err);
+
+  err = ksba_cms_new (&cms);
+  fail_if_err (err);
+  err = ksba_cms_set_reader_writer (cms, r, w);
+  fail_if_err (err);
+  ksba_cms_set_hash_function (cms, dummy_hash_fnc, &ctx->counter);
+  do
+    {
+      err = ksba_cms_parse (cms, &stopreason);
+      fail_if_err (err);
+    }
+  while (stopreason != KSBA_SR_READY);
+  if (ctx->counter < ctx->param)
+    fail ("CMS payload length mismatch");
+
+  ksba_cms_release (cms);
+  ksba_writer_release (w);
+  ksba_reader_release (r);
+  return ctx->param;
+}
+
+
+/* Record a synthetic message with PARAM certificates or recipients
+   for run_synth_parse.  */
+static ctx_t
+setup_synth_cms (unsigned long long param, int enveloped)
+{
+  gpg_error_t err;
+  ctx_t ctx = xcalloc (1, sizeof *ctx);
+  ksba_writer_t w;
+
+  ctx->tape = xcalloc (1, sizeof *ctx->tape);
+  err = ksba_writer_new (&w);
+  fail_if_err (err);
+  err = ksba_writer_set_cb (w, tape_write_cb, ctx->tape);
+  fail_if_err (err);
+  if (enveloped)
+    err = synth_cms_enveloped (w, param, SYNTH_PAYLOAD, seed, NULL);
+  else
+    err = synth_cms_signed (w, param, SYNTH_PAYLOAD, seed, NULL);
+  fail_if_err (err);
+  ksba_writer_release (w);
+  /* From now on PARAM is the payload length checked by
+     run_cms_parse.  */
+  ctx->param = SYNTH_PAYLOAD;
+  return ctx;
+}
+
+static ctx_t
+setup_synth_signed (unsigned long long param)
+{
+  return setup_synth_cms (param, 0);
+}
+
+static ctx_t
+setup_synth_enveloped (unsigned long long param)
+{
+  return setup_synth_cms (param, 1);
+}
+
+
+/* Parse a synthetic message; unlike run_cms_parse the entire message
+   is counted because the payload is small.  */
+static size_t
+run_synth_parse (ctx_t ctx)
+{
+  run_cms_parse (ctx);
+  return ctx->tape->total;
+}
+
+
+/* Build a certificate like object.  */
+static void
+build_sample_object (ksba_der_t d, ctx_t ctx, unsigned int serial)
+{
+  unsigned char sn[4];
+
+  sn[0] = serial >> 24;
+  sn[1] = serial >> 16;
+  sn[2] = serial >> 8;
+  sn[3] = serial;
+  ksba_der_add_tag (d, 0, KSBA_TYPE_SEQUENCE);
+  ksba_der_add_tag (d, KSBA_CLASS_CONTEXT, 0);
+  ksba_der_add_int (d, "\x02", 1, 0);
+  ksba_der_add_end (d);
+  ksba_der_add_int (d, sn, sizeof sn, 1);
+  ksba_der_add_tag (d, 0, KSBA_TYPE_SEQUENCE);
+  ksba_der_add_oid (d, "1.2.840.113549.1.1.11");
+  ksba_der_add_ptr (d, 0, KSBA_TYPE_NULL, NULL, 0);
+  ksba_der_add_end (d);
+  ksba_der_add_der (d, ctx->items[0], ctx->itemlens[0]);
+  ksba_der_add_tag (d, 0, KSBA_TYPE_SEQUENCE);
+  ksba_der_add_val (d, 0, KSBA_TYPE_UTC_TIME, "260101000000Z", 13);
+  ksba_der_add_val (d, 0, KSBA_TYPE_UTC_TIME, "270101000000Z", 13);
+  ksba_der_add_end (d);
+  ksba_der_add_der (d, ctx->items[1], ctx->itemlens[1]);
+  ksba_der_add_tag (d, 0, KSBA_TYPE_SEQUENCE);
+  ksba_der_add_tag (d, 0, KSBA_TYPE_SEQUENCE);
+  ksba_der_add_oid (d, "1.3.101.112");
+  ksba_der_add_end (d);
+  ksba_der_add_bts (d, ctx->payload, 32, 0);
+  ksba_der_add_end (d);
+  ksba_der_add_tag (d, KSBA_CLASS_CONTEXT, 3);
+  ksba_der_add_tag (d, 0, KSBA_TYPE_SEQUENCE);
+  ksba_der_add_tag (d, 0, KSBA_TYPE_SEQUENCE);
+  ksba_der_add_oid (d, "2.5.29.19");
+  ksba_der_add_val (d, 0, KSBA_TYPE_BOOLEAN, "\xff", 1);
+  ksba_der_add_tag (d, KSBA_CLASS_ENCAPSULATE, KSBA_TYPE_OCTET_STRING);
+  ksba_der_add_tag (d, 0, KSBA_TYPE_SEQUENCE);
+  ksba_der_add_val (d, 0, KSBA_TYPE_BOOLEAN, "\xff", 1);
+  ksba_der_add_end (d);
+  ksba_der_add_end (d);
+  ksba_der_add_end (d);
+  ksba_der_add_end (d);
+  ksba_der_add_end (d);
+  ksba_der_add_end (d);
+}
+
+
+static ctx_t
+setup_der (unsigned long long param)
+{
+  gpg_error_t err;
+  ctx_t ctx = setup_dn (param);
+
+  if (ctx->nitems < 2)
+    fail ("not enough sample certificates");
+  ctx->payload = xcalloc (1, 32);
+  ctx->der = ksba_der_builder_new (0);
+  if (!ctx->der)
+    fail ("out of core");
+  err = ksba_writer_new (&ctx->writer);
+  fail_if_err (err);
+  err = ksba_writer_set_cb (ctx->writer, null_write_cb, NULL);
+  fail_if_err (err);
+  return ctx;
+}
+
+
+static size_t
+run_der_new (ctx_t ctx)
+{
+  gpg_error_t err;
+  ksba_der_t d;
+  unsigned char *der;
+  size_t derlen;
+
+  d = ksba_der_builder_new (0);
+  if (!d)
+    fail ("out of core");
+  build_sample_object (d, ctx, ctx->idx++);
+  err = ksba_der_builder_get (d, &der, &derlen);
+  fail_if_err (err);
+  ksba_free (der);
+  ksba_der_release (d);
+  return derlen;
+}
+
+
+static size_t
+run_der_reuse (ctx_t ctx)
+{
+  gpg_error_t err;
+  unsigned char *der;
+  size_t derlen;
+
+  ksba_der_builder_reset (ctx->der);
+  build_sample_object (ctx->der, ctx, ctx->idx++);
+  err = ksba_der_builder_get (ctx->der, &der, &derlen);
+  fail_if_err (err);
+  ksba_free (der);
+  return derlen;
+}
+
+
+static size_t
+run_der_write (ctx_t ctx)
+{
+  gpg_error_t err;
+  size_t derlen;
+
+  ksba_der_builder_reset (ctx->der);
+  build_sample_object (ctx->der, ctx, ctx->idx++);
+  err = ksba_der_builder_write (ctx->der, ctx->writer, &derlen);
+  fail_if_err (err);
+  return derlen;
+}
+
+
+
+#define KB 1024ULL
+#define MB (1024ULL*KB)
+#define GB (1024ULL*MB)
+
+/* Flags for the benchmark table.  */
+#define BF_MACRO 1  /* Do not run a warm up operation.  */
+
+static struct {
+  const char *name;
+  ctx_t (*setup) (unsigned long long param);
+  size_t (*run) (ctx_t ctx);
+  unsigned long long param;
+  unsigned int flags;
+} benchmarks[] = {
+  { "cert-parse",          setup_cert,      run_cert_parse },
+  { "cert-access",         setup_cert,      run_cert_access },
+  { "cert-parse-500-sans", setup_cert_sans, run_cert_parse,  500 },
+  { "cert-access-500-sans", setup_cert_sans, run_cert_access, 500 },
+  { "dn-der2str",          setup_dn,        run_dn_der2str },
+  { "dn-str2der",          setup_dn,        run_dn_str2der },
+  { "oid-to-str",          setup_oid,       run_oid_to_str },
+  { "oid-from-str",        setup_oid,       run_oid_from_str },
+  { "crl-parse-1k",        setup_crl,       run_crl_parse, 1000 },
+  { "crl-parse-100k",      setup_crl,       run_crl_parse, 100000, BF_MACRO },
+  { "crl-parse-1m",        setup_crl,       run_crl_parse, 1000000,
+    BF_MACRO },
+  { "ocsp-parse",          setup_ocsp,      run_ocsp_parse },
+  { "cms-signed-build-1k", setup_signed,    run_signed_build, 1*KB },
+  { "cms-signed-parse-1k", setup_signed,    run_cms_parse,    1*KB },
+  { "cms-signed-build-1m", setup_signed,    run_signed_build, 1*MB },
+  { "cms-signed-parse-1m", setup_signed,    run_cms_parse,    1*MB },
+  { "cms-signed-build-64m", setup_signed,   run_signed_build, 64*MB, BF_MACRO },
+  { "cms-signed-parse-64m", setup_signed,   run_cms_parse,    64*MB, BF_MACRO },
+  { "cms-signed-build-1g", setup_signed,    run_signed_build, 1*GB,
+    BF_MACRO },
+  { "cms-signed-parse-1g", setup_signed,    run_cms_parse,    1*GB,
+    BF_MACRO },
+  { "cms-enveloped-build-1k", setup_enveloped, run_enveloped_build, 1*KB },
+  { "cms-enveloped-parse-1k", setup_enveloped, run_cms_parse,       1*KB },
+  { "cms-enveloped-build-1m", setup_enveloped, run_enveloped_build, 1*MB },
+  { "cms-enveloped-parse-1m", setup_enveloped, run_cms_parse,       1*MB },
+  { "cms-enveloped-build-64m", setup_enveloped, run_enveloped_build, 64*MB,
+    BF_MACRO },
+  { "cms-enveloped-parse-64m", setup_enveloped, run_cms_parse,       64*MB,
+    BF_MACRO },
+  { "cms-enveloped-build-1g", setup_enveloped, run_enveloped_build, 1*GB,
+    BF_MACRO },
+  { "cms-enveloped-parse-1g", setup_enveloped, run_cms_parse,       1*GB,
+    BF_MACRO },
+  { "cms-signed-parse-1000-certs", setup_synth_signed, run_synth_parse, 1000 },
+  { "cms-enveloped-parse-1000-recipients", setup_synth_enveloped,
+    run_synth_parse, 1000 },
+  { "der-builder-new",     setup_der,       run_der_new },
+  { "der-builder-reuse",   setup_der,       run_der_reuse },
+  { "der-builder-write",   setup_der,       run_der_write },
+  { NULL }
+};
+
+
+static void
+run_benchmark (int bidx)
+{
+  ctx_t ctx;
+  unsigned long long iterations = 0;
+  unsigned long long bytes = 0;
+  unsigned long count;
+  double start, elapsed;
+
+  ctx = benchmarks[bidx].setup (benchmarks[bidx].param);
+  if (!(benchmarks[bidx].flags & BF_MACRO))
+    benchmarks[bidx].run (ctx);
+
+  count = alloc_count;
+  start = timer_now ();
+  do
+    {
+      bytes += benchmarks[bidx].run (ctx);
+      iterations++;
+      elapsed = timer_now () - start;
+    }
+  while (elapsed < min_time);
+  count = alloc_count - count;
+
+  printf ("{\"bench\":\"%s\",\"iterations\":%llu,\"seconds\":%.6f,"
+          "\"bytes_per_op\":%.1f,\"ops_per_sec\":%.3f,"
+          "\"bytes_per_sec\":%.1f,\"allocs_per_op\":%.2f}\n",
+          benchmarks[bidx].name, iterations, elapsed,
+          (double)bytes / iterations, iterations / elapsed,
+          bytes / elapsed, (double)count / iterations);
+  fflush (stdout);
+  release_ctx (ctx);
+}
+
+
+/* Return true if the benchmark NAME is selected by the patterns in
+   ARGV.  A pattern selects all benchmarks starting with it.  */
+static int
+selected (const char *name, int argc, char **argv)
+{
+  if (!argc)
+    return 1;
+  for (; argc; argc--, argv++)
+    if (!strncmp (name, *argv, strlen (*argv)))
+      return 1;
+  return 0;
+}
+
+
+int
+main (int argc, char **argv)
+{
+  int last_argc = -1;
+  int list = 0;
+  int i;
+
+  if (argc)
+    {
+      argc--;  argv++;
+    }
+  while (argc && last_argc != argc )
+    {
+      last_argc = argc;
+      if (!strcmp (*argv, "--"))
+        {
+          argc--; argv++;
+          break;
+        }
+      else if (!strcmp (*argv, "--help"))
+        {
+          fputs ("usage: "PGM" [options] [NAMES]\n"
+                 "Options:\n"
+                 "  --samples DIR  directory with the samples\n"
+                 "  --time N       run each benchmark for N seconds\n"
+                 "  --seed N       seed for the synthetic objects\n"
+                 "  --list         list the benchmarks\n"
+                 "  --verbose      print diagnostics\n"
+                 "Only benchmarks starting with one of NAMES are run.\n",
+                 stdout);
+          exit (0);
+        }
+      else if (!strcmp (*argv, "--verbose"))
+        {
+          verbose = 1;
+          argc--; argv++;
+        }
+      else if (!strcmp (*argv, "--list"))
+        {
+          list = 1;
+          argc--; argv++;
+        }
+      else if (!strcmp (*argv, "--samples") && argc > 1)
+        {
+          samples_dir = argv[1];
+          argc -= 2; argv += 2;
+        }
+      else if (!strcmp (*argv, "--time") && argc > 1)
+        {
+          min_time = atof (argv[1]);
+          argc -= 2; argv += 2;
+        }
+      else if (!strcmp (*argv, "--seed") && argc > 1)
+        {
+          seed = strtoul (argv[1], NULL, 0);
+          argc -= 2; argv += 2;
+        }
+      else if (!strncmp (*argv, "--", 2))
+        {
+          fprintf (stderr, PGM": unknown option '%s'\n", *argv);
+          exit (1);
+        }
+    }
+
+  ksba_set_malloc_hooks (count_malloc, count_realloc, free);
+  ksba_set_hash_buffer_function (dummy_hash_buffer, NULL);
+
+  for (i=0; benchmarks[i].name; i++)
+    {
+      if (!selected (benchmarks[i].name, argc, argv))
+        continue;
+      if (list)
+        printf ("%s\n", benchmarks[i].name);
+      else
+        run_benchmark (i);
+    }
+
+  return 0;
+}
@@ -0,0 +1,202 @@
+/* ksba-gencorpus.c - Create synthetic objects for scale testing
+ * Copyright (C) 2026 g10 Code GmbH
+ *
+ * This file is part of KSBA.
+ *
+ * KSBA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KSBA is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* This tool writes large or deeply nested objects which are hard to
+   come by in the wild.  The output depends only on the arguments;
+   the same seed always yields the same object.  All signatures and
+   encrypted keys are random octets; thus the objects are only useful
+   to exercise the parsers.  */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "../src/ksba.h"
+#include "synth.h"
+
+#define PGM "ksba-gencorpus"
+
+static int verbose;
+
+
+static void
+usage (int status)
+{
+  fputs ("usage: "PGM" [options] KIND FILE\n"
+         "Write a synthetic object of type KIND to FILE.\n"
+         "KIND is one of:\n"
+         "  crl        CRL with COUNT revoked certificates\n"
+         "  cert       certificate with COUNT subjectAltNames\n"
+         "  signed     CMS signed data with COUNT certificates\n"
+         "  enveloped  CMS enveloped data for COUNT recipients\n"
+         "  nested     BER object nested COUNT levels deep\n"
+         "Options:\n"
+         "  --seed N        seed for the generator (default 1)\n"
+         "  --count N       see above (default 1000)\n"
+         "  --extensions N  additional certificate extensions\n"
+         "  --payload N     length of the CMS content (default 1024)\n"
+         "  --verbose       print the length of the object\n",
+         status? stderr : stdout);
+  exit (status);
+}
+
+
+int
+main (int argc, char **argv)
+{
+  gpg_error_t err;
+  int last_argc = -1;
+  unsigned long seed = 1;
+  unsigned long long count = 1000;
+  unsigned int nexts = 0;
+  size_t payloadlen = 1024;
+  unsigned long long length = 0;
+  const char *kind, *fname;
+  FILE *fp;
+  ksba_writer_t w;
+
+  if (argc)
+    {
+      argc--;  argv++;
+    }
+  while (argc && last_argc != argc )
+    {
+      last_argc = argc;
+      if (!strcmp (*argv, "--"))
+        {
+          argc--; argv++;
+          break;
+        }
+      else if (!strcmp (*argv, "--help"))
+        usage (0);
+      else if (!strcmp (*argv, "--verbose"))
+        {
+          verbose = 1;
+          argc--; argv++;
+        }
+      else if (!strcmp (*argv, "--seed") && argc > 1)
+        {
+          seed = strtoul (argv[1], NULL, 0);
+          argc -= 2; argv += 2;
+        }
+      else if (!strcmp (*argv, "--count") && argc > 1)
+        {
+          count = strtoull (argv[1], NULL, 0);
+          argc -= 2; argv += 2;
+        }
+      else if (!strcmp (*argv, "--extensions") && argc > 1)
+        {
+          nexts = strtoul (argv[1], NULL, 0);
+          argc -= 2; argv += 2;
+        }
+      else if (!strcmp (*argv, "--payload") && argc > 1)
+        {
+          payloadlen = strtoul (argv[1], NULL, 0);
+          argc -= 2; argv += 2;
+        }
+      else if (!strncmp (*argv, "--", 2))
+        {
+          fprintf (stderr, PGM": unknown option '%s'\n", *argv);
+          exit (1);
+        }
+    }
+  if (argc != 2)
+    usage (1);
+  kind = argv[0];
+  fname = argv[1];
+
+  if (strcmp (kind, "crl") && count > 0xffffffff)
+    {
+      fprintf (stderr, PGM": count too large for '%s'\n", kind);
+      exit (1);
+    }
+
+  fp = fopen (fname, "wb");
+  if (!fp)
+    {
+      fprintf (stderr, PGM": can't create '%s': %s\n",
+               fname, strerror (errno));
+      exit (1);
+    }
+  err = ksba_writer_new (&w);
+  if (!err)
+    err = ksba_writer_set_file (w, fp);
+  if (err)
+    {
+      fprintf (stderr, PGM": can't create writer: %s\n", gpg_strerror (err));
+      exit (1);
+    }
+
+  if (!strcmp (kind, "crl"))
+    {
+      unsigned char *issuer = NULL;
+      size_t issuerlen;
+
+      err = ksba_dn_str2der ("CN=Synthetic Test CA,O=Example,C=DE",
+                             &issuer, &issuerlen);
+      if (!err)
+        err = synth_crl (w, issuer, issuerlen, count, seed, &length);
+      ksba_free (issuer);
+    }
+  else if (!strcmp (kind, "cert"))
+    {
+      unsigned char *der;
+      size_t derlen;
+
+      err = synth_cert (count, nexts, seed, &der, &derlen);
+      if (!err)
+        err = ksba_writer_write (w, der, derlen);
+      length = derlen;
+      ksba_free (der);
+    }
+  else if (!strcmp (kind, "signed"))
+    err = synth_cms_signed (w, count, payloadlen, seed, &length);
+  else if (!strcmp (kind, "enveloped"))
+    err = synth_cms_enveloped (w, count, payloadlen, seed, &length);
+  else if (!strcmp (kind, "nested"))
+    err = synth_nested_ber (w, count, seed, &length);
+  else
+    {
+      fprintf (stderr, PGM": unknown kind '%s'\n", kind);
+      usage (1);
+    }
+
+  ksba_writer_release (w);
+  if (err)
+    {
+      fprintf (stderr, PGM": creating %s failed: %s\n",
+               kind, gpg_strerror (err));
+      fclose (fp);
+      exit (1);
+    }
+  if (fclose (fp))
+    {
+      fprintf (stderr, PGM": error writing '%s': %s\n",
+               fname, strerror (errno));
+      exit (1);
+    }
+  if (verbose)
+    fprintf (stderr, PGM": wrote %llu octets to '%s'\n", length, fname);
+
+  return 0;
+}
@@ -0,0 +1,1031 @@
+/* synth.c - Create synthetic objects for benchmarks
+ * Copyright (C) 2026 g10 Code GmbH
+ *
+ * This file is part of KSBA.
+ *
+ * KSBA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KSBA is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* The objects created here are syntactically valid but carry dummy
+   signatures.  All of them are built with the DER builder and are
+   fully determined by the seed.  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "synth.h"
+
+static const char oid_sha256_rsa[] = "1.2.840.113549.1.1.11";
+static const char oid_crl_reason[] = "2.5.29.21";
+static const char oid_crl_number[] = "2.5.29.20";
+static const char oid_ocsp_basic[] = "1.3.6.1.5.5.7.48.1.1";
+static const char oid_rsa[]        = "1.2.840.113549.1.1.1";
+static const char oid_sha256[]     = "2.16.840.1.101.3.4.2.1";
+static const char oid_aes128_cbc[] = "2.16.840.1.101.3.4.1.2";
+static const char oid_cms_data[]   = "1.2.840.113549.1.7.1";
+static const char oid_cms_signed[] = "1.2.840.113549.1.7.2";
+static const char oid_cms_enveloped[] = "1.2.840.113549.1.7.3";
+static const char oid_content_type[]  = "1.2.840.113549.1.9.3";
+static const char oid_message_digest[] = "1.2.840.113549.1.9.4";
+static const char oid_signing_time[]  = "1.2.840.113549.1.9.5";
+
+/* The DN of the issuer of all synthetic certificates.  */
+static const char synth_issuer[] = "CN=Synthetic Test CA,O=Example,C=DE";
+
+/* All generated times are relative to 2026-01-01.  */
+#define BASE_TIME 1767225600ULL
+
+
+
+void
+synth_rng_init (synth_rng_t *rng, unsigned long seed)
+{
+  /* Spread the seed so that small seeds give unrelated sequences and
+     make sure that the state is never zero.  */
+  rng->state = (seed + 1) * 0x9e3779b97f4a7c15ULL;
+  synth_rng_next (rng);
+}
+
+
+/* This is xorshift64* which is good enough for test data.  */
+unsigned int
+synth_rng_next (synth_rng_t *rng)
+{
+  unsigned long long x = rng->state;
+
+  x ^= x >> 12;
+  x ^= x << 25;
+  x ^= x >> 27;
+  rng->state = x;
+  return (unsigned int)((x * 0x2545f4914f6cdd1dULL) >> 32);
+}
+
+
+void
+synth_rng_fill (synth_rng_t *rng, void *buffer, size_t length)
+{
+  unsigned char *p = buffer;
+  unsigned int v;
+
+  for (; length >= 4; length -= 4, p += 4)
+    {
+      v = synth_rng_next (rng);
+      p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+    }
+  if (length)
+    {
+      v = synth_rng_next (rng);
+      for (; length; length--, v >>= 8)
+        *p++ = v;
+    }
+}
+
+
+
+size_t
+synth_encode_tl (unsigned char *buffer, int cls, int tag,
+                 int constructed, unsigned long long length)
+{
+  unsigned char *p = buffer;
+  int n;
+
+  /* We only need low tag numbers.  */
+  *p++ = ((cls & 3) << 6) | (constructed? 0x20 : 0) | (tag & 0x1f);
+  if (length == SYNTH_NDEF)
+    *p++ = 0x80;
+  else if (length < 128)
+    *p++ = length;
+  else
+    {
+      for (n=1; n < 8 && (length >> (8*n)); n++)
+        ;
+      *p++ = 0x80 | n;
+      while (n--)
+        *p++ = length >> (8*n);
+    }
+  return p - buffer;
+}
+
+
+gpg_error_t
+synth_write_tl (ksba_writer_t w, int cls, int tag, int constructed,
+                unsigned long long length)
+{
+  unsigned char hdr[10];
+
+  return ksba_writer_write (w, hdr, synth_encode_tl (hdr, cls, tag,
+                                                     constructed, length));
+}
+
+
+/* Return the length of a header for an object of LENGTH.  */
+static size_t
+tl_length (unsigned long long length)
+{
+  unsigned char hdr[10];
+
+  return synth_encode_tl (hdr, 0, KSBA_TYPE_SEQUENCE, 1, length);
+}
+
+
+/* Parse the header at *BUFFER and advance *BUFFER and *LENGTH to the
+   content.  Only the definite length form is supported.  */
+static gpg_error_t
+parse_tl (const unsigned char **buffer, size_t *length,
+          int *r_tag, int *r_cls, size_t *r_len)
+{
+  const unsigned char *p = *buffer;
+  size_t n = *length;
+  size_t len;
+  int c;
+
+  if (n < 2)
+    return gpg_error (GPG_ERR_BAD_BER);
+  *r_cls = (p[0] >> 6) & 3;
+  *r_tag = p[0] & 0x1f;
+  if (*r_tag == 0x1f)
+    return gpg_error (GPG_ERR_NOT_IMPLEMENTED);
+  c = p[1];
+  p += 2;
+  n -= 2;
+  if (c == 0x80)
+    return gpg_error (GPG_ERR_NOT_DER_ENCODED);
+  if (c & 0x80)
+    {
+      c &= 0x7f;
+      if (c > sizeof len || c > n)
+        return gpg_error (GPG_ERR_BAD_BER);
+      for (len=0; c; c--, n--)
+        len = (len << 8) | *p++;
+    }
+  else
+    len = c;
+  if (len > n)
+    return gpg_error (GPG_ERR_BAD_BER);
+  *buffer = p;
+  *length = n;
+  *r_len = len;
+  return 0;
+}
+
+
+const unsigned char *
+synth_content (const unsigned char *der, size_t derlen, size_t *r_length)
+{
+  int tag, cls;
+
+  if (parse_tl (&der, &derlen, &tag, &cls, r_length))
+    return NULL;
+  return der;
+}
+
+
+size_t
+synth_asntime (char *buffer, unsigned long long seconds, int generalized)
+{
+  time_t t = seconds;
+  struct tm *tp;
+
+  tp = gmtime (&t);
+  if (!tp)
+    return 0;
+  if (generalized)
+    return strftime (buffer, 16, "%Y%m%d%H%M%SZ", tp);
+  return strftime (buffer, 16, "%y%m%d%H%M%SZ", tp);
+}
+
+
+/* Add a time to D.  OCSP uses GeneralizedTime, the others use
+   UTCTime.  */
+static void
+add_time (ksba_der_t d, unsigned long long seconds, int generalized)
+{
+  char buf[16];
+  size_t n;
+
+  n = synth_asntime (buf, seconds, generalized);
+  ksba_der_add_val (d, 0, generalized? KSBA_TYPE_GENERALIZED_TIME
+                                      : KSBA_TYPE_UTC_TIME, buf, n);
+}
+
+
+static void
+add_algo (ksba_der_t d, const char *oid)
+{
+  ksba_der_add_tag (d, 0, KSBA_TYPE_SEQUENCE);
+  ksba_der_add_oid (d, oid);
+  ksba_der_add_ptr (d, 0, KSBA_TYPE_NULL, NULL, 0);
+  ksba_der_add_end (d);
+}
+
+
+/* Add a dummy RSA signature to D.  */
+static void
+add_signature (ksba_der_t d, synth_rng_t *rng)
+{
+  unsigned char sig[256];
+
+  synth_rng_fill (rng, sig, sizeof sig);
+  ksba_der_add_bts (d, sig, sizeof sig, 0);
+}
+
+
+
+/* Build the revoked certificate entry number IDX into D.  The entry
+   only depends on the state of RNG.  */
+static void
+build_crl_entry (ksba_der_t d, synth_rng_t *rng, unsigned long long idx)
+{
+  unsigned char serial[16];
+  unsigned char reason;
+
+  synth_rng_fill (rng, serial, sizeof serial);
+  serial[0] &= 0x7f;
+  serial[0] |= 0x01;
+  reason = synth_rng_next (rng) % 11;
+  if (reason == 7)
+    reason = 0;  /* Value 7 is not used.  */
+
+  ksba_der_builder_reset (d);
+  ksba_der_add_tag (d, 0, KSBA_TYPE_SEQUENCE);
+  ksba_der_add_int (d, serial, sizeof serial, 1);
+  add_time (d, BASE_TIME - 86400 * 365 + idx % (86400 * 365), 0);
+  if ((idx & 3) == 1)
+    {
+      ksba_der_add_tag (d, 0, KSBA_TYPE_SEQUENCE);
+      ksba_der_add_tag (d, 0, KSBA_TYPE_SEQUENCE);
+      ksba_der_add_oid (d, oid_crl_reason);
+      ksba_der_add_tag (d, KSBA_CLASS_ENCAPSULATE, KSBA_TYPE_OCTET_STRING);
+      ksba_der_add_val (d, 0, KSBA_TYPE_ENUMERATED, &reason, 1);
+      ksba_der_add_end (d);
+      ksba_der_add_end (d);
+      ksba_der_add_end (d);
+    }
+  ksba_der_add_end (d);
+}
+
+
+/* Build an object and store its content (i.e. without the outermost
+   header) at R_BUFFER.  The returned pointer points into the buffer
+   stored at R_FREE which needs to be released by the caller.  */
+static gpg_error_t
+get_content (ksba_der_t d, unsigned char **r_free,
+             const unsigned char **r_buffer, size_t *r_length)
+{
+  gpg_error_t err;
+  size_t len;
+
+  err = ksba_der_builder_get (d, r_free, &len);
+  if (err)
+    return err;
+  *r_buffer = synth_content (*r_free, len, r_length);
+  if (!*r_buffer)
+    {
+      ksba_free (*r_free);
+      *r_free = NULL;
+      return gpg_error (GPG_ERR_BUG);
+    }
+  return 0;
+}
+
+
+gpg_error_t
+synth_crl (ksba_writer_t w, const unsigned char *issuer, size_t issuerlen,
+           unsigned long long nentries, unsigned long seed,
+           unsigned long long *r_length)
+{
+  gpg_error_t err;
+  ksba_der_t d;
+  synth_rng_t rng, entryrng;
+  unsigned char *headbuf = NULL;
+  unsigned char *sigbuf = NULL;
+  unsigned char *tail = NULL;
+  const unsigned char *head, *sig;
+  size_t headlen, siglen, taillen, len;
+  unsigned long long idx, entrieslen, tbslen, total;
+  const ksba_iov_t *iov;
+  size_t niov;
+  unsigned char crlno[4];
+
+  d = ksba_der_builder_new (0);
+  if (!d)
+    return gpg_error_from_syserror ();
+  synth_rng_init (&rng, seed);
+
+  /* The fixed part of the tbsCertList.  */
+  ksba_der_add_tag (d, 0, KSBA_TYPE_SEQUENCE);
+  ksba_der_add_int (d, "\x01", 1, 0);
+  add_algo (d, oid_sha256_rsa);
+  ksba_der_add_der (d, issuer, issuerlen);
+  add_time (d, BASE_TIME, 0);
+  add_time (d, BASE_TIME + 7*86400, 0);
+  ksba_der_add_end (d);
+  err = get_content (d, &headbuf, &head, &headlen);
+  if (err)
+    goto leave;
+
+  /* The crlExtensions with a CRL number.  */
+  synth_rng_fill (&rng, crlno, sizeof crlno);
+  ksba_der_builder_reset (d);
+  ksba_der_add_tag (d, KSBA_CLASS_CONTEXT, 0);
+  ksba_der_add_tag (d, 0, KSBA_TYPE_SEQUENCE);
+  ksba_der_add_tag (d, 0, KSBA_TYPE_SEQUENCE);
+  ksba_der_add_oid (d, oid_crl_number);
+  ksba_der_add_tag (d, KSBA_CLASS_ENCAPSULATE, KSBA_TYPE_OCTET_STRING);
+  ksba_der_add_int (d, crlno, sizeof crlno, 1);
+  ksba_der_add_end (d);
+  ksba_der_add_end (d);
+  ksba_der_add_end (d);
+  ksba_der_add_end (d);
+  err = ksba_der_builder_get (d, &tail, &taillen);
+  if (err)
+    goto leave;
+
+  /* The signatureAlgorithm and the signature.  */
+  ksba_der_builder_reset (d);
+  ksba_der_add_tag (d, 0, KSBA_TYPE_SEQUENCE);
+  add_algo (d, oid_sha256_rsa);
+  add_signature (d, &rng);
+  ksba_der_add_end (d);
+  err = get_content (d, &sigbuf, &sig, &siglen);
+  if (err)
+    goto leave;
+
+  /* To write the headers we need the length of all entries.  Thus we
+     build them twice with the same seed.  */
+  entryrng = rng;
+  entrieslen = 0;
+  for (idx=0; idx < nentries; idx++)
+    {
+      build_crl_entry (d, &entryrng, idx);
+      err = ksba_der_builder_get_iov (d, &iov, &niov);
+      if (err)
+        goto leave;
+      for (; niov; niov--, iov++)
+        entrieslen += iov->len;
+    }
+
+  tbslen = headlen + taillen;
+  if (nentries)
+    tbslen += tl_length (entrieslen) + entrieslen;
+  total = tl_length (tbslen) + tbslen + siglen;
+
+  err = synth_write_tl (w, 0, KSBA_TYPE_SEQUENCE, 1, total);
+  if (!err)
+    err = synth_write_tl (w, 0, KSBA_TYPE_SEQUENCE, 1, tbslen);
+  if (!err)
+    err = ksba_writer_write (w, head, headlen);
+  if (!err && nentries)
+    err = synth_write_tl (w, 0, KSBA_TYPE_SEQUENCE, 1, entrieslen);
+  entryrng = rng;
+  for (idx=0; !err && idx < nentries; idx++)
+    {
+      build_crl_entry (d, &entryrng, idx);
+      err = ksba_der_builder_write (d, w, &len);
+    }
+  if (!err)
+    err = ksba_writer_write (w, tail, taillen);
+  if (!err)
+    err = ksba_writer_write (w, sig, siglen);
+  if (!err && r_length)
+    *r_length = tl_length (total) + total;
+
+ leave:
+  ksba_free (headbuf);
+  ksba_free (tail);
+  ksba_free (sigbuf);
+  ksba_der_release (d);
+  return err;
+}
+
+
+
+/* Store the CertIDs of all requests in the OCSP request REQUEST as
+   verbatim objects in D.  */
+static gpg_error_t
+add_certids (ksba_der_t d, const unsigned char *request, size_t requestlen)
+{
+  gpg_error_t err;
+  const unsigned char *p = request;
+  size_t n = requestlen;
+  size_t len, reqlen;
+  int tag, cls;
+
+  /* OCSPRequest and tbsRequest.  */
+  err = parse_tl (&p, &n, &tag, &cls, &len);
+  if (!err)
+    err = parse_tl (&p, &n, &tag, &cls, &len);
+  if (err)
+    return err;
+  n = len;
+  /* Skip the optional version and requestorName.  */
+  for (;;)
+    {
+      err = parse_tl (&p, &n, &tag, &cls, &len);
+      if (err)
+        return err;
+      if (cls == KSBA_CLASS_UNIVERSAL)
+        break;
+      p += len;
+      n -= len;
+    }
+  if (tag != KSBA_TYPE_SEQUENCE)
+    return gpg_error (GPG_ERR_INV_OBJ);
+
+  /* Walk over the requestList.  */
+  n = len;
+  while (n)
+    {
+      err = parse_tl (&p, &n, &tag, &cls, &reqlen);
+      if (err)
+        return err;
+      /* The first element of the Request is the CertID.  */
+      {
+        const unsigned char *certid = p;
+        size_t certidlen;
+        size_t nn = reqlen;
+
+        err = parse_tl (&p, &nn, &tag, &cls, &len);
+        if (err)
+          return err;
+        certidlen = (p - certid) + len;
+        p = certid;
+        ksba_der_add_tag (d, 0, KSBA_TYPE_SEQUENCE);
+        ksba_der_add_der (d, certid, certidlen);
+        /* The builder encodes empty values with an indefinite
+           length; thus we add the good status verbatim.  */
+        ksba_der_add_der (d, "\x80\x00", 2);
+        add_time (d, BASE_TIME, 1);
+        ksba_der_add_tag (d, KSBA_CLASS_CONTEXT, 0);
+        add_time (d, BASE_TIME + 86400, 1);
+        ksba_der_add_end (d);
+        ksba_der_add_end (d);
+      }
+      p += reqlen;
+      n -= reqlen;
+    }
+  return 0;
+}
+
+
+gpg_error_t
+synth_ocsp_response (const unsigned char *request, size_t requestlen,
+                     ksba_cert_t responder, unsigned long seed,
+                     unsigned char **r_der, size_t *r_derlen)
+{
+  gpg_error_t err;
+  ksba_der_t d;
+  synth_rng_t rng;
+  char *subject;
+  unsigned char *name = NULL;
+  size_t namelen;
+  const unsigned char *image;
+  size_t imagelen;
+
+  *r_der = NULL;
+  *r_derlen = 0;
+
+  subject = ksba_cert_get_subject (responder, 0);
+  if (!subject)
+    return gpg_error (GPG_ERR_INV_CERT_OBJ);
+  err = ksba_dn_str2der (subject, &name, &namelen);
+  ksba_free (subject);
+  if (err)
+    return err;
+  image = ksba_cert_get_image (responder, &imagelen);
+  if (!image)
+    {
+      ksba_free (name);
+      return gpg_error (GPG_ERR_INV_CERT_OBJ);
+    }
+
+  d = ksba_der_builder_new (0);
+  if (!d)
+    {
+      err = gpg_error_from_syserror ();
+      ksba_free (name);
+      return err;
+    }
+  synth_rng_init (&rng, seed);
+
+  ksba_der_add_tag (d, 0, KSBA_TYPE_SEQUENCE);  /* OCSPResponse */
+  ksba_der_add_val (d, 0, KSBA_TYPE_ENUMERATED, "", 1);  /* successful */
+  ksba_der_add_tag (d, KSBA_CLASS_CONTEXT, 0);
+  ksba_der_add_tag (d, 0, KSBA_TYPE_SEQUENCE);  /* ResponseBytes */
+  ksba_der_add_oid (d, oid_ocsp_basic);
+  ksba_der_add_tag (d, KSBA_CLASS_ENCAPSULATE, KSBA_TYPE_OCTET_STRING);
+  ksba_der_add_tag (d, 0, KSBA_TYPE_SEQUENCE);  /* BasicOCSPResponse */
+  ksba_der_add_tag (d, 0, KSBA_TYPE_SEQUENCE);  /* ResponseData */
+  ksba_der_add_tag (d, KSBA_CLASS_CONTEXT, 1);  /* byName */
+  ksba_der_add_der (d, name, namelen);
+  ksba_der_add_end (d);
+  add_time (d, BASE_TIME, 1);  /* producedAt */
+  ksba_der_add_tag (d, 0, KSBA_TYPE_SEQUENCE);  /* responses */
+  err = add_certids (d, request, requestlen);
+  if (err)
+    goto leave;
+  ksba_der_add_end (d);
+  ksba_der_add_end (d);
+  add_algo (d, oid_sha256_rsa);
+  add_signature (d, &rng);
+  ksba_der_add_tag (d, KSBA_CLASS_CONTEXT, 0);
+  ksba_der_add_tag (d, 0, KSBA_TYPE_SEQUENCE);
+  ksba_der_add_der (d, image, imagelen);
+  ksba_der_add_end (d);
+  ksba_der_add_end (d);
+  ksba_der_add_end (d);
+  ksba_der_add_end (d);
+  ksba_der_add_end (d);
+  ksba_der_add_end (d);
+  ksba_der_add_end (d);
+
+  err = ksba_der_builder_get (d, r_der, r_derlen);
+
+ leave:
+  ksba_der_release (d);
+  ksba_free (name);
+  return err;
+}
+
+
+
+/* Add the DER encoded DN STRING to D.  */
+static gpg_error_t
+add_dn (ksba_der_t d, const char *string)
+{
+  gpg_error_t err;
+  unsigned char *der;
+  size_t derlen;
+
+  err = ksba_dn_str2der (string, &der, &derlen);
+  if (err)
+    return err;
+  ksba_der_add_der (d, der, derlen);
+  ksba_free (der);
+  return 0;
+}
+
+
+/* Add an extension with OID to D.  The value is added by the caller
+   which must also close the extension with two add_end calls.  */
+static void
+begin_extension (ksba_der_t d, const char *oid, int critical)
+{
+  ksba_der_add_tag (d, 0, KSBA_TYPE_SEQUENCE);
+  ksba_der_add_oid (d, oid);
+  if (critical)
+    ksba_der_add_val (d, 0, KSBA_TYPE_BOOLEAN, "\xff", 1);
+  ksba_der_add_tag (d, KSBA_CLASS_ENCAPSULATE, KSBA_TYPE_OCTET_STRING);
+}
+
+
+/* Add a subjectAltName with NSANS names to D.  Most of them are DNS
+   names but all common types are used.  */
+static void
+add_alt_names (ksba_der_t d, synth_rng_t *rng, unsigned int nsans)
+{
+  char buf[80];
+  unsigned char ip[16];
+  unsigned int i, r;
+
+  begin_extension (d, "2.5.29.17", 0);
+  ksba_der_add_tag (d, 0, KSBA_TYPE_SEQUENCE);
+  for (i=0; i < nsans; i++)
+    {
+      r = synth_rng_next (rng);
+      if (!(i % 11))
+        {
+          snprintf (buf, sizeof buf, "https://www%u.example.org/%08x", i, r);
+          ksba_der_add_val (d, KSBA_CLASS_CONTEXT, KSBA_GN_URI,
+                            buf, strlen (buf));
+        }
+      else if (!(i % 7))
+        {
+          synth_rng_fill (rng, ip, sizeof ip);
+          ksba_der_add_val (d, KSBA_CLASS_CONTEXT, KSBA_GN_IP_ADDRESS,
+                            ip, (r & 1)? 16 : 4);
+        }
+      else if (!(i % 5))
+        {
+          snprintf (buf, sizeof buf, "user%u.%04x@example.org", i, r & 0xffff);
+          ksba_der_add_val (d, KSBA_CLASS_CONTEXT, KSBA_GN_RFC822_NAME,
+                            buf, strlen (buf));
+        }
+      else
+        {
+          snprintf (buf, sizeof buf, "%shost%u-%06x.example.org",
+                    (r & 0x80000000)? "*.":"", i, r & 0xffffff);
+          ksba_der_add_val (d, KSBA_CLASS_CONTEXT, KSBA_GN_DNS_NAME,
+                            buf, strlen (buf));
+        }
+    }
+  ksba_der_add_end (d);
+  ksba_der_add_end (d);
+  ksba_der_add_end (d);
+}
+
+
+/* Build the certificate number IDX.  All certificates are issued by
+   the same CA.  The serial number is stored at SERIAL.  */
+static gpg_error_t
+build_cert (ksba_der_t d, synth_rng_t *rng, unsigned int idx,
+            unsigned int nsans, unsigned int nexts, unsigned char *serial)
+{
+  gpg_error_t err;
+  unsigned char modulus[257];
+  unsigned char keyid[20];
+  char buf[80];
+  unsigned int i;
+
+  synth_rng_fill (rng, serial, 16);
+  serial[0] &= 0x7f;
+  serial[0] |= 0x01;
+  synth_rng_fill (rng, modulus, sizeof modulus);
+  modulus[0] = 0;
+  modulus[1] |= 0x80;
+  modulus[256] |= 0x01;
+  synth_rng_fill (rng, keyid, sizeof keyid);
+
+  ksba_der_add_tag (d, 0, KSBA_TYPE_SEQUENCE);
+  ksba_der_add_tag (d, 0, KSBA_TYPE_SEQUENCE);  /* tbsCertificate */
+  ksba_der_add_tag (d, KSBA_CLASS_CONTEXT, 0);
+  ksba_der_add_int (d, "\x02", 1, 0);
+  ksba_der_add_end (d);
+  ksba_der_add_int (d, serial, 16, 1);
+  add_algo (d, oid_sha256_rsa);
+  err = add_dn (d, synth_issuer);
+  if (err)
+    return err;
+  ksba_der_add_tag (d, 0, KSBA_TYPE_SEQUENCE);
+  add_time (d, BASE_TIME - 86400 * (idx % 365), 0);
+  add_time (d, BASE_TIME + 86400 * 365 * 2, 0);
+  ksba_der_add_end (d);
+  snprintf (buf, sizeof buf, "CN=Synthetic Test %u,O=Example,C=DE", idx);
+  err = add_dn (d, buf);
+  if (err)
+    return err;
+
+  ksba_der_add_tag (d, 0, KSBA_TYPE_SEQUENCE);  /* subjectPublicKeyInfo */
+  add_algo (d, oid_rsa);
+  ksba_der_add_tag (d, KSBA_CLASS_ENCAPSULATE, KSBA_TYPE_BIT_STRING);
+  ksba_der_add_tag (d, 0, KSBA_TYPE_SEQUENCE);
+  ksba_der_add_int (d, modulus, sizeof modulus, 0);
+  ksba_der_add_int (d, "\x01\x00\x01", 3, 0);
+  ksba_der_add_end (d);
+  ksba_der_add_end (d);
+  ksba_der_add_end (d);
+
+  ksba_der_add_tag (d, KSBA_CLASS_CONTEXT, 3);
+  ksba_der_add_tag (d, 0, KSBA_TYPE_SEQUENCE);
+  begin_extension (d, "2.5.29.15", 1);  /* keyUsage */
+  ksba_der_add_bts (d, "\xa0", 1, 5);
+  ksba_der_add_end (d);
+  ksba_der_add_end (d);
+  begin_extension (d, "2.5.29.14", 0);  /* subjectKeyIdentifier */
+  ksba_der_add_val (d, 0, KSBA_TYPE_OCTET_STRING, keyid, sizeof keyid);
+  ksba_der_add_end (d);
+  ksba_der_add_end (d);
+  if (nsans)
+    add_alt_names (d, rng, nsans);
+  for (i=0; i < nexts; i++)
+    {
+      /* Private extensions below the g10 Code test arc.  */
+      snprintf (buf, sizeof buf, "1.3.6.1.4.1.11591.2.99.%u", i);
+      begin_extension (d, buf, 0);
+      snprintf (buf, sizeof buf, "synthetic extension %u", i);
+      ksba_der_add_val (d, 0, KSBA_TYPE_UTF8_STRING, buf, strlen (buf));
+      ksba_der_add_end (d);
+      ksba_der_add_end (d);
+    }
+  ksba_der_add_end (d);
+  ksba_der_add_end (d);
+  ksba_der_add_end (d);  /* End tbsCertificate.  */
+
+  add_algo (d, oid_sha256_rsa);
+  add_signature (d, rng);
+  ksba_der_add_end (d);
+  return 0;
+}
+
+
+gpg_error_t
+synth_cert (unsigned int nsans, unsigned int nexts, unsigned long seed,
+            unsigned char **r_der, size_t *r_derlen)
+{
+  gpg_error_t err;
+  ksba_der_t d;
+  synth_rng_t rng;
+  unsigned char serial[16];
+
+  *r_der = NULL;
+  *r_derlen = 0;
+  d = ksba_der_builder_new (0);
+  if (!d)
+    return gpg_error_from_syserror ();
+  synth_rng_init (&rng, seed);
+  err = build_cert (d, &rng, 0, nsans, nexts, serial);
+  if (!err)
+    err = ksba_der_builder_get (d, r_der, r_derlen);
+  ksba_der_release (d);
+  return err;
+}
+
+
+
+/* Add an IssuerAndSerialNumber for a certificate of our CA to D.  */
+static gpg_error_t
+add_issuer_serial (ksba_der_t d, const unsigned char *serial)
+{
+  gpg_error_t err;
+
+  ksba_der_add_tag (d, 0, KSBA_TYPE_SEQUENCE);
+  err = add_dn (d, synth_issuer);
+  ksba_der_add_int (d, serial, 16, 1);
+  ksba_der_add_end (d);
+  return err;
+}
+
+
+/* Write the DER object from D to W and add its length to
+   *R_LENGTH.  */
+static gpg_error_t
+write_object (ksba_der_t d, ksba_writer_t w, unsigned long long *r_length)
+{
+  gpg_error_t err;
+  size_t len;
+
+  err = ksba_der_builder_write (d, w, &len);
+  if (!err && r_length)
+    *r_length = len;
+  return err;
+}
+
+
+gpg_error_t
+synth_cms_signed (ksba_writer_t w, unsigned int ncerts, size_t payloadlen,
+                  unsigned long seed, unsigned long long *r_length)
+{
+  gpg_error_t err = 0;
+  ksba_der_t d, dcert;
+  synth_rng_t rng;
+  unsigned char *payload = NULL;
+  unsigned char *cert;
+  size_t certlen;
+  unsigned char serial[16], firstserial[16];
+  unsigned char digest[32];
+  unsigned int i;
+
+  if (!ncerts)
+    return gpg_error (GPG_ERR_INV_VALUE);
+  d = ksba_der_builder_new (0);
+  dcert = ksba_der_builder_new (0);
+  if (payloadlen)
+    payload = malloc (payloadlen);
+  if (!d || !dcert || (payloadlen && !payload))
+    {
+      err = gpg_error_from_syserror ();
+      goto leave;
+    }
+  synth_rng_init (&rng, seed);
+  if (payloadlen)
+    synth_rng_fill (&rng, payload, payloadlen);
+  synth_rng_fill (&rng, digest, sizeof digest);
+
+  ksba_der_add_tag (d, 0, KSBA_TYPE_SEQUENCE);  /* ContentInfo */
+  ksba_der_add_oid (d, oid_cms_signed);
+  ksba_der_add_tag (d, KSBA_CLASS_CONTEXT, 0);
+  ksba_der_add_tag (d, 0, KSBA_TYPE_SEQUENCE);  /* SignedData */
+  ksba_der_add_int (d, "\x01", 1, 0);
+  ksba_der_add_tag (d, 0, KSBA_TYPE_SET);
+  add_algo (d, oid_sha256);
+  ksba_der_add_end (d);
+  ksba_der_add_tag (d, 0, KSBA_TYPE_SEQUENCE);  /* encapContentInfo */
+  ksba_der_add_oid (d, oid_cms_data);
+  if (payloadlen)
+    {
+      ksba_der_add_tag (d, KSBA_CLASS_CONTEXT, 0);
+      ksba_der_add_ptr (d, 0, KSBA_TYPE_OCTET_STRING, payload, payloadlen);
+      ksba_der_add_end (d);
+    }
+  ksba_der_add_end (d);
+  /* Note that the certificates are not sorted as required for a DER
+     encoded SET OF; BER parsers don't care.  */
+  ksba_der_add_tag (d, KSBA_CLASS_CONTEXT, 0);
+  for (i=0; i < ncerts; i++)
+    {
+      ksba_der_builder_reset (dcert);
+      err = build_cert (dcert, &rng, i, 2, 0, i? serial : firstserial);
+      if (!err)
+        err = ksba_der_builder_get (dcert, &cert, &certlen);
+      if (err)
+        goto leave;
+      ksba_der_add_der (d, cert, certlen);
+      ksba_free (cert);
+    }
+  ksba_der_add_end (d);
+
+  ksba_der_add_tag (d, 0, KSBA_TYPE_SET);       /* signerInfos */
+  ksba_der_add_tag (d, 0, KSBA_TYPE_SEQUENCE);
+  ksba_der_add_int (d, "\x01", 1, 0);
+  err = add_issuer_serial (d, firstserial);
+  if (err)
+    goto leave;
+  add_algo (d, oid_sha256);
+  ksba_der_add_tag (d, KSBA_CLASS_CONTEXT, 0);  /* signedAttrs */
+  ksba_der_add_tag (d, 0, KSBA_TYPE_SEQUENCE);
+  ksba_der_add_oid (d, oid_content_type);
+  ksba_der_add_tag (d, 0, KSBA_TYPE_SET);
+  ksba_der_add_oid (d, oid_cms_data);
+  ksba_der_add_end (d);
+  ksba_der_add_end (d);
+  ksba_der_add_tag (d, 0, KSBA_TYPE_SEQUENCE);
+  ksba_der_add_oid (d, oid_signing_time);
+  ksba_der_add_tag (d, 0, KSBA_TYPE_SET);
+  add_time (d, BASE_TIME, 0);
+  ksba_der_add_end (d);
+  ksba_der_add_end (d);
+  ksba_der_add_tag (d, 0, KSBA_TYPE_SEQUENCE);
+  ksba_der_add_oid (d, oid_message_digest);
+  ksba_der_add_tag (d, 0, KSBA_TYPE_SET);
+  ksba_der_add_val (d, 0, KSBA_TYPE_OCTET_STRING, digest, sizeof digest);
+  ksba_der_add_end (d);
+  ksba_der_add_end (d);
+  ksba_der_add_end (d);
+  add_algo (d, oid_rsa);
+  {
+    unsigned char sig[256];
+
+    synth_rng_fill (&rng, sig, sizeof sig);
+    ksba_der_add_val (d, 0, KSBA_TYPE_OCTET_STRING, sig, sizeof sig);
+  }
+  ksba_der_add_end (d);
+  ksba_der_add_end (d);
+  ksba_der_add_end (d);
+  ksba_der_add_end (d);
+  ksba_der_add_end (d);
+
+  err = write_object (d, w, r_length);
+
+ leave:
+  free (payload);
+  ksba_der_release (dcert);
+  ksba_der_release (d);
+  return err;
+}
+
+
+gpg_error_t
+synth_cms_enveloped (ksba_writer_t w, unsigned int nrecipients,
+                     size_t payloadlen, unsigned long seed,
+                     unsigned long long *r_length)
+{
+  gpg_error_t err = 0;
+  ksba_der_t d;
+  synth_rng_t rng;
+  unsigned char *payload = NULL;
+  unsigned char serial[16], iv[16], key[256];
+  unsigned int i;
+
+  /* An empty encryptedContent would be encoded with an indefinite
+     length by the builder.  */
+  if (!nrecipients || !payloadlen)
+    return gpg_error (GPG_ERR_INV_VALUE);
+  d = ksba_der_builder_new (0);
+  payload = malloc (payloadlen);
+  if (!d || !payload)
+    {
+      err = gpg_error_from_syserror ();
+      goto leave;
+    }
+  synth_rng_init (&rng, seed);
+
+  ksba_der_add_tag (d, 0, KSBA_TYPE_SEQUENCE);  /* ContentInfo */
+  ksba_der_add_oid (d, oid_cms_enveloped);
+  ksba_der_add_tag (d, KSBA_CLASS_CONTEXT, 0);
+  ksba_der_add_tag (d, 0, KSBA_TYPE_SEQUENCE);  /* EnvelopedData */
+  ksba_der_add_int (d, "", 1, 0);
+  ksba_der_add_tag (d, 0, KSBA_TYPE_SET);       /* recipientInfos */
+  for (i=0; i < nrecipients; i++)
+    {
+      synth_rng_fill (&rng, serial, sizeof serial);
+      synth_rng_fill (&rng, key, sizeof key);
+      serial[0] &= 0x7f;
+      serial[0] |= 0x01;
+      ksba_der_add_tag (d, 0, KSBA_TYPE_SEQUENCE);
+      ksba_der_add_int (d, "", 1, 0);
+      err = add_issuer_serial (d, serial);
+      if (err)
+        goto leave;
+      add_algo (d, oid_rsa);
+      ksba_der_add_val (d, 0, KSBA_TYPE_OCTET_STRING, key, sizeof key);
+      ksba_der_add_end (d);
+    }
+  ksba_der_add_end (d);
+  synth_rng_fill (&rng, iv, sizeof iv);
+  synth_rng_fill (&rng, payload, payloadlen);
+  ksba_der_add_tag (d, 0, KSBA_TYPE_SEQUENCE);  /* encryptedContentInfo */
+  ksba_der_add_oid (d, oid_cms_data);
+  ksba_der_add_tag (d, 0, KSBA_TYPE_SEQUENCE);
+  ksba_der_add_oid (d, oid_aes128_cbc);
+  ksba_der_add_val (d, 0, KSBA_TYPE_OCTET_STRING, iv, sizeof iv);
+  ksba_der_add_end (d);
+  ksba_der_add_ptr (d, KSBA_CLASS_CONTEXT, 0, payload, payloadlen);
+  ksba_der_add_end (d);
+  ksba_der_add_end (d);
+  ksba_der_add_end (d);
+  ksba_der_add_end (d);
+
+  err = write_object (d, w, r_length);
+
+ leave:
+  free (payload);
+  ksba_der_release (d);
+  return err;
+}
+
+
+
+gpg_error_t
+synth_nested_ber (ksba_writer_t w, unsigned int depth, unsigned long seed,
+                  unsigned long long *r_length)
+{
+  gpg_error_t err = 0;
+  ksba_der_t d;
+  synth_rng_t rng;
+  unsigned char buf[64];
+  unsigned long long total = 0;
+  unsigned int level, r, n;
+  size_t len;
+
+  d = ksba_der_builder_new (0);
+  if (!d)
+    return gpg_error_from_syserror ();
+  synth_rng_init (&rng, seed);
+
+  /* The DER builder can't create indefinite length objects; thus we
+     write the headers ourselves and use the builder only for the
+     primitive elements.  */
+  for (level=0; !err && level < depth; level++)
+    {
+      r = synth_rng_next (&rng);
+      if (!level || (r % 3) == 0)
+        err = synth_write_tl (w, 0, KSBA_TYPE_SEQUENCE, 1, SYNTH_NDEF);
+      else if ((r % 3) == 1)
+        err = synth_write_tl (w, 0, KSBA_TYPE_SET, 1, SYNTH_NDEF);
+      else
+        err = synth_write_tl (w, KSBA_CLASS_CONTEXT, (r >> 8) % 31,
+                              1, SYNTH_NDEF);
+      total += 2;
+      if (!err && (r & 0x10000))
+        {
+          /* Add a primitive element before the next level.  */
+          n = 1 + (r >> 20) % sizeof buf;
+          synth_rng_fill (&rng, buf, n);
+          ksba_der_builder_reset (d);
+          if ((r & 0x20000))
+            ksba_der_add_int (d, buf, n, 1);
+          else
+            ksba_der_add_val (d, 0, KSBA_TYPE_OCTET_STRING, buf, n);
+          err = ksba_der_builder_write (d, w, &len);
+          total += len;
+        }
+    }
+
+  /* The innermost element is a constructed octet string.  */
+  if (!err)
+    err = synth_write_tl (w, 0, KSBA_TYPE_OCTET_STRING, 1, SYNTH_NDEF);
+  total += 2;
+  for (n=0; !err && n < 3; n++)
+    {
+      synth_rng_fill (&rng, buf, sizeof buf);
+      ksba_der_builder_reset (d);
+      ksba_der_add_val (d, 0, KSBA_TYPE_OCTET_STRING, buf, 16 + 16*n);
+      err = ksba_der_builder_write (d, w, &len);
+      total += len;
+    }
+
+  /* Close everything with end-of-contents octets.  */
+  for (level=0; !err && level <= depth; level++)
+    {
+      err = ksba_writer_write (w, "\x00\x00", 2);
+      total += 2;
+    }
+  if (!err && r_length)
+    *r_length = total;
+
+  ksba_der_release (d);
+  return err;
+}
@@ -0,0 +1,99 @@
+/* synth.h - Definitions for the synthetic object generator
+ * Copyright (C) 2026 g10 Code GmbH
+ *
+ * This file is part of KSBA.
+ *
+ * KSBA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KSBA is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SYNTH_H
+#define SYNTH_H
+
+#include "../src/ksba.h"
+
+/* A small deterministic pseudo random generator.  It is not suitable
+   for anything but creating reproducible test data.  */
+struct synth_rng_s
+{
+  unsigned long long state;
+};
+typedef struct synth_rng_s synth_rng_t;
+
+void synth_rng_init (synth_rng_t *rng, unsigned long seed);
+unsigned int synth_rng_next (synth_rng_t *rng);
+void synth_rng_fill (synth_rng_t *rng, void *buffer, size_t length);
+
+/* Encode a tag and length header into BUFFER which must have space
+   for at least 10 octets.  A LENGTH of SYNTH_NDEF requests the
+   indefinite length form.  Returns the length of the header.  */
+#define SYNTH_NDEF ((unsigned long long)(-1))
+size_t synth_encode_tl (unsigned char *buffer, int cls, int tag,
+                        int constructed, unsigned long long length);
+gpg_error_t synth_write_tl (ksba_writer_t w, int cls, int tag,
+                            int constructed, unsigned long long length);
+
+/* Return the content of the DER object at DER.  */
+const unsigned char *synth_content (const unsigned char *der, size_t derlen,
+                                    size_t *r_length);
+
+/* Store the UTCTime or GeneralizedTime for the time SECONDS since the
+   Epoch at BUFFER which must have space for 16 octets.  */
+size_t synth_asntime (char *buffer, unsigned long long seconds,
+                      int generalized);
+
+/* Write a CRL for the issuer given by the DER encoded Name ISSUER
+   with NENTRIES revoked certificates to W.  The CRL is streamed so
+   that its size is only limited by the writer.  The signature is a
+   dummy value.  */
+gpg_error_t synth_crl (ksba_writer_t w,
+                       const unsigned char *issuer, size_t issuerlen,
+                       unsigned long long nentries, unsigned long seed,
+                       unsigned long long *r_length);
+
+/* Create an OCSP response with status good for all certificates
+   requested by the DER encoded OCSP request REQUEST.  The response
+   is signed by RESPONDER with a dummy signature and RESPONDER is
+   included in the response.  */
+gpg_error_t synth_ocsp_response (const unsigned char *request,
+                                 size_t requestlen,
+                                 ksba_cert_t responder, unsigned long seed,
+                                 unsigned char **r_der, size_t *r_derlen);
+
+/* Create a certificate with NSANS names in the subjectAltName and
+   NEXTS additional private extensions.  */
+gpg_error_t synth_cert (unsigned int nsans, unsigned int nexts,
+                        unsigned long seed,
+                        unsigned char **r_der, size_t *r_derlen);
+
+/* Write a signed message with a payload of PAYLOADLEN random octets
+   to W.  The message includes NCERTS certificates and is signed by
+   the first one.  */
+gpg_error_t synth_cms_signed (ksba_writer_t w, unsigned int ncerts,
+                              size_t payloadlen, unsigned long seed,
+                              unsigned long long *r_length);
+
+/* Write an enveloped message for NRECIPIENTS recipients with
+   PAYLOADLEN random octets as encrypted content to W.  */
+gpg_error_t synth_cms_enveloped (ksba_writer_t w, unsigned int nrecipients,
+                                 size_t payloadlen, unsigned long seed,
+                                 unsigned long long *r_length);
+
+/* Write DEPTH nested constructed objects with indefinite length and
+   some primitive elements in between to W.  */
+gpg_error_t synth_nested_ber (ksba_writer_t w, unsigned int depth,
+                              unsigned long seed,
+                              unsigned long long *r_length);
+
+
+#endif /*SYNTH_H*/
@@ -38,6 +38,8 @@
 #include <ctype.h>
 #include <assert.h>
 
+#define STATS_MODULE KSBA_STATS_MOD_ASN1
+
 #ifdef BUILD_GENTOOLS
 # include "gen-help.h"
 #else
@@ -65,6 +67,7 @@ add_node (node_type_t type)
   punt->left = NULL;
   punt->name = NULL;
   punt->type = type;
+  punt->actual_type = TYPE_NONE;
   punt->valuetype = VALTYPE_NULL;
   punt->value.v_cstr = NULL;
   punt->off = -1;
@@ -382,6 +385,7 @@ find_node (AsnNode root, const char *name, int resolve)
 AsnNode
 _ksba_asn_find_node (AsnNode root, const char *name)
 {
+  STATS_ADD (find_node, 1);
   return find_node (root, name, 0);
 }
 
@@ -43,6 +43,8 @@
 #include <ctype.h>
 #include <assert.h>
 
+#define STATS_MODULE KSBA_STATS_MOD_ASN1
+
 #include "util.h"
 #include "ksba.h"
 #include "asn1-func.h"
@@ -33,6 +33,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#define STATS_MODULE KSBA_STATS_MOD_BER
+
 #include "util.h"
 
 #include "util.h"
@@ -1228,13 +1230,18 @@ _ksba_ber_decoder_decode (BerDecoder d, const char *start_name,
   d->fast_stop = !!(flags & BER_DECODER_FLAG_FAST_STOP);
 
   startoff = ksba_reader_tell (d->reader);
+  TRACE (KSBA_TRACE_BER_DECODE_START, 0, 0, 0, d, start_name);
 
   err = decoder_init (d, start_name);
   if (err)
-    return err;
+    {
+      TRACE (KSBA_TRACE_BER_DECODE_END, 0, err, 0, d, start_name);
+      return err;
+    }
 
   while (!(err = decoder_next (d)))
     {
+      STATS_ADD (decoder_nodes, 1);
       node = d->val.node;
       /* Fixme: USE_IMAGE is only not used with the ber-dump utility
          and thus of no big use.  We should remove the other code
@@ -1342,5 +1349,7 @@ _ksba_ber_decoder_decode (BerDecoder d, const char *start_name,
 
   decoder_deinit (d);
   xfree (buf);
+  TRACE (KSBA_TRACE_BER_DECODE_END, 0, err,
+         ksba_reader_tell (d->reader) - startoff, d, start_name);
   return err;
 }
@@ -33,6 +33,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#define STATS_MODULE KSBA_STATS_MOD_BER
+
 #include "util.h"
 
 #include "asn1-func.h" /* need some constants */
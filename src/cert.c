@@ -35,6 +35,8 @@
 #include <assert.h>
 #include <errno.h>
 
+#define STATS_MODULE KSBA_STATS_MOD_CERT
+
 #include "util.h"
 #include "ber-decoder.h"
 #include "ber-help.h"
@@ -55,6 +57,11 @@ static const char oidstr_authorityKeyIdentifier[] = "2.5.29.35";
 static const char oidstr_extKeyUsage[] = "2.5.29.37";
 static const char oidstr_authorityInfoAccess[] = "1.3.6.1.5.5.7.1.1";
 static const char oidstr_subjectInfoAccess[]   = "1.3.6.1.5.5.7.1.11";
+static const char oidstr_ctPoison[]  = "1.3.6.1.4.1.11129.2.4.3";
+static const char oidstr_ctSCTList[] = "1.3.6.1.4.1.11129.2.4.2";
+
+
+static gpg_error_t read_extensions (ksba_cert_t cert);
 
 
 /**
@@ -73,10 +80,32 @@ ksba_cert_new (ksba_cert_t *acert)
   if (!*acert)
     return gpg_error_from_errno (errno);
   (*acert)->ref_count++;
+  (*acert)->actx = _ksba_alloc_ctx_current ();
 
   return 0;
 }
 
+
+/* Create a new and empty certificate object like ksba_cert_new but
+   take all memory owned by the certificate from the allocation
+   context CTX.  The certificate is valid until it is released or CTX
+   is released.  Strings and other objects returned to the caller are
+   allocated with the global allocation functions.  */
+gpg_error_t
+ksba_cert_new_in (ksba_alloc_ctx_t ctx, ksba_cert_t *acert)
+{
+  gpg_error_t err;
+  ksba_alloc_ctx_t prevctx;
+
+  *acert = NULL;
+  err = _ksba_alloc_ctx_enter (ctx, &prevctx);
+  if (err)
+    return err;
+  err = ksba_cert_new (acert);
+  _ksba_alloc_ctx_leave (ctx, prevctx);
+  return err;
+}
+
 void
 ksba_cert_ref (ksba_cert_t cert)
 {
@@ -96,6 +125,7 @@ void
 ksba_cert_release (ksba_cert_t cert)
 {
   int i;
+  ksba_alloc_ctx_t actx, prevctx;
 
   if (!cert)
     return;
@@ -107,6 +137,15 @@ ksba_cert_release (ksba_cert_t cert)
   if (--cert->ref_count)
     return;
 
+  actx = cert->actx;
+  if (_ksba_alloc_ctx_enter (actx, &prevctx))
+    {
+      /* Another thread uses the context; the memory is reclaimed
+         when the context is released.  */
+      fprintf (stderr, "BUG: releasing a cert while its allocation"
+               " context is in use\n");
+      return;
+    }
   if (cert->udata)
     {
       struct cert_user_data *ud = cert->udata;
@@ -129,6 +168,13 @@ ksba_cert_release (ksba_cert_t cert)
         xfree (cert->cache.extns[i].oid);
       xfree (cert->cache.extns);
     }
+  xfree (cert->cache.san_index);
+  while (cert->cache.fprs)
+    {
+      struct cert_fpr_s *fpr = cert->cache.fprs->next;
+      xfree (cert->cache.fprs);
+      cert->cache.fprs = fpr;
+    }
 
   _ksba_asn_release_nodes (cert->root);
   ksba_asn_tree_release (cert->asn_tree);
@@ -136,28 +182,17 @@ ksba_cert_release (ksba_cert_t cert)
   xfree (cert->image);
 
   xfree (cert);
+  _ksba_alloc_ctx_leave (actx, prevctx);
 }
 
 
-/* Store arbitrary data along with a certificate.  The DATA of length
-   DATALEN will be stored under the string KEY.  If some data is
-   already stored under this key it will be replaced by the new data.
-   Using NULL for DATA will effectivly delete the data.
-
-   On error (i.e. out or memory) an already existing data object
-   stored under KEY may get deleted.
-
-   This function is not thread safe because we don't employ any
-   locking. */
-gpg_error_t
-ksba_cert_set_user_data (ksba_cert_t cert,
-                         const char *key, const void *data, size_t datalen)
+/* The actual code of ksba_cert_set_user_data.  */
+static gpg_error_t
+set_user_data (ksba_cert_t cert,
+               const char *key, const void *data, size_t datalen)
 {
   struct cert_user_data *ud;
 
-  if (!cert || !key || !*key)
-    return gpg_error (GPG_ERR_INV_VALUE);
-
   for (ud=cert->udata; ud; ud = ud->next)
     if (!strcmp (ud->key, key))
       break;
@@ -212,6 +247,35 @@ ksba_cert_set_user_data (ksba_cert_t cert,
 }
 
 
+/* Store arbitrary data along with a certificate.  The DATA of length
+   DATALEN will be stored under the string KEY.  If some data is
+   already stored under this key it will be replaced by the new data.
+   Using NULL for DATA will effectivly delete the data.
+
+   On error (i.e. out or memory) an already existing data object
+   stored under KEY may get deleted.
+
+   This function is not thread safe because we don't employ any
+   locking. */
+gpg_error_t
+ksba_cert_set_user_data (ksba_cert_t cert,
+                         const char *key, const void *data, size_t datalen)
+{
+  gpg_error_t err;
+  ksba_alloc_ctx_t prevctx;
+
+  if (!cert || !key || !*key)
+    return gpg_error (GPG_ERR_INV_VALUE);
+
+  err = _ksba_alloc_ctx_enter (cert->actx, &prevctx);
+  if (err)
+    return err;
+  err = set_user_data (cert, key, data, datalen);
+  _ksba_alloc_ctx_leave (cert->actx, prevctx);
+  return err;
+}
+
+
 
 /* Return user data for certificate CERT stored under the string
    KEY. The caller needs to provide a suitable large BUFFER and pass
@@ -269,12 +333,16 @@ ksba_cert_read_der (ksba_cert_t cert, ksba_reader_t reader)
 {
   gpg_error_t err = 0;
   BerDecoder decoder = NULL;
+  ksba_alloc_ctx_t prevctx;
 
   if (!cert || !reader)
     return gpg_error (GPG_ERR_INV_VALUE);
   if (cert->initialized)
     return gpg_error (GPG_ERR_CONFLICT); /* Fixme: should remove the old one */
 
+  err = _ksba_alloc_ctx_enter (cert->actx, &prevctx);
+  if (err)
+    return err;
   _ksba_asn_release_nodes (cert->root);
   ksba_asn_tree_release (cert->asn_tree);
   cert->root = NULL;
@@ -302,10 +370,21 @@ ksba_cert_read_der (ksba_cert_t cert, ksba_reader_t reader)
   err = _ksba_ber_decoder_decode (decoder, "TMTTv2.Certificate", 0,
                                   &cert->root, &cert->image, &cert->imagelen);
   if (!err)
+    {
+      const unsigned char *image;
+      size_t imagelen;
+
       cert->initialized = 1;
+      /* Compute the quick hash right away so that comparing
+         certificates does not need to touch the images.  */
+      image = ksba_cert_get_image (cert, &imagelen);
+      if (image)
+        cert->quickhash = _ksba_hash64 (image, imagelen);
+    }
 
  leave:
   _ksba_ber_decoder_release (decoder);
+  _ksba_alloc_ctx_leave (cert->actx, prevctx);
 
   return err;
 }
@@ -374,17 +453,109 @@ ksba_cert_get_image (ksba_cert_t cert, size_t *r_length )
    this case. */
 int
 _ksba_cert_cmp (ksba_cert_t a, ksba_cert_t b)
+{
+  return !ksba_cert_equal (a, b);
+}
+
+
+/* Return true if the certificates A and B are identical.  The hashes
+   computed while parsing are compared first so that the images need
+   to be compared only if the certificates are very likely equal.  */
+int
+ksba_cert_equal (ksba_cert_t a, ksba_cert_t b)
 {
   const unsigned char *img_a, *img_b;
   size_t len_a, len_b;
 
+  if (!a || !b || !a->initialized || !b->initialized)
+    return 0;
+  if (a == b)
+    return 1;
+  if (a->quickhash != b->quickhash)
+    return 0;
+
   img_a = ksba_cert_get_image (a, &len_a);
   if (!img_a)
-    return 1;
+    return 0;
   img_b = ksba_cert_get_image (b, &len_b);
   if (!img_b)
-    return 1;
-  return !(len_a == len_b && !memcmp (img_a, img_b, len_a));
+    return 0;
+  return (len_a == len_b && !memcmp (img_a, img_b, len_a));
+}
+
+
+/* Return a 64 bit hash of the certificate CERT which has been
+   computed while parsing.  This is a non-cryptographic hash useful
+   for hash tables and quick inequality tests; it depends on the byte
+   order of the host and shall thus not be stored.  0 is returned for
+   an uninitialized certificate.  */
+uint64_t
+ksba_cert_get_quickhash (ksba_cert_t cert)
+{
+  if (!cert || !cert->initialized)
+    return 0;
+  return cert->quickhash;
+}
+
+
+/* Return the fingerprint of CERT computed with the hash algorithm
+   given by OID; NULL selects SHA-1.  The hash function registered
+   with ksba_set_hash_buffer_function is used to compute it on the
+   first call; the result is cached in CERT.  On success R_DIGEST is
+   set to the digest which is valid as long as CERT is valid and
+   R_DIGESTLEN to its length.  */
+gpg_error_t
+ksba_cert_get_fingerprint (ksba_cert_t cert, const char *oid,
+                           const unsigned char **r_digest,
+                           size_t *r_digestlen)
+{
+  gpg_error_t err;
+  const char *key;
+  const unsigned char *image;
+  size_t imagelen;
+  struct cert_fpr_s *fpr;
+  ksba_alloc_ctx_t prevctx;
+
+  if (!cert || !r_digest || !r_digestlen)
+    return gpg_error (GPG_ERR_INV_VALUE);
+  *r_digest = NULL;
+  *r_digestlen = 0;
+  if (!cert->initialized)
+    return gpg_error (GPG_ERR_NO_DATA);
+
+  key = oid? oid : "1.3.14.3.2.26";
+  for (fpr = cert->cache.fprs; fpr; fpr = fpr->next)
+    if (!strcmp (fpr->oid, key))
+      break;
+  if (!fpr)
+    {
+      image = ksba_cert_get_image (cert, &imagelen);
+      if (!image)
+        return gpg_error (GPG_ERR_NO_VALUE);
+      err = _ksba_alloc_ctx_enter (cert->actx, &prevctx);
+      if (err)
+        return err;
+      fpr = xtrymalloc (sizeof *fpr + strlen (key));
+      if (!fpr)
+        err = gpg_error_from_syserror ();
+      else
+        {
+          strcpy (fpr->oid, key);
+          err = _ksba_hash_buffer (oid, image, imagelen, sizeof fpr->digest,
+                                   fpr->digest, &fpr->len);
+          if (err)
+            xfree (fpr);
+        }
+      _ksba_alloc_ctx_leave (cert->actx, prevctx);
+      if (err)
+        return err;
+      fpr->next = cert->cache.fprs;
+      cert->cache.fprs = fpr;
+    }
+
+  *r_digest = fpr->digest;
+  *r_digestlen = fpr->len;
+  return 0;
 }
 
 
@@ -422,6 +593,234 @@ ksba_cert_hash (ksba_cert_t cert, int what,
 
 
 
+/* Return true if the Extension located at the image offsets START to
+   END is the CT poison or the SCT list extension (RFC-6962); these
+   are not part of the TBSCertificate covered by an SCT.  */
+static int
+is_ct_extension (ksba_cert_t cert, size_t start, size_t end)
+{
+  int i;
+
+  for (i=0; i < cert->cache.n_extns; i++)
+    if (cert->cache.extns[i].off >= start && cert->cache.extns[i].off < end)
+      return (!strcmp (cert->cache.extns[i].oid, oidstr_ctPoison)
+              || !strcmp (cert->cache.extns[i].oid, oidstr_ctSCTList));
+  return 0;
+}
+
+
+/* Helper for ksba_cert_get_ct_tbs and ksba_cert_hash_ct_tbs.  Compute
+   the length of the TBSCertificate without the CT extensions and
+   store it at R_LENGTH.  If EMIT is not NULL, the TBSCertificate is
+   passed piecewise to it.  Only the headers of the TBSCertificate,
+   the extensions field and the Extensions sequence need to be
+   re-encoded; everything else is taken unchanged from the image.  */
+static gpg_error_t
+ct_tbs_emit (ksba_cert_t cert,
+             void (*emit)(void *, const void *, size_t), void *emit_arg,
+             size_t *r_length)
+{
+  gpg_error_t err;
+  AsnNode n;
+  struct tag_info ti;
+  const unsigned char *image, *tbs, *tbsend, *p, *q, *e;
+  const unsigned char *a3 = NULL, *a3end = NULL, *seq, *seqend, *run;
+  size_t left, removed, seqlen, a3len, tbslen, nhdr;
+  unsigned char hdr[3*6];
+
+  if (!cert->cache.extns_valid)
+    {
+      err = read_extensions (cert);
+      if (err)
+        return err;
+    }
+
+  n = _ksba_asn_find_node (cert->root, "Certificate.tbsCertificate");
+  if (!n || n->off == -1)
+    return gpg_error (GPG_ERR_NO_VALUE);
+  image = cert->image;
+  tbs = image + n->off;
+  tbsend = tbs + n->nhdr + n->len;
+
+  /* Locate the extensions field.  It is the last one but we do not
+     rely on this.  */
+  p = tbs + n->nhdr;
+  left = n->len;
+  while (left)
+    {
+      q = p;
+      err = _ksba_ber_parse_tl (&p, &left, &ti);
+      if (err)
+        return err;
+      if (ti.ndef)
+        return gpg_error (GPG_ERR_NOT_DER_ENCODED);
+      if (ti.length > left)
+        return gpg_error (GPG_ERR_BAD_BER);
+      if (ti.class == CLASS_CONTEXT && ti.tag == 3 && ti.is_constructed)
+        {
+          a3 = q;
+          a3end = p + ti.length;
+          break;
+        }
+      p += ti.length;
+      left -= ti.length;
+    }
+
+  removed = 0;
+  seq = seqend = NULL;
+  if (a3)
+    {
+      left = a3end - p;
+      err = _ksba_ber_parse_tl (&p, &left, &ti);
+      if (err)
+        return err;
+      if (!(ti.class == CLASS_UNIVERSAL && ti.tag == TYPE_SEQUENCE
+            && ti.is_constructed))
+        return gpg_error (GPG_ERR_INV_CERT_OBJ);
+      if (ti.ndef)
+        return gpg_error (GPG_ERR_NOT_DER_ENCODED);
+      if (ti.length > left)
+        return gpg_error (GPG_ERR_BAD_BER);
+      seq = p;
+      seqend = p + ti.length;
+      while (left)
+        {
+          q = p;
+          err = _ksba_ber_parse_tl (&p, &left, &ti);
+          if (err)
+            return err;
+          if (ti.ndef)
+            return gpg_error (GPG_ERR_NOT_DER_ENCODED);
+          if (ti.length > left)
+            return gpg_error (GPG_ERR_BAD_BER);
+          p += ti.length;
+          left -= ti.length;
+          if (is_ct_extension (cert, q - image, p - image))
+            removed += p - q;
+        }
+    }
+
+  if (!removed)
+    {
+      /* Nothing to remove - this is the plain TBSCertificate.  */
+      if (emit)
+        emit (emit_arg, tbs, tbsend - tbs);
+      *r_length = tbsend - tbs;
+      return 0;
+    }
+
+  /* An empty Extensions sequence is not allowed; thus we drop the
+     entire extensions field if no other extension is left.  */
+  seqlen = (seqend - seq) - removed;
+  a3len = 0;
+  if (seqlen)
+    {
+      a3len = _ksba_ber_count_tl (TYPE_SEQUENCE, CLASS_UNIVERSAL, 1, seqlen);
+      a3len += seqlen;
+    }
+  tbslen = n->len - (a3end - a3);
+  if (a3len)
+    tbslen += _ksba_ber_count_tl (3, CLASS_CONTEXT, 1, a3len) + a3len;
+  *r_length = _ksba_ber_count_tl (TYPE_SEQUENCE, CLASS_UNIVERSAL, 1, tbslen);
+  *r_length += tbslen;
+
+  if (!emit)
+    return 0;
+
+  nhdr = _ksba_ber_encode_tl (hdr, TYPE_SEQUENCE, CLASS_UNIVERSAL, 1, tbslen);
+  emit (emit_arg, hdr, nhdr);
+  emit (emit_arg, tbs + n->nhdr, a3 - (tbs + n->nhdr));
+  if (seqlen)
+    {
+      nhdr = _ksba_ber_encode_tl (hdr, 3, CLASS_CONTEXT, 1, a3len);
+      nhdr += _ksba_ber_encode_tl (hdr+nhdr, TYPE_SEQUENCE, CLASS_UNIVERSAL,
+                                   1, seqlen);
+      emit (emit_arg, hdr, nhdr);
+      /* Pass on runs of kept extensions.  The structure has already
+         been checked above.  */
+      run = p = seq;
+      left = seqend - seq;
+      while (left)
+        {
+          q = p;
+          _ksba_ber_parse_tl (&p, &left, &ti);
+          e = p + ti.length;
+          p = e;
+          left -= ti.length;
+          if (is_ct_extension (cert, q - image, e - image))
+            {
+              if (q > run)
+                emit (emit_arg, run, q - run);
+              run = e;
+            }
+        }
+      if (seqend > run)
+        emit (emit_arg, run, seqend - run);
+    }
+  if (tbsend > a3end)
+    emit (emit_arg, a3end, tbsend - a3end);
+
+  return 0;
+}
+
+
+static void
+ct_tbs_copy (void *arg, const void *buffer, size_t length)
+{
+  unsigned char **pp = arg;
+
+  memcpy (*pp, buffer, length);
+  *pp += length;
+}
+
+
+/* Store the TBSCertificate of CERT without the CT poison and the SCT
+   list extensions into BUFFER of size BUFSIZE.  This is the data
+   which is covered by a Signed Certificate Timestamp; for a
+   precertificate it is what gets logged.  The length of the result is
+   stored at R_LENGTH.  If BUFFER is NULL only the length is returned;
+   if BUFSIZE is too small GPG_ERR_BUFFER_TOO_SHORT is returned.  */
+gpg_error_t
+ksba_cert_get_ct_tbs (ksba_cert_t cert, unsigned char *buffer,
+                      size_t bufsize, size_t *r_length)
+{
+  gpg_error_t err;
+  unsigned char *p;
+
+  if (!cert || !r_length)
+    return gpg_error (GPG_ERR_INV_VALUE);
+  if (!cert->initialized)
+    return gpg_error (GPG_ERR_NO_DATA);
+
+  err = ct_tbs_emit (cert, NULL, NULL, r_length);
+  if (err || !buffer)
+    return err;
+  if (*r_length > bufsize)
+    return gpg_error (GPG_ERR_BUFFER_TOO_SHORT);
+  p = buffer;
+  return ct_tbs_emit (cert, ct_tbs_copy, &p, r_length);
+}
+
+
+/* Pass the TBSCertificate as returned by ksba_cert_get_ct_tbs to
+   HASHER without building it in memory.  */
+gpg_error_t
+ksba_cert_hash_ct_tbs (ksba_cert_t cert,
+                       void (*hasher)(void *, const void *, size_t length),
+                       void *hasher_arg)
+{
+  size_t length;
+
+  if (!cert || !hasher)
+    return gpg_error (GPG_ERR_INV_VALUE);
+  if (!cert->initialized)
+    return gpg_error (GPG_ERR_NO_DATA);
+
+  return ct_tbs_emit (cert, hasher, hasher_arg, &length);
+}
+
+
+
 /**
  * ksba_cert_get_digest_algo:
  * @cert: Initialized certificate object
@@ -444,6 +843,7 @@ ksba_cert_get_digest_algo (ksba_cert_t cert)
   AsnNode n;
   char *algo;
   size_t nread;
+  ksba_alloc_ctx_t prevctx;
 
   if (!cert)
     return NULL;  /* Ooops (can't set cert->last_error :-().  */
@@ -472,8 +872,16 @@ ksba_cert_get_digest_algo (ksba_cert_t cert)
       err = gpg_error (GPG_ERR_UNKNOWN_ALGORITHM);
     }
   else
-    err = _ksba_parse_algorithm_identifier (cert->image + n->off,
-                                            n->nhdr + n->len, &nread, &algo);
+    {
+      err = _ksba_alloc_ctx_enter (cert->actx, &prevctx);
+      if (!err)
+        {
+          err = _ksba_parse_algorithm_identifier (cert->image + n->off,
+                                                  n->nhdr + n->len, &nread,
+                                                  &algo);
+          _ksba_alloc_ctx_leave (cert->actx, prevctx);
+        }
+    }
   if (err)
     cert->last_error = err;
   else
@@ -795,26 +1203,15 @@ ksba_cert_get_subject (ksba_cert_t cert, int idx)
 
 
 
-/**
- * ksba_cert_get_valididy:
- * @cert: certificate object
- * @what: 0 for notBefore, 1 for notAfter
- * @timebuf: Returns the time.
- *
- * Return the validity object from the certificate.  If no value is
- * available 0 is returned because we can safely assume that this is
- * not a valid date.
- *
- * Return value: The time value an 0 or an error code.
- **/
-gpg_error_t
-ksba_cert_get_validity (ksba_cert_t cert, int what, ksba_isotime_t timebuf)
+/* Return the node with the time value for notBefore (WHAT is 0) or
+   notAfter (WHAT is 1) at R_NODE.  NULL is stored there if no value
+   is available.  */
+static gpg_error_t
+get_validity_node (ksba_cert_t cert, int what, AsnNode *r_node)
 {
   AsnNode n, n2;
 
-  if (!cert || what < 0 || what > 1)
-    return gpg_error (GPG_ERR_INV_VALUE);
-  *timebuf = 0;
+  *r_node = NULL;
   if (!cert->initialized)
     return gpg_error (GPG_ERR_NO_DATA);
 
@@ -836,24 +1233,80 @@ ksba_cert_get_validity (ksba_cert_t cert, int what, ksba_isotime_t timebuf)
     return 0; /* no value available */
 
   return_val_if_fail (n->off != -1, gpg_error (GPG_ERR_BUG));
-
-  return _ksba_asntime_to_iso (cert->image + n->off + n->nhdr, n->len,
-                               n->type == TYPE_UTC_TIME, timebuf);
+  *r_node = n;
+  return 0;
 }
 
 
-
-ksba_sexp_t
-ksba_cert_get_public_key (ksba_cert_t cert)
+/**
+ * ksba_cert_get_valididy:
+ * @cert: certificate object
+ * @what: 0 for notBefore, 1 for notAfter
+ * @timebuf: Returns the time.
+ *
+ * Return the validity object from the certificate.  If no value is
+ * available 0 is returned because we can safely assume that this is
+ * not a valid date.
+ *
+ * Return value: The time value an 0 or an error code.
+ **/
+gpg_error_t
+ksba_cert_get_validity (ksba_cert_t cert, int what, ksba_isotime_t timebuf)
 {
-  AsnNode n;
   gpg_error_t err;
-  ksba_sexp_t string;
-
-  if (!cert)
-    return NULL;
-  if (!cert->initialized)
-    return NULL;
+  AsnNode n;
+
+  if (!cert || what < 0 || what > 1)
+    return gpg_error (GPG_ERR_INV_VALUE);
+  *timebuf = 0;
+
+  err = get_validity_node (cert, what, &n);
+  if (err || !n)
+    return err;
+
+  return _ksba_asntime_to_iso (cert->image + n->off + n->nhdr, n->len,
+                               n->type == TYPE_UTC_TIME, timebuf);
+}
+
+
+/* Same as ksba_cert_get_validity but return the time as seconds since
+   the epoch at R_TIME.  The value is directly computed from the DER
+   encoded time without going through the ISO format.  If no value is
+   available GPG_ERR_NO_VALUE is returned.  */
+gpg_error_t
+ksba_cert_get_validity_epoch (ksba_cert_t cert, int what,
+                              ksba_epochtime_t *r_time)
+{
+  gpg_error_t err;
+  AsnNode n;
+
+  if (!cert || what < 0 || what > 1 || !r_time)
+    return gpg_error (GPG_ERR_INV_VALUE);
+  *r_time = 0;
+
+  err = get_validity_node (cert, what, &n);
+  if (err)
+    return err;
+  if (!n)
+    return gpg_error (GPG_ERR_NO_VALUE);
+
+  return _ksba_asntime_to_epoch (cert->image + n->off + n->nhdr, n->len,
+                                 n->type == TYPE_UTC_TIME, r_time);
+}
+
+
+
+ksba_sexp_t
+ksba_cert_get_public_key (ksba_cert_t cert)
+{
+  AsnNode n;
+  gpg_error_t err;
+  ksba_sexp_t string;
+
+  if (!cert)
+    return NULL;
+  if (!cert->initialized)
+    return NULL;
 
   n = _ksba_asn_find_node (cert->root,
                            "Certificate"
@@ -953,7 +1406,7 @@ ksba_cert_get_sig_val (ksba_cert_t cert)
 
 /* Read all extensions into the cache */
 static gpg_error_t
-read_extensions (ksba_cert_t cert)
+do_read_extensions (ksba_cert_t cert)
 {
   AsnNode start, n;
   int count;
@@ -1016,6 +1469,23 @@ read_extensions (ksba_cert_t cert)
 }
 
 
+/* Read all extensions of CERT into the cache using the allocation
+   context of CERT.  */
+static gpg_error_t
+read_extensions (ksba_cert_t cert)
+{
+  gpg_error_t err;
+  ksba_alloc_ctx_t prevctx;
+
+  err = _ksba_alloc_ctx_enter (cert->actx, &prevctx);
+  if (err)
+    return err;
+  err = do_read_extensions (cert);
+  _ksba_alloc_ctx_leave (cert->actx, prevctx);
+  return err;
+}
+
+
 /* Return information about the IDX nth extension */
 gpg_error_t
 ksba_cert_get_extension (ksba_cert_t cert, int idx,
@@ -1055,6 +1525,43 @@ ksba_cert_get_extension (ksba_cert_t cert, int idx,
 }
 
 
+/* Search the extensions of CERT for OID starting at index *R_IDX, or
+   at 0 if R_IDX is NULL.  On success the value of the extension is
+   stored at R_DER and R_DERLEN, its critical flag at R_CRIT if that is
+   not NULL, and its index at R_IDX if that is not NULL.
+   GPG_ERR_NO_DATA is returned if there is no (further) such
+   extension.  */
+static gpg_error_t
+find_extension (ksba_cert_t cert, const char *oid, int *r_idx, int *r_crit,
+                const unsigned char **r_der, size_t *r_derlen)
+{
+  gpg_error_t err;
+  const char *tmpoid;
+  size_t off, derlen;
+  int idx, crit;
+
+  for (idx = r_idx? *r_idx : 0;
+       !(err=ksba_cert_get_extension (cert, idx, &tmpoid, &crit,
+                                      &off, &derlen)); idx++)
+    {
+      if (!strcmp (tmpoid, oid))
+        {
+          if (r_idx)
+            *r_idx = idx;
+          if (r_crit)
+            *r_crit = crit;
+          *r_der = cert->image + off;
+          *r_derlen = derlen;
+          return 0;
+        }
+    }
+  if (gpg_err_code (err) == GPG_ERR_EOF
+      || gpg_err_code (err) == GPG_ERR_NO_VALUE)
+    err = gpg_error (GPG_ERR_NO_DATA);
+  return err;
+}
+
+
 
 /* Return information on the basicConstraint (2.5.19.19) of CERT.
    R_CA receives true if this is a CA and only in that case R_PATHLEN
@@ -1269,6 +1776,180 @@ ksba_cert_get_key_usage (ksba_cert_t cert, unsigned int *r_flags)
 }
 
 
+/* Fill row I of COLUMNS with the FIELDS of CERT.  */
+static gpg_error_t
+get_column_row (ksba_cert_t cert, size_t i, unsigned int fields,
+                ksba_cert_columns_t *columns)
+{
+  gpg_error_t err, firsterr = 0;
+  const unsigned char *ptr;
+  size_t len;
+
+#define SETERR(e) do { if ((e) && !firsterr) firsterr = (e); } while (0)
+
+  if (!cert || !cert->initialized)
+    firsterr = gpg_error (GPG_ERR_NO_DATA);
+
+  if ((fields & KSBA_COLUMN_SERIAL))
+    {
+      columns->serial_off[i] = 0;
+      columns->serial_len[i] = 0;
+      if (!firsterr)
+        {
+          err = _ksba_cert_get_serial_ptr (cert, &ptr, &len);
+          if (!err)
+            {
+              struct tag_info ti;
+              const unsigned char *image = ksba_cert_get_image (cert, NULL);
+
+              err = _ksba_ber_parse_tl (&ptr, &len, &ti);
+              if (!err && (!image || ti.length > len))
+                err = gpg_error (GPG_ERR_BAD_BER);
+              if (!err)
+                {
+                  columns->serial_off[i] = ptr - image;
+                  columns->serial_len[i] = ti.length;
+                }
+            }
+          SETERR (err);
+        }
+    }
+
+  if ((fields & KSBA_COLUMN_VALIDITY))
+    {
+      columns->not_before[i] = 0;
+      columns->not_after[i] = 0;
+      if (!firsterr)
+        {
+          err = ksba_cert_get_validity_epoch (cert, 0,
+                                              &columns->not_before[i]);
+          if (!err)
+            err = ksba_cert_get_validity_epoch (cert, 1,
+                                                &columns->not_after[i]);
+          SETERR (err);
+        }
+    }
+
+  if ((fields & KSBA_COLUMN_ISSUER_HASH))
+    {
+      columns->issuer_hash[i] = 0;
+      if (!firsterr)
+        {
+          err = _ksba_cert_get_issuer_dn_ptr (cert, &ptr, &len);
+          if (!err)
+            columns->issuer_hash[i] = _ksba_hash64 (ptr, len);
+          SETERR (err);
+        }
+    }
+
+  if ((fields & KSBA_COLUMN_SUBJECT_HASH))
+    {
+      columns->subject_hash[i] = 0;
+      if (!firsterr)
+        {
+          err = _ksba_cert_get_subject_dn_ptr (cert, &ptr, &len);
+          if (!err)
+            columns->subject_hash[i] = _ksba_hash64 (ptr, len);
+          SETERR (err);
+        }
+    }
+
+  if ((fields & KSBA_COLUMN_PUBKEY))
+    {
+      columns->pk_algo[i] = KSBA_PKALGO_NONE;
+      columns->pk_nbits[i] = 0;
+      if (!firsterr)
+        {
+          AsnNode n;
+          int algo;
+
+          n = _ksba_asn_find_node
+            (cert->root, "Certificate.tbsCertificate.subjectPublicKeyInfo");
+          if (!n || n->off == -1)
+            err = gpg_error (GPG_ERR_NO_VALUE);
+          else
+            err = _ksba_keyinfo_get_pk_info (cert->image + n->off,
+                                             n->nhdr + n->len,
+                                             &algo, &columns->pk_nbits[i]);
+          if (!err)
+            columns->pk_algo[i] = algo;
+          SETERR (err);
+        }
+    }
+
+  if ((fields & KSBA_COLUMN_BASIC_CONSTRAINTS))
+    {
+      columns->is_ca[i] = 0;
+      columns->pathlen[i] = -1;
+      if (!firsterr)
+        {
+          err = ksba_cert_is_ca (cert, &columns->is_ca[i],
+                                 &columns->pathlen[i]);
+          SETERR (err);
+        }
+    }
+
+  if ((fields & KSBA_COLUMN_KEY_USAGE))
+    {
+      columns->key_usage[i] = 0;
+      if (!firsterr)
+        {
+          err = ksba_cert_get_key_usage (cert, &columns->key_usage[i]);
+          if (gpg_err_code (err) == GPG_ERR_NO_DATA)
+            err = 0;
+          SETERR (err);
+        }
+    }
+
+#undef SETERR
+  return firsterr;
+}
+
+
+/* Extract the fields selected by the KSBA_COLUMN_ flags in FIELDS from
+   the NCERTS certificates in CERTS into the arrays of COLUMNS; see
+   ksba_cert_columns_t for the array belonging to each flag.  Row I of
+   each array describes CERTS[I].  No memory is allocated except for
+   the extension cache of each certificate which is built once.  If
+   COLUMNS->status is not NULL the status of each row is stored there
+   and 0 is returned; otherwise the first error is returned.  In any
+   case all rows are filled, using 0 (-1 for pathlen) for fields which
+   could not be extracted.  The function may be run concurrently on
+   disjoint sets of certificates.  */
+gpg_error_t
+ksba_cert_get_columns (ksba_cert_t *certs, size_t ncerts,
+                       unsigned int fields, ksba_cert_columns_t *columns)
+{
+  gpg_error_t err, firsterr = 0;
+  size_t i;
+
+  if ((ncerts && !certs) || !columns)
+    return gpg_error (GPG_ERR_INV_VALUE);
+  if (((fields & KSBA_COLUMN_SERIAL)
+       && (!columns->serial_off || !columns->serial_len))
+      || ((fields & KSBA_COLUMN_VALIDITY)
+          && (!columns->not_before || !columns->not_after))
+      || ((fields & KSBA_COLUMN_ISSUER_HASH) && !columns->issuer_hash)
+      || ((fields & KSBA_COLUMN_SUBJECT_HASH) && !columns->subject_hash)
+      || ((fields & KSBA_COLUMN_PUBKEY)
+          && (!columns->pk_algo || !columns->pk_nbits))
+      || ((fields & KSBA_COLUMN_BASIC_CONSTRAINTS)
+          && (!columns->is_ca || !columns->pathlen))
+      || ((fields & KSBA_COLUMN_KEY_USAGE) && !columns->key_usage))
+    return gpg_error (GPG_ERR_INV_VALUE);
+
+  for (i=0; i < ncerts; i++)
+    {
+      err = get_column_row (certs[i], i, fields, columns);
+      if (columns->status)
+        columns->status[i] = err;
+      else if (err && !firsterr)
+        firsterr = err;
+    }
+  return firsterr;
+}
+
+
 
 /* Note, that this helper is also used for ext_key_usage. */
 static gpg_error_t
@@ -1298,238 +1979,220 @@ append_cert_policy (char **policies, const char *oid, int crit)
 }
 
 
-/* Return a string with the certificatePolicies delimited by
-   linefeeds.  The return values may be extended to carry more
-   information er line, so the caller should only use the first
-   white-space delimited token per line.  The function returns
-   GPG_ERR_NO_DATA when this extension is not used.  Caller must free
-   the returned value.  */
-gpg_error_t
-ksba_cert_get_cert_policies (ksba_cert_t cert, char **r_policies)
+/* Setup ITER for the certificatePolicies (POLICIES is true) or the
+   extKeyUsage extension with the DER encoded value DER of length
+   DERLEN and the critical flag CRIT.  */
+static gpg_error_t
+init_oid_iter (ksba_oid_iter_t *iter, int policies, int crit,
+               const unsigned char *der, size_t derlen)
 {
   gpg_error_t err;
-  const char *oid;
-  int idx, crit;
-  size_t off, derlen, seqlen;
-  const unsigned char *der;
   struct tag_info ti;
 
-  if (!cert || !r_policies)
+  err = _ksba_ber_parse_tl (&der, &derlen, &ti);
+  if (err)
+    return err;
+  if ( !(ti.class == CLASS_UNIVERSAL && ti.tag == TYPE_SEQUENCE
+         && ti.is_constructed) )
+    return gpg_error (GPG_ERR_INV_CERT_OBJ);
+  if (ti.ndef)
+    return gpg_error (GPG_ERR_NOT_DER_ENCODED);
+  if (ti.length > derlen)
+    return gpg_error (GPG_ERR_BAD_BER);
+
+  iter->_der = der;
+  iter->_derlen = ti.length;
+  iter->_crit = crit;
+  iter->_policies = policies;
+  return 0;
+}
+
+
+/* Common code for ksba_cert_iter_cert_policies and
+   ksba_cert_iter_ext_key_usages.  */
+static gpg_error_t
+iter_oid_extension (ksba_cert_t cert, int policies, ksba_oid_iter_t *r_iter)
+{
+  gpg_error_t err;
+  const unsigned char *der;
+  size_t derlen;
+  int crit;
+
+  if (!cert || !r_iter)
     return gpg_error (GPG_ERR_INV_VALUE);
-  *r_policies = NULL;
+  r_iter->_der = NULL;
+  r_iter->_derlen = 0;
 
-  for (idx=0; !(err=ksba_cert_get_extension (cert, idx, &oid, &crit,
-                                             &off, &derlen)); idx++)
-    {
-      if (!strcmp (oid, oidstr_certificatePolicies))
-        {
-          char *suboid;
+  err = find_extension (cert, (policies?
+                               oidstr_certificatePolicies : oidstr_extKeyUsage),
+                        NULL, &crit, &der, &derlen);
+  if (err)
+    return err;
+  return init_oid_iter (r_iter, policies, crit, der, derlen);
+}
 
-          der = cert->image + off;
 
-          err = _ksba_ber_parse_tl (&der, &derlen, &ti);
-          if (err)
-            goto leave;
-          if ( !(ti.class == CLASS_UNIVERSAL && ti.tag == TYPE_SEQUENCE
-                 && ti.is_constructed) )
-            {
-              err = gpg_error (GPG_ERR_INV_CERT_OBJ);
-              goto leave;
-            }
-          if (ti.ndef)
-            {
-              err = gpg_error (GPG_ERR_NOT_DER_ENCODED);
-              goto leave;
-            }
-          seqlen = ti.length;
-          if (seqlen > derlen)
-            {
-              err = gpg_error (GPG_ERR_BAD_BER);
-              goto leave;
-            }
-          while (seqlen)
-            {
-              size_t seqseqlen;
+/* Setup the iterator R_ITER to walk over the policies of the
+   certificatePolicies extension of CERT.  Use ksba_oid_iter_next to
+   retrieve the items.  Nothing is allocated; the iterator references
+   the image of CERT and is thus valid as long as CERT is valid.
+   GPG_ERR_NO_DATA is returned if CERT has no such extension.  */
+gpg_error_t
+ksba_cert_iter_cert_policies (ksba_cert_t cert, ksba_oid_iter_t *r_iter)
+{
+  return iter_oid_extension (cert, 1, r_iter);
+}
 
-              err = _ksba_ber_parse_tl (&der, &derlen, &ti);
-              if (err)
-                goto leave;
-              if ( !(ti.class == CLASS_UNIVERSAL && ti.tag == TYPE_SEQUENCE
-                     && ti.is_constructed) )
-                {
-                  err = gpg_error (GPG_ERR_INV_CERT_OBJ);
-                  goto leave;
-                }
-              if (ti.ndef)
-                {
-                  err = gpg_error (GPG_ERR_NOT_DER_ENCODED);
-                  goto leave;
-                }
-              if (ti.length > derlen)
-                {
-                  err = gpg_error (GPG_ERR_BAD_BER);
-                  goto leave;
-                }
-              if (!ti.length)
-                {
-                  /* We do not accept an empty inner SEQ */
-                  err = gpg_error (GPG_ERR_INV_CERT_OBJ);
-                  goto leave;
-                }
-              if (ti.nhdr+ti.length > seqlen)
-                {
-                  err = gpg_error (GPG_ERR_BAD_BER);
-                  goto leave;
-                }
-              seqlen -= ti.nhdr + ti.length;
-              seqseqlen = ti.length;
 
-              err = _ksba_ber_parse_tl (&der, &derlen, &ti);
-              if (err)
-                goto leave;
-              if ( !(ti.class == CLASS_UNIVERSAL && ti.tag == TYPE_OBJECT_ID))
-                {
-                  err = gpg_error (GPG_ERR_INV_CERT_OBJ);
-                  goto leave;
-                }
-              if (ti.length > derlen)
-                {
-                  err = gpg_error (GPG_ERR_BAD_BER);
-                  goto leave;
-                }
-              if (ti.nhdr+ti.length > seqseqlen)
-                {
-                  err = gpg_error (GPG_ERR_BAD_BER);
-                  goto leave;
-                }
-              seqseqlen -= ti.nhdr;
+/* Same as ksba_cert_iter_cert_policies but for the extKeyUsage
+   extension.  */
+gpg_error_t
+ksba_cert_iter_ext_key_usages (ksba_cert_t cert, ksba_oid_iter_t *r_iter)
+{
+  return iter_oid_extension (cert, 0, r_iter);
+}
 
-              suboid = ksba_oid_to_str (der, ti.length);
-              if (!suboid)
-                {
-                  err = gpg_error (GPG_ERR_ENOMEM);
-                  goto leave;
-                }
-              der       += ti.length;
-              derlen    -= ti.length;
-              seqseqlen -= ti.length;
 
-              err = append_cert_policy (r_policies, suboid, crit);
-              xfree (suboid);
-              if (err)
-                goto leave;
+/* Return the next item from ITER.  R_OID and R_OIDLEN are set to the
+   DER encoded content of the OID, pointing into the certificate; use
+   ksba_oid_to_str to convert it to a string or compare it against the
+   output of ksba_oid_from_str.  If R_CRIT is not NULL the critical
+   flag of the extension is stored there.  If R_QUALIFIERS is not NULL
+   it is set to the DER encoded policyQualifiers (the complete SEQUENCE)
+   and R_QUALIFIERSLEN to its length; if there are no qualifiers or for
+   extended key usages these are set to NULL and 0.  GPG_ERR_EOF is
+   returned if no more items are available.  */
+gpg_error_t
+ksba_oid_iter_next (ksba_oid_iter_t *iter,
+                    const unsigned char **r_oid, size_t *r_oidlen,
+                    int *r_crit,
+                    const unsigned char **r_qualifiers,
+                    size_t *r_qualifierslen)
+{
+  gpg_error_t err;
+  struct tag_info ti;
+  const unsigned char *der;
+  size_t derlen;
 
-              /* skip the rest of the seq which is more or less optional */
-              der    += seqseqlen;
-              derlen -= seqseqlen;
-            }
-        }
+  if (!iter || !r_oid || !r_oidlen)
+    return gpg_error (GPG_ERR_INV_VALUE);
+  if (r_qualifiers)
+    {
+      *r_qualifiers = NULL;
+      if (r_qualifierslen)
+        *r_qualifierslen = 0;
     }
+  if (!iter->_derlen)
+    return gpg_error (GPG_ERR_EOF);
 
-  if (gpg_err_code (err) == GPG_ERR_EOF)
-    err = 0;
-  if (!*r_policies || gpg_err_code (err) == GPG_ERR_NO_VALUE)
-    err = gpg_error (GPG_ERR_NO_DATA);
+  if (iter->_policies)
+    {
+      /* PolicyInformation ::= SEQUENCE {
+            policyIdentifier   CertPolicyId,
+            policyQualifiers   SEQUENCE SIZE (1..MAX) OF
+                                    PolicyQualifierInfo OPTIONAL }  */
+      err = _ksba_ber_parse_tl (&iter->_der, &iter->_derlen, &ti);
+      if (err)
+        return err;
+      if ( !(ti.class == CLASS_UNIVERSAL && ti.tag == TYPE_SEQUENCE
+             && ti.is_constructed) )
+        return gpg_error (GPG_ERR_INV_CERT_OBJ);
+      if (ti.ndef)
+        return gpg_error (GPG_ERR_NOT_DER_ENCODED);
+      if (ti.length > iter->_derlen)
+        return gpg_error (GPG_ERR_BAD_BER);
+      if (!ti.length)
+        return gpg_error (GPG_ERR_INV_CERT_OBJ); /* Empty inner SEQ.  */
+      der = iter->_der;
+      derlen = ti.length;
+      iter->_der += ti.length;
+      iter->_derlen -= ti.length;
+    }
+  else
+    {
+      der = iter->_der;
+      derlen = iter->_derlen;
+    }
 
- leave:
+  err = _ksba_ber_parse_tl (&der, &derlen, &ti);
   if (err)
+    return err;
+  if ( !(ti.class == CLASS_UNIVERSAL && ti.tag == TYPE_OBJECT_ID))
+    return gpg_error (GPG_ERR_INV_CERT_OBJ);
+  if (ti.ndef)
+    return gpg_error (GPG_ERR_NOT_DER_ENCODED);
+  if (ti.length > derlen)
+    return gpg_error (GPG_ERR_BAD_BER);
+
+  *r_oid = der;
+  *r_oidlen = ti.length;
+  der += ti.length;
+  derlen -= ti.length;
+  if (r_crit)
+    *r_crit = iter->_crit;
+
+  if (iter->_policies)
     {
-      xfree (*r_policies);
-      *r_policies = NULL;
+      if (derlen && r_qualifiers)
+        {
+          *r_qualifiers = der;
+          if (r_qualifierslen)
+            *r_qualifierslen = derlen;
+        }
     }
-  return err;
+  else
+    {
+      iter->_der = der;
+      iter->_derlen = derlen;
+    }
+  return 0;
 }
 
 
-/* Return a string with the extendedKeyUsageOIDs delimited by
-   linefeeds.  The return values may be extended to carry more
-   information per line, so the caller should only use the first
-   white-space delimited token per line.  The function returns
-   GPG_ERR_NO_DATA when this extension is not used.  Caller must free
-   the returned value.  */
-gpg_error_t
-ksba_cert_get_ext_key_usages (ksba_cert_t cert, char **result)
+/* Common code for ksba_cert_get_cert_policies and
+   ksba_cert_get_ext_key_usages.  */
+static gpg_error_t
+get_oid_list (ksba_cert_t cert, int policies, char **result)
 {
   gpg_error_t err;
   const char *oid;
   int idx, crit;
-  size_t off, derlen;
-  const unsigned char *der;
-  struct tag_info ti;
+  const unsigned char *der, *extder;
+  size_t len, derlen;
+  ksba_oid_iter_t iter;
+  char *suboid;
 
   if (!cert || !result)
     return gpg_error (GPG_ERR_INV_VALUE);
   *result = NULL;
 
-  for (idx=0; !(err=ksba_cert_get_extension (cert, idx, &oid, &crit,
-                                             &off, &derlen)); idx++)
+  oid = policies? oidstr_certificatePolicies : oidstr_extKeyUsage;
+  for (idx=0; !(err=find_extension (cert, oid, &idx, &crit,
+                                    &extder, &derlen)); idx++)
     {
-      if (!strcmp (oid, oidstr_extKeyUsage))
+      err = init_oid_iter (&iter, policies, crit, extder, derlen);
+      if (err)
+        goto leave;
+      while (!(err = ksba_oid_iter_next (&iter, &der, &len, NULL, NULL, NULL)))
         {
-          char *suboid;
-
-          der = cert->image + off;
-
-          err = _ksba_ber_parse_tl (&der, &derlen, &ti);
-          if (err)
-            goto leave;
-          if ( !(ti.class == CLASS_UNIVERSAL && ti.tag == TYPE_SEQUENCE
-                 && ti.is_constructed) )
-            {
-              err = gpg_error (GPG_ERR_INV_CERT_OBJ);
-              goto leave;
-            }
-          if (ti.ndef)
-            {
-              err = gpg_error (GPG_ERR_NOT_DER_ENCODED);
-              goto leave;
-            }
-          if (ti.length > derlen)
+          suboid = ksba_oid_to_str (der, len);
+          if (!suboid)
             {
-              err = gpg_error (GPG_ERR_BAD_BER);
+              err = gpg_error (GPG_ERR_ENOMEM);
               goto leave;
             }
-          while (derlen)
-            {
-              err = _ksba_ber_parse_tl (&der, &derlen, &ti);
-              if (err)
-                goto leave;
-              if ( !(ti.class == CLASS_UNIVERSAL && ti.tag == TYPE_OBJECT_ID))
-                {
-                  err = gpg_error (GPG_ERR_INV_CERT_OBJ);
-                  goto leave;
-                }
-              if (ti.ndef)
-                {
-                  err = gpg_error (GPG_ERR_NOT_DER_ENCODED);
-                  goto leave;
-                }
-              if (ti.length > derlen)
-                {
-                  err = gpg_error (GPG_ERR_BAD_BER);
-                  goto leave;
-                }
-
-              suboid = ksba_oid_to_str (der, ti.length);
-              if (!suboid)
-                {
-                  err = gpg_error (GPG_ERR_ENOMEM);
-                  goto leave;
-                }
-              der       += ti.length;
-              derlen    -= ti.length;
-
-              err = append_cert_policy (result, suboid, crit);
-              xfree (suboid);
-              if (err)
-                goto leave;
-            }
+          err = append_cert_policy (result, suboid, crit);
+          xfree (suboid);
+          if (err)
+            goto leave;
         }
+      if (gpg_err_code (err) != GPG_ERR_EOF)
+        goto leave;
     }
 
-  if (gpg_err_code (err) == GPG_ERR_EOF)
+  if (gpg_err_code (err) == GPG_ERR_NO_DATA)
     err = 0;
-  if (!*result || gpg_err_code (err) == GPG_ERR_NO_VALUE)
+  if (!*result && !err)
     err = gpg_error (GPG_ERR_NO_DATA);
 
  leave:
@@ -1542,8 +2205,34 @@ ksba_cert_get_ext_key_usages (ksba_cert_t cert, char **result)
 }
 
 
+/* Return a string with the certificatePolicies delimited by
+   linefeeds.  The return values may be extended to carry more
+   information er line, so the caller should only use the first
+   white-space delimited token per line.  The function returns
+   GPG_ERR_NO_DATA when this extension is not used.  Caller must free
+   the returned value.  See also ksba_cert_iter_cert_policies.  */
+gpg_error_t
+ksba_cert_get_cert_policies (ksba_cert_t cert, char **r_policies)
+{
+  return get_oid_list (cert, 1, r_policies);
+}
+
+
+/* Return a string with the extendedKeyUsageOIDs delimited by
+   linefeeds.  The return values may be extended to carry more
+   information per line, so the caller should only use the first
+   white-space delimited token per line.  The function returns
+   GPG_ERR_NO_DATA when this extension is not used.  Caller must free
+   the returned value.  See also ksba_cert_iter_ext_key_usages.  */
+gpg_error_t
+ksba_cert_get_ext_key_usages (ksba_cert_t cert, char **result)
+{
+  return get_oid_list (cert, 0, result);
+}
+
+
+
 
-
 /* Helper function for ksba_cert_get_crl_dist_point */
 static gpg_error_t
 parse_distribution_point (const unsigned char *der, size_t derlen,
@@ -2036,6 +2725,97 @@ ksba_cert_get_subj_key_id (ksba_cert_t cert, int *r_crit, ksba_sexp_t *r_keyid)
 }
 
 
+/* Return a pointer to the keyIdentifier of the subjectKeyIdentifier
+   extension of CERT in PTR and its length in LENGTH.  The returned
+   pointer is valid as long as CERT is valid.  */
+gpg_error_t
+_ksba_cert_get_subj_key_id_ptr (ksba_cert_t cert,
+                                unsigned char const **ptr, size_t *length)
+{
+  gpg_error_t err;
+  const unsigned char *der;
+  size_t derlen;
+  struct tag_info ti;
+
+  if (!cert || !cert->initialized || !ptr || !length)
+    return gpg_error (GPG_ERR_INV_VALUE);
+
+  err = find_extension (cert, oidstr_subjectKeyIdentifier, NULL, NULL,
+                        &der, &derlen);
+  if (err)
+    return err;
+  err = _ksba_ber_parse_tl (&der, &derlen, &ti);
+  if (err)
+    return err;
+  if ( !(ti.class == CLASS_UNIVERSAL && ti.tag == TYPE_OCTET_STRING
+         && !ti.is_constructed) )
+    return gpg_error (GPG_ERR_INV_CERT_OBJ);
+  if (ti.ndef)
+    return gpg_error (GPG_ERR_NOT_DER_ENCODED);
+  if (ti.length > derlen)
+    return gpg_error (GPG_ERR_BAD_BER);
+  if (!ti.length)
+    return gpg_error (GPG_ERR_NO_DATA);
+
+  *ptr = der;
+  *length = ti.length;
+  return 0;
+}
+
+
+/* Return a pointer to the keyIdentifier of the
+   authorityKeyIdentifier extension of CERT in PTR and its length in
+   LENGTH.  GPG_ERR_NO_DATA is returned if the extension does not use
+   the keyIdentifier method.  The returned pointer is valid as long as
+   CERT is valid.  */
+gpg_error_t
+_ksba_cert_get_auth_key_id_ptr (ksba_cert_t cert,
+                                unsigned char const **ptr, size_t *length)
+{
+  gpg_error_t err;
+  const unsigned char *der;
+  size_t derlen;
+  struct tag_info ti;
+
+  if (!cert || !cert->initialized || !ptr || !length)
+    return gpg_error (GPG_ERR_INV_VALUE);
+
+  err = find_extension (cert, oidstr_authorityKeyIdentifier, NULL, NULL,
+                        &der, &derlen);
+  if (err)
+    return err;
+  err = _ksba_ber_parse_tl (&der, &derlen, &ti);
+  if (err)
+    return err;
+  if ( !(ti.class == CLASS_UNIVERSAL && ti.tag == TYPE_SEQUENCE
+         && ti.is_constructed) )
+    return gpg_error (GPG_ERR_INV_CERT_OBJ);
+  if (ti.ndef)
+    return gpg_error (GPG_ERR_NOT_DER_ENCODED);
+  if (ti.length > derlen)
+    return gpg_error (GPG_ERR_BAD_BER);
+  if (!ti.length)
+    return gpg_error (GPG_ERR_NO_DATA);
+  derlen = ti.length;
+
+  err = _ksba_ber_parse_tl (&der, &derlen, &ti);
+  if (err)
+    return err;
+  if (!(ti.class == CLASS_CONTEXT && ti.tag == 0))
+    return gpg_error (GPG_ERR_NO_DATA); /* No keyIdentifier.  */
+  if (ti.ndef)
+    return gpg_error (GPG_ERR_NOT_DER_ENCODED);
+  if (ti.length > derlen)
+    return gpg_error (GPG_ERR_BAD_BER);
+  if (!ti.length)
+    return gpg_error (GPG_ERR_NO_DATA);
+
+  *ptr = der;
+  *length = ti.length;
+  return 0;
+}
+
+
 
 /* MODE 0 := authorityInfoAccess
         1 := subjectInfoAccess
@@ -2161,6 +2941,286 @@ get_info_access (ksba_cert_t cert, int idx, int mode,
 }
 
 
+/* Setup the iterator R_ITER to walk over the names of the
+   issuerAltName extension (USE_SUBJECT is false) or the subjectAltName
+   extension (USE_SUBJECT is true) of CERT.  Use ksba_name_iter_next to
+   retrieve the names; the returned values point directly into the
+   image of CERT and are thus valid as long as CERT is valid.
+   GPG_ERR_NO_DATA is returned if CERT has no such extension.  */
+gpg_error_t
+ksba_cert_get_alt_names (ksba_cert_t cert, int use_subject,
+                         ksba_name_iter_t *r_iter)
+{
+  gpg_error_t err;
+  const unsigned char *der;
+  size_t derlen;
+
+  if (!cert || !r_iter)
+    return gpg_error (GPG_ERR_INV_VALUE);
+  r_iter->_der = NULL;
+  r_iter->_derlen = 0;
+
+  err = find_extension (cert, (use_subject?
+                               oidstr_subjectAltName:oidstr_issuerAltName),
+                        NULL, NULL, &der, &derlen);
+  if (err)
+    return err;
+
+  return ksba_name_iter_init (r_iter, der, derlen);
+}
+
+
+/* Map an ASCII letter to lowercase.  Host names are compared
+   case-insensitively only for ASCII; IDNs are expected in A-label
+   form.  */
+static inline int
+san_tolower (int c)
+{
+  return (c >= 'A' && c <= 'Z')? (c + ('a' - 'A')) : c;
+}
+
+
+/* Return a case-insensitive FNV-1a hash over the LEN bytes at S.  */
+static unsigned int
+san_hash (const char *s, size_t len)
+{
+  unsigned int h = 2166136261u;
+
+  for (; len; len--, s++)
+    {
+      h ^= (unsigned char)san_tolower (*s);
+      h *= 16777619u;
+    }
+  return h;
+}
+
+
+/* Return the smallest power of 2 which is at least twice N.  */
+static unsigned int
+san_table_size (unsigned int n)
+{
+  unsigned int size = 2;
+
+  while (size < 2*n)
+    size <<= 1;
+  return size;
+}
+
+
+/* Insert the lowercase NAME of length LEN into the hash table TABLE
+   with mask MASK.  Duplicates are ignored.  */
+static void
+san_insert (struct san_slot_s *table, unsigned int mask,
+            const char *name, size_t len)
+{
+  unsigned int hash = san_hash (name, len);
+  unsigned int i;
+
+  for (i = hash & mask; table[i].name; i = (i + 1) & mask)
+    if (table[i].hash == hash && table[i].len == len
+        && !memcmp (table[i].name, name, len))
+      return;
+  table[i].hash = hash;
+  table[i].len = len;
+  table[i].name = name;
+}
+
+
+/* Return true if NAME of length LEN is in TABLE.  The comparison is
+   case-insensitive; the names in the table are already lowercase.  */
+static int
+san_lookup (const struct san_slot_s *table, unsigned int mask,
+            const char *name, size_t len)
+{
+  unsigned int hash = san_hash (name, len);
+  unsigned int i;
+
+  for (i = hash & mask; table[i].name; i = (i + 1) & mask)
+    if (table[i].hash == hash && table[i].len == len
+        && !ascii_memcasecmp (table[i].name, name, len))
+      return 1;
+  return 0;
+}
+
+
+/* Check the dNSName at NAME of length LEN and return its class: 0 to
+   ignore it, 1 for a plain name and 2 for a wildcard name.  The
+   length to be stored is returned at R_LEN.  A trailing dot is
+   stripped.  Only wildcards in the form "*.example.org" with at least
+   two labels after the asterisk are accepted; partial wildcards like
+   "w*.example.org" are ignored.  */
+static int
+san_classify (const unsigned char *name, size_t len, size_t *r_len)
+{
+  const unsigned char *s;
+
+  if (len && name[len-1] == '.')
+    len--;
+  if (!len || memchr (name, 0, len))
+    return 0;
+  *r_len = len;
+  s = memchr (name, '*', len);
+  if (!s)
+    return 1;
+  if (s != name || len < 3 || name[1] != '.'
+      || memchr (name + 1, '*', len - 1)
+      || !memchr (name + 2, '.', len - 2))
+    return 0;
+  return 2;
+}
+
+
+/* Build the dNSName index for CERT.  */
+static gpg_error_t
+do_build_san_index (ksba_cert_t cert)
+{
+  gpg_error_t err;
+  ksba_name_iter_t iter, iter0;
+  ksba_gn_type_t type;
+  const unsigned char *der;
+  size_t derlen, len, poolsize;
+  unsigned int n_exact, n_wild, exact_size, wild_size;
+  struct san_index_s *idx;
+  char *pool;
+
+  err = ksba_cert_get_alt_names (cert, 1, &iter);
+  if (gpg_err_code (err) == GPG_ERR_NO_DATA)
+    iter._derlen = 0;
+  else if (err)
+    return err;
+  iter0 = iter;
+
+  /* First pass: count the names and check the encoding.  */
+  n_exact = n_wild = 0;
+  poolsize = 0;
+  while (!(err = ksba_name_iter_next (&iter, &type, &der, &derlen)))
+    {
+      if (type != KSBA_GN_DNS_NAME)
+        continue;
+      switch (san_classify (der, derlen, &len))
+        {
+        case 1: n_exact++; poolsize += len; break;
+        case 2: n_wild++; poolsize += len - 2; break;
+        default: break;
+        }
+    }
+  if (gpg_err_code (err) != GPG_ERR_EOF)
+    return err;
+
+  exact_size = san_table_size (n_exact);
+  wild_size = san_table_size (n_wild);
+  idx = xtrycalloc (1, sizeof *idx
+                    + (exact_size + wild_size) * sizeof (struct san_slot_s)
+                    + poolsize);
+  if (!idx)
+    return gpg_error_from_syserror ();
+  idx->n_names = n_exact + n_wild;
+  idx->exact_mask = exact_size - 1;
+  idx->wild_mask = wild_size - 1;
+  idx->exact = (struct san_slot_s *)(idx + 1);
+  idx->wild = idx->exact + exact_size;
+  pool = (char *)(idx->wild + wild_size);
+
+  /* Second pass: store the lowercased names.  */
+  iter = iter0;
+  while (!ksba_name_iter_next (&iter, &type, &der, &derlen))
+    {
+      int class;
+      size_t i;
+
+      if (type != KSBA_GN_DNS_NAME
+          || !(class = san_classify (der, derlen, &len)))
+        continue;
+      if (class == 2)
+        {
+          der += 2;
+          len -= 2;
+        }
+      for (i=0; i < len; i++)
+        pool[i] = san_tolower (der[i]);
+      if (class == 2)
+        san_insert (idx->wild, idx->wild_mask, pool, len);
+      else
+        san_insert (idx->exact, idx->exact_mask, pool, len);
+      pool += len;
+    }
+
+  cert->cache.san_index = idx;
+  return 0;
+}
+
+
+/* Build the dNSName index for CERT using the allocation context of
+   CERT.  */
+static gpg_error_t
+build_san_index (ksba_cert_t cert)
+{
+  gpg_error_t err;
+  ksba_alloc_ctx_t prevctx;
+
+  err = _ksba_alloc_ctx_enter (cert->actx, &prevctx);
+  if (err)
+    return err;
+  err = do_build_san_index (cert);
+  _ksba_alloc_ctx_leave (cert->actx, prevctx);
+  return err;
+}
+
+
+/* Check whether HOSTNAME matches one of the dNSNames of the
+   subjectAltName of CERT.  Wildcard names match exactly one leftmost
+   label.  The comparison is case-insensitive and a trailing dot of
+   HOSTNAME is ignored.  An index of the names is built on the first
+   call and cached in CERT; further calls do not allocate any memory.
+   Returns 0 on a match, GPG_ERR_NOT_FOUND if there is no match, and
+   GPG_ERR_NO_DATA if CERT has no dNSNames at all; in the latter case
+   the caller may want to fall back to the commonName.  A HOSTNAME
+   with a '*' or an empty label is rejected with GPG_ERR_INV_VALUE;
+   it would otherwise match wildcard names literally.  */
+gpg_error_t
+ksba_cert_match_hostname (ksba_cert_t cert, const char *hostname)
+{
+  gpg_error_t err;
+  struct san_index_s *idx;
+  const char *s;
+  size_t len;
+
+  if (!cert || !cert->initialized || !hostname)
+    return gpg_error (GPG_ERR_INV_VALUE);
+
+  len = strlen (hostname);
+  if (len && hostname[len-1] == '.')
+    len--;
+  if (!len || *hostname == '.' || hostname[len-1] == '.'
+      || memchr (hostname, '*', len))
+    return gpg_error (GPG_ERR_INV_VALUE);
+  for (s = hostname; (s = memchr (s, '.', len - (s - hostname))); s++)
+    if (s[1] == '.')
+      return gpg_error (GPG_ERR_INV_VALUE);
+
+  if (!cert->cache.san_index)
+    {
+      err = build_san_index (cert);
+      if (err)
+        return err;
+    }
+  idx = cert->cache.san_index;
+  if (!idx->n_names)
+    return gpg_error (GPG_ERR_NO_DATA);
+
+  if (san_lookup (idx->exact, idx->exact_mask, hostname, len))
+    return 0;
+
+  /* Try the wildcards with the leftmost label removed.  */
+  s = memchr (hostname, '.', len);
+  if (s && san_lookup (idx->wild, idx->wild_mask, s + 1,
+                     len - (s + 1 - hostname)))
+    return 0;
+
+  return gpg_error (GPG_ERR_NOT_FOUND);
+}
+
+
 /* Return the authorityInfoAccess attributes. IDX should be iterated
    starting from 0 until the function returns GPG_ERR_EOF.  R_METHOD
    returns an allocated string with the OID of one item and R_LOCATION
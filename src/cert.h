@@ -67,6 +67,37 @@ struct cert_user_data
 };
 
 
+/* A cached fingerprint of a certificate.  */
+struct cert_fpr_s
+{
+  struct cert_fpr_s *next;
+  size_t len;                  /* Length of DIGEST.  */
+  unsigned char digest[64];    /* The fingerprint.  */
+  char oid[1];                 /* The OID of the hash algorithm.  */
+};
+
+/* A hash table slot of the dNSName index.  */
+struct san_slot_s
+{
+  unsigned int hash;  /* The hash of NAME.  */
+  unsigned int len;   /* The length of NAME.  */
+  const char *name;   /* Lowercase name or NULL for an empty slot.  */
+};
+
+/* The index over the dNSNames of the subjectAltName.  Wildcard names
+   "*.example.org" are stored without the leading "*." in WILD; all
+   other names in EXACT.  The object is allocated in one chunk with
+   the tables and the names following the header.  */
+struct san_index_s
+{
+  unsigned int n_names;     /* Number of names in both tables.  */
+  unsigned int exact_mask;  /* Size of EXACT minus 1.  */
+  unsigned int wild_mask;   /* Size of WILD minus 1.  */
+  struct san_slot_s *exact;
+  struct san_slot_s *wild;
+};
+
+
 /* The internal certificate object. */
 struct ksba_cert_s
 {
@@ -88,11 +119,17 @@ struct ksba_cert_s
      modified. */
   int ref_count;
 
+  /* The allocation context the certificate has been created in or
+     NULL for the global allocation functions.  All memory owned by
+     the certificate is taken from this context.  */
+  ksba_alloc_ctx_t actx;
+
   ksba_asn_tree_t asn_tree;
   AsnNode root;              /* Root of the tree with the values */
 
   unsigned char *image;
   size_t imagelen;
+  uint64_t quickhash;        /* _ksba_hash64 of the certificate.  */
 
   gpg_error_t last_error;
   struct {
@@ -100,6 +137,8 @@ struct ksba_cert_s
     int  extns_valid;
     int  n_extns;
     struct cert_extn_info *extns;
+    struct san_index_s *san_index; /* Built by ksba_cert_match_hostname. */
+    struct cert_fpr_s *fprs;       /* Fingerprints.  */
   } cache;
 };
 
@@ -120,6 +159,12 @@ gpg_error_t _ksba_cert_get_subject_dn_ptr (ksba_cert_t cert,
 gpg_error_t _ksba_cert_get_public_key_ptr (ksba_cert_t cert,
                                            unsigned char const **ptr,
                                            size_t *length);
+gpg_error_t _ksba_cert_get_subj_key_id_ptr (ksba_cert_t cert,
+                                            unsigned char const **ptr,
+                                            size_t *length);
+gpg_error_t _ksba_cert_get_auth_key_id_ptr (ksba_cert_t cert,
+                                            unsigned char const **ptr,
+                                            size_t *length);
 
 
 #endif /*CERT_H*/
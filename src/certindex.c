@@ -0,0 +1,486 @@
+/* certindex.c - Index over certificates
+ * Copyright (C) 2026 g10 Code GmbH
+ *
+ * This file is part of KSBA.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* This module provides an in-memory index over a set of certificates
+ * to quickly locate them by subject, issuer and serial number, or by
+ * their key identifiers.  This is for example useful to build chains
+ * from a large set of intermediate certificates.
+ */
+
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#define STATS_MODULE KSBA_STATS_MOD_CERT
+
+#include "util.h"
+#include "cert.h"
+
+
+/* The keys we index.  */
+enum
+  {
+    KEY_SUBJECT = 0,    /* The subject DN.  */
+    KEY_ISSUER_SERIAL,  /* The issuer DN and the serial number.  */
+    KEY_SKI,            /* The subjectKeyIdentifier.  */
+    KEY_AKI,            /* The keyIdentifier of the authorityKeyIdentifier. */
+    N_KEYS
+  };
+
+
+/* An indexed certificate.  The key pointers point into the image of
+ * CERT; they are computed when inserting so that lookups do not need
+ * to touch the certificate objects.  */
+struct item_s
+{
+  ksba_cert_t cert;
+  const unsigned char *key[N_KEYS];  /* NULL if not available.  */
+  size_t keylen[N_KEYS];
+  const unsigned char *serial;       /* The serial for KEY_ISSUER_SERIAL. */
+  size_t seriallen;
+  uint64_t hash[N_KEYS];
+  size_t next[N_KEYS];               /* Index + 1 of the next item in the
+                                        bucket or 0.  */
+};
+
+
+/* The index object.  There is one hash table for each key; all
+ * tables have NBUCKETS buckets which hold the index + 1 of the first
+ * item or 0.  */
+struct ksba_certindex_s
+{
+  struct item_s *items;
+  size_t nitems;
+  size_t itemsize;               /* Allocated number of ITEMS.  */
+  size_t nbuckets;               /* A power of 2.  */
+  size_t *buckets[N_KEYS];       /* All allocated in one chunk by
+                                    BUCKETS[0].  */
+};
+
+
+/* Create a new and empty certificate index and store it at R_INDEX.  */
+gpg_error_t
+ksba_certindex_new (ksba_certindex_t *r_index)
+{
+  if (!r_index)
+    return gpg_error (GPG_ERR_INV_VALUE);
+  *r_index = xtrycalloc (1, sizeof **r_index);
+  if (!*r_index)
+    return gpg_error_from_syserror ();
+  return 0;
+}
+
+
+/* Release the index INDEX and the references it holds to the
+   certificates.  */
+void
+ksba_certindex_release (ksba_certindex_t index)
+{
+  size_t i;
+
+  if (!index)
+    return;
+  for (i=0; i < index->nitems; i++)
+    ksba_cert_release (index->items[i].cert);
+  xfree (index->items);
+  xfree (index->buckets[0]);
+  xfree (index);
+}
+
+
+/* Return the number of certificates in INDEX.  */
+size_t
+ksba_certindex_count (ksba_certindex_t index)
+{
+  return index? index->nitems : 0;
+}
+
+
+static uint64_t
+hash_issuer_serial (const unsigned char *issuer, size_t issuerlen,
+                    const unsigned char *serial, size_t seriallen)
+{
+  return (_ksba_hash64 (issuer, issuerlen) * 31
+          + _ksba_hash64 (serial, seriallen));
+}
+
+
+/* Link item number IDX into the bucket lists.  */
+static void
+link_item (ksba_certindex_t index, size_t idx)
+{
+  struct item_s *item = index->items + idx;
+  size_t b;
+  int k;
+
+  for (k=0; k < N_KEYS; k++)
+    {
+      item->next[k] = 0;
+      if (!item->key[k])
+        continue;
+      b = item->hash[k] & (index->nbuckets - 1);
+      item->next[k] = index->buckets[k][b];
+      index->buckets[k][b] = idx + 1;
+    }
+}
+
+
+/* Make sure that INDEX has space for NEEDED items and enough buckets
+   for them.  */
+static gpg_error_t
+reserve (ksba_certindex_t index, size_t needed)
+{
+  size_t nbuckets, i;
+  size_t *buckets;
+  int k;
+
+  if (needed < index->nitems)
+    return gpg_error (GPG_ERR_TOO_LARGE);  /* Overflow.  */
+
+  if (needed > index->itemsize)
+    {
+      struct item_s *items;
+      size_t n = index->itemsize? index->itemsize : 16;
+
+      while (n < needed)
+        {
+          if (n*2 < n)
+            return gpg_error (GPG_ERR_TOO_LARGE);
+          n *= 2;
+        }
+      items = _ksba_reallocarray (index->items, index->itemsize,
+                                  n, sizeof *items);
+      if (!items)
+        return gpg_error_from_syserror ();
+      index->items = items;
+      index->itemsize = n;
+    }
+
+  if (needed <= index->nbuckets)
+    return 0;
+
+  /* Rehash with a load factor of at most 1.  */
+  nbuckets = index->nbuckets? index->nbuckets : 16;
+  while (nbuckets < needed)
+    {
+      if (nbuckets*2 < nbuckets)
+        return gpg_error (GPG_ERR_TOO_LARGE);
+      nbuckets *= 2;
+    }
+  buckets = xtrycalloc (nbuckets, N_KEYS * sizeof *buckets);
+  if (!buckets)
+    return gpg_error_from_syserror ();
+  xfree (index->buckets[0]);
+  for (k=0; k < N_KEYS; k++)
+    index->buckets[k] = buckets + k * nbuckets;
+  index->nbuckets = nbuckets;
+  for (i=0; i < index->nitems; i++)
+    link_item (index, i);
+  return 0;
+}
+
+
+/* Fill ITEM with the keys of CERT.  */
+static gpg_error_t
+setup_item (struct item_s *item, ksba_cert_t cert)
+{
+  gpg_error_t err;
+  int k;
+
+  if (!cert)
+    return gpg_error (GPG_ERR_INV_VALUE);
+  memset (item, 0, sizeof *item);
+
+  err = _ksba_cert_get_subject_dn_ptr (cert, &item->key[KEY_SUBJECT],
+                                       &item->keylen[KEY_SUBJECT]);
+  if (!err)
+    err = _ksba_cert_get_issuer_dn_ptr (cert, &item->key[KEY_ISSUER_SERIAL],
+                                        &item->keylen[KEY_ISSUER_SERIAL]);
+  if (!err)
+    err = _ksba_cert_get_serial_ptr (cert, &item->serial, &item->seriallen);
+  if (err)
+    return err;
+
+  /* The key identifiers are optional; a certificate with a broken
+     extension is still indexed by its names.  */
+  if (_ksba_cert_get_subj_key_id_ptr (cert, &item->key[KEY_SKI],
+                                      &item->keylen[KEY_SKI]))
+    item->key[KEY_SKI] = NULL;
+  if (_ksba_cert_get_auth_key_id_ptr (cert, &item->key[KEY_AKI],
+                                      &item->keylen[KEY_AKI]))
+    item->key[KEY_AKI] = NULL;
+
+  for (k=0; k < N_KEYS; k++)
+    if (item->key[k])
+      item->hash[k] = (k == KEY_ISSUER_SERIAL
+                       ? hash_issuer_serial (item->key[k], item->keylen[k],
+                                             item->serial, item->seriallen)
+                       : _ksba_hash64 (item->key[k], item->keylen[k]));
+  item->cert = cert;
+  return 0;
+}
+
+
+/* Return true if ITEM has the key K with value KEY/KEYLEN and hash
+   HASH.  For KEY_ISSUER_SERIAL the serial number is also compared.  */
+static int
+item_matches (const struct item_s *item, int k, uint64_t hash,
+              const void *key, size_t keylen,
+              const void *serial, size_t seriallen)
+{
+  if (item->hash[k] != hash
+      || item->keylen[k] != keylen
+      || memcmp (item->key[k], key, keylen))
+    return 0;
+  if (k == KEY_ISSUER_SERIAL
+      && (item->seriallen != seriallen
+          || memcmp (item->serial, serial, seriallen)))
+    return 0;
+  return 1;
+}
+
+
+/* Return true if a certificate equal to ITEM is already in INDEX.  */
+static int
+have_item (ksba_certindex_t index, const struct item_s *item)
+{
+  size_t i;
+
+  if (!index->nbuckets)
+    return 0;
+  i = index->buckets[KEY_ISSUER_SERIAL][item->hash[KEY_ISSUER_SERIAL]
+                                        & (index->nbuckets - 1)];
+  for (; i; i = index->items[i-1].next[KEY_ISSUER_SERIAL])
+    if (ksba_cert_equal (index->items[i-1].cert, item->cert))
+      return 1;
+  return 0;
+}
+
+
+/* Add the NCERTS certificates from the array CERTS to INDEX.  The
+   index takes a reference to each certificate; certificates which are
+   already in the index are skipped.  The tables are resized at most
+   once per call, thus adding certificates in batches is faster than
+   adding them one by one.  On error no certificate is added.  The
+   index may not be used by other threads while this function
+   runs.  */
+gpg_error_t
+ksba_certindex_add_many (ksba_certindex_t index,
+                         ksba_cert_t *certs, size_t ncerts)
+{
+  gpg_error_t err;
+  size_t base, i, w;
+
+  if (!index || (ncerts && !certs))
+    return gpg_error (GPG_ERR_INV_VALUE);
+
+  err = reserve (index, index->nitems + ncerts);
+  if (err)
+    return err;
+
+  /* First compute all keys so that we can fail without changing the
+     index.  */
+  base = index->nitems;
+  for (i=0; i < ncerts; i++)
+    {
+      err = setup_item (index->items + base + i, certs[i]);
+      if (err)
+        return err;
+    }
+
+  /* Now link them while skipping duplicates.  */
+  for (i=0, w=base; i < ncerts; i++)
+    {
+      if (have_item (index, index->items + base + i))
+        continue;
+      if (w != base + i)
+        index->items[w] = index->items[base + i];
+      ksba_cert_ref (index->items[w].cert);
+      link_item (index, w);
+      index->nitems = ++w;
+    }
+  return 0;
+}
+
+
+/* Add the certificate CERT to INDEX.  See ksba_certindex_add_many.  */
+gpg_error_t
+ksba_certindex_add (ksba_certindex_t index, ksba_cert_t cert)
+{
+  return ksba_certindex_add_many (index, &cert, 1);
+}
+
+
+/* Return the IDX-th certificate of INDEX whose key K matches KEY of
+   length KEYLEN (and SERIAL of length SERIALLEN for KEY_ISSUER_SERIAL)
+   at R_CERT.  */
+static gpg_error_t
+find_item (ksba_certindex_t index, int k,
+           const void *key, size_t keylen,
+           const void *serial, size_t seriallen,
+           int idx, ksba_cert_t *r_cert)
+{
+  uint64_t hash;
+  size_t i;
+  int count = 0;
+
+  if (r_cert)
+    *r_cert = NULL;
+  if (!index || !key || !r_cert || (k == KEY_ISSUER_SERIAL && !serial))
+    return gpg_error (GPG_ERR_INV_VALUE);
+  if (idx < 0)
+    return gpg_error (GPG_ERR_INV_INDEX);
+  if (!index->nbuckets)
+    return gpg_error (GPG_ERR_NOT_FOUND);
+
+  hash = (k == KEY_ISSUER_SERIAL
+          ? hash_issuer_serial (key, keylen, serial, seriallen)
+          : _ksba_hash64 (key, keylen));
+  for (i = index->buckets[k][hash & (index->nbuckets - 1)];
+       i; i = index->items[i-1].next[k])
+    {
+      if (!item_matches (index->items + i - 1, k, hash, key, keylen,
+                         serial, seriallen))
+        continue;
+      if (count++ == idx)
+        {
+          *r_cert = index->items[i-1].cert;
+          return 0;
+        }
+    }
+  return gpg_error (count? GPG_ERR_EOF : GPG_ERR_NOT_FOUND);
+}
+
+
+/* Return the IDX-th certificate from INDEX with the subject DN given
+   in DER encoding at DN of length DNLEN at R_CERT.  IDX should be
+   iterated starting from 0 until GPG_ERR_EOF is returned;
+   GPG_ERR_NOT_FOUND is returned if no certificate matches at all.
+   The most recently added certificates are returned first.  The
+   returned certificate is owned by INDEX; use ksba_cert_ref to keep it
+   beyond the lifetime of the index.  The lookup functions do not
+   modify INDEX and may thus be called concurrently from several
+   threads as long as no certificates are added at the same time.  */
+gpg_error_t
+ksba_certindex_find_subject (ksba_certindex_t index,
+                             const void *dn, size_t dnlen,
+                             int idx, ksba_cert_t *r_cert)
+{
+  return find_item (index, KEY_SUBJECT, dn, dnlen, NULL, 0, idx, r_cert);
+}
+
+
+/* Return the certificate with the issuer DN given in DER encoding at
+   ISSUER of length ISSUERLEN and the serial number given as DER
+   encoded INTEGER (including tag and length) at SERIAL of length
+   SERIALLEN at R_CERT.  See ksba_certindex_find_subject for
+   details.  */
+gpg_error_t
+ksba_certindex_find_issuer_serial (ksba_certindex_t index,
+                                   const void *issuer, size_t issuerlen,
+                                   const void *serial, size_t seriallen,
+                                   int idx, ksba_cert_t *r_cert)
+{
+  return find_item (index, KEY_ISSUER_SERIAL, issuer, issuerlen,
+                    serial, seriallen, idx, r_cert);
+}
+
+
+/* Return the IDX-th certificate with a subjectKeyIdentifier of KEYID
+   and length KEYIDLEN at R_CERT.  See ksba_certindex_find_subject for
+   details.  */
+gpg_error_t
+ksba_certindex_find_subj_key_id (ksba_certindex_t index,
+                                 const void *keyid, size_t keyidlen,
+                                 int idx, ksba_cert_t *r_cert)
+{
+  return find_item (index, KEY_SKI, keyid, keyidlen, NULL, 0, idx, r_cert);
+}
+
+
+/* Return the IDX-th certificate with an authorityKeyIdentifier of
+   KEYID and length KEYIDLEN at R_CERT; that is the certificates
+   issued by the key with that identifier.  See
+   ksba_certindex_find_subject for details.  */
+gpg_error_t
+ksba_certindex_find_auth_key_id (ksba_certindex_t index,
+                                 const void *keyid, size_t keyidlen,
+                                 int idx, ksba_cert_t *r_cert)
+{
+  return find_item (index, KEY_AKI, keyid, keyidlen, NULL, 0, idx, r_cert);
+}
+
+
+/* Return the IDX-th candidate issuer certificate of CERT from INDEX
+   at R_CERT.  Candidates are the certificates whose subject matches
+   the issuer of CERT.  If CERT has an authorityKeyIdentifier with a
+   keyIdentifier, candidates with a different subjectKeyIdentifier are
+   skipped.  The signature is not checked.  CERT itself need not be in
+   INDEX; it may however not be used concurrently by other threads.
+   See ksba_certindex_find_subject for details.  */
+gpg_error_t
+ksba_certindex_find_issuer (ksba_certindex_t index, ksba_cert_t cert,
+                            int idx, ksba_cert_t *r_cert)
+{
+  gpg_error_t err;
+  const unsigned char *issuer, *keyid;
+  size_t issuerlen, keyidlen;
+  const struct item_s *item;
+  uint64_t hash;
+  size_t i;
+  int count = 0;
+
+  if (r_cert)
+    *r_cert = NULL;
+  if (!index || !cert || !r_cert)
+    return gpg_error (GPG_ERR_INV_VALUE);
+  if (idx < 0)
+    return gpg_error (GPG_ERR_INV_INDEX);
+
+  err = _ksba_cert_get_issuer_dn_ptr (cert, &issuer, &issuerlen);
+  if (err)
+    return err;
+  if (_ksba_cert_get_auth_key_id_ptr (cert, &keyid, &keyidlen))
+    keyid = NULL;
+  if (!index->nbuckets)
+    return gpg_error (GPG_ERR_NOT_FOUND);
+
+  hash = _ksba_hash64 (issuer, issuerlen);
+  for (i = index->buckets[KEY_SUBJECT][hash & (index->nbuckets - 1)];
+       i; i = item->next[KEY_SUBJECT])
+    {
+      item = index->items + i - 1;
+      if (!item_matches (item, KEY_SUBJECT, hash, issuer, issuerlen, NULL, 0))
+        continue;
+      if (keyid && item->key[KEY_SKI]
+          && (item->keylen[KEY_SKI] != keyidlen
+              || memcmp (item->key[KEY_SKI], keyid, keyidlen)))
+        continue;
+      if (count++ == idx)
+        {
+          *r_cert = item->cert;
+          return 0;
+        }
+    }
+  return gpg_error (count? GPG_ERR_EOF : GPG_ERR_NOT_FOUND);
+}
@@ -35,6 +35,8 @@
 #include <assert.h>
 #include <errno.h>
 
+#define STATS_MODULE KSBA_STATS_MOD_CERTREQ
+
 #include "util.h"
 
 #include "cms.h"
@@ -630,241 +632,95 @@ ksba_certreq_set_sig_val (ksba_certreq_t cr, ksba_const_sexp_t sigval)
 
 
 
-/* Build the extension block and return it in R_DER and R_DERLEN.  IF
-   CERTMODE is true build X.509 certificate extension instead.  */
-static gpg_error_t
-build_extensions (ksba_certreq_t cr, int certmode,
-                  void **r_der, size_t *r_derlen)
+/* Add the extension block to the builder D.  IF CERTMODE is true
+   build X.509 certificate extension instead.  */
+static void
+add_extensions (ksba_certreq_t cr, int certmode, ksba_der_t d)
 {
-  gpg_error_t err;
-  ksba_writer_t writer, w=NULL;
   struct extn_list_s *e;
-  unsigned char *value = NULL;
-  size_t valuelen;
-  unsigned char *p;
-  size_t n;
 
-  *r_der = NULL;
-  *r_derlen = 0;
-  err = ksba_writer_new (&writer);
-  if (err)
-    goto leave;
-  err = ksba_writer_set_mem (writer, 2048);
-  if (err)
-    goto leave;
-  err = ksba_writer_new (&w);
-  if (err)
-    goto leave;
-
-  for (e=cr->extn_list; e; e = e->next)
+  if (!certmode)
     {
-      err = ksba_writer_set_mem (w, e->derlen + 100);
-      if (err)
-        goto leave;
-
-      err = ksba_oid_from_str (e->oid, &p, &n);
-      if(err)
-        goto leave;
-      err = _ksba_ber_write_tl (w, TYPE_OBJECT_ID, CLASS_UNIVERSAL, 0, n);
-      if (!err)
-        err = ksba_writer_write (w, p, n);
-      xfree (p);
-
-      if (e->critical)
-        {
-          err = _ksba_ber_write_tl (w, TYPE_BOOLEAN, CLASS_UNIVERSAL, 0, 1);
-          if (!err)
-            err = ksba_writer_write (w, "\xff", 1);
-          if(err)
-            goto leave;
-        }
-
-      err = _ksba_ber_write_tl (w, TYPE_OCTET_STRING, CLASS_UNIVERSAL,
-                                0, e->derlen);
-      if (!err)
-        err = ksba_writer_write (w, e->der, e->derlen);
-      if(err)
-        goto leave;
-
-      p = ksba_writer_snatch_mem (w, &n);
-      if (!p)
-        {
-          err = gpg_error (GPG_ERR_ENOMEM);
-          goto leave;
-        }
-      err = _ksba_ber_write_tl (writer, TYPE_SEQUENCE, CLASS_UNIVERSAL,
-                                1, n);
-      if (!err)
-        err = ksba_writer_write (writer, p, n);
-      xfree (p); p = NULL;
-      if (err)
-        goto leave;
+      /* The extension request sequence.  */
+      _ksba_der_add_tag (d, 0, TYPE_SEQUENCE);
+      _ksba_der_add_oid (d, oidstr_extensionReq);
+      _ksba_der_add_tag (d, 0, TYPE_SET);
     }
 
   /* Embed all the sequences into another sequence */
-  value = ksba_writer_snatch_mem (writer, &valuelen);
-  if (!value)
-    {
-      err = gpg_error (GPG_ERR_ENOMEM);
-      goto leave;
-    }
-  err = ksba_writer_set_mem (writer, valuelen+10);
-  if (err)
-    goto leave;
-  err = _ksba_ber_write_tl (writer, TYPE_SEQUENCE, CLASS_UNIVERSAL,
-                            1, valuelen);
-  if (!err)
-    err = ksba_writer_write (writer, value, valuelen);
-  if (err)
-    goto leave;
-
-  xfree (value);
-  value = ksba_writer_snatch_mem (writer, &valuelen);
-  if (!value)
+  _ksba_der_add_tag (d, 0, TYPE_SEQUENCE);
+  for (e=cr->extn_list; e; e = e->next)
     {
-      err = gpg_error (GPG_ERR_ENOMEM);
-      goto leave;
+      _ksba_der_add_tag (d, 0, TYPE_SEQUENCE);
+      _ksba_der_add_oid (d, e->oid);
+      if (e->critical)
+        _ksba_der_add_ptr (d, 0, TYPE_BOOLEAN, "\xff", 1);
+      _ksba_der_add_ptr (d, 0, TYPE_OCTET_STRING, e->der, e->derlen);
+      _ksba_der_add_end (d);
     }
+  _ksba_der_add_end (d);
 
   if (!certmode)
     {
-      /* Now create the extension request sequence content */
-      err = ksba_writer_set_mem (writer, valuelen+100);
-      if (err)
-        goto leave;
-      err = ksba_oid_from_str (oidstr_extensionReq, &p, &n);
-      if(err)
-        goto leave;
-      err = _ksba_ber_write_tl (writer, TYPE_OBJECT_ID, CLASS_UNIVERSAL, 0, n);
-      if (!err)
-        err = ksba_writer_write (writer, p, n);
-      xfree (p); p = NULL;
-      if (err)
-        return err;
-      err = _ksba_ber_write_tl (writer, TYPE_SET, CLASS_UNIVERSAL, 1, valuelen);
-      if (!err)
-        err = ksba_writer_write (writer, value, valuelen);
-
-      /* Put this all into a SEQUENCE */
-      xfree (value);
-      value = ksba_writer_snatch_mem (writer, &valuelen);
-      if (!value)
-        {
-          err = gpg_error (GPG_ERR_ENOMEM);
-          goto leave;
-        }
-      err = ksba_writer_set_mem (writer, valuelen+10);
-      if (err)
-        goto leave;
-      err = _ksba_ber_write_tl (writer, TYPE_SEQUENCE, CLASS_UNIVERSAL,
-                                1, valuelen);
-      if (!err)
-        err = ksba_writer_write (writer, value, valuelen);
-      if (err)
-        goto leave;
-
-      xfree (value);
-      value = ksba_writer_snatch_mem (writer, &valuelen);
-      if (!value)
-        {
-          err = gpg_error (GPG_ERR_ENOMEM);
-          goto leave;
-        }
+      _ksba_der_add_end (d);
+      _ksba_der_add_end (d);
     }
-
-  *r_der = value;
-  *r_derlen = valuelen;
-  value = NULL;
-
-
- leave:
-  ksba_writer_release (writer);
-  ksba_writer_release (w);
-  xfree (value);
-  return err;
 }
 
 
-/* Build a value tree from the already stored values. */
+/* Build the cri from the already stored values.  */
 static gpg_error_t
 build_cri (ksba_certreq_t cr)
 {
   gpg_error_t err;
-  ksba_writer_t writer;
-  void *value = NULL;
-  size_t valuelen;
+  ksba_der_t dbld;
   int certmode;
 
   /* If a serial number has been set, we don't create a CSR but a
      proper certificate.  */
   certmode = !!cr->x509.serial.der;
 
-  err = ksba_writer_new (&writer);
-  if (err)
-    goto leave;
-  err = ksba_writer_set_mem (writer, 2048);
-  if (err)
-    goto leave;
+  if (!cr->key.der || !cr->subject.der)
+    return gpg_error (GPG_ERR_MISSING_VALUE);
+  if (certmode && !cr->x509.siginfo.der)
+    return gpg_error (GPG_ERR_MISSING_VALUE);
 
-  if (!cr->key.der)
-    {
-      err = gpg_error (GPG_ERR_MISSING_VALUE);
-      goto leave;
-    }
+  dbld = _ksba_der_builder_new (0);
+  if (!dbld)
+    return gpg_error_from_syserror ();
 
-  /* We write all stuff out to a temporary writer object, then use
-     this object to create the cri and store the cri image */
+  /* The entire cri is constructed in one go with the builder.  */
+  _ksba_der_add_tag (dbld, 0, TYPE_SEQUENCE);
 
   if (certmode)
     {
       /* Store the version structure; version is 3 (encoded as 2):
          [0] { INTEGER 2 }  */
-      err = ksba_writer_write (writer, "\xa0\x03\x02\x01\x02", 5);
+      _ksba_der_add_der (dbld, "\xa0\x03\x02\x01\x02", 5);
     }
   else
     {
       /* Store version v1 (which is a 0).  */
-      err = _ksba_ber_write_tl (writer, TYPE_INTEGER, CLASS_UNIVERSAL, 0, 1);
-      if (!err)
-        err = ksba_writer_write (writer, "", 1);
+      _ksba_der_add_ptr (dbld, 0, TYPE_INTEGER, "", 1);
     }
-  if (err)
-    goto leave;
 
   /* For a certificate we need to store the s/n, the signature
      algorithm identifier, the issuer DN and the validity.  */
   if (certmode)
     {
       /* Store the serial number. */
-      err = _ksba_ber_write_tl (writer, TYPE_INTEGER, CLASS_UNIVERSAL, 0,
-                                cr->x509.serial.derlen);
-      if (!err)
-        err = ksba_writer_write (writer,
-                                 cr->x509.serial.der, cr->x509.serial.derlen);
-      if (err)
-        goto leave;
+      _ksba_der_add_ptr (dbld, 0, TYPE_INTEGER,
+                         cr->x509.serial.der, cr->x509.serial.derlen);
 
       /* Store the signature algorithm identifier.  */
-      if (!cr->x509.siginfo.der)
-        err = gpg_error (GPG_ERR_MISSING_VALUE);
-      else
-        err = ksba_writer_write (writer,
-                                 cr->x509.siginfo.der, cr->x509.siginfo.derlen);
-      if (err)
-        goto leave;
-
+      _ksba_der_add_der (dbld, cr->x509.siginfo.der, cr->x509.siginfo.derlen);
 
       /* Store the issuer DN.  If no issuer DN has been set we use the
          subject DN.  */
       if (cr->x509.issuer.der)
-        err = ksba_writer_write (writer,
-                                 cr->x509.issuer.der, cr->x509.issuer.derlen);
-      else if (cr->subject.der)
-        err = ksba_writer_write (writer, cr->subject.der, cr->subject.derlen);
+        _ksba_der_add_der (dbld, cr->x509.issuer.der, cr->x509.issuer.derlen);
       else
-        err = gpg_error (GPG_ERR_MISSING_VALUE);
-      if (err)
-        goto leave;
+        _ksba_der_add_der (dbld, cr->subject.der, cr->subject.derlen);
 
       /* Store the Validity.  */
       {
@@ -935,26 +791,15 @@ build_cri (ksba_certreq_t cr)
         assert (tp - templ <= 36);
         templ[1] = tp - templ - 2;  /* Fixup the sequence length.  */
 
-        err = ksba_writer_write (writer, templ, tp - templ);
-        if (err)
-          goto leave;
+        _ksba_der_add_der (dbld, templ, tp - templ);
       }
     }
 
   /* store the subject */
-  if (!cr->subject.der)
-    {
-      err = gpg_error (GPG_ERR_MISSING_VALUE);
-      goto leave;
-    }
-  err = ksba_writer_write (writer, cr->subject.der, cr->subject.derlen);
-  if (err)
-    goto leave;
+  _ksba_der_add_der (dbld, cr->subject.der, cr->subject.derlen);
 
   /* store the public key info */
-  err = ksba_writer_write (writer, cr->key.der, cr->key.derlen);
-  if (err)
-    goto leave;
+  _ksba_der_add_der (dbld, cr->key.der, cr->key.derlen);
 
   /* Copy generalNames objects to the extension list. */
   if (cr->subject_alt_names)
@@ -974,58 +819,24 @@ build_cri (ksba_certreq_t cr)
 
 
   /* Write the extensions.  Note that the implicit SET OF is REQUIRED */
-  xfree (value); value = NULL;
-  valuelen = 0;
   if (cr->extn_list)
     {
-      err = build_extensions (cr, certmode, &value, &valuelen);
-      if (err)
-        goto leave;
-      err = _ksba_ber_write_tl (writer, certmode? 3:0,
-                                CLASS_CONTEXT, 1, valuelen);
-      if (!err)
-        err = ksba_writer_write (writer, value, valuelen);
-      if (err)
-        goto leave;
+      _ksba_der_add_tag (dbld, CLASS_CONTEXT, certmode? 3:0);
+      add_extensions (cr, certmode, dbld);
+      _ksba_der_add_end (dbld);
     }
   else
-    { /* We can't write an object of length zero using our ber_write
-         function.  So we must open encode it. */
-      err = ksba_writer_write (writer,
-                               certmode? "\xa3\x02\x30":"\xa0\x02\x30", 4);
-      if (err)
-        goto leave;
-    }
-
-
-  /* pack it into the sequence */
-  xfree (value);
-  value = ksba_writer_snatch_mem (writer, &valuelen);
-  if (!value)
-    {
-      err = gpg_error (GPG_ERR_ENOMEM);
-      goto leave;
+    { /* The builder would encode an empty constructed object with an
+         indefinite length.  So we must open encode it. */
+      _ksba_der_add_der (dbld, certmode? "\xa3\x02\x30":"\xa0\x02\x30", 4);
     }
-  /* reinitialize the buffer to create the outer sequence */
-  err = ksba_writer_set_mem (writer, valuelen+10);
-  if (err)
-    goto leave;
-  /* write outer sequence */
-  err = _ksba_ber_write_tl (writer, TYPE_SEQUENCE, CLASS_UNIVERSAL,
-                            1, valuelen);
-  if (!err)
-    err = ksba_writer_write (writer, value, valuelen);
-  if (err)
-    goto leave;
 
-  /* and store the final result */
-  cr->cri.der = ksba_writer_snatch_mem (writer, &cr->cri.derlen);
-  if (!cr->cri.der)
-    err = gpg_error (GPG_ERR_ENOMEM);
+  /* Close the outer sequence and store the final result.  */
+  _ksba_der_add_end (dbld);
+  err = _ksba_der_builder_get (dbld, &cr->cri.der, &cr->cri.derlen);
 
  leave:
-  ksba_writer_release (writer);
-  xfree (value);
+  _ksba_der_release (dbld);
   return err;
 }
 
@@ -1036,6 +847,8 @@ hash_cri (ksba_certreq_t cr)
     return gpg_error (GPG_ERR_MISSING_ACTION);
   if (!cr->cri.der)
     return gpg_error (GPG_ERR_INV_STATE);
+  STATS_ADD (hash_calls, 1);
+  STATS_ADD (hash_bytes, cr->cri.derlen);
   cr->hash_fnc (cr->hash_fnc_arg, cr->cri.der, cr->cri.derlen);
   return 0;
 }
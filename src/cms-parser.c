@@ -42,6 +42,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#define STATS_MODULE KSBA_STATS_MOD_CMS
+
 #include "util.h"
 
 #include "cms.h"
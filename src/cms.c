@@ -42,6 +42,8 @@
 #include <assert.h>
 #include <errno.h>
 
+#define STATS_MODULE KSBA_STATS_MOD_CMS
+
 #include "util.h"
 
 #include "cms.h"
@@ -52,6 +54,7 @@
 #include "sexp-parse.h"
 #include "cert.h"
 #include "der-builder.h"
+#include "reader.h"
 
 
 static gpg_error_t ct_parse_data (ksba_cms_t cms);
@@ -177,19 +180,24 @@ read_hash_block (ksba_cms_t cms, unsigned long nleft)
 {
   gpg_error_t err;
   char buffer[4096];
+  const char *p;
   size_t n, nread;
 
   while (nleft)
     {
       n = nleft < sizeof (buffer)? nleft : sizeof (buffer);
-      err = ksba_reader_read (cms->reader, buffer, n, &nread);
+      err = _ksba_reader_read_ptr (cms->reader, buffer, n, &p, &nread);
       if (err)
         return err;
       nleft -= nread;
       if (cms->hash_fnc)
-        cms->hash_fnc (cms->hash_fnc_arg, buffer, nread);
+        {
+          STATS_ADD (hash_calls, 1);
+          STATS_ADD (hash_bytes, nread);
+          cms->hash_fnc (cms->hash_fnc_arg, p, nread);
+        }
       if (cms->writer)
-        err = ksba_writer_write (cms->writer, buffer, nread);
+        err = ksba_writer_write (cms->writer, p, nread);
       if (err)
         return err;
     }
@@ -415,6 +423,7 @@ write_encrypted_cont (ksba_cms_t cms)
 {
   gpg_error_t err = 0;
   char buffer[4096];
+  const char *p;
   size_t nread;
 
   /* we do it the simple way: the parts are made up from the chunks we
@@ -423,13 +432,13 @@ write_encrypted_cont (ksba_cms_t cms)
      Fixme: We should write the tag here, and write a definite length
      header if everything fits into our local buffer.  Actually pretty
      simple to do, but I am too lazy right now. */
-  while (!(err = ksba_reader_read (cms->reader, buffer,
-                                   sizeof buffer, &nread)) )
+  while (!(err = _ksba_reader_read_ptr (cms->reader, buffer, sizeof buffer,
+                                       &p, &nread)) )
     {
       err = _ksba_ber_write_tl (cms->writer, TYPE_OCTET_STRING,
                                 CLASS_UNIVERSAL, 0, nread);
       if (!err)
-        err = ksba_writer_write (cms->writer, buffer, nread);
+        err = ksba_writer_write (cms->writer, p, nread);
     }
   if (gpg_err_code (err) == GPG_ERR_EOF) /* write the end tag */
       err = _ksba_ber_write_tl (cms->writer, 0, 0, 0, 0);
@@ -648,15 +657,14 @@ ksba_cms_set_reader_writer (ksba_cms_t cms, ksba_reader_t r, ksba_writer_t w)
 
 
 
-gpg_error_t
-ksba_cms_parse (ksba_cms_t cms, ksba_stop_reason_t *r_stopreason)
+/* Run the next step of the parser.  This is the actual code of
+   ksba_cms_parse.  */
+static gpg_error_t
+cms_parse_step (ksba_cms_t cms, ksba_stop_reason_t *r_stopreason)
 {
   gpg_error_t err;
   int i;
 
-  if (!cms || !r_stopreason)
-    return gpg_error (GPG_ERR_INV_VALUE);
-
   *r_stopreason = KSBA_SR_RUNNING;
   if (!cms->stop_reason)
     { /* Initial state: start parsing */
@@ -689,6 +697,23 @@ ksba_cms_parse (ksba_cms_t cms, ksba_stop_reason_t *r_stopreason)
   return 0;
 }
 
+
+gpg_error_t
+ksba_cms_parse (ksba_cms_t cms, ksba_stop_reason_t *r_stopreason)
+{
+  gpg_error_t err;
+
+  if (!cms || !r_stopreason)
+    return gpg_error (GPG_ERR_INV_VALUE);
+
+  TRACE (KSBA_TRACE_CMS_PARSE_START, cms->stop_reason, 0,
+         cms->reader? ksba_reader_tell (cms->reader) : 0, cms, NULL);
+  err = cms_parse_step (cms, r_stopreason);
+  TRACE (KSBA_TRACE_CMS_PARSE_END, *r_stopreason, err,
+         cms->reader? ksba_reader_tell (cms->reader) : 0, cms, NULL);
+  return err;
+}
+
 gpg_error_t
 ksba_cms_build (ksba_cms_t cms, ksba_stop_reason_t *r_stopreason)
 {
@@ -1540,6 +1565,8 @@ ksba_cms_hash_signed_attrs (ksba_cms_t cms, int idx)
     return gpg_error (GPG_ERR_NO_VALUE);
 
   /* We don't hash the implicit tag [0] but a SET tag */
+  STATS_ADD (hash_calls, 2);
+  STATS_ADD (hash_bytes, n->nhdr + n->len);
   cms->hash_fnc (cms->hash_fnc_arg, "\x31", 1);
   cms->hash_fnc (cms->hash_fnc_arg,
                  si->image + n->off + 1, n->nhdr + n->len - 1);
@@ -2589,64 +2616,59 @@ build_signed_data_header (ksba_cms_t cms)
   return err;
 }
 
-/* Set the issuer/serial from the cert to the node.
-   mode 0: sid
-   mode 1: rid
- */
+/* Add the issuerAndSerialNumber of CERT to the builder D.  */
 static gpg_error_t
-set_issuer_serial (AsnNode info, ksba_cert_t cert, int mode)
+add_issuer_serial (ksba_der_t d, ksba_cert_t cert)
 {
   gpg_error_t err;
-  AsnNode dst, src;
-
-  if (!info || !cert)
-    return gpg_error (GPG_ERR_INV_VALUE);
+  const unsigned char *der;
+  size_t derlen;
 
-  src = _ksba_asn_find_node (cert->root,
-                             "Certificate.tbsCertificate.serialNumber");
-  dst = _ksba_asn_find_node (info,
-                             mode?
-                             "rid.issuerAndSerialNumber.serialNumber":
-                             "sid.issuerAndSerialNumber.serialNumber");
-  err = _ksba_der_copy_tree (dst, src, cert->image);
+  _ksba_der_add_tag (d, 0, TYPE_SEQUENCE);
+  err = _ksba_cert_get_issuer_dn_ptr (cert, &der, &derlen);
   if (err)
     return err;
-
-  src = _ksba_asn_find_node (cert->root,
-                             "Certificate.tbsCertificate.issuer");
-  dst = _ksba_asn_find_node (info,
-                             mode?
-                             "rid.issuerAndSerialNumber.issuer":
-                             "sid.issuerAndSerialNumber.issuer");
-  err = _ksba_der_copy_tree (dst, src, cert->image);
+  _ksba_der_add_der (d, der, derlen);
+  err = _ksba_cert_get_serial_ptr (cert, &der, &derlen);
   if (err)
     return err;
-
+  _ksba_der_add_der (d, der, derlen);
+  _ksba_der_add_end (d);
   return 0;
 }
 
 
-/* Store the sequence of capabilities at NODE */
+/* Add the time ATIME to the builder D.  We need to use
+   GeneralizedTime beginning with the year 2050.  */
 static gpg_error_t
-store_smime_capability_sequence (AsnNode node,
-                                 struct oidparmlist_s *capabilities)
+add_time (ksba_der_t d, const ksba_isotime_t atime)
 {
   gpg_error_t err;
-  struct oidparmlist_s *cap, *cap2;
-  unsigned char *value;
-  size_t valuelen;
-  ksba_writer_t tmpwrt;
+  char buf[15];
 
-  err = ksba_writer_new (&tmpwrt);
+  err = _ksba_assert_time_format (atime);
   if (err)
     return err;
-  err = ksba_writer_set_mem (tmpwrt, 512);
-  if (err)
-    {
-      ksba_writer_release (tmpwrt);
-      return err;
-    }
 
+  memcpy (buf, atime, 8);
+  memcpy (buf+8, atime+9, 6);
+  buf[14] = 'Z';
+  if (_ksba_cmp_time (atime, "20500101T000000") >= 0)
+    _ksba_der_add_val (d, 0, TYPE_GENERALIZED_TIME, buf, 15);
+  else
+    _ksba_der_add_val (d, 0, TYPE_UTC_TIME, buf+2, 13);
+  return 0;
+}
+
+
+/* Add the sequence of capabilities to the builder D.  */
+static void
+add_smime_capability_sequence (ksba_der_t d,
+                               struct oidparmlist_s *capabilities)
+{
+  struct oidparmlist_s *cap, *cap2;
+
+  _ksba_der_add_tag (d, 0, TYPE_SEQUENCE);
   for (cap=capabilities; cap; cap = cap->next)
     {
       /* (avoid writing duplicates) */
@@ -2664,31 +2686,20 @@ store_smime_capability_sequence (AsnNode node,
              of the algorithm identifier where ist is allowed and in
              some profiles (e.g. tmttv2) even explicitly suggested to
              use NULL.  */
-          err = _ksba_der_write_algorithm_identifier
-                 (tmpwrt, cap->oid,
-                  cap->parmlen?cap->parm:(const void*)"", cap->parmlen);
-          if (err)
-            {
-              ksba_writer_release (tmpwrt);
-              return err;
-            }
+          _ksba_der_add_tag (d, 0, TYPE_SEQUENCE);
+          _ksba_der_add_oid (d, cap->oid);
+          if (cap->parmlen)
+            _ksba_der_add_ptr (d, 0, TYPE_OCTET_STRING,
+                               cap->parm, cap->parmlen);
+          _ksba_der_add_end (d);
         }
     }
-
-  value = ksba_writer_snatch_mem (tmpwrt, &valuelen);
-  if (!value)
-    err = gpg_error (GPG_ERR_ENOMEM);
-  if (!err)
-    err = _ksba_der_store_sequence (node, value, valuelen);
-  xfree (value);
-  ksba_writer_release (tmpwrt);
-  return err;
+  _ksba_der_add_end (d);
 }
 
 
 /* An object used to construct the signed attributes. */
 struct attrarray_s {
-  AsnNode root;
   unsigned char *image;
   size_t imagelen;
 };
@@ -2716,6 +2727,177 @@ compare_attrarray (const void *a_v, const void *b_v)
 }
 
 
+/* Close the SET with the value and the SEQUENCE of the attribute
+   started in D and store its encoding at ATTR.  */
+static gpg_error_t
+finish_attribute (ksba_der_t d, struct attrarray_s *attr)
+{
+  _ksba_der_add_end (d);
+  _ksba_der_add_end (d);
+  return _ksba_der_builder_get (d, &attr->image, &attr->imagelen);
+}
+
+
+/* Allocate a node for the value tree of the signed attributes and
+   link it to PARENT or, if not NULL, to its left sibling PREV.  The
+   node is also appended to the list at *LINKP so that the entire tree
+   can be released with _ksba_asn_release_nodes.  */
+static AsnNode
+new_attr_node (AsnNode **linkp, AsnNode parent, AsnNode prev,
+               node_type_t type, const char *name,
+               const unsigned char *image, const unsigned char *p,
+               const struct tag_info *ti)
+{
+  AsnNode node;
+
+  node = xtrycalloc (1, sizeof *node);
+  if (!node)
+    return NULL;
+  if (name && !(node->name = xtrystrdup (name)))
+    {
+      xfree (node);
+      return NULL;
+    }
+  node->type = type;
+  node->off = (p - image) - ti->nhdr;
+  node->nhdr = ti->nhdr;
+  node->len = ti->length;
+  if (prev)
+    {
+      prev->right = node;
+      node->left = prev;
+    }
+  else if (parent)
+    {
+      parent->down = node;
+      node->left = parent;
+    }
+  **linkp = node;
+  *linkp = &node->link_next;
+  return node;
+}
+
+
+/* Create the value tree for IMAGE, which is a SignerInfo with only
+   the signedAttrs as built by build_signed_data_attributes.  Only
+   the nodes needed by the functions accessing the signed attributes
+   are created; the structure is the same as the one of a parsed
+   SignerInfo.  */
+static gpg_error_t
+make_signed_attrs_tree (const unsigned char *image, size_t imagelen,
+                        AsnNode *r_root)
+{
+  gpg_error_t err;
+  const unsigned char *p = image;
+  size_t n = imagelen;
+  size_t attrsend, attrend, setend;
+  struct tag_info ti;
+  AsnNode root = NULL;
+  AsnNode *linkp = &root;
+  AsnNode attrs, attr, type, values, value;
+
+  *r_root = NULL;
+
+  err = _ksba_ber_parse_tl (&p, &n, &ti);
+  if (err)
+    goto leave;
+  if (!new_attr_node (&linkp, NULL, NULL, TYPE_SEQUENCE, "SignerInfo",
+                      image, p, &ti))
+    goto leave_oom;
+  err = _ksba_ber_parse_tl (&p, &n, &ti);
+  if (err)
+    goto leave;
+  if (ti.class != CLASS_CONTEXT || ti.tag || ti.length > n)
+    {
+      err = gpg_error (GPG_ERR_BUG);
+      goto leave;
+    }
+  attrs = new_attr_node (&linkp, root, NULL, TYPE_SET_OF, "signedAttrs",
+                         image, p, &ti);
+  if (!attrs)
+    goto leave_oom;
+  attrsend = n - ti.length;
+
+  for (attr = NULL; n > attrsend; )
+    {
+      err = _ksba_ber_parse_tl (&p, &n, &ti);
+      if (err)
+        goto leave;
+      if (ti.tag != TYPE_SEQUENCE || ti.length > n)
+        {
+          err = gpg_error (GPG_ERR_BUG);
+          goto leave;
+        }
+      attr = new_attr_node (&linkp, attrs, attr, TYPE_SEQUENCE, NULL,
+                            image, p, &ti);
+      if (!attr)
+        goto leave_oom;
+      attrend = n - ti.length;
+
+      err = _ksba_ber_parse_tl (&p, &n, &ti);
+      if (err)
+        goto leave;
+      if (ti.tag != TYPE_OBJECT_ID || ti.length > n)
+        {
+          err = gpg_error (GPG_ERR_BUG);
+          goto leave;
+        }
+      type = new_attr_node (&linkp, attr, NULL, TYPE_OBJECT_ID, "attrType",
+                            image, p, &ti);
+      if (!type)
+        goto leave_oom;
+      p += ti.length;
+      n -= ti.length;
+
+      err = _ksba_ber_parse_tl (&p, &n, &ti);
+      if (err)
+        goto leave;
+      if (ti.tag != TYPE_SET || ti.length > n)
+        {
+          err = gpg_error (GPG_ERR_BUG);
+          goto leave;
+        }
+      values = new_attr_node (&linkp, attr, type, TYPE_SET_OF, "attrValues",
+                              image, p, &ti);
+      if (!values)
+        goto leave_oom;
+      setend = n - ti.length;
+
+      for (value = NULL; n > setend; )
+        {
+          err = _ksba_ber_parse_tl (&p, &n, &ti);
+          if (err)
+            goto leave;
+          if (ti.class != CLASS_UNIVERSAL || ti.length > n)
+            {
+              err = gpg_error (GPG_ERR_BUG);
+              goto leave;
+            }
+          value = new_attr_node (&linkp, values, value, ti.tag, NULL,
+                                 image, p, &ti);
+          if (!value)
+            goto leave_oom;
+          p += ti.length;
+          n -= ti.length;
+        }
+      if (n != attrend)
+        {
+          err = gpg_error (GPG_ERR_BUG);
+          goto leave;
+        }
+    }
+
+  *r_root = root;
+  return 0;
+
+ leave_oom:
+  err = gpg_error_from_syserror ();
+ leave:
+  _ksba_asn_release_nodes (root);
+  return err;
+}
+
+
 
 
 /* Write the END of data NULL tag and everything we can write before
@@ -2725,11 +2907,10 @@ build_signed_data_attributes (ksba_cms_t cms)
 {
   gpg_error_t err;
   int signer;
-  ksba_asn_tree_t cms_tree = NULL;
   struct certlist_s *certlist;
   struct oidlist_s *digestlist;
   struct signer_info_s *si, **si_tail;
-  AsnNode root = NULL;
+  ksba_der_t dbld = NULL;
   struct attrarray_s attrarray[4];
   int attridx = 0;
   int i;
@@ -2779,37 +2960,27 @@ build_signed_data_attributes (ksba_cms_t cms)
 
   /* Now we have to prepare the signer info.  For now we will just build the
      signedAttributes, so that the user can do the signature calculation */
-  err = ksba_asn_create_tree ("cms", &cms_tree);
-  if (err)
-    return err;
-
   certlist = cms->cert_list;
   if (!certlist)
-    {
-      err = gpg_error (GPG_ERR_MISSING_VALUE); /* oops */
-      goto leave;
-    }
+    return gpg_error (GPG_ERR_MISSING_VALUE); /* oops */
   digestlist = cms->digest_algos;
   if (!digestlist)
-    {
-      err = gpg_error (GPG_ERR_MISSING_VALUE); /* oops */
-      goto leave;
-    }
+    return gpg_error (GPG_ERR_MISSING_VALUE); /* oops */
+
+  /* The same builder is used for all attributes and signers.  */
+  dbld = _ksba_der_builder_new (0);
+  if (!dbld)
+    return gpg_error_from_syserror ();
 
   si_tail = &cms->signer_info;
   for (signer=0; certlist;
        signer++, certlist = certlist->next, digestlist = digestlist->next)
     {
-      AsnNode attr;
-      AsnNode n;
       unsigned char *image;
       size_t imagelen;
 
       for (i = 0; i < attridx; i++)
-        {
-          _ksba_asn_release_nodes (attrarray[i].root);
-          xfree (attrarray[i].image);
-        }
+        xfree (attrarray[i].image);
       attridx = 0;
       memset (attrarray, 0, sizeof (attrarray));
 
@@ -2826,148 +2997,56 @@ build_signed_data_attributes (ksba_cms_t cms)
 	}
 
       /* Include the pretty important message digest. */
-      attr = _ksba_asn_expand_tree (cms_tree->parse_tree,
-                                    "CryptographicMessageSyntax.Attribute");
-      if (!attr)
-        {
-	  err = gpg_error (GPG_ERR_ELEMENT_NOT_FOUND);
-	  goto leave;
-	}
-      n = _ksba_asn_find_node (attr, "Attribute.attrType");
-      if (!n)
-        {
-	  err = gpg_error (GPG_ERR_ELEMENT_NOT_FOUND);
-	  goto leave;
-	}
-      err = _ksba_der_store_oid (n, oidstr_messageDigest);
-      if (err)
-        goto leave;
-      n = _ksba_asn_find_node (attr, "Attribute.attrValues");
-      if (!n || !n->down)
-        return gpg_error (GPG_ERR_ELEMENT_NOT_FOUND);
-      n = n->down; /* fixme: ugly hack */
       assert (certlist && certlist->msg_digest_len);
-      err = _ksba_der_store_octet_string (n, certlist->msg_digest,
-                                          certlist->msg_digest_len);
-      if (err)
-        goto leave;
-      err = _ksba_der_encode_tree (attr, &image, &imagelen);
+      _ksba_der_builder_reset (dbld);
+      _ksba_der_add_tag (dbld, 0, TYPE_SEQUENCE);
+      _ksba_der_add_oid (dbld, oidstr_messageDigest);
+      _ksba_der_add_tag (dbld, 0, TYPE_SET);
+      _ksba_der_add_ptr (dbld, 0, TYPE_OCTET_STRING,
+                         certlist->msg_digest, certlist->msg_digest_len);
+      err = finish_attribute (dbld, attrarray + attridx);
       if (err)
         goto leave;
-      attrarray[attridx].root = attr;
-      attrarray[attridx].image = image;
-      attrarray[attridx].imagelen = imagelen;
       attridx++;
 
       /* Include the content-type attribute. */
-      attr = _ksba_asn_expand_tree (cms_tree->parse_tree,
-                                    "CryptographicMessageSyntax.Attribute");
-      if (!attr)
-        {
-	  err = gpg_error (GPG_ERR_ELEMENT_NOT_FOUND);
-	  goto leave;
-	}
-      n = _ksba_asn_find_node (attr, "Attribute.attrType");
-      if (!n)
-        {
-	  err = gpg_error (GPG_ERR_ELEMENT_NOT_FOUND);
-	  goto leave;
-	}
-      err = _ksba_der_store_oid (n, oidstr_contentType);
-      if (err)
-	goto leave;
-      n = _ksba_asn_find_node (attr, "Attribute.attrValues");
-      if (!n || !n->down)
-        {
-	  err = gpg_error (GPG_ERR_ELEMENT_NOT_FOUND);
-	  goto leave;
-	}
-      n = n->down; /* fixme: ugly hack */
-      err = _ksba_der_store_oid (n, cms->inner_cont_oid);
+      _ksba_der_builder_reset (dbld);
+      _ksba_der_add_tag (dbld, 0, TYPE_SEQUENCE);
+      _ksba_der_add_oid (dbld, oidstr_contentType);
+      _ksba_der_add_tag (dbld, 0, TYPE_SET);
+      _ksba_der_add_oid (dbld, cms->inner_cont_oid);
+      err = finish_attribute (dbld, attrarray + attridx);
       if (err)
         goto leave;
-      err = _ksba_der_encode_tree (attr, &image, &imagelen);
-      if (err)
-        goto leave;
-      attrarray[attridx].root = attr;
-      attrarray[attridx].image = image;
-      attrarray[attridx].imagelen = imagelen;
       attridx++;
 
       /* Include the signing time */
       if (*certlist->signing_time)
         {
-          attr = _ksba_asn_expand_tree (cms_tree->parse_tree,
-                                     "CryptographicMessageSyntax.Attribute");
-          if (!attr)
-            {
-	      err = gpg_error (GPG_ERR_ELEMENT_NOT_FOUND);
-	      goto leave;
-	    }
-          n = _ksba_asn_find_node (attr, "Attribute.attrType");
-          if (!n)
-            {
-	      err = gpg_error (GPG_ERR_ELEMENT_NOT_FOUND);
-	      goto leave;
-	    }
-          err = _ksba_der_store_oid (n, oidstr_signingTime);
-          if (err)
-            goto leave;
-          n = _ksba_asn_find_node (attr, "Attribute.attrValues");
-          if (!n || !n->down)
-            {
-	      err = gpg_error (GPG_ERR_ELEMENT_NOT_FOUND);
-	      goto leave;
-	    }
-          n = n->down; /* fixme: ugly hack */
-          err = _ksba_der_store_time (n, certlist->signing_time);
+          _ksba_der_builder_reset (dbld);
+          _ksba_der_add_tag (dbld, 0, TYPE_SEQUENCE);
+          _ksba_der_add_oid (dbld, oidstr_signingTime);
+          _ksba_der_add_tag (dbld, 0, TYPE_SET);
+          err = add_time (dbld, certlist->signing_time);
           if (err)
             goto leave;
-          err = _ksba_der_encode_tree (attr, &image, &imagelen);
+          err = finish_attribute (dbld, attrarray + attridx);
           if (err)
             goto leave;
-          /* We will use the attributes again - so save them */
-          attrarray[attridx].root = attr;
-          attrarray[attridx].image = image;
-          attrarray[attridx].imagelen = imagelen;
           attridx++;
         }
 
       /* Include the S/MIME capabilities with the first signer. */
       if (cms->capability_list && !signer)
         {
-          attr = _ksba_asn_expand_tree (cms_tree->parse_tree,
-                                    "CryptographicMessageSyntax.Attribute");
-          if (!attr)
-            {
-	      err = gpg_error (GPG_ERR_ELEMENT_NOT_FOUND);
-	      goto leave;
-	    }
-          n = _ksba_asn_find_node (attr, "Attribute.attrType");
-          if (!n)
-            {
-	      err = gpg_error (GPG_ERR_ELEMENT_NOT_FOUND);
-	      goto leave;
-	    }
-          err = _ksba_der_store_oid (n, oidstr_smimeCapabilities);
-          if (err)
-            goto leave;
-          n = _ksba_asn_find_node (attr, "Attribute.attrValues");
-          if (!n || !n->down)
-            {
-	      err = gpg_error (GPG_ERR_ELEMENT_NOT_FOUND);
-	      goto leave;
-	    }
-          n = n->down; /* fixme: ugly hack */
-          err = store_smime_capability_sequence (n, cms->capability_list);
-          if (err)
-            goto leave;
-          err = _ksba_der_encode_tree (attr, &image, &imagelen);
+          _ksba_der_builder_reset (dbld);
+          _ksba_der_add_tag (dbld, 0, TYPE_SEQUENCE);
+          _ksba_der_add_oid (dbld, oidstr_smimeCapabilities);
+          _ksba_der_add_tag (dbld, 0, TYPE_SET);
+          add_smime_capability_sequence (dbld, cms->capability_list);
+          err = finish_attribute (dbld, attrarray + attridx);
           if (err)
             goto leave;
-          attrarray[attridx].root = attr;
-          attrarray[attridx].image = image;
-          attrarray[attridx].imagelen = imagelen;
           attridx++;
         }
 
@@ -2976,68 +3055,44 @@ build_signed_data_attributes (ksba_cms_t cms)
       qsort (attrarray, attridx, sizeof (struct attrarray_s),
              compare_attrarray);
 
-      /* Now copy them to an SignerInfo tree.  This tree is not
-         complete but suitable for ksba_cms_hash_signed_attributes() */
-      root = _ksba_asn_expand_tree (cms_tree->parse_tree,
-                                    "CryptographicMessageSyntax.SignerInfo");
-      n = _ksba_asn_find_node (root, "SignerInfo.signedAttrs");
-      if (!n || !n->down)
-        {
-	  err = gpg_error (GPG_ERR_ELEMENT_NOT_FOUND);
-	  goto leave;
-	}
-      /* This is another ugly hack to move to the element we want */
-      for (n = n->down->down; n && n->type != TYPE_SEQUENCE; n = n->right)
-        ;
-      if (!n)
-        {
-	  err = gpg_error (GPG_ERR_ELEMENT_NOT_FOUND);
-	  goto leave;
-	}
-
+      /* Now put them into a SignerInfo.  This object is not complete
+         but suitable for ksba_cms_hash_signed_attributes() */
       assert (attridx <= DIM (attrarray));
+      _ksba_der_builder_reset (dbld);
+      _ksba_der_add_tag (dbld, 0, TYPE_SEQUENCE);
+      _ksba_der_add_tag (dbld, CLASS_CONTEXT, 0);
       for (i=0; i < attridx; i++)
-        {
-          if (i)
-            {
-              if ( !(n=_ksba_asn_insert_copy (n)))
-                {
-		  err = gpg_error (GPG_ERR_ENOMEM);
-		  goto leave;
-		}
-            }
-          err = _ksba_der_copy_tree (n, attrarray[i].root, attrarray[i].image);
-          if (err)
-            goto leave;
-	  _ksba_asn_release_nodes (attrarray[i].root);
-	  free (attrarray[i].image);
-	  attrarray[i].root = NULL;
-	  attrarray[i].image = NULL;
-        }
-
-      err = _ksba_der_encode_tree (root, &image, NULL);
+        _ksba_der_add_der (dbld, attrarray[i].image, attrarray[i].imagelen);
+      _ksba_der_add_end (dbld);
+      _ksba_der_add_end (dbld);
+      err = _ksba_der_builder_get (dbld, &image, &imagelen);
       if (err)
         goto leave;
 
       si = xtrycalloc (1, sizeof *si);
       if (!si)
-        return gpg_error (GPG_ERR_ENOMEM);
-      si->root = root;
-      root = NULL;
+        {
+          err = gpg_error_from_syserror ();
+          xfree (image);
+          goto leave;
+        }
       si->image = image;
-      /* Hmmm, we don't set the length of the image. */
+      si->imagelen = imagelen;
+      err = make_signed_attrs_tree (image, imagelen, &si->root);
+      if (err)
+        {
+          xfree (si->image);
+          xfree (si);
+          goto leave;
+        }
       *si_tail = si;
       si_tail = &si->next;
     }
 
  leave:
-  _ksba_asn_release_nodes (root);
-  ksba_asn_tree_release (cms_tree);
+  _ksba_der_release (dbld);
   for (i = 0; i < attridx; i++)
-    {
-      _ksba_asn_release_nodes (attrarray[i].root);
-      xfree (attrarray[i].image);
-    }
+    xfree (attrarray[i].image);
 
   return err;
 }
@@ -3052,20 +3107,13 @@ build_signed_data_rest (ksba_cms_t cms)
 {
   gpg_error_t err;
   int signer;
-  ksba_asn_tree_t cms_tree = NULL;
   struct certlist_s *certlist;
   struct oidlist_s *digestlist;
   struct signer_info_s *si;
   struct sig_val_s *sv;
-  ksba_writer_t tmpwrt = NULL;
-  AsnNode root = NULL;
   ksba_der_t dbld = NULL;
 
   /* Now we can really write the signer info */
-  err = ksba_asn_create_tree ("cms", &cms_tree);
-  if (err)
-    return err;
-
   certlist = cms->cert_list;
   if (!certlist)
     {
@@ -3073,18 +3121,16 @@ build_signed_data_rest (ksba_cms_t cms)
       return err;
     }
 
-  /* To construct the set we use a temporary writer object. */
-  err = ksba_writer_new (&tmpwrt);
-  if (err)
-    goto leave;
-  err = ksba_writer_set_mem (tmpwrt, 2048);
-  if (err)
-    goto leave;
+  /* All signer infos are constructed in one go.  */
+  dbld = _ksba_der_builder_new (0);
+  if (!dbld)
+    return gpg_error_from_syserror ();
 
   digestlist = cms->digest_algos;
   si = cms->signer_info;
   sv = cms->sig_val;
 
+  _ksba_der_add_tag (dbld, 0, TYPE_SET);
   for (signer=0; certlist;
        signer++,
          certlist = certlist->next,
@@ -3092,9 +3138,7 @@ build_signed_data_rest (ksba_cms_t cms)
          si = si->next,
          sv = sv->next)
     {
-      AsnNode n, n2;
-      unsigned char *image;
-      size_t imagelen;
+      AsnNode n;
       const char *oid;
 
       if (!digestlist || !si || !sv)
@@ -3108,80 +3152,34 @@ build_signed_data_rest (ksba_cms_t cms)
 	  goto leave;
 	}
 
-      root = _ksba_asn_expand_tree (cms_tree->parse_tree,
-                                    "CryptographicMessageSyntax.SignerInfo");
+      _ksba_der_add_tag (dbld, 0, TYPE_SEQUENCE);
 
       /* We store a version of 1 because we use the issuerAndSerialNumber */
-      n = _ksba_asn_find_node (root, "SignerInfo.version");
-      if (!n)
-	{
-	  err = gpg_error (GPG_ERR_ELEMENT_NOT_FOUND);
-	  goto leave;
-	}
-      err = _ksba_der_store_integer (n, "\x00\x00\x00\x01\x01");
-      if (err)
-        goto leave;
+      _ksba_der_add_ptr (dbld, 0, TYPE_INTEGER, "\x01", 1);
 
       /* Store the sid */
-      n = _ksba_asn_find_node (root, "SignerInfo.sid");
-      if (!n)
-        {
-	  err = gpg_error (GPG_ERR_ELEMENT_NOT_FOUND);
-	  goto leave;
-	}
-
-      err = set_issuer_serial (n, certlist->cert, 0);
+      err = add_issuer_serial (dbld, certlist->cert);
       if (err)
         goto leave;
 
       /* store the digestAlgorithm */
-      n = _ksba_asn_find_node (root, "SignerInfo.digestAlgorithm.algorithm");
-      if (!n)
-	{
-	  err = gpg_error (GPG_ERR_ELEMENT_NOT_FOUND);
-	  goto leave;
-	}
-      err = _ksba_der_store_oid (n, digestlist->oid);
-      if (err)
-        goto leave;
-      n = _ksba_asn_find_node (root, "SignerInfo.digestAlgorithm.parameters");
-      if (!n)
-        {
-	  err = gpg_error (GPG_ERR_ELEMENT_NOT_FOUND);
-	  goto leave;
-	}
-      err = _ksba_der_store_null (n);
-      if (err)
-        goto leave;
+      _ksba_der_add_tag (dbld, 0, TYPE_SEQUENCE);
+      _ksba_der_add_oid (dbld, digestlist->oid);
+      _ksba_der_add_ptr (dbld, 0, TYPE_NULL, NULL, 0);
+      _ksba_der_add_end (dbld);
 
       /* and the signed attributes */
-      n = _ksba_asn_find_node (root, "SignerInfo.signedAttrs");
-      if (!n || !n->down)
-        {
-	  err = gpg_error (GPG_ERR_ELEMENT_NOT_FOUND);
-	  goto leave;
-	}
       assert (si->root);
       assert (si->image);
-      n2 = _ksba_asn_find_node (si->root, "SignerInfo.signedAttrs");
-      if (!n2 || !n2->down)
+      n = _ksba_asn_find_node (si->root, "SignerInfo.signedAttrs");
+      if (!n || n->off == -1)
         {
 	  err = gpg_error (GPG_ERR_ELEMENT_NOT_FOUND);
 	  goto leave;
 	}
-      err = _ksba_der_copy_tree (n, n2, si->image);
-      if (err)
-        goto leave;
-      image = NULL;
+      _ksba_der_add_der (dbld, si->image + n->off, n->nhdr + n->len);
 
       /* store the signatureAlgorithm */
-      n = _ksba_asn_find_node (root,
-			       "SignerInfo.signatureAlgorithm.algorithm");
-      if (!n)
-        {
-	  err = gpg_error (GPG_ERR_ELEMENT_NOT_FOUND);
-	  goto leave;
-	}
       if (!sv->algo)
         {
 	  err = gpg_error (GPG_ERR_MISSING_VALUE);
@@ -3206,19 +3204,10 @@ build_signed_data_rest (ksba_cms_t cms)
       else
         oid = sv->algo;
 
-      err = _ksba_der_store_oid (n, oid);
-      if (err)
-	goto leave;
-      n = _ksba_asn_find_node (root,
-			       "SignerInfo.signatureAlgorithm.parameters");
-      if (!n)
-        {
-	  err = gpg_error (GPG_ERR_ELEMENT_NOT_FOUND);
-	  goto leave;
-	}
-      err = _ksba_der_store_null (n);
-      if (err)
-	goto leave;
+      _ksba_der_add_tag (dbld, 0, TYPE_SEQUENCE);
+      _ksba_der_add_oid (dbld, oid);
+      _ksba_der_add_ptr (dbld, 0, TYPE_NULL, NULL, 0);
+      _ksba_der_add_end (dbld);
 
       /* store the signature  */
       if (!sv->value)
@@ -3226,75 +3215,30 @@ build_signed_data_rest (ksba_cms_t cms)
 	  err = gpg_error (GPG_ERR_MISSING_VALUE);
 	  goto leave;
 	}
-      n = _ksba_asn_find_node (root, "SignerInfo.signature");
-      if (!n)
-	{
-	  err = gpg_error (GPG_ERR_ELEMENT_NOT_FOUND);
-	  goto leave;
-	}
 
       if (sv->ecc.r)  /* ECDSA */
         {
-          unsigned char *tmpder;
-          size_t tmpderlen;
-
-          _ksba_der_release (dbld);
-          dbld = _ksba_der_builder_new (0);
-          if (!dbld)
-            {
-              err = gpg_error_from_syserror ();
-              goto leave;
-            }
+          /* The class bit 0x80 requests an OCTET STRING which
+             encapsulates the following SEQUENCE.  */
+          _ksba_der_add_tag (dbld, 0x80, TYPE_OCTET_STRING);
           _ksba_der_add_tag (dbld, 0, TYPE_SEQUENCE);
           _ksba_der_add_int (dbld, sv->ecc.r, sv->ecc.rlen, 1);
           _ksba_der_add_int (dbld, sv->value, sv->valuelen, 1);
           _ksba_der_add_end (dbld);
-
-          err = _ksba_der_builder_get (dbld, &tmpder, &tmpderlen);
-          if (err)
-            goto leave;
-          err = _ksba_der_store_octet_string (n, tmpder, tmpderlen);
-          xfree (tmpder);
-          if (err)
-            goto leave;
+          _ksba_der_add_end (dbld);
         }
       else  /* RSA */
-        {
-          err = _ksba_der_store_octet_string (n, sv->value, sv->valuelen);
-          if (err)
-            goto leave;
-        }
-
-      /* Make the DER encoding and write it out. */
-      err = _ksba_der_encode_tree (root, &image, &imagelen);
-      if (err)
-	goto leave;
+        _ksba_der_add_ptr (dbld, 0, TYPE_OCTET_STRING,
+                           sv->value, sv->valuelen);
 
-      err = ksba_writer_write (tmpwrt, image, imagelen);
-      xfree (image);
-      if (err)
-	goto leave;
+      _ksba_der_add_end (dbld); /* End SignerInfo.  */
     }
+  _ksba_der_add_end (dbld);  /* End SET.  */
 
   /* Write out the SET filled with all signer infos */
-  {
-    unsigned char *value;
-    size_t valuelen;
-
-    value = ksba_writer_snatch_mem (tmpwrt, &valuelen);
-    if (!value)
-      {
-        err = gpg_error (GPG_ERR_ENOMEM);
-	goto leave;
-      }
-    err = _ksba_ber_write_tl (cms->writer, TYPE_SET, CLASS_UNIVERSAL,
-                              1, valuelen);
-    if (!err)
-      err = ksba_writer_write (cms->writer, value, valuelen);
-    xfree (value);
-    if (err)
-      goto leave;
-  }
+  err = _ksba_der_builder_write (dbld, cms->writer, NULL);
+  if (err)
+    goto leave;
 
   /* Write 3 end tags */
   err = _ksba_ber_write_tl (cms->writer, 0, 0, 0, 0);
@@ -3304,9 +3248,6 @@ build_signed_data_rest (ksba_cms_t cms)
     err = _ksba_ber_write_tl (cms->writer, 0, 0, 0, 0);
 
  leave:
-  ksba_asn_tree_release (cms_tree);
-  _ksba_asn_release_nodes (root);
-  ksba_writer_release (tmpwrt);
   _ksba_der_release (dbld);
   return err;
 }
@@ -3487,9 +3428,6 @@ build_enveloped_data_header (ksba_cms_t cms)
   _ksba_der_add_tag (dbld, 0, TYPE_SET);
   for (recpno=0; certlist; recpno++, certlist = certlist->next)
     {
-      const unsigned char *der;
-      size_t derlen;
-
       if (!certlist->cert)
         {
           err = gpg_error (GPG_ERR_BUG);
@@ -3503,18 +3441,9 @@ build_enveloped_data_header (ksba_cms_t cms)
            * use the issuerAndSerialNumber for SPHINX */
           _ksba_der_add_ptr (dbld, 0, TYPE_INTEGER, "", 1);
           /* rid.issuerAndSerialNumber */
-          _ksba_der_add_tag (dbld, 0, TYPE_SEQUENCE);
-          /* rid.issuerAndSerialNumber.issuer */
-          err = _ksba_cert_get_issuer_dn_ptr (certlist->cert, &der, &derlen);
-          if (err)
-            goto leave;
-          _ksba_der_add_der (dbld, der, derlen);
-          /* rid.issuerAndSerialNumber.serialNumber */
-          err = _ksba_cert_get_serial_ptr (certlist->cert, &der, &derlen);
+          err = add_issuer_serial (dbld, certlist->cert);
           if (err)
             goto leave;
-          _ksba_der_add_der (dbld, der, derlen);
-          _ksba_der_add_end (dbld);
 
           /* Store the keyEncryptionAlgorithm */
           _ksba_der_add_tag (dbld, 0, TYPE_SEQUENCE);
@@ -3587,16 +3516,9 @@ build_enveloped_data_header (ksba_cms_t cms)
           _ksba_der_add_tag (dbld, 0, TYPE_SEQUENCE); /* recpEncrKey */
 
           /* rid.issuerAndSerialNumber */
-          _ksba_der_add_tag (dbld, 0, TYPE_SEQUENCE);
-          err = _ksba_cert_get_issuer_dn_ptr (certlist->cert, &der, &derlen);
+          err = add_issuer_serial (dbld, certlist->cert);
           if (err)
             goto leave;
-          _ksba_der_add_der (dbld, der, derlen);
-          err = _ksba_cert_get_serial_ptr (certlist->cert, &der, &derlen);
-          if (err)
-            goto leave;
-          _ksba_der_add_der (dbld, der, derlen);
-          _ksba_der_add_end (dbld);
 
           /* encryptedKey  */
           if (!certlist->enc_val.value)
@@ -40,6 +40,11 @@ gpg_error_t _ksba_assert_time_format (const ksba_isotime_t atime);
 void _ksba_copy_time (ksba_isotime_t d, const ksba_isotime_t s);
 int _ksba_cmp_time (const ksba_isotime_t a, const ksba_isotime_t b);
 void _ksba_current_time (ksba_isotime_t timebuf);
+gpg_error_t _ksba_asntime_to_epoch (const char *buffer, size_t length,
+                                    int is_utctime, ksba_epochtime_t *r_epoch);
+gpg_error_t _ksba_isotime_to_epoch (const ksba_isotime_t atime,
+                                    ksba_epochtime_t *r_epoch);
+void _ksba_epoch_to_isotime (ksba_epochtime_t epoch, ksba_isotime_t timebuf);
 
 
 /*-- dn.c --*/
@@ -51,6 +56,8 @@ gpg_error_t _ksba_dn_from_str (const char *string, char **rbuf, size_t *rlength)
 
 /*-- oid.c --*/
 char *_ksba_oid_node_to_str (const unsigned char *image, AsnNode node);
+gpg_error_t _ksba_oid_encode (const char *string, unsigned char *buf,
+                             size_t *r_length);
 gpg_error_t _ksba_oid_from_buf (const void *buffer, size_t buflen,
                                 unsigned char **rbuf, size_t *rlength);
 
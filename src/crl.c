@@ -35,6 +35,8 @@
 #include <assert.h>
 #include <errno.h>
 
+#define STATS_MODULE KSBA_STATS_MOD_CRL
+
 #include "util.h"
 
 #include "convert.h"
@@ -69,8 +71,12 @@ do_hash (ksba_crl_t crl, const void *buffer, size_t length)
       if (crl->hashbuf.used == sizeof crl->hashbuf.buffer)
         {
           if (crl->hash_fnc)
-            crl->hash_fnc (crl->hash_fnc_arg,
-                           crl->hashbuf.buffer, crl->hashbuf.used);
+            {
+              STATS_ADD (hash_calls, 1);
+              STATS_ADD (hash_bytes, crl->hashbuf.used);
+              crl->hash_fnc (crl->hash_fnc_arg,
+                             crl->hashbuf.buffer, crl->hashbuf.used);
+            }
           crl->hashbuf.used = 0;
         }
       buffer = (const char *)buffer + n;
@@ -490,6 +496,43 @@ ksba_crl_get_update_times (ksba_crl_t crl,
   return 0;
 }
 
+/**
+ * ksba_crl_get_update_times_epoch:
+ * @crl: CRL object
+ * @this: Returns the thisUpdate value
+ * @next: Returns the nextUpdate value.
+ *
+ * Same as ksba_crl_get_update_times but return the times as seconds
+ * since the epoch.  THIS and NEXT may be given as NULL if the value is
+ * not required.  If NEXT is requested but the CRL has no nextUpdate,
+ * GPG_ERR_NO_VALUE is returned; THIS is valid nevertheless.
+ *
+ * Return value: 0 on success or an error code
+ **/
+gpg_error_t
+ksba_crl_get_update_times_epoch (ksba_crl_t crl,
+                                 ksba_epochtime_t *this,
+                                 ksba_epochtime_t *next)
+{
+  if (this)
+    *this = 0;
+  if (next)
+    *next = 0;
+  if (!crl)
+    return gpg_error (GPG_ERR_INV_VALUE);
+  if (!*crl->this_update)
+    return gpg_error (GPG_ERR_INV_TIME);
+  if (this)
+    *this = crl->this_update_epoch;
+  if (next)
+    {
+      if (!*crl->next_update)
+        return gpg_error (GPG_ERR_NO_VALUE);
+      *next = crl->next_update_epoch;
+    }
+  return 0;
+}
+
 /**
  * ksba_crl_get_item:
  * @crl: CRL object
@@ -948,6 +991,8 @@ parse_to_next_update (ksba_crl_t crl)
   HASH (tmpbuf, ti.nhdr+ti.length);
   _ksba_asntime_to_iso (tmpbuf+ti.nhdr, ti.length,
                         ti.tag == TYPE_UTC_TIME, crl->this_update);
+  _ksba_asntime_to_epoch (tmpbuf+ti.nhdr, ti.length,
+                          ti.tag == TYPE_UTC_TIME, &crl->this_update_epoch);
 
   /* Read the optional nextUpdate time. */
   err = _ksba_ber_read_tl (crl->reader, &ti);
@@ -975,6 +1020,9 @@ parse_to_next_update (ksba_crl_t crl)
       HASH (tmpbuf, ti.nhdr+ti.length);
       _ksba_asntime_to_iso (tmpbuf+ti.nhdr, ti.length,
                             ti.tag == TYPE_UTC_TIME, crl->next_update);
+      _ksba_asntime_to_epoch (tmpbuf+ti.nhdr, ti.length,
+                              ti.tag == TYPE_UTC_TIME,
+                              &crl->next_update_epoch);
       err = _ksba_ber_read_tl (crl->reader, &ti);
       if (err)
         return err;
@@ -1367,7 +1415,7 @@ parse_signature (ksba_crl_t crl)
 gpg_error_t
 ksba_crl_parse (ksba_crl_t crl, ksba_stop_reason_t *r_stopreason)
 {
-  enum {
+  enum {  /* The values match ksba_trace_crl_state_t.  */
     sSTART,
     sCRLENTRY,
     sCRLEXT,
@@ -1411,6 +1459,10 @@ ksba_crl_parse (ksba_crl_t crl, ksba_stop_reason_t *r_stopreason)
   if (err)
     return err;
 
+  if (state == sSTART)
+    TRACE (KSBA_TRACE_CRL_STATE, KSBA_TRACE_CRL_START, 0,
+           ksba_reader_tell (crl->reader), crl, NULL);
+
   /* Do the action */
   switch (state)
     {
@@ -1425,8 +1477,12 @@ ksba_crl_parse (ksba_crl_t crl, ksba_stop_reason_t *r_stopreason)
       if (!err)
         {
           if (crl->hash_fnc && crl->hashbuf.used)
-            crl->hash_fnc (crl->hash_fnc_arg,
-                           crl->hashbuf.buffer, crl->hashbuf.used);
+            {
+              STATS_ADD (hash_calls, 1);
+              STATS_ADD (hash_bytes, crl->hashbuf.used);
+              crl->hash_fnc (crl->hash_fnc_arg,
+                             crl->hashbuf.buffer, crl->hashbuf.used);
+            }
           crl->hashbuf.used = 0;
           err = parse_signature (crl);
         }
@@ -1436,7 +1492,11 @@ ksba_crl_parse (ksba_crl_t crl, ksba_stop_reason_t *r_stopreason)
       break;
     }
   if (err)
-    return err;
+    {
+      TRACE (KSBA_TRACE_CRL_STATE, state, err,
+             ksba_reader_tell (crl->reader), crl, NULL);
+      return err;
+    }
 
   /* Calculate new stop reason */
   switch (state)
@@ -1454,6 +1514,13 @@ ksba_crl_parse (ksba_crl_t crl, ksba_stop_reason_t *r_stopreason)
       break;
     }
 
+  /* Report the state we are going to enter.  */
+  if (stop_reason != KSBA_SR_GOT_ITEM)
+    TRACE (KSBA_TRACE_CRL_STATE,
+           (state == sSTART? KSBA_TRACE_CRL_ENTRY :
+            state == sCRLENTRY? KSBA_TRACE_CRL_EXT : KSBA_TRACE_CRL_DONE),
+           0, ksba_reader_tell (crl->reader), crl, NULL);
+
   *r_stopreason = stop_reason;
   return 0;
 }
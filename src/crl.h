@@ -77,6 +77,8 @@ struct ksba_crl_s {
   } issuer;
   ksba_isotime_t this_update;
   ksba_isotime_t next_update;
+  ksba_epochtime_t this_update_epoch;  /* Same as above but as seconds */
+  ksba_epochtime_t next_update_epoch;  /* since the epoch.             */
 
   struct {
     ksba_sexp_t serial;
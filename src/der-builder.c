@@ -32,6 +32,8 @@
 #include <string.h>
 #include <assert.h>
 
+#define STATS_MODULE KSBA_STATS_MOD_DER_BUILDER
+
 #include "util.h"
 #include "asn1-constants.h"
 #include "convert.h"
@@ -49,9 +51,21 @@ struct item_s
   unsigned int encapsulate:1;    /* This encapsulates other objects.    */
   unsigned int verbatim:1;       /* Copy the value verbatim.            */
   unsigned int is_stop:1;        /* This is a STOP item.                */
+  unsigned int is_slot:1;        /* The value is set by set_slot.       */
+  unsigned int slot_set:1;       /* The value of the slot has been set. */
+  unsigned int slot;             /* The number of the slot.             */
   const void *value;
   size_t valuelen;
-  char *buffer;                  /* Malloced space or NULL.  */
+};
+
+
+/* A block of the arena used for the values of the items.  */
+struct arena_block_s
+{
+  struct arena_block_s *next;
+  size_t size;                   /* Allocated size of DATA.  */
+  size_t used;                   /* Used size of DATA.  */
+  unsigned char data[1];
 };
 
 
@@ -63,8 +77,20 @@ struct ksba_der_s
   size_t nallocateditems; /* Number of allocated items.  */
   size_t nitems;          /* Number of used items.  */
   struct item_s *items;   /* Array of items.  */
+  struct arena_block_s *arena;    /* List of arena blocks.  They are kept
+                                     on reset to avoid allocations when
+                                     building similar objects.  */
+  struct arena_block_s *curblock; /* The block currently used.  */
   int laststop;           /* Used as return value of compute_length.  */
   unsigned int finished:1;/* The object has been constructed.  */
+  unsigned int slots_changed:1; /* A slot has been set since the
+                                   lengths were computed.  */
+  unsigned char *hdrbuf;  /* Buffer for the headers used by get_iov.  */
+  size_t hdrbufsize;      /* Allocated size of HDRBUF.  */
+  size_t hdrbuflen;       /* Used size of HDRBUF.  */
+  ksba_iov_t *iov;        /* Array with the segments used by get_iov.  */
+  size_t iovsize;         /* Allocated number of IOV items.  */
+  size_t niov;            /* Used number of IOV items.  */
 };
 
 
@@ -72,14 +98,19 @@ struct ksba_der_s
 void
 _ksba_der_release (ksba_der_t d)
 {
-  int idx;
+  struct arena_block_s *b, *b2;
 
   if (!d)
     return;
 
-  for (idx=0; idx < d->nitems; idx++)
-    xfree (d->items[idx].buffer);
+  for (b = d->arena; b; b = b2)
+    {
+      b2 = b->next;
+      xfree (b);
+    }
   xfree (d->items);
+  xfree (d->hdrbuf);
+  xfree (d->iov);
   xfree (d);
 }
 
@@ -110,30 +141,34 @@ _ksba_der_builder_new (unsigned int nitems)
 }
 
 
-/* Reset a DER build context so that a new sequence can be build.  */
+/* Reset a DER build context so that a new sequence can be build.  The
+ * memory used for the items and their values is kept for the next
+ * object.  */
 void
 _ksba_der_builder_reset (ksba_der_t d)
 {
+  struct arena_block_s *b;
   int idx;
 
   if (!d)
     return;  /* Oops.  */
+  for (b = d->arena; b; b = b->next)
+    b->used = 0;
+  d->curblock = d->arena;
   for (idx=0; idx < d->nitems; idx++)
     {
-      if (d->items[idx].buffer)
-        {
-          xfree (d->items[idx].buffer);
-          d->items[idx].buffer = NULL;
-        }
       d->items[idx].hdrlen = 0;
       d->items[idx].is_constructed = 0;
       d->items[idx].encapsulate = 0;
       d->items[idx].verbatim = 0;
       d->items[idx].is_stop = 0;
+      d->items[idx].is_slot = 0;
+      d->items[idx].slot_set = 0;
       d->items[idx].value = NULL;
     }
   d->nitems = 0;
   d->finished = 0;
+  d->slots_changed = 0;
   d->error = 0;
 }
 
@@ -151,18 +186,70 @@ ensure_space (ksba_der_t d)
 
   if (d->nitems == d->nallocateditems)
     {
-      d->nallocateditems += 32;
+      size_t n = d->nallocateditems? 2 * d->nallocateditems : 32;
+
       newitems = _ksba_reallocarray (d->items, d->nitems,
-                                     d->nallocateditems, sizeof *newitems);
+                                     n, sizeof *newitems);
       if (!newitems)
         d->error = gpg_error_from_syserror ();
       else
-        d->items = newitems;
+        {
+          d->items = newitems;
+          d->nallocateditems = n;
+        }
     }
   return !!d->error;
 }
 
 
+/* Allocate LENGTH bytes from the arena of D.  Records any error in D
+ * and returns NULL in that case.  The memory is valid until D is
+ * reset or released.  */
+static unsigned char *
+arena_alloc (ksba_der_t d, size_t length)
+{
+  struct arena_block_s *b, *last;
+  unsigned char *p;
+  size_t size;
+
+  /* Blocks are used in order; thus after a reset the same sequence
+   * of calls gets the same memory again.  */
+  last = NULL;
+  for (b = d->curblock; b; b = b->next)
+    {
+      if (b->size - b->used >= length)
+        break;
+      last = b;
+    }
+  if (!b)
+    {
+      if (!last)
+        for (last = d->arena; last && last->next; last = last->next)
+          ;
+      size = last? 2 * last->size : 1024;
+      if (size < length)
+        size = length;
+      b = xtrymalloc (sizeof *b + size - 1);
+      if (!b)
+        {
+          d->error = gpg_error_from_syserror ();
+          return NULL;
+        }
+      b->next = NULL;
+      b->size = size;
+      b->used = 0;
+      if (last)
+        last->next = b;
+      else
+        d->arena = b;
+    }
+  d->curblock = b;
+  p = b->data + b->used;
+  b->used += length;
+  return p;
+}
+
+
 /* Add a new primitive element to the builder instance D.  The element
  * is described by CLASS, TAG, VALUE, and VALUELEN.  CLASS and TAG
  * must describe a primitive element and (VALUE,VALUELEN) specify its
@@ -186,13 +273,12 @@ _ksba_der_add_ptr (ksba_der_t d, int class, int tag,
 
 /* This is a low level function which assumes that D has been
  * validated, VALUE is not NULL and enough space for a new item is
- * available.  It takes ownership of VALUE.  VERBATIM is usually
- * passed as false */
+ * available.  VALUE is expected to be allocated from the arena of D.
+ * VERBATIM is usually passed as false */
 static void
 add_val_core (ksba_der_t d, int class, int tag, void *value, size_t valuelen,
               int verbatim)
 {
-  d->items[d->nitems].buffer   = value;
   d->items[d->nitems].class    = class & 0x03;
   d->items[d->nitems].tag      = tag;
   d->items[d->nitems].value    = value;
@@ -218,12 +304,9 @@ _ksba_der_add_val (ksba_der_t d, int class, int tag,
       d->error = gpg_error (GPG_ERR_INV_VALUE);
       return;
     }
-  p = xtrymalloc (valuelen);
+  p = arena_alloc (d, valuelen);
   if (!p)
-    {
-      d->error = gpg_error_from_syserror ();
-      return;
-    }
+    return;
   memcpy (p, value, valuelen);
   add_val_core (d, class, tag, p, valuelen, 0);
 }
@@ -240,12 +323,27 @@ _ksba_der_add_oid (ksba_der_t d, const char *oidstr)
 
   if (ensure_space (d))
     return;
+  if (!oidstr)
+    {
+      d->error = gpg_error (GPG_ERR_INV_VALUE);
+      return;
+    }
 
-  err = ksba_oid_from_str (oidstr, &buf, &len);
+  /* The encoded OID is always shorter than the string; the unused
+   * space is returned to the arena.  */
+  len = strlen (oidstr) + 2;
+  buf = arena_alloc (d, len);
+  if (!buf)
+    return;
+  d->curblock->used -= len;
+  err = _ksba_oid_encode (oidstr, buf, &len);
   if (err)
     d->error = err;
   else
-    add_val_core (d, 0, TYPE_OBJECT_ID, buf, len, 0);
+    {
+      d->curblock->used += len;
+      add_val_core (d, 0, TYPE_OBJECT_ID, buf, len, 0);
+    }
 }
 
 
@@ -264,12 +362,9 @@ _ksba_der_add_bts (ksba_der_t d, const void *value, size_t valuelen,
       d->error = gpg_error (GPG_ERR_INV_VALUE);
       return;
     }
-  p = xtrymalloc (1+valuelen);
+  p = arena_alloc (d, 1+valuelen);
   if (!p)
-    {
-      d->error = gpg_error_from_syserror ();
-      return;
-    }
+    return;
   p[0] = unusedbits;
   memcpy (p+1, value, valuelen);
   add_val_core (d, 0, TYPE_BIT_STRING, p, 1+valuelen, 0);
@@ -293,12 +388,9 @@ _ksba_der_add_int (ksba_der_t d, const void *value, size_t valuelen,
   else
     need_extra = (force_positive && (*(const unsigned char*)value & 0x80));
 
-  p = xtrymalloc (need_extra+valuelen);
+  p = arena_alloc (d, need_extra+valuelen);
   if (!p)
-    {
-      d->error = gpg_error_from_syserror ();
-      return;
-    }
+    return;
   if (need_extra)
     p[0] = 0;
   if (valuelen)
@@ -323,12 +415,9 @@ _ksba_der_add_der (ksba_der_t d, const void *der, size_t derlen)
       d->error = gpg_error (GPG_ERR_INV_VALUE);
       return;
     }
-  p = xtrymalloc (derlen);
+  p = arena_alloc (d, derlen);
   if (!p)
-    {
-      d->error = gpg_error_from_syserror ();
-      return;
-    }
+    return;
   memcpy (p, der, derlen);
   add_val_core (d, 0, 0, p, derlen, 1);
 }
@@ -365,6 +454,61 @@ _ksba_der_add_end (ksba_der_t d)
 }
 
 
+/* Add a slot to the builder instance D.  A slot is a primitive
+ * element described by CLASS and TAG whose value is not yet known; it
+ * is set later with ksba_der_set_slot using the number SLOT.  If
+ * CLASS and TAG are both 0, the value of the slot is a complete DER
+ * object which is copied verbatim.  Several items may share the same
+ * SLOT number.  This allows to construct an object once and then to
+ * create many objects which differ only in a few values; only the
+ * length headers are computed again for each object.  */
+void
+_ksba_der_add_slot (ksba_der_t d, int class, int tag, unsigned int slot)
+{
+  if (ensure_space (d))
+    return;
+  d->items[d->nitems].class    = class & 0x03;
+  d->items[d->nitems].tag      = tag;
+  d->items[d->nitems].verbatim = (!class && !tag);
+  d->items[d->nitems].is_slot  = 1;
+  d->items[d->nitems].slot     = slot;
+  d->nitems++;
+}
+
+
+/* Set the value of all slots of D with the number SLOT to (VALUE,
+ * VALUELEN).  The value is a pointer and its object must not be
+ * changed as long as it is used by D.  Unlike the add functions this
+ * may also be called after ksba_der_builder_get to create the next
+ * object.  Returns GPG_ERR_NOT_FOUND if there is no such slot.  */
+gpg_error_t
+_ksba_der_set_slot (ksba_der_t d, unsigned int slot,
+                    const void *value, size_t valuelen)
+{
+  int idx, found = 0;
+
+  if (!d)
+    return gpg_error (GPG_ERR_INV_ARG);
+  if (d->error)
+    return d->error;
+
+  for (idx=0; idx < d->nitems; idx++)
+    if (d->items[idx].is_slot && d->items[idx].slot == slot)
+      {
+        if (d->items[idx].verbatim && (!value || !valuelen))
+          return gpg_error (GPG_ERR_INV_VALUE);
+        d->items[idx].value    = value;
+        d->items[idx].valuelen = value? valuelen : 0;
+        d->items[idx].slot_set = 1;
+        found = 1;
+      }
+  if (!found)
+    return gpg_error (GPG_ERR_NOT_FOUND);
+  d->slots_changed = 1;
+  return 0;
+}
+
+
 /* Return the length of the TL header of a to be constructed TLV.
  * LENGTH gives the length of the value, if it is 0 indefinite length
  * is assumed.  LENGTH is ignored for the NULL tag.  On error 0 is
@@ -535,64 +679,53 @@ compute_lengths (ksba_der_t d, int idx)
 }
 
 
-/* Return the constructed DER object at D.  On success the object is
- * stored at R_OBJ and its length at R_OBJLEN.  The caller needs to
- * release that memory.  On error NULL is stored at R_OBJ and an error
- * code is returned.  Further the number of successful calls prior to
- * the error are stored at R_OBJLEN.  Note than an error may stem from
- * any of the previous call made to this object or from constructing
- * the DER object.  If this function is called with NULL for R_OBJ
- * only the current error state is returned and no further processing
- * is done.  This can be used to figure which of the add calls induced
- * the error.
- */
-gpg_error_t
-_ksba_der_builder_get (ksba_der_t d, unsigned char **r_obj, size_t *r_objlen)
+/* Check the state of D and compute the lengths of all items.  This
+ * needs to be done only once unless slots are changed.  */
+static gpg_error_t
+finish_object (ksba_der_t d)
 {
-  gpg_error_t err;
   int idx;
-  unsigned char *buffer = NULL;
-  unsigned char *p;
-  size_t bufsize, buflen;
-  int encap_bts;
 
-  *r_obj = NULL;
-  *r_objlen = 0;
+  if (d->finished && !d->slots_changed)
+    return 0;
 
-  if (!d)
-    return gpg_error (GPG_ERR_INV_ARG);
+  for (idx=0; idx < d->nitems; idx++)
+    if (d->items[idx].is_slot && !d->items[idx].slot_set)
+      return gpg_error (GPG_ERR_MISSING_VALUE);
+
+  if (d->nitems == 1)
+    ;  /* Single item does not need an end tag.  */
+  else if (!d->nitems || !d->items[d->nitems-1].is_stop)
+    return gpg_error (GPG_ERR_NO_OBJ);
+
+  compute_lengths (d, 0);
   if (d->error)
-    {
-      err = d->error;
-      if (r_objlen)
-        *r_objlen = d->nitems;
-      goto leave;
-    }
-  if (!r_obj)
-    return 0;
+    return d->error;
 
-  if (!d->finished)
-    {
-      if (d->nitems == 1)
-        ;  /* Single item does not need an end tag.  */
-      else if (!d->nitems || !d->items[d->nitems-1].is_stop)
-        {
-          err = gpg_error (GPG_ERR_NO_OBJ);
-          goto leave;
-        }
+  d->finished = 1;
+  d->slots_changed = 0;
+  return 0;
+}
 
-      compute_lengths (d, 0);
-      err = d->error;
-      if (err)
-        goto leave;
 
-      d->finished = 1;
-    }
+/* Pass the object at D in pieces to the function EMIT.  The headers
+ * are constructed in a local buffer and passed with TRANSIENT set;
+ * the values are passed directly from the items.  finish_object
+ * must have been called before.  */
+static gpg_error_t
+emit_object (ksba_der_t d,
+             gpg_error_t (*emit)(void *, const void *, size_t, int transient),
+             void *emit_arg)
+{
+  gpg_error_t err;
+  int idx;
+  unsigned char hdr[16];
+  size_t hdrlen;
+  int encap_bts;
 
   /* If the first element is a primitive element we rightly assume no
    * other elements follow.  It is the user's duty to build a valid
    * ASN.1 object.  */
-  bufsize = d->items[0].hdrlen + d->items[0].valuelen;
 
   /* for (idx=0; idx < d->nitems; idx++) */
   /*   gpgrt_log_debug ("DERB[%2d]: c=%d t=%2d %s p=%p h=%u l=%zu\n", */
@@ -606,15 +739,6 @@ _ksba_der_builder_get (ksba_der_t d, unsigned char **r_obj, size_t *r_objlen)
   /*                    d->items[idx].hdrlen, */
   /*                    d->items[idx].valuelen); */
 
-  buffer = xtrymalloc (bufsize);
-  if (!buffer)
-    {
-      err = gpg_error_from_syserror ();
-      goto leave;
-    }
-  buflen = 0;
-  p = buffer;
-
   for (idx=0; idx < d->nitems; idx++)
     {
       if (d->items[idx].is_stop)
@@ -626,42 +750,233 @@ _ksba_der_builder_get (ksba_der_t d, unsigned char **r_obj, size_t *r_objlen)
           encap_bts = (d->items[idx].encapsulate && !d->items[idx].class
                        && d->items[idx].tag == TYPE_BIT_STRING);
 
-          if (buflen + d->items[idx].hdrlen + encap_bts > bufsize)
-            {
-              err = gpg_error (GPG_ERR_BUG);
-              goto leave;
-            }
-          write_tl (p, d->items[idx].class, d->items[idx].tag,
+          hdrlen = d->items[idx].hdrlen;
+          if (hdrlen + encap_bts > sizeof hdr)
+            return gpg_error (GPG_ERR_BUG);
+          write_tl (hdr, d->items[idx].class, d->items[idx].tag,
                     (d->items[idx].is_constructed
                      && !d->items[idx].encapsulate),
                     d->items[idx].valuelen + encap_bts);
-          p += d->items[idx].hdrlen;
-          buflen += d->items[idx].hdrlen;
           if (encap_bts)
-            {
-              *p++ = 0;
-              buflen++;
-            }
+            hdr[hdrlen++] = 0;
+          err = emit (emit_arg, hdr, hdrlen, 1);
+          if (err)
+            return err;
         }
-      if (d->items[idx].value)
+      if (d->items[idx].value && d->items[idx].valuelen)
         {
-          if (buflen + d->items[idx].valuelen > bufsize)
-            {
-              err = gpg_error (GPG_ERR_BUG);
-              goto leave;
-            }
-          memcpy (p, d->items[idx].value, d->items[idx].valuelen);
-          p += d->items[idx].valuelen;
-          buflen += d->items[idx].valuelen;
+          err = emit (emit_arg, d->items[idx].value,
+                      d->items[idx].valuelen, 0);
+          if (err)
+            return err;
         }
     }
-  assert (buflen == bufsize);
+  return 0;
+}
+
 
-  *r_obj = buffer;
-  *r_objlen = buflen;
-  buffer = NULL;
+/* The state for emit_to_buffer.  */
+struct emit_buffer_s
+{
+  unsigned char *buffer;
+  size_t bufsize;
+  size_t buflen;
+};
+
+static gpg_error_t
+emit_to_buffer (void *arg, const void *data, size_t datalen, int transient)
+{
+  struct emit_buffer_s *parm = arg;
+
+  (void)transient;
+  if (parm->buflen + datalen > parm->bufsize)
+    return gpg_error (GPG_ERR_BUG);
+  memcpy (parm->buffer + parm->buflen, data, datalen);
+  parm->buflen += datalen;
+  return 0;
+}
+
+
+/* Return the constructed DER object at D.  On success the object is
+ * stored at R_OBJ and its length at R_OBJLEN.  The caller needs to
+ * release that memory.  On error NULL is stored at R_OBJ and an error
+ * code is returned.  Further the number of successful calls prior to
+ * the error are stored at R_OBJLEN.  Note than an error may stem from
+ * any of the previous call made to this object or from constructing
+ * the DER object.  If this function is called with NULL for R_OBJ
+ * only the current error state is returned and no further processing
+ * is done.  This can be used to figure which of the add calls induced
+ * the error.
+ */
+gpg_error_t
+_ksba_der_builder_get (ksba_der_t d, unsigned char **r_obj, size_t *r_objlen)
+{
+  gpg_error_t err;
+  struct emit_buffer_s parm;
+
+  *r_obj = NULL;
+  *r_objlen = 0;
+
+  if (!d)
+    return gpg_error (GPG_ERR_INV_ARG);
+  if (d->error)
+    {
+      err = d->error;
+      if (r_objlen)
+        *r_objlen = d->nitems;
+      goto leave;
+    }
+  if (!r_obj)
+    return 0;
+
+  err = finish_object (d);
+  if (err)
+    return err;
+
+  parm.bufsize = d->items[0].hdrlen + d->items[0].valuelen;
+  parm.buflen = 0;
+  parm.buffer = xtrymalloc (parm.bufsize);
+  if (!parm.buffer)
+    return gpg_error_from_syserror ();
+
+  err = emit_object (d, emit_to_buffer, &parm);
+  if (err)
+    {
+      xfree (parm.buffer);
+      return err;
+    }
+  assert (parm.buflen == parm.bufsize);
+
+  *r_obj = parm.buffer;
+  *r_objlen = parm.buflen;
 
  leave:
-  xfree (buffer);
   return err;
 }
+
+
+static gpg_error_t
+emit_to_writer (void *arg, const void *data, size_t datalen, int transient)
+{
+  (void)transient;
+  return ksba_writer_write (arg, data, datalen);
+}
+
+
+/* Write the constructed DER object at D to WRITER.  Unlike
+ * ksba_der_builder_get the object is not materialized in memory;
+ * in particular values added with ksba_der_add_ptr are passed to the
+ * writer directly from the caller's buffer.  If R_OBJLEN is not NULL
+ * the length of the object is stored there.  */
+gpg_error_t
+_ksba_der_builder_write (ksba_der_t d, ksba_writer_t writer, size_t *r_objlen)
+{
+  gpg_error_t err;
+
+  if (r_objlen)
+    *r_objlen = 0;
+  if (!d || !writer)
+    return gpg_error (GPG_ERR_INV_ARG);
+  if (d->error)
+    return d->error;
+
+  err = finish_object (d);
+  if (err)
+    return err;
+  err = emit_object (d, emit_to_writer, writer);
+  if (!err && r_objlen)
+    *r_objlen = d->items[0].hdrlen + d->items[0].valuelen;
+  return err;
+}
+
+
+static gpg_error_t
+emit_to_iov (void *arg, const void *data, size_t datalen, int transient)
+{
+  ksba_der_t d = arg;
+  ksba_iov_t *last = d->niov? &d->iov[d->niov-1] : NULL;
+
+  if (transient)
+    {
+      /* Headers are copied to HDRBUF which has been allocated large
+       * enough for all of them.  Consecutive headers are merged.  */
+      if (d->hdrbuflen + datalen > d->hdrbufsize)
+        return gpg_error (GPG_ERR_BUG);
+      memcpy (d->hdrbuf + d->hdrbuflen, data, datalen);
+      data = d->hdrbuf + d->hdrbuflen;
+      d->hdrbuflen += datalen;
+    }
+  if (last && (const unsigned char *)last->data + last->len == data)
+    {
+      last->len += datalen;
+      return 0;
+    }
+  if (d->niov == d->iovsize)
+    return gpg_error (GPG_ERR_BUG);
+  d->iov[d->niov].data = data;
+  d->iov[d->niov].len = datalen;
+  d->niov++;
+  return 0;
+}
+
+
+/* Describe the constructed DER object at D as a list of segments.  On
+ * success a pointer to an array of segments is stored at R_IOV and
+ * the number of segments at R_NIOV.  The segments either point to
+ * headers stored in D or to the values of the items; in particular
+ * values added with ksba_der_add_ptr are not copied.  The array is
+ * owned by D and valid until D is modified, reset or released.  */
+gpg_error_t
+_ksba_der_builder_get_iov (ksba_der_t d,
+                           const ksba_iov_t **r_iov, size_t *r_niov)
+{
+  gpg_error_t err;
+  size_t needed;
+  int idx;
+
+  if (!d || !r_iov || !r_niov)
+    return gpg_error (GPG_ERR_INV_ARG);
+  *r_iov = NULL;
+  *r_niov = 0;
+  if (d->error)
+    return d->error;
+
+  err = finish_object (d);
+  if (err)
+    return err;
+
+  /* Make sure that the header buffer and the array are large
+   * enough.  We need at most one header and one value segment for
+   * each item.  */
+  needed = 0;
+  for (idx=0; idx < d->nitems; idx++)
+    needed += d->items[idx].hdrlen + 1;
+  if (needed > d->hdrbufsize)
+    {
+      xfree (d->hdrbuf);
+      d->hdrbufsize = 0;
+      d->hdrbuf = xtrymalloc (needed);
+      if (!d->hdrbuf)
+        return gpg_error_from_syserror ();
+      d->hdrbufsize = needed;
+    }
+  if (2 * d->nitems > d->iovsize)
+    {
+      xfree (d->iov);
+      d->iovsize = 0;
+      d->iov = xtrycalloc (2 * d->nitems, sizeof *d->iov);
+      if (!d->iov)
+        return gpg_error_from_syserror ();
+      d->iovsize = 2 * d->nitems;
+    }
+  d->hdrbuflen = 0;
+  d->niov = 0;
+
+  err = emit_object (d, emit_to_iov, d);
+  if (err)
+    return err;
+
+  *r_iov = d->iov;
+  *r_niov = d->niov;
+  return 0;
+}
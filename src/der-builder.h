@@ -43,9 +43,17 @@ void _ksba_der_add_int (ksba_der_t d, const void *value, size_t valuelen,
 void _ksba_der_add_der (ksba_der_t d, const void *der, size_t derlen);
 void _ksba_der_add_tag (ksba_der_t d, int class, int tag);
 void _ksba_der_add_end (ksba_der_t d);
+void _ksba_der_add_slot (ksba_der_t d, int class, int tag, unsigned int slot);
+gpg_error_t _ksba_der_set_slot (ksba_der_t d, unsigned int slot,
+                                const void *value, size_t valuelen);
 
 gpg_error_t _ksba_der_builder_get (ksba_der_t d,
                                    unsigned char **r_obj, size_t *r_objlen);
+gpg_error_t _ksba_der_builder_write (ksba_der_t d, ksba_writer_t writer,
+                                     size_t *r_objlen);
+gpg_error_t _ksba_der_builder_get_iov (ksba_der_t d,
+                                       const ksba_iov_t **r_iov,
+                                       size_t *r_niov);
 
 
 #endif /*DER_BUILDER_H*/
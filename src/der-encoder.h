@@ -50,25 +50,4 @@ gpg_error_t _ksba_der_write_algorithm_identifier (
 
 
 
-gpg_error_t _ksba_der_copy_tree (AsnNode dst,
-                               AsnNode src, const unsigned char *srcimage);
-
-
-
-gpg_error_t _ksba_der_store_time (AsnNode node, const ksba_isotime_t atime);
-gpg_error_t _ksba_der_store_string (AsnNode node, const char *string);
-gpg_error_t _ksba_der_store_integer (AsnNode node, const unsigned char *value);
-gpg_error_t _ksba_der_store_oid (AsnNode node, const char *oid);
-gpg_error_t _ksba_der_store_octet_string (AsnNode node,
-                                        const char *buf, size_t len);
-gpg_error_t _ksba_der_store_sequence (AsnNode node,
-                                      const unsigned char *buf, size_t len);
-gpg_error_t _ksba_der_store_null (AsnNode node);
-
-
-gpg_error_t _ksba_der_encode_tree (AsnNode root,
-                                 unsigned char **r_image, size_t *r_imagelen);
-
-
-
 #endif /*DER_ENCODER_H*/
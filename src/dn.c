@@ -36,6 +36,8 @@
 #include <string.h>
 #include <assert.h>
 
+#define STATS_MODULE KSBA_STATS_MOD_NAME
+
 #include "util.h"
 #include "asn1-func.h"
 #include "ber-help.h"
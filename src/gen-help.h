@@ -36,6 +36,7 @@ void *xrealloc (void *mem, size_t n);
 char *xstrdup (const char *str);
 void xfree (void *a);
 #define xtrymalloc(a) malloc ((a))
+#define STATS_ADD(field,n) do { } while (0)
 
 char *gen_help_stpcpy (char *a, const char *b);
 #define stpcpy(a, b)  gen_help_stpcpy ((a), (b))
@@ -38,6 +38,8 @@
 #include <string.h>
 #include <assert.h>
 
+#define STATS_MODULE KSBA_STATS_MOD_KEYINFO
+
 #include "util.h"
 #include "asn1-func.h"
 #include "keyinfo.h"
@@ -48,7 +50,8 @@
 #include "stringbuf.h"
 #include "der-builder.h"
 
-/* Constants used for the public key algorithms.  */
+/* Constants used for the public key algorithms.  The values must
+   match those of ksba_pkalgo_t.  */
 typedef enum
   {
     PKALGO_NONE,
@@ -871,6 +874,138 @@ _ksba_keyinfo_to_sexp (const unsigned char *der, size_t derlen,
 }
 
 
+
+
+/* Return the number of bits of the INTEGER at DER with length DERLEN
+   not counting leading zeroes.  0 is returned on error.  */
+static unsigned int
+integer_nbits (const unsigned char *der, size_t derlen)
+{
+  struct tag_info ti;
+  unsigned int nbits;
+  int c;
+
+  if (_ksba_ber_parse_tl (&der, &derlen, &ti)
+      || !(ti.class == CLASS_UNIVERSAL && ti.tag == TYPE_INTEGER)
+      || ti.is_constructed || ti.ndef || ti.length > derlen)
+    return 0;
+  for (; ti.length && !*der; der++, ti.length--)
+    ;
+  if (!ti.length)
+    return 0;
+  nbits = (ti.length - 1) * 8;
+  for (c = *der; c; c >>= 1)
+    nbits++;
+  return nbits;
+}
+
+
+/* Parse the subjectPublicKeyInfo DER of length DERLEN and store the
+   public key algorithm (a pkalgo_t) at R_ALGO and the size of the key
+   in bits at R_NBITS.  For RSA this is the size of the modulus, for
+   DSA the size of P and for ECC the size of the curve as derived from
+   the size of the public point.  R_NBITS is set to 0 if the size can't
+   be determined.  Unlike _ksba_keyinfo_to_sexp this function does
+   not allocate any memory.  */
+gpg_error_t
+_ksba_keyinfo_get_pk_info (const unsigned char *der, size_t derlen,
+                           int *r_algo, unsigned int *r_nbits)
+{
+  gpg_error_t err;
+  int c;
+  size_t nread, off, len, parm_off, parm_len;
+  int parm_type;
+  int algoidx;
+  int is_bitstr;
+  unsigned int nbits = 0;
+  const unsigned char *parmder = NULL;
+  struct tag_info ti;
+
+  *r_algo = PKALGO_NONE;
+  *r_nbits = 0;
+
+  /* check the outer sequence */
+  if (!derlen)
+    return gpg_error (GPG_ERR_INV_KEYINFO);
+  c = *der++; derlen--;
+  if ( c != 0x30 )
+    return gpg_error (GPG_ERR_UNEXPECTED_TAG); /* not a SEQUENCE */
+  TLV_LENGTH(der);
+  /* and now the inner part */
+  err = get_algorithm (1, der, derlen, &nread, &off, &len, &is_bitstr,
+                       &parm_off, &parm_len, &parm_type);
+  if (err)
+    return err;
+
+  for (algoidx=0; pk_algo_table[algoidx].oid; algoidx++)
+    {
+      if ( len == pk_algo_table[algoidx].oidlen
+           && !memcmp (der+off, pk_algo_table[algoidx].oid, len))
+        break;
+    }
+  if (!pk_algo_table[algoidx].oid)
+    return gpg_error (GPG_ERR_UNKNOWN_ALGORITHM);
+
+  if (parm_off && parm_len && parm_type == TYPE_SEQUENCE)
+    parmder = der + parm_off;
+
+  der += nread;
+  derlen -= nread;
+  if (is_bitstr)
+    {
+      if (!derlen)
+        return gpg_error (GPG_ERR_INV_KEYINFO);
+      der++; derlen--;  /* Skip the number of unused bits.  */
+    }
+
+  switch (pk_algo_table[algoidx].pkalgo)
+    {
+    case PKALGO_RSA: /* SEQUENCE { INTEGER n, INTEGER e } */
+      if (!_ksba_ber_parse_tl (&der, &derlen, &ti)
+          && ti.class == CLASS_UNIVERSAL && ti.tag == TYPE_SEQUENCE)
+        nbits = integer_nbits (der, derlen);
+      break;
+
+    case PKALGO_DSA: /* The parameters are SEQUENCE { p, q, g } */
+      if (parmder)
+        {
+          size_t n = parm_len;
+
+          if (!_ksba_ber_parse_tl (&parmder, &n, &ti)
+              && ti.class == CLASS_UNIVERSAL && ti.tag == TYPE_SEQUENCE)
+            nbits = integer_nbits (parmder, n);
+        }
+      break;
+
+    case PKALGO_ECC: /* The key is the point.  */
+      if (derlen > 1 && der[0] == 0x04)
+        nbits = (derlen - 1) / 2 * 8;
+      else if (derlen > 1 && (der[0] == 0x02 || der[0] == 0x03))
+        nbits = (derlen - 1) * 8;
+      if (nbits == 528)
+        nbits = 521;  /* NIST P-521 */
+      break;
+
+    case PKALGO_X25519:
+    case PKALGO_ED25519:
+      nbits = 255;
+      break;
+
+    case PKALGO_X448:
+    case PKALGO_ED448:
+      nbits = 448;
+      break;
+
+    default:
+      break;
+    }
+
+  *r_algo = pk_algo_table[algoidx].pkalgo;
+  *r_nbits = nbits;
+  return 0;
+}
+
+
 /* Match the algorithm string given in BUF which is of length BUFLEN
  * with the known algorithms from our table and return the table
  * entriy with the OID string.  If WITH_SIG is true, the table of
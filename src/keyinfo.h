@@ -53,6 +53,10 @@ gpg_error_t _ksba_keyinfo_from_sexp (ksba_const_sexp_t sexp, int algoinfomode,
                                      unsigned char **r_der, size_t *r_derlen)
      _KSBA_VISIBILITY_DEFAULT;
 
+gpg_error_t _ksba_keyinfo_get_pk_info (const unsigned char *der,
+                                       size_t derlen,
+                                       int *r_algo, unsigned int *r_nbits);
+
 gpg_error_t _ksba_algoinfo_from_sexp (ksba_const_sexp_t sexp,
                                       unsigned char **r_der, size_t *r_derlen);
 
@@ -35,6 +35,8 @@
 #include <assert.h>
 #include <errno.h>
 
+#define STATS_MODULE KSBA_STATS_MOD_NAME
+
 #include "util.h"
 #include "asn1-func.h"
 #include "convert.h"
@@ -94,6 +96,82 @@ ksba_name_release (ksba_name_t name)
 }
 
 
+/* Initialize the iterator ITER to walk over the GeneralNames object
+   given by its DER encoding at DER with length DERLEN.  The object is
+   expected to start with the SEQUENCE tag as for example used in the
+   subjectAltName extension.  ITER references DER; thus DER must be
+   valid as long as ITER is in use.  Nothing is allocated, so there
+   is no need to release ITER.  */
+gpg_error_t
+ksba_name_iter_init (ksba_name_iter_t *iter, const void *der, size_t derlen)
+{
+  gpg_error_t err;
+  struct tag_info ti;
+  const unsigned char *p = der;
+
+  if (!iter || !der)
+    return gpg_error (GPG_ERR_INV_VALUE);
+  iter->_der = NULL;
+  iter->_derlen = 0;
+
+  err = _ksba_ber_parse_tl (&p, &derlen, &ti);
+  if (err)
+    return err;
+  if ( !(ti.class == CLASS_UNIVERSAL && ti.tag == TYPE_SEQUENCE
+         && ti.is_constructed) )
+    return gpg_error (GPG_ERR_INV_CERT_OBJ);
+  if (ti.ndef)
+    return gpg_error (GPG_ERR_NOT_DER_ENCODED);
+  if (ti.length > derlen)
+    return gpg_error (GPG_ERR_BAD_BER);
+
+  iter->_der = p;
+  iter->_derlen = ti.length;
+  return 0;
+}
+
+
+/* Return the next GeneralName from ITER.  The type of the name is
+   stored at R_TYPE and R_VALUE and R_VALUELEN are set to the content
+   of the name, pointing directly into the DER object given to
+   ksba_name_iter_init.  For rfc822Name, dNSName and URI this is the
+   IA5String, for iPAddress the 4 or 16 octets of the address (8 or 32
+   for a name constraint), for directoryName the DER encoded Name and
+   for all other types the raw content octets.  GPG_ERR_EOF is
+   returned if no more names are available.  */
+gpg_error_t
+ksba_name_iter_next (ksba_name_iter_t *iter, ksba_gn_type_t *r_type,
+                     const unsigned char **r_value, size_t *r_valuelen)
+{
+  gpg_error_t err;
+  struct tag_info ti;
+
+  if (!iter || !r_type || !r_value || !r_valuelen)
+    return gpg_error (GPG_ERR_INV_VALUE);
+  if (!iter->_derlen)
+    return gpg_error (GPG_ERR_EOF);
+
+  err = _ksba_ber_parse_tl (&iter->_der, &iter->_derlen, &ti);
+  if (err)
+    return err;
+  if (ti.class != CLASS_CONTEXT)
+    return gpg_error (GPG_ERR_INV_CERT_OBJ); /* we expected a tag */
+  if (ti.ndef)
+    return gpg_error (GPG_ERR_NOT_DER_ENCODED);
+  if (iter->_derlen < ti.length)
+    return gpg_error (GPG_ERR_BAD_BER);
+
+  *r_type = ti.tag;
+  *r_value = iter->_der;
+  *r_valuelen = ti.length;
+
+  /* advance pointer */
+  iter->_der += ti.length;
+  iter->_derlen -= ti.length;
+  return 0;
+}
+
+
 /* This is an internal function to create an ksba_name_t object from an
    DER encoded image which must point to an GeneralNames object */
 gpg_error_t
@@ -102,7 +180,8 @@ _ksba_name_new_from_der (ksba_name_t *r_name,
 {
   gpg_error_t err;
   ksba_name_t name;
-  struct tag_info ti;
+  ksba_name_iter_t iter;
+  ksba_gn_type_t type;
   const unsigned char *der;
   size_t derlen;
   int n;
@@ -114,36 +193,26 @@ _ksba_name_new_from_der (ksba_name_t *r_name,
   *r_name = NULL;
 
   /* Count and check for encoding errors - we won't do this again
-     during the second pass */
-  der = image;
-  derlen = imagelen;
+     during the second pass.  IMAGE is the content of the GeneralNames
+     and thus we set the iterator up directly.  */
+  iter._der = image;
+  iter._derlen = imagelen;
   n = 0;
-  while (derlen)
+  while (!(err = ksba_name_iter_next (&iter, &type, &der, &derlen)))
     {
-      err = _ksba_ber_parse_tl (&der, &derlen, &ti);
-      if (err)
-        return err;
-      if (ti.class != CLASS_CONTEXT)
-        return gpg_error (GPG_ERR_INV_CERT_OBJ); /* we expected a tag */
-      if (ti.ndef)
-        return gpg_error (GPG_ERR_NOT_DER_ENCODED);
-      if (derlen < ti.length)
-        return gpg_error (GPG_ERR_BAD_BER);
-      switch (ti.tag)
+      switch (type)
         {
-        case 1: /* rfc822Name - this is an imlicit IA5_STRING */
-        case 4: /* Name */
-        case 6: /* URI */
+        case KSBA_GN_RFC822_NAME:
+        case KSBA_GN_DIRECTORY_NAME:
+        case KSBA_GN_URI:
           n++;
           break;
         default:
           break;
         }
-
-      /* advance pointer */
-      der += ti.length;
-      derlen -= ti.length;
     }
+  if (gpg_err_code (err) != GPG_ERR_EOF)
+    return err;
 
   /* allocate array and set all slots to NULL for easier error recovery */
   err = ksba_name_new (&name);
@@ -160,41 +229,39 @@ _ksba_name_new_from_der (ksba_name_t *r_name,
   name->n_names = n;
 
   /* start the second pass */
-  der = image;
-  derlen = imagelen;
+  iter._der = image;
+  iter._derlen = imagelen;
   n = 0;
-  while (derlen)
+  while (!ksba_name_iter_next (&iter, &type, &der, &derlen))
     {
       char numbuf[21];
 
-      err = _ksba_ber_parse_tl (&der, &derlen, &ti);
-      assert (!err);
-      switch (ti.tag)
+      switch (type)
         {
-        case 1: /* rfc822Name - this is an imlicit IA5_STRING */
-          p = name->names[n] = xtrymalloc (ti.length+3);
+        case KSBA_GN_RFC822_NAME: /* this is an imlicit IA5_STRING */
+          p = name->names[n] = xtrymalloc (derlen+3);
           if (!p)
             {
               ksba_name_release (name);
               return gpg_error (GPG_ERR_ENOMEM);
             }
           *p++ = '<';
-          memcpy (p, der, ti.length);
-          p += ti.length;
+          memcpy (p, der, derlen);
+          p += derlen;
           *p++ = '>';
           *p = 0;
           n++;
           break;
-        case 4: /* Name */
-          err = _ksba_derdn_to_str (der, ti.length, &p);
+        case KSBA_GN_DIRECTORY_NAME:
+          err = _ksba_derdn_to_str (der, derlen, &p);
           if (err)
             return err; /* FIXME: we need to release some of the memory */
           name->names[n++] = p;
           break;
-        case 6: /* URI */
-          sprintf (numbuf, "%u:", (unsigned int)ti.length);
+        case KSBA_GN_URI:
+          sprintf (numbuf, "%u:", (unsigned int)derlen);
           p = name->names[n] = xtrymalloc (1+5+strlen (numbuf)
-                                           + ti.length +1+1);
+                                           + derlen +1+1);
           if (!p)
             {
               ksba_name_release (name);
@@ -202,8 +269,8 @@ _ksba_name_new_from_der (ksba_name_t *r_name,
             }
           p = stpcpy (p, "(3:uri");
           p = stpcpy (p, numbuf);
-          memcpy (p, der, ti.length);
-          p += ti.length;
+          memcpy (p, der, derlen);
+          p += derlen;
           *p++ = ')';
           *p = 0; /* extra safeguard null */
           n++;
@@ -211,10 +278,6 @@ _ksba_name_new_from_der (ksba_name_t *r_name,
         default:
           break;
         }
-
-      /* advance pointer */
-      der += ti.length;
-      derlen -= ti.length;
     }
   *r_name = name;
   return 0;
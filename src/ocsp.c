@@ -34,6 +34,8 @@
 #include <string.h>
 #include <assert.h>
 
+#define STATS_MODULE KSBA_STATS_MOD_OCSP
+
 #include "util.h"
 
 #include "cert.h"
@@ -982,8 +984,10 @@ parse_single_response (ksba_ocsp_t ocsp,
   err= parse_integer (data, datalen, &ti);
   if (err)
     return err;
-  serialno = *data;
-  serialnolen = ti.length;
+  /* The request item stores the serial number including its tag and
+     length; thus we compare the entire encoding.  */
+  serialno = *data - ti.nhdr;
+  serialnolen = ti.nhdr + ti.length;
 /*   fprintf (stderr, "serialNumber=");  */
 /*   dump_hex (*data, ti.length); */
 /*   putc ('\n', stderr); */
@@ -1450,8 +1454,11 @@ ksba_ocsp_parse_response (ksba_ocsp_t ocsp,
     }
 
   /* Run the actual parser.  */
+  TRACE (KSBA_TRACE_OCSP_PARSE_START, 0, 0, 0, ocsp, NULL);
   err = parse_response (ocsp, msg, msglen);
   *response_status = ocsp->response_status;
+  TRACE (KSBA_TRACE_OCSP_PARSE_END, ocsp->response_status, err, msglen,
+         ocsp, NULL);
 
   /* FIXME: find duplicates in the request list and set them to the
      same status. */
@@ -1649,6 +1656,50 @@ ksba_ocsp_get_status (ksba_ocsp_t ocsp, ksba_cert_t cert,
 }
 
 
+/* Same as ksba_ocsp_get_status but return the times as seconds since
+   the epoch.  If one of the requested times is not available, for
+   example the revocation time of a good certificate, 0 is stored for
+   it and GPG_ERR_NO_VALUE is returned; all other values are valid
+   nevertheless.  */
+gpg_error_t
+ksba_ocsp_get_status_epoch (ksba_ocsp_t ocsp, ksba_cert_t cert,
+                            ksba_status_t *r_status,
+                            ksba_epochtime_t *r_this_update,
+                            ksba_epochtime_t *r_next_update,
+                            ksba_epochtime_t *r_revocation_time,
+                            ksba_crl_reason_t *r_reason)
+{
+  struct ocsp_reqitem_s *ri;
+  gpg_error_t err = 0;
+
+  if (!ocsp || !cert || !r_status)
+    return gpg_error (GPG_ERR_INV_VALUE);
+  if (!ocsp->requestlist)
+    return gpg_error (GPG_ERR_MISSING_ACTION);
+
+  for (ri=ocsp->requestlist; ri; ri = ri->next)
+    if (ri->cert == cert)
+      break;
+  if (!ri)
+    return gpg_error (GPG_ERR_NOT_FOUND);
+  *r_status = ri->status;
+  /* The times have been validated while parsing; thus an error here
+     can only be GPG_ERR_NO_VALUE.  */
+  if (r_this_update && _ksba_isotime_to_epoch (ri->this_update,
+                                               r_this_update))
+    err = gpg_error (GPG_ERR_NO_VALUE);
+  if (r_next_update && _ksba_isotime_to_epoch (ri->next_update,
+                                               r_next_update))
+    err = gpg_error (GPG_ERR_NO_VALUE);
+  if (r_revocation_time && _ksba_isotime_to_epoch (ri->revocation_time,
+                                                   r_revocation_time))
+    err = gpg_error (GPG_ERR_NO_VALUE);
+  if (r_reason)
+    *r_reason = ri->revocation_reason;
+  return err;
+}
+
+
 /* WARNING: The returned values ares only valid as long as no other
    ocsp function is called on the same context.  */
 gpg_error_t
@@ -34,6 +34,8 @@
 #include <string.h>
 #include <assert.h>
 
+#define STATS_MODULE KSBA_STATS_MOD_OID
+
 #include "util.h"
 #include "asn1-func.h"
 #include "convert.h"
@@ -163,35 +165,19 @@ make_flagged_int (unsigned long value, char *buf, size_t buflen)
 }
 
 
-/**
- * ksba_oid_from_str:
- * @string: A string with the OID in dotted decimal form
- * @rbuf:   Returns the DER encoded OID
- * @rlength: and its length
- *
- * Convertes the OID given in dotted decimal form to an DER encoding
- * and returns it in allocated buffer rbuf and its length in rlength.
- * rbuf is set to NULL in case an error is returned.
- * Scanning stops at the first white space.
- *
- * The caller must free the returned buffer using ksba_free() or the
- * function he has registered as a replacement.
- *
- * Return value: 0 on success or an error value
- **/
+/* Convert the OID given in dotted decimal form in STRING to its DER
+   encoding and store it at BUF.  BUF must have a size of at least
+   strlen (STRING) + 2 bytes.  The length of the encoding is stored at
+   R_LENGTH.  */
 gpg_error_t
-ksba_oid_from_str (const char *string, unsigned char **rbuf, size_t *rlength)
+_ksba_oid_encode (const char *string, unsigned char *buf, size_t *r_length)
 {
-  unsigned char *buf;
   size_t buflen;
   unsigned long val1, val;
   const char *endp;
   int arcno;
 
-  if (!string || !rbuf || !rlength)
-    return gpg_error (GPG_ERR_INV_VALUE);
-  *rbuf = NULL;
-  *rlength = 0;
+  *r_length = 0;
 
   /* we allow the OID to be prefixed with either "oid." or "OID." */
   if ( !strncmp (string, "oid.", 4) || !strncmp (string, "OID.", 4))
@@ -200,22 +186,14 @@ ksba_oid_from_str (const char *string, unsigned char **rbuf, size_t *rlength)
   if (!*string)
     return gpg_error (GPG_ERR_INV_VALUE);
 
-  /* we can safely assume that the encoded OID is shorter than the string */
-  buf = xtrymalloc ( strlen(string) + 2);
-  if (!buf)
-    return gpg_error (GPG_ERR_ENOMEM);
   buflen = 0;
-
   val1 = 0; /* avoid compiler warnings */
   arcno = 0;
   do {
     arcno++;
     val = strtoul (string, (char**)&endp, 10);
     if (!digitp (string) || !(*endp == '.' || !*endp))
-      {
-        xfree (buf);
-        return gpg_error (GPG_ERR_INV_OID_STRING);
-      }
+      return gpg_error (GPG_ERR_INV_OID_STRING);
     if (*endp == '.')
       string = endp+1;
 
@@ -230,10 +208,7 @@ ksba_oid_from_str (const char *string, unsigned char **rbuf, size_t *rlength)
         if (val1 < 2)
           {
             if (val > 39)
-              {
-                xfree (buf);
-                return gpg_error (GPG_ERR_INV_OID_STRING);
-              }
+              return gpg_error (GPG_ERR_INV_OID_STRING);
             buf[buflen++] = val1*40 + val;
           }
         else
@@ -250,12 +225,54 @@ ksba_oid_from_str (const char *string, unsigned char **rbuf, size_t *rlength)
 
   if (arcno == 1)
     { /* it is not possible to encode only the first arc */
-      xfree (buf);
       return gpg_error (GPG_ERR_INV_OID_STRING);
     }
 
+  *r_length = buflen;
+  return 0;
+}
+
+
+/**
+ * ksba_oid_from_str:
+ * @string: A string with the OID in dotted decimal form
+ * @rbuf:   Returns the DER encoded OID
+ * @rlength: and its length
+ *
+ * Convertes the OID given in dotted decimal form to an DER encoding
+ * and returns it in allocated buffer rbuf and its length in rlength.
+ * rbuf is set to NULL in case an error is returned.
+ * Scanning stops at the first white space.
+ *
+ * The caller must free the returned buffer using ksba_free() or the
+ * function he has registered as a replacement.
+ *
+ * Return value: 0 on success or an error value
+ **/
+gpg_error_t
+ksba_oid_from_str (const char *string, unsigned char **rbuf, size_t *rlength)
+{
+  gpg_error_t err;
+  unsigned char *buf;
+
+  if (!string || !rbuf || !rlength)
+    return gpg_error (GPG_ERR_INV_VALUE);
+  *rbuf = NULL;
+  *rlength = 0;
+
+  /* we can safely assume that the encoded OID is shorter than the string */
+  buf = xtrymalloc ( strlen(string) + 2);
+  if (!buf)
+    return gpg_error (GPG_ERR_ENOMEM);
+
+  err = _ksba_oid_encode (string, buf, rlength);
+  if (err)
+    {
+      xfree (buf);
+      return err;
+    }
+
   *rbuf = buf;
-  *rlength = buflen;
   return 0;
 }
 
@@ -35,11 +35,58 @@
 #include <string.h>
 #include <assert.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef HAVE_SYS_MMAN_H
+# include <sys/mman.h>
+#endif
+#define STATS_MODULE KSBA_STATS_MOD_IO
+
 #include "util.h"
 
 #include "ksba.h"
 #include "reader.h"
 
+#ifndef O_BINARY
+# define O_BINARY 0
+#endif
+
+
+/* Map of the base64 characters to their values.  Other values are
+   used for the padding character, white space, the dash which starts
+   an armor line and for invalid characters.  */
+#define B64_PAD     0x40
+#define B64_SPACE   0x41
+#define B64_DASH    0x42
+#define B64_INVALID 0xff
+static const unsigned char asctobin[256] =
+  {
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x41, 0x41, 0x41,
+    0x41, 0x41, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x41, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x3e, 0xff, 0x42, 0xff, 0x3f,
+    0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0xff, 0xff,
+    0xff, 0x40, 0xff, 0xff, 0xff, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06,
+    0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x10, 0x11, 0x12,
+    0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20, 0x21, 0x22, 0x23, 0x24,
+    0x25, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f, 0x30,
+    0x31, 0x32, 0x33, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff
+  };
+
+
 /**
  * ksba_reader_new:
  *
@@ -78,7 +125,14 @@ ksba_reader_release (ksba_reader_t r)
     }
   if (r->type == READER_TYPE_MEM)
     xfree (r->u.mem.buffer);
+#ifdef HAVE_MMAP
+  else if (r->type == READER_TYPE_MMAP && r->u.mmap.map)
+    munmap (r->u.mmap.map, r->u.mmap.size);
+#endif
+  else if (r->type == READER_TYPE_FD && r->close_fd)
+    close (r->u.fd);
   xfree (r->unread.buf);
+  xfree (r->base64.buf);
   xfree (r);
 }
 
@@ -119,6 +173,7 @@ ksba_reader_clear (ksba_reader_t r, unsigned char **buffer, size_t *buflen)
   r->eof = 0;
   r->error = 0;
   r->nread = 0;
+  r->base64.eof = 0;
   n = r->unread.length;
   r->unread.length = 0;
 
@@ -243,6 +298,85 @@ ksba_reader_set_file (ksba_reader_t r, FILE *fp)
 
 
 
+/* Initialize the reader object R to read the regular file opened as
+   FD by mapping it into memory.  The decoders then take the data
+   directly from the mapping.  FD is not needed after this call and
+   may be closed.  GPG_ERR_NOT_SUPPORTED is returned if FD does not
+   refer to a regular file or the system does not support mapping.  */
+gpg_error_t
+ksba_reader_set_mmap (ksba_reader_t r, int fd)
+{
+#ifdef HAVE_MMAP
+  struct stat st;
+  void *map = NULL;
+
+  if (!r || fd == -1)
+    return gpg_error (GPG_ERR_INV_VALUE);
+  if (r->type)
+    return gpg_error (GPG_ERR_CONFLICT);
+
+  if (fstat (fd, &st))
+    return gpg_error_from_syserror ();
+  if (!S_ISREG (st.st_mode) || (uint64_t)st.st_size > (size_t)-1)
+    return gpg_error (GPG_ERR_NOT_SUPPORTED);
+  if (st.st_size)
+    {
+      map = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (map == MAP_FAILED)
+        return gpg_error_from_syserror ();
+# ifdef HAVE_MADVISE
+      madvise (map, st.st_size, MADV_SEQUENTIAL);
+# endif
+    }
+
+  r->eof = 0;
+  r->type = READER_TYPE_MMAP;
+  r->u.mmap.map = map;
+  r->u.mmap.size = st.st_size;
+  r->u.mmap.readpos = 0;
+  return 0;
+#else /*!HAVE_MMAP*/
+  (void)fd;
+  if (!r)
+    return gpg_error (GPG_ERR_INV_VALUE);
+  return gpg_error (GPG_ERR_NOT_SUPPORTED);
+#endif /*!HAVE_MMAP*/
+}
+
+
+/* Initialize the reader object R to read the file FNAME.  If
+   possible the file is mapped into memory, otherwise it is read
+   using a file descriptor which is closed when R is released.  */
+gpg_error_t
+ksba_reader_open_file (ksba_reader_t r, const char *fname)
+{
+  gpg_error_t err;
+  int fd;
+
+  if (!r || !fname)
+    return gpg_error (GPG_ERR_INV_VALUE);
+  if (r->type)
+    return gpg_error (GPG_ERR_CONFLICT);
+
+  fd = open (fname, O_RDONLY | O_BINARY);
+  if (fd == -1)
+    return gpg_error_from_syserror ();
+
+  err = ksba_reader_set_mmap (r, fd);
+  if (!err)
+    close (fd);
+  else if (gpg_err_code (err) == GPG_ERR_NOT_SUPPORTED)
+    {
+      err = ksba_reader_set_fd (r, fd);
+      if (!err)
+        r->close_fd = 1;
+    }
+  if (err)
+    close (fd);
+  return err;
+}
+
+
 /**
  * ksba_reader_set_cb:
  * @r: Reader object
@@ -285,65 +419,50 @@ ksba_reader_set_cb (ksba_reader_t r,
 }
 
 
-/**
- * ksba_reader_read:
- * @r: Readder object
- * @buffer: A buffer for returning the data
- * @length: The length of this buffer
- * @nread:  Number of bytes actually read.
- *
- * Read data from the current read position to the supplied @buffer,
- * max. @length bytes are read and the actual number of bytes read are
- * returned in @nread.  If there are no more bytes available %GPG_ERR_EOF is
- * returned and @nread is set to 0.
- *
- * If a @buffer of NULL is specified, the function does only return
- * the number of bytes available and does not move the read pointer.
- * This does only work for objects initialized from memory; if the
- * object is not capable of this it will return the error
- * GPG_ERR_NOT_IMPLEMENTED
- *
- * Return value: 0 on success, GPG_ERR_EOF or another error code
- **/
+/* Let the reader R decode base64 encoded data from its source on the
+   fly.  White space is ignored and decoding stops at a dash, which
+   is for example the start of a MIME boundary.  With the flag
+   KSBA_BASE64_PEM set in FLAGS everything up to a line starting with
+   "-----BEGIN" is skipped and decoding stops at the "-----END" line;
+   further PEM objects are then decoded as well so that a bundle reads
+   as a sequence of DER objects.  */
 gpg_error_t
-ksba_reader_read (ksba_reader_t r, char *buffer, size_t length, size_t *nread)
+ksba_reader_set_base64 (ksba_reader_t r, unsigned int flags)
 {
-  size_t nbytes;
-
-  if (!r || !nread)
+  if (!r)
     return gpg_error (GPG_ERR_INV_VALUE);
+  if ((flags & ~KSBA_BASE64_PEM))
+    return gpg_error (GPG_ERR_INV_FLAG);
 
-
-  if (!buffer)
+  if (!r->base64.buf)
     {
-      if (r->type != READER_TYPE_MEM)
-        return gpg_error (GPG_ERR_NOT_IMPLEMENTED);
-      *nread = r->u.mem.size - r->u.mem.readpos;
-      if (r->unread.buf)
-        *nread += r->unread.length - r->unread.readpos;
-      return *nread? 0 : gpg_error (GPG_ERR_EOF);
+      r->base64.size = 4096;
+      r->base64.buf = xtrymalloc (r->base64.size);
+      if (!r->base64.buf)
+        return gpg_error_from_syserror ();
     }
+  r->base64.flags = flags;
+  r->base64.state = (flags & KSBA_BASE64_PEM)? BASE64_SEEK : BASE64_BODY;
+  r->base64.match = 0;
+  r->base64.quad = 0;
+  r->base64.nquad = 0;
+  r->base64.npending = 0;
+  r->base64.length = 0;
+  r->base64.readpos = 0;
+  r->base64.eof = 0;
 
-  *nread = 0;
-
-  if (r->unread.buf && r->unread.length)
-    {
-      nbytes = r->unread.length - r->unread.readpos;
-      if (!nbytes)
-        return gpg_error (GPG_ERR_BUG);
+  return 0;
+}
 
-      if (nbytes > length)
-        nbytes = length;
-      memcpy (buffer, r->unread.buf + r->unread.readpos, nbytes);
-      r->unread.readpos += nbytes;
-      if (r->unread.readpos == r->unread.length)
-        r->unread.readpos = r->unread.length = 0;
-      *nread = nbytes;
-      r->nread += nbytes;
-      return 0;
-    }
 
+/* Read up to LENGTH bytes from the source of R into BUFFER and store
+   the number of bytes read at NREAD.  */
+static gpg_error_t
+read_source (ksba_reader_t r, char *buffer, size_t length, size_t *nread)
+{
+  size_t nbytes;
 
+  *nread = 0;
   if (!r->type)
     {
       r->eof = 1;
@@ -362,9 +481,23 @@ ksba_reader_read (ksba_reader_t r, char *buffer, size_t length, size_t *nread)
         nbytes = length;
       memcpy (buffer, r->u.mem.buffer + r->u.mem.readpos, nbytes);
       *nread = nbytes;
-      r->nread += nbytes;
       r->u.mem.readpos += nbytes;
     }
+  else if (r->type == READER_TYPE_MMAP)
+    {
+      nbytes = r->u.mmap.size - r->u.mmap.readpos;
+      if (!nbytes)
+        {
+          r->eof = 1;
+          return gpg_error (GPG_ERR_EOF);
+        }
+
+      if (nbytes > length)
+        nbytes = length;
+      memcpy (buffer, r->u.mmap.map + r->u.mmap.readpos, nbytes);
+      *nread = nbytes;
+      r->u.mmap.readpos += nbytes;
+    }
   else if (r->type == READER_TYPE_FILE)
     {
       size_t n;
@@ -379,13 +512,7 @@ ksba_reader_read (ksba_reader_t r, char *buffer, size_t length, size_t *nread)
         }
 
       n = fread (buffer, 1, length, r->u.file);
-      if (n)
-        {
-          r->nread += n;
-          *nread = n;
-        }
-      else
-        *nread = 0;
+      *nread = n;
       if (n < length)
         {
           if (ferror(r->u.file))
@@ -406,7 +533,6 @@ ksba_reader_read (ksba_reader_t r, char *buffer, size_t length, size_t *nread)
           r->eof = 1;
           return gpg_error (GPG_ERR_EOF);
         }
-      r->nread += *nread;
     }
   else if (r->type == READER_TYPE_FD)
     {
@@ -423,10 +549,7 @@ ksba_reader_read (ksba_reader_t r, char *buffer, size_t length, size_t *nread)
 
       n = read (r->u.fd, buffer, length);
       if (n > 0)
-        {
-          r->nread += n;
-          *nread = n;
-        }
+        *nread = n;
       else
         {
           *nread = 0;
@@ -449,6 +572,331 @@ ksba_reader_read (ksba_reader_t r, char *buffer, size_t length, size_t *nread)
   return 0;
 }
 
+
+/* Store the N bytes at TMP to D, but not beyond DEND; the rest is
+   kept as pending data of R.  Returns the new value of D.  */
+static unsigned char *
+put_bytes (ksba_reader_t r, unsigned char *d, unsigned char *dend,
+           const unsigned char *tmp, int n)
+{
+  int i;
+
+  for (i=0; i < n && d < dend; i++)
+    *d++ = tmp[i];
+  for (; i < n; i++)
+    r->base64.pending[r->base64.npending++] = tmp[i];
+  return d;
+}
+
+
+/* Store the bytes of an incomplete quad of R at D and reset the
+   quad.  Returns the new value of D.  */
+static unsigned char *
+flush_quad (ksba_reader_t r, unsigned char *d, unsigned char *dend)
+{
+  unsigned char tmp[2];
+  unsigned int quad = r->base64.quad;
+
+  if (r->base64.nquad == 2)
+    {
+      tmp[0] = quad >> 4;
+      d = put_bytes (r, d, dend, tmp, 1);
+    }
+  else if (r->base64.nquad == 3)
+    {
+      tmp[0] = quad >> 10;
+      tmp[1] = quad >> 2;
+      d = put_bytes (r, d, dend, tmp, 2);
+    }
+  r->base64.quad = 0;
+  r->base64.nquad = 0;
+  return d;
+}
+
+
+/* Decode base64 data from the source of R into BUFFER of LENGTH and
+   store the number of bytes decoded at NREAD.  The source is only
+   read again if no decoded data is available.  */
+static gpg_error_t
+read_base64 (ksba_reader_t r, unsigned char *buffer, size_t length,
+             size_t *nread)
+{
+  gpg_error_t err;
+  const unsigned char *s, *end;
+  unsigned char *d = buffer;
+  unsigned char *dend = buffer + length;
+  unsigned char tmp[3];
+  unsigned int c, quad;
+  size_t n;
+
+  *nread = 0;
+  for (;;)
+    {
+      while (r->base64.npending && d < dend)
+        {
+          *d++ = r->base64.pending[0];
+          r->base64.npending--;
+          memmove (r->base64.pending, r->base64.pending + 1,
+                   r->base64.npending);
+        }
+      if (d == dend || r->base64.state == BASE64_DONE)
+        break;
+
+      if (r->base64.readpos == r->base64.length)
+        {
+          if (d > buffer)
+            break;  /* Return what we have.  */
+          if (r->base64.eof)
+            {
+              d = flush_quad (r, d, dend);
+              r->base64.state = BASE64_DONE;
+              continue;
+            }
+          err = read_source (r, (char*)r->base64.buf, r->base64.size, &n);
+          if (gpg_err_code (err) == GPG_ERR_EOF)
+            r->base64.eof = 1;
+          else if (err)
+            return err;
+          r->base64.length = n;
+          r->base64.readpos = 0;
+          continue;
+        }
+
+      s = r->base64.buf + r->base64.readpos;
+      end = r->base64.buf + r->base64.length;
+      switch (r->base64.state)
+        {
+        case BASE64_SEEK:
+          while (s < end)
+            {
+              c = *s++;
+              if (c == "-----BEGIN"[r->base64.match])
+                {
+                  if (++r->base64.match == 10)
+                    {
+                      r->base64.state = BASE64_HEADLINE;
+                      break;
+                    }
+                }
+              else if (c == '\n')
+                r->base64.match = 0;
+              else
+                {
+                  r->base64.state = BASE64_SKIPLINE;
+                  r->base64.match = 0;
+                  break;
+                }
+            }
+          break;
+
+        case BASE64_SKIPLINE:
+        case BASE64_HEADLINE:
+          s = memchr (s, '\n', end - s);
+          if (!s)
+            s = end;
+          else
+            {
+              s++;
+              r->base64.state = (r->base64.state == BASE64_HEADLINE
+                                 ? BASE64_BODY : BASE64_SEEK);
+              r->base64.match = 0;
+            }
+          break;
+
+        case BASE64_BODY:
+          quad = r->base64.quad;
+          while (s < end && d < dend)
+            {
+              /* Fast path for four valid characters.  */
+              if (!r->base64.nquad && end - s >= 4 && dend - d >= 3
+                  && (asctobin[s[0]] | asctobin[s[1]]
+                      | asctobin[s[2]] | asctobin[s[3]]) < 64)
+                {
+                  c = ((asctobin[s[0]] << 18) | (asctobin[s[1]] << 12)
+                       | (asctobin[s[2]] << 6) | asctobin[s[3]]);
+                  d[0] = c >> 16;
+                  d[1] = c >> 8;
+                  d[2] = c;
+                  d += 3;
+                  s += 4;
+                  continue;
+                }
+
+              c = asctobin[*s++];
+              if (c < 64)
+                {
+                  quad = (quad << 6) | c;
+                  if (++r->base64.nquad == 4)
+                    {
+                      tmp[0] = quad >> 16;
+                      tmp[1] = quad >> 8;
+                      tmp[2] = quad;
+                      d = put_bytes (r, d, dend, tmp, 3);
+                      quad = 0;
+                      r->base64.nquad = 0;
+                    }
+                }
+              else if (c == B64_SPACE)
+                ;
+              else if (c == B64_PAD || c == B64_DASH)
+                {
+                  r->base64.quad = quad;
+                  d = flush_quad (r, d, dend);
+                  quad = 0;
+                  if (c == B64_DASH)
+                    {
+                      /* The end line or a MIME boundary.  */
+                      r->base64.state = ((r->base64.flags & KSBA_BASE64_PEM)
+                                         ? BASE64_SKIPLINE : BASE64_DONE);
+                      break;
+                    }
+                }
+              else
+                {
+                  r->base64.readpos = s - r->base64.buf;
+                  r->base64.quad = quad;
+                  return gpg_error (GPG_ERR_INV_ARMOR);
+                }
+            }
+          r->base64.quad = quad;
+          break;
+
+        default:
+          return gpg_error (GPG_ERR_BUG);
+        }
+      r->base64.readpos = s - r->base64.buf;
+    }
+
+  *nread = d - buffer;
+  return *nread? 0 : gpg_error (GPG_ERR_EOF);
+}
+
+
+/**
+ * ksba_reader_read:
+ * @r: Readder object
+ * @buffer: A buffer for returning the data
+ * @length: The length of this buffer
+ * @nread:  Number of bytes actually read.
+ *
+ * Read data from the current read position to the supplied @buffer,
+ * max. @length bytes are read and the actual number of bytes read are
+ * returned in @nread.  If there are no more bytes available %GPG_ERR_EOF is
+ * returned and @nread is set to 0.
+ *
+ * If a @buffer of NULL is specified, the function does only return
+ * the number of bytes available and does not move the read pointer.
+ * This does only work for objects initialized from memory; if the
+ * object is not capable of this it will return the error
+ * GPG_ERR_NOT_IMPLEMENTED
+ *
+ * Return value: 0 on success, GPG_ERR_EOF or another error code
+ **/
+gpg_error_t
+ksba_reader_read (ksba_reader_t r, char *buffer, size_t length, size_t *nread)
+{
+  gpg_error_t err;
+  size_t nbytes;
+
+  if (!r || !nread)
+    return gpg_error (GPG_ERR_INV_VALUE);
+
+
+  if (!buffer)
+    {
+      if (r->type == READER_TYPE_MMAP && !r->base64.state)
+        *nread = r->u.mmap.size - r->u.mmap.readpos;
+      else if (r->type != READER_TYPE_MEM || r->base64.state)
+        return gpg_error (GPG_ERR_NOT_IMPLEMENTED);
+      else
+        *nread = r->u.mem.size - r->u.mem.readpos;
+      if (r->unread.buf)
+        *nread += r->unread.length - r->unread.readpos;
+      return *nread? 0 : gpg_error (GPG_ERR_EOF);
+    }
+
+  *nread = 0;
+
+  if (r->unread.buf && r->unread.length)
+    {
+      nbytes = r->unread.length - r->unread.readpos;
+      if (!nbytes)
+        return gpg_error (GPG_ERR_BUG);
+
+      if (nbytes > length)
+        nbytes = length;
+      memcpy (buffer, r->unread.buf + r->unread.readpos, nbytes);
+      r->unread.readpos += nbytes;
+      if (r->unread.readpos == r->unread.length)
+        r->unread.readpos = r->unread.length = 0;
+      *nread = nbytes;
+      r->nread += nbytes;
+      STATS_ADD (reader_calls, 1);
+      STATS_ADD (reader_bytes, nbytes);
+      return 0;
+    }
+
+  if (r->base64.state)
+    err = read_base64 (r, (unsigned char*)buffer, length, nread);
+  else
+    err = read_source (r, buffer, length, nread);
+  if (!err)
+    {
+      r->nread += *nread;
+      STATS_ADD (reader_calls, 1);
+      STATS_ADD (reader_bytes, *nread);
+    }
+  return err;
+}
+
+
+/* Read up to LENGTH bytes from R like ksba_reader_read.  For memory
+   and mapped readers no data is copied but a pointer to the data is
+   stored at R_PTR; for all other readers the data is read into BUFFER
+   and R_PTR is set to BUFFER.  */
+gpg_error_t
+_ksba_reader_read_ptr (ksba_reader_t r, char *buffer, size_t length,
+                       const char **r_ptr, size_t *nread)
+{
+  unsigned char *base;
+  size_t size, *readpos;
+
+  *r_ptr = buffer;
+  if (!r || !nread || !length || r->unread.length || r->base64.state)
+    return ksba_reader_read (r, buffer, length, nread);
+
+  if (r->type == READER_TYPE_MEM)
+    {
+      base = r->u.mem.buffer;
+      size = r->u.mem.size;
+      readpos = &r->u.mem.readpos;
+    }
+  else if (r->type == READER_TYPE_MMAP)
+    {
+      base = r->u.mmap.map;
+      size = r->u.mmap.size;
+      readpos = &r->u.mmap.readpos;
+    }
+  else
+    return ksba_reader_read (r, buffer, length, nread);
+
+  *nread = size - *readpos;
+  if (!*nread)
+    {
+      r->eof = 1;
+      return gpg_error (GPG_ERR_EOF);
+    }
+  if (*nread > length)
+    *nread = length;
+  *r_ptr = (const char*)base + *readpos;
+  *readpos += *nread;
+  r->nread += *nread;
+  STATS_ADD (reader_calls, 1);
+  STATS_ADD (reader_bytes, *nread);
+  return 0;
+}
+
+
 gpg_error_t
 ksba_reader_unread (ksba_reader_t r, const void *buffer, size_t count)
 {
@@ -464,8 +912,15 @@ ksba_reader_unread (ksba_reader_t r, const void *buffer, size_t count)
 
   if (!r->unread.buf)
     {
+      ksba_alloc_ctx_t prevctx;
+
+      /* Readers are not created in an allocation context; thus do
+         not take the buffer from the context of a certificate
+         currently reading from R.  */
       r->unread.size = count + 100;
+      _ksba_alloc_ctx_enter (NULL, &prevctx);
       r->unread.buf = xtrymalloc (r->unread.size);
+      _ksba_alloc_ctx_leave (NULL, prevctx);
       if (!r->unread.buf)
         return gpg_error (GPG_ERR_ENOMEM);
       r->unread.length = count;
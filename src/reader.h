@@ -38,7 +38,20 @@ enum reader_type {
   READER_TYPE_MEM,
   READER_TYPE_FD,
   READER_TYPE_FILE,
-  READER_TYPE_CB
+  READER_TYPE_CB,
+  READER_TYPE_MMAP
+};
+
+
+/* States of the base64 decoder.  */
+enum base64_state {
+  BASE64_NONE = 0,     /* No decoding.  */
+  BASE64_SEEK,         /* At the start of a line looking for the
+                          PEM begin line.  */
+  BASE64_SKIPLINE,     /* Skip to the end of the line and then seek.  */
+  BASE64_HEADLINE,     /* Skip the rest of the begin line.  */
+  BASE64_BODY,         /* Decoding.  */
+  BASE64_DONE          /* End of the base64 data.  */
 };
 
 
@@ -53,6 +66,8 @@ struct ksba_reader_s {
     size_t readpos; /* offset where to start the next read */
   } unread;
   enum reader_type type;
+  int close_fd;  /* The fd of a READER_TYPE_FD has been opened by
+                    ksba_reader_open_file.  */
   union {
     struct {
       unsigned char *buffer;
@@ -60,17 +75,41 @@ struct ksba_reader_s {
       size_t readpos;
     } mem;   /* for READER_TYPE_MEM */
     int fd;  /* for READER_TYPE_FD */
+    struct {
+      unsigned char *map;
+      size_t size;
+      size_t readpos;
+    } mmap;  /* for READER_TYPE_MMAP */
     FILE *file; /* for READER_TYPE_FILE */
     struct {
       int (*fnc)(void*,char *,size_t,size_t*);
       void *value;
     } cb;   /* for READER_TYPE_CB */
   } u;
+  struct {
+    enum base64_state state;
+    unsigned int flags;    /* KSBA_BASE64_xxx as given to
+                              ksba_reader_set_base64.  */
+    int match;             /* Number of matched chars of the begin line.  */
+    unsigned int quad;     /* Bits of the incomplete quad.  */
+    int nquad;             /* Number of chars in QUAD.  */
+    unsigned char pending[3]; /* Decoded bytes not yet returned.  */
+    int npending;
+    unsigned char *buf;    /* Buffer for the encoded data.  */
+    size_t size;
+    size_t length;
+    size_t readpos;
+    int eof;               /* The source has no more data.  */
+  } base64;
   void (*notify_cb)(void*,ksba_reader_t);
   void *notify_cb_value;
 };
 
 
+/*-- reader.c --*/
+gpg_error_t _ksba_reader_read_ptr (ksba_reader_t r,
+                                   char *buffer, size_t length,
+                                   const char **r_ptr, size_t *nread);
 
 
 #endif /*READER_H*/
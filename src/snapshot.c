@@ -0,0 +1,884 @@
+/* snapshot.c - Persisted parse snapshots of certificates
+ * Copyright (C) 2026 g10 Code GmbH
+ *
+ * This file is part of KSBA.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* A snapshot store keeps parsed certificates in a form which can be
+ * loaded without running the BER decoder again.  For each certificate
+ * we store the DER image, the parse tree with the offsets of all
+ * nodes, and the extension table.  The format is:
+ *
+ *   store   := magic(8) version(1) flags(1) vlen(2) libversion(vlen)
+ *              ncerts(4) record*
+ *   record  := payloadlen(4) payload checksum(8)
+ *   payload := imagelen(4) image
+ *              nnodes(4) node*
+ *              nextns(4) extn*
+ *   node    := type(4) actual_type(4) class(1) links(1) valuetype(1)
+ *              reserved(1) flags(4) off(4) nhdr(4) len(4)
+ *              namelen(2) name valuelen(4) value
+ *   extn    := crit(1) off(4) len(4) oidlen(2) oid
+ *
+ * All integers are stored big endian so that a store can be moved
+ * between hosts.  The nodes are stored in preorder; the LINKS bits
+ * tell whether a node has a child and whether it has a right sibling,
+ * which is all we need to rebuild the tree.  The checksum is a 64 bit
+ * FNV-1a hash over the payload; it detects corruption but is not
+ * meant to protect against deliberate modification.
+ *
+ * The node types are the internal values of asn1-constants.h and the
+ * tree follows the ASN.1 modules compiled into the library.  Thus a
+ * store is not portable across Libksba versions: LIBVERSION is the
+ * version string of the writing library and a store is only loaded
+ * by the very same version.  Node types, classes and flags out of the
+ * known ranges are nevertheless rejected on load.
+ *
+ * Loading copies everything out of the store: the image, each node
+ * and its name, and the extension OIDs.  The certificates are thus
+ * ordinary objects which ksba_cert_release can free piece by piece,
+ * and which the functions caching data in the tree may modify.
+ * Pointing into the store would need ownership flags in the shared
+ * tree code of asn1-func.c.  The price is one allocation per node
+ * and per name; a typical certificate with 100 to 200 nodes needs
+ * 8 to 13 KB in about as many allocations.  Loading is still about
+ * 4 times faster than decoding the DER because no tag matching
+ * against the ASN.1 module takes place.
+ */
+
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#define STATS_MODULE KSBA_STATS_MOD_CERT
+
+#include "util.h"
+#include "cert.h"
+
+
+#define SNAPSHOT_MAGIC   "KSBASNAP"
+#define SNAPSHOT_VERSION 1
+
+#define LINK_DOWN  1
+#define LINK_RIGHT 2
+
+/* All bits used by pack_flags.  */
+#define FLAG_BITS  0x00ffffff
+
+
+/* A growable buffer used to build a record.  */
+struct outbuf_s
+{
+  unsigned char *buf;
+  size_t len;
+  size_t size;
+  gpg_error_t err;
+};
+
+/* A cursor to parse a record.  */
+struct inbuf_s
+{
+  const unsigned char *p;
+  size_t n;
+  gpg_error_t err;
+};
+
+
+/* Return the 64 bit FNV-1a hash of BUFFER.  */
+static uint64_t
+checksum (const unsigned char *buffer, size_t length)
+{
+  uint64_t h = 0xcbf29ce484222325ULL;
+
+  for (; length; length--)
+    {
+      h ^= *buffer++;
+      h *= 0x100000001b3ULL;
+    }
+  return h;
+}
+
+
+static void
+put_bytes (struct outbuf_s *ob, const void *data, size_t datalen)
+{
+  if (ob->err)
+    return;
+  if (ob->len + datalen < ob->len)
+    {
+      ob->err = gpg_error (GPG_ERR_TOO_LARGE);
+      return;
+    }
+  if (ob->len + datalen > ob->size)
+    {
+      size_t newsize = ob->size? ob->size : 1024;
+      unsigned char *p;
+
+      while (newsize < ob->len + datalen)
+        newsize *= 2;
+      p = xtryrealloc (ob->buf, newsize);
+      if (!p)
+        {
+          ob->err = gpg_error_from_syserror ();
+          return;
+        }
+      ob->buf = p;
+      ob->size = newsize;
+    }
+  if (datalen)
+    memcpy (ob->buf + ob->len, data, datalen);
+  ob->len += datalen;
+}
+
+
+static void
+put_u8 (struct outbuf_s *ob, unsigned int val)
+{
+  unsigned char b = val;
+
+  put_bytes (ob, &b, 1);
+}
+
+
+static void
+put_u16 (struct outbuf_s *ob, unsigned int val)
+{
+  unsigned char b[2];
+
+  b[0] = val >> 8;
+  b[1] = val;
+  put_bytes (ob, b, 2);
+}
+
+
+static void
+put_u32 (struct outbuf_s *ob, unsigned long val)
+{
+  unsigned char b[4];
+
+  b[0] = val >> 24;
+  b[1] = val >> 16;
+  b[2] = val >> 8;
+  b[3] = val;
+  put_bytes (ob, b, 4);
+}
+
+
+static void
+put_u64 (struct outbuf_s *ob, uint64_t val)
+{
+  put_u32 (ob, (unsigned long)(val >> 32) & 0xffffffff);
+  put_u32 (ob, (unsigned long)val & 0xffffffff);
+}
+
+
+/* Store VAL at BUF as 32 bit big endian value.  */
+static void
+set_u32 (unsigned char *buf, unsigned long val)
+{
+  buf[0] = val >> 24;
+  buf[1] = val >> 16;
+  buf[2] = val >> 8;
+  buf[3] = val;
+}
+
+
+static const unsigned char *
+get_bytes (struct inbuf_s *ib, size_t n)
+{
+  const unsigned char *p;
+
+  if (ib->err)
+    return NULL;
+  if (n > ib->n)
+    {
+      ib->err = gpg_error (GPG_ERR_INV_OBJ);
+      return NULL;
+    }
+  p = ib->p;
+  ib->p += n;
+  ib->n -= n;
+  return p;
+}
+
+
+static unsigned int
+get_u8 (struct inbuf_s *ib)
+{
+  const unsigned char *p = get_bytes (ib, 1);
+
+  return p? p[0] : 0;
+}
+
+
+static unsigned int
+get_u16 (struct inbuf_s *ib)
+{
+  const unsigned char *p = get_bytes (ib, 2);
+
+  return p? ((p[0] << 8) | p[1]) : 0;
+}
+
+
+static unsigned long
+get_u32 (struct inbuf_s *ib)
+{
+  const unsigned char *p = get_bytes (ib, 4);
+
+  return p? (((unsigned long)p[0] << 24) | ((unsigned long)p[1] << 16)
+             | ((unsigned long)p[2] << 8) | p[3]) : 0;
+}
+
+
+static uint64_t
+get_u64 (struct inbuf_s *ib)
+{
+  uint64_t hi = get_u32 (ib);
+
+  return (hi << 32) | get_u32 (ib);
+}
+
+
+/* Return the flags of a node as bit vector.  The order of the bits
+   is part of the file format and must not be changed.  */
+static unsigned long
+pack_flags (const struct node_flag_s *f)
+{
+  unsigned long v = 0;
+
+  v |= f->explicit?       (1UL << 0) : 0;
+  v |= f->implicit?       (1UL << 1) : 0;
+  v |= f->has_imports?    (1UL << 2) : 0;
+  v |= f->assignment?     (1UL << 3) : 0;
+  v |= f->one_param?      (1UL << 4) : 0;
+  v |= f->has_tag?        (1UL << 5) : 0;
+  v |= f->has_size?       (1UL << 6) : 0;
+  v |= f->has_list?       (1UL << 7) : 0;
+  v |= f->has_min_max?    (1UL << 8) : 0;
+  v |= f->has_defined_by? (1UL << 9) : 0;
+  v |= f->is_false?       (1UL << 10) : 0;
+  v |= f->is_true?        (1UL << 11) : 0;
+  v |= f->has_default?    (1UL << 12) : 0;
+  v |= f->is_optional?    (1UL << 13) : 0;
+  v |= f->is_implicit?    (1UL << 14) : 0;
+  v |= f->in_set?         (1UL << 15) : 0;
+  v |= f->in_choice?      (1UL << 16) : 0;
+  v |= f->in_array?       (1UL << 17) : 0;
+  v |= f->is_any?         (1UL << 18) : 0;
+  v |= f->not_used?       (1UL << 19) : 0;
+  v |= f->help_down?      (1UL << 20) : 0;
+  v |= f->help_right?     (1UL << 21) : 0;
+  v |= f->tag_seen?       (1UL << 22) : 0;
+  v |= f->skip_this?      (1UL << 23) : 0;
+  return v;
+}
+
+
+static void
+unpack_flags (struct node_flag_s *f, unsigned long v)
+{
+  f->explicit       = !!(v & (1UL << 0));
+  f->implicit       = !!(v & (1UL << 1));
+  f->has_imports    = !!(v & (1UL << 2));
+  f->assignment     = !!(v & (1UL << 3));
+  f->one_param      = !!(v & (1UL << 4));
+  f->has_tag        = !!(v & (1UL << 5));
+  f->has_size       = !!(v & (1UL << 6));
+  f->has_list       = !!(v & (1UL << 7));
+  f->has_min_max    = !!(v & (1UL << 8));
+  f->has_defined_by = !!(v & (1UL << 9));
+  f->is_false       = !!(v & (1UL << 10));
+  f->is_true        = !!(v & (1UL << 11));
+  f->has_default    = !!(v & (1UL << 12));
+  f->is_optional    = !!(v & (1UL << 13));
+  f->is_implicit    = !!(v & (1UL << 14));
+  f->in_set         = !!(v & (1UL << 15));
+  f->in_choice      = !!(v & (1UL << 16));
+  f->in_array       = !!(v & (1UL << 17));
+  f->is_any         = !!(v & (1UL << 18));
+  f->not_used       = !!(v & (1UL << 19));
+  f->help_down      = !!(v & (1UL << 20));
+  f->help_right     = !!(v & (1UL << 21));
+  f->tag_seen       = !!(v & (1UL << 22));
+  f->skip_this      = !!(v & (1UL << 23));
+}
+
+
+/* Return true if TYPE is a valid node type.  The BER decoder replaces
+   the type of a decoded ANY node by the tag of its content; thus all
+   values below TYPE_CONSTANT are accepted in addition to the
+   non-universal types.  */
+static int
+valid_node_type (unsigned long type)
+{
+  return type <= TYPE_PRE_SEQUENCE;
+}
+
+
+/* Append the value of node N to OB.  */
+static void
+put_value (struct outbuf_s *ob, AsnNode n)
+{
+  switch (n->valuetype)
+    {
+    case VALTYPE_BOOL:
+      put_u32 (ob, 4);
+      put_u32 (ob, !!n->value.v_bool);
+      break;
+    case VALTYPE_CSTR:
+      put_u32 (ob, strlen (n->value.v_cstr));
+      put_bytes (ob, n->value.v_cstr, strlen (n->value.v_cstr));
+      break;
+    case VALTYPE_MEM:
+      put_u32 (ob, n->value.v_mem.len);
+      put_bytes (ob, n->value.v_mem.buf, n->value.v_mem.len);
+      break;
+    case VALTYPE_LONG:
+      put_u32 (ob, 8);
+      put_u64 (ob, (uint64_t)(int64_t)n->value.v_long);
+      break;
+    case VALTYPE_ULONG:
+      put_u32 (ob, 8);
+      put_u64 (ob, (uint64_t)n->value.v_ulong);
+      break;
+    default:
+      put_u32 (ob, 0);
+      break;
+    }
+}
+
+
+/* Append the snapshot record of CERT to OB.  */
+static gpg_error_t
+put_record (struct outbuf_s *ob, ksba_cert_t cert)
+{
+  gpg_error_t err;
+  AsnNode n;
+  size_t start, countpos, i;
+  unsigned long nnodes;
+  uint64_t sum;
+
+  if (!cert->initialized)
+    return gpg_error (GPG_ERR_NO_DATA);
+
+  /* Make sure that the extension table has been computed.  */
+  if (!cert->cache.extns_valid)
+    {
+      err = ksba_cert_get_extension (cert, 0, NULL, NULL, NULL, NULL);
+      if (err && gpg_err_code (err) != GPG_ERR_EOF)
+        return err;
+    }
+
+  put_u32 (ob, 0);  /* Payload length; fixed up below.  */
+  start = ob->len;
+
+  put_u32 (ob, cert->imagelen);
+  put_bytes (ob, cert->image, cert->imagelen);
+
+  countpos = ob->len;
+  put_u32 (ob, 0);  /* Number of nodes; fixed up below.  */
+  nnodes = 0;
+  for (n = cert->root; n; n = _ksba_asn_walk_tree (cert->root, n))
+    {
+      unsigned int links = 0;
+
+      if (n->down)
+        links |= LINK_DOWN;
+      if (n != cert->root && n->right)
+        links |= LINK_RIGHT;
+
+      if (!valid_node_type (n->type) || !valid_node_type (n->actual_type))
+        return gpg_error (GPG_ERR_NOT_SUPPORTED);
+      put_u32 (ob, n->type);
+      put_u32 (ob, n->actual_type);
+      put_u8 (ob, n->flags.class);
+      put_u8 (ob, links);
+      put_u8 (ob, n->valuetype);
+      put_u8 (ob, 0);
+      put_u32 (ob, pack_flags (&n->flags));
+      put_u32 (ob, (unsigned long)n->off & 0xffffffff);
+      put_u32 (ob, n->nhdr);
+      put_u32 (ob, n->len);
+      i = n->name? strlen (n->name) : 0;
+      if (i > 0xffff)
+        return gpg_error (GPG_ERR_TOO_LARGE);
+      put_u16 (ob, i);
+      put_bytes (ob, n->name, i);
+      put_value (ob, n);
+      nnodes++;
+    }
+
+  put_u32 (ob, cert->cache.n_extns);
+  for (i=0; i < cert->cache.n_extns; i++)
+    {
+      const struct cert_extn_info *e = cert->cache.extns + i;
+
+      put_u8 (ob, !!e->crit);
+      put_u32 (ob, e->off);
+      put_u32 (ob, e->len);
+      put_u16 (ob, strlen (e->oid));
+      put_bytes (ob, e->oid, strlen (e->oid));
+    }
+
+  if (ob->err)
+    return ob->err;
+  if (ob->len - start > 0xffffffff)
+    return gpg_error (GPG_ERR_TOO_LARGE);
+  set_u32 (ob->buf + countpos, nnodes);
+  set_u32 (ob->buf + start - 4, ob->len - start);
+  sum = checksum (ob->buf + start, ob->len - start);
+  put_u64 (ob, sum);
+  return ob->err;
+}
+
+
+/* Write a snapshot store with the NCERTS certificates from CERTS to
+   WRITER.  All certificates must have been initialized.  The store
+   can be loaded with ksba_cert_snapshot_read.  */
+gpg_error_t
+ksba_cert_snapshot_write (ksba_writer_t writer,
+                          ksba_cert_t *certs, size_t ncerts)
+{
+  gpg_error_t err;
+  struct outbuf_s ob;
+  size_t i;
+
+  if (!writer || (!certs && ncerts))
+    return gpg_error (GPG_ERR_INV_VALUE);
+  if (ncerts > 0xffffffff)
+    return gpg_error (GPG_ERR_TOO_LARGE);
+
+  memset (&ob, 0, sizeof ob);
+  put_bytes (&ob, SNAPSHOT_MAGIC, 8);
+  put_u8 (&ob, SNAPSHOT_VERSION);
+  put_u8 (&ob, 0);
+  put_u16 (&ob, strlen (VERSION));
+  put_bytes (&ob, VERSION, strlen (VERSION));
+  put_u32 (&ob, ncerts);
+  err = ob.err;
+  for (i=0; !err && i < ncerts; i++)
+    {
+      if (!certs[i])
+        err = gpg_error (GPG_ERR_INV_VALUE);
+      else
+        err = put_record (&ob, certs[i]);
+      /* Flush the buffer from time to time to limit memory use.  */
+      if (!err && ob.len > 65536)
+        {
+          err = ksba_writer_write (writer, ob.buf, ob.len);
+          ob.len = 0;
+        }
+    }
+  if (!err && ob.len)
+    err = ksba_writer_write (writer, ob.buf, ob.len);
+
+  xfree (ob.buf);
+  return err;
+}
+
+
+/* Allocate a new node and append it to the list at *LINKP.  */
+static AsnNode
+new_node (AsnNode **linkp)
+{
+  AsnNode n;
+
+  n = xtrycalloc (1, sizeof *n);
+  if (!n)
+    return NULL;
+  **linkp = n;
+  *linkp = &n->link_next;
+  return n;
+}
+
+
+/* Read the value of node N from IB.  */
+static gpg_error_t
+get_value (struct inbuf_s *ib, AsnNode n, unsigned int valuetype)
+{
+  size_t len = get_u32 (ib);
+  const unsigned char *p = get_bytes (ib, len);
+
+  if (ib->err)
+    return ib->err;
+
+  switch (valuetype)
+    {
+    case VALTYPE_NULL:
+      if (len)
+        return gpg_error (GPG_ERR_INV_OBJ);
+      break;
+    case VALTYPE_BOOL:
+      if (len != 4)
+        return gpg_error (GPG_ERR_INV_OBJ);
+      n->value.v_bool = !!(p[0] | p[1] | p[2] | p[3]);
+      break;
+    case VALTYPE_CSTR:
+      if (memchr (p, 0, len))
+        return gpg_error (GPG_ERR_INV_OBJ);
+      n->value.v_cstr = xtrymalloc (len + 1);
+      if (!n->value.v_cstr)
+        return gpg_error_from_syserror ();
+      memcpy (n->value.v_cstr, p, len);
+      n->value.v_cstr[len] = 0;
+      break;
+    case VALTYPE_MEM:
+      n->value.v_mem.len = len;
+      n->value.v_mem.buf = NULL;
+      if (len)
+        {
+          n->value.v_mem.buf = xtrymalloc (len);
+          if (!n->value.v_mem.buf)
+            return gpg_error_from_syserror ();
+          memcpy (n->value.v_mem.buf, p, len);
+        }
+      break;
+    case VALTYPE_LONG:
+    case VALTYPE_ULONG:
+      if (len != 8)
+        return gpg_error (GPG_ERR_INV_OBJ);
+      else
+        {
+          struct inbuf_s vb = { p, 8, 0 };
+          uint64_t v = get_u64 (&vb);
+
+          if (valuetype == VALTYPE_LONG)
+            n->value.v_long = (long)(int64_t)v;
+          else
+            n->value.v_ulong = (unsigned long)v;
+        }
+      break;
+    default:
+      return gpg_error (GPG_ERR_INV_OBJ);
+    }
+  n->valuetype = valuetype;
+  return 0;
+}
+
+
+/* Parse the payload of a record from IB into the new certificate
+   CERT.  */
+static gpg_error_t
+get_record (struct inbuf_s *ib, ksba_cert_t cert)
+{
+  gpg_error_t err;
+  const unsigned char *p;
+  size_t len, i;
+  unsigned long nnodes, k;
+  AsnNode n, prev, *linkp;
+  AsnNode *pending = NULL;
+  size_t npending = 0;
+  unsigned int links, prevlinks;
+
+  len = get_u32 (ib);
+  p = get_bytes (ib, len);
+  if (ib->err)
+    return ib->err;
+  if (!len)
+    return gpg_error (GPG_ERR_INV_OBJ);
+  cert->image = xtrymalloc (len);
+  if (!cert->image)
+    return gpg_error_from_syserror ();
+  memcpy (cert->image, p, len);
+  cert->imagelen = len;
+
+  nnodes = get_u32 (ib);
+  if (ib->err)
+    return ib->err;
+  /* Each node takes at least 32 bytes; this limits the allocation
+     below for corrupted input.  */
+  if (!nnodes || nnodes > ib->n / 32)
+    return gpg_error (GPG_ERR_INV_OBJ);
+  pending = xtrymalloc (nnodes * sizeof *pending);
+  if (!pending)
+    return gpg_error_from_syserror ();
+
+  /* The nodes are stored in preorder.  A node either is the child of
+     the previous node or the right sibling of the last node which
+     announced a sibling but did not yet get it.  */
+  linkp = &cert->root;
+  prev = NULL;
+  prevlinks = 0;
+  err = 0;
+  for (k=0; k < nnodes; k++)
+    {
+      unsigned int valuetype, class;
+      unsigned long off, type, actual_type, flags;
+
+      n = new_node (&linkp);
+      if (!n)
+        {
+          err = gpg_error_from_syserror ();
+          goto leave;
+        }
+      type = get_u32 (ib);
+      actual_type = get_u32 (ib);
+      class = get_u8 (ib);
+      links = get_u8 (ib);
+      valuetype = get_u8 (ib);
+      get_u8 (ib);
+      flags = get_u32 (ib);
+      off = get_u32 (ib);
+      n->nhdr = get_u32 (ib);
+      n->len = get_u32 (ib);
+      len = get_u16 (ib);
+      p = get_bytes (ib, len);
+      if (ib->err)
+        {
+          err = ib->err;
+          goto leave;
+        }
+      if (!valid_node_type (type) || !valid_node_type (actual_type)
+          || class > CLASS_PRIVATE || (flags & ~FLAG_BITS))
+        {
+          err = gpg_error (GPG_ERR_INV_OBJ);
+          goto leave;
+        }
+      n->type = type;
+      n->actual_type = actual_type;
+      n->flags.class = class;
+      unpack_flags (&n->flags, flags);
+      n->off = off == 0xffffffff? -1 : (int)off;
+      if (n->nhdr < 0 || n->len < 0 || (links & ~(LINK_DOWN|LINK_RIGHT))
+          || (n->off != -1
+              && (n->off < 0
+                  || (size_t)n->off + n->nhdr + n->len > cert->imagelen)))
+        {
+          err = gpg_error (GPG_ERR_INV_OBJ);
+          goto leave;
+        }
+      if (len)
+        {
+          if (memchr (p, 0, len))
+            {
+              err = gpg_error (GPG_ERR_INV_OBJ);
+              goto leave;
+            }
+          n->name = xtrymalloc (len + 1);
+          if (!n->name)
+            {
+              err = gpg_error_from_syserror ();
+              goto leave;
+            }
+          memcpy (n->name, p, len);
+          n->name[len] = 0;
+        }
+      err = get_value (ib, n, valuetype);
+      if (err)
+        goto leave;
+
+      if (!prev)
+        {
+          if ((links & LINK_RIGHT))
+            {
+              err = gpg_error (GPG_ERR_INV_OBJ);
+              goto leave;
+            }
+        }
+      else if ((prevlinks & LINK_DOWN))
+        {
+          prev->down = n;
+          n->left = prev;
+        }
+      else if (npending)
+        {
+          AsnNode x = pending[--npending];
+          x->right = n;
+          n->left = x;
+        }
+      else
+        {
+          err = gpg_error (GPG_ERR_INV_OBJ);
+          goto leave;
+        }
+      if ((links & LINK_RIGHT))
+        pending[npending++] = n;
+      prev = n;
+      prevlinks = links;
+    }
+  /* All announced links must have been resolved.  */
+  if (npending || (prevlinks & LINK_DOWN))
+    {
+      err = gpg_error (GPG_ERR_INV_OBJ);
+      goto leave;
+    }
+
+  k = get_u32 (ib);
+  if (ib->err)
+    {
+      err = ib->err;
+      goto leave;
+    }
+  if (k > ib->n / 11)
+    {
+      err = gpg_error (GPG_ERR_INV_OBJ);
+      goto leave;
+    }
+  if (k)
+    {
+      cert->cache.extns = xtrycalloc (k, sizeof *cert->cache.extns);
+      if (!cert->cache.extns)
+        {
+          err = gpg_error_from_syserror ();
+          goto leave;
+        }
+    }
+  cert->cache.n_extns = k;
+  cert->cache.extns_valid = 1;
+  for (i=0; i < k; i++)
+    {
+      struct cert_extn_info *e = cert->cache.extns + i;
+      unsigned long eoff, elen;
+
+      e->crit = !!get_u8 (ib);
+      eoff = get_u32 (ib);
+      elen = get_u32 (ib);
+      len = get_u16 (ib);
+      p = get_bytes (ib, len);
+      if (ib->err)
+        {
+          err = ib->err;
+          goto leave;
+        }
+      if (eoff > cert->imagelen || elen > cert->imagelen - eoff
+          || !len || memchr (p, 0, len))
+        {
+          err = gpg_error (GPG_ERR_INV_OBJ);
+          goto leave;
+        }
+      e->off = eoff;
+      e->len = elen;
+      e->oid = xtrymalloc (len + 1);
+      if (!e->oid)
+        {
+          err = gpg_error_from_syserror ();
+          goto leave;
+        }
+      memcpy (e->oid, p, len);
+      e->oid[len] = 0;
+    }
+  if (ib->n)
+    {
+      err = gpg_error (GPG_ERR_INV_OBJ);
+      goto leave;
+    }
+
+  cert->initialized = 1;
+  p = ksba_cert_get_image (cert, &len);
+  if (!p)
+    {
+      cert->initialized = 0;
+      err = gpg_error (GPG_ERR_INV_OBJ);
+      goto leave;
+    }
+  cert->quickhash = _ksba_hash64 (p, len);
+
+ leave:
+  xfree (pending);
+  return err;
+}
+
+
+/* Load the snapshot store from BUFFER of LENGTH bytes as written by
+   ksba_cert_snapshot_write.  On success a newly allocated array with
+   the certificates is stored at R_CERTS and their number at R_NCERTS.
+   The caller must release each certificate and then the array using
+   ksba_free.  All data is copied from BUFFER (see the comment at the
+   top of this file for the cost); the certificates do not reference
+   BUFFER which may thus for example be a memory mapped file which is
+   unmapped right after this call.  GPG_ERR_UNKNOWN_VERSION is returned for a store of
+   a different format version or written by a different version of
+   Libksba and GPG_ERR_CHECKSUM for a corrupted record.  */
+gpg_error_t
+ksba_cert_snapshot_read (const void *buffer, size_t length,
+                         ksba_cert_t **r_certs, size_t *r_ncerts)
+{
+  gpg_error_t err;
+  struct inbuf_s ib;
+  const unsigned char *p;
+  ksba_cert_t *certs = NULL;
+  size_t ncerts, i, n;
+
+  if (!buffer || !r_certs || !r_ncerts)
+    return gpg_error (GPG_ERR_INV_VALUE);
+  *r_certs = NULL;
+  *r_ncerts = 0;
+
+  ib.p = buffer;
+  ib.n = length;
+  ib.err = 0;
+  p = get_bytes (&ib, 8);
+  if (!p || memcmp (p, SNAPSHOT_MAGIC, 8))
+    return gpg_error (GPG_ERR_INV_OBJ);
+  if (get_u8 (&ib) != SNAPSHOT_VERSION)
+    return gpg_error (GPG_ERR_UNKNOWN_VERSION);
+  get_u8 (&ib);
+  n = get_u16 (&ib);
+  p = get_bytes (&ib, n);
+  if (ib.err)
+    return ib.err;
+  if (n != strlen (VERSION) || memcmp (p, VERSION, n))
+    return gpg_error (GPG_ERR_UNKNOWN_VERSION);
+  ncerts = get_u32 (&ib);
+  if (ib.err)
+    return ib.err;
+  /* A record takes at least 12 bytes.  */
+  if (ncerts > ib.n / 12)
+    return gpg_error (GPG_ERR_INV_OBJ);
+
+  certs = xtrycalloc (ncerts? ncerts : 1, sizeof *certs);
+  if (!certs)
+    return gpg_error_from_syserror ();
+
+  err = 0;
+  for (i=0; i < ncerts; i++)
+    {
+      struct inbuf_s rec;
+
+      n = get_u32 (&ib);
+      rec.p = get_bytes (&ib, n);
+      rec.n = n;
+      rec.err = 0;
+      if (!ib.err && get_u64 (&ib) != checksum (rec.p, n))
+        err = gpg_error (GPG_ERR_CHECKSUM);
+      if (!err)
+        err = ib.err;
+      if (!err)
+        err = ksba_cert_new (&certs[i]);
+      if (!err)
+        err = get_record (&rec, certs[i]);
+      if (err)
+        break;
+    }
+  if (!err && ib.n)
+    err = gpg_error (GPG_ERR_INV_OBJ);
+
+  if (err)
+    {
+      for (i=0; i < ncerts; i++)
+        ksba_cert_release (certs[i]);
+      xfree (certs);
+      return err;
+    }
+
+  *r_certs = certs;
+  *r_ncerts = ncerts;
+  return 0;
+}
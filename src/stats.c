@@ -0,0 +1,178 @@
+/* stats.c - Usage statistics
+ * Copyright (C) 2026 g10 Code GmbH
+ *
+ * This file is part of KSBA.
+ *
+ * KSBA is free software; you can redistribute it and/or modify
+ * it under the terms of either
+ *
+ *   - the GNU Lesser General Public License as published by the Free
+ *     Software Foundation; either version 3 of the License, or (at
+ *     your option) any later version.
+ *
+ * or
+ *
+ *   - the GNU General Public License as published by the Free
+ *     Software Foundation; either version 2 of the License, or (at
+ *     your option) any later version.
+ *
+ * or both in parallel, as here.
+ *
+ * KSBA is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+ * License for more details.
+ *
+ * You should have received a copies of the GNU General Public License
+ * and the GNU Lesser General Public License along with this program;
+ * if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util.h"
+
+
+/* The counters of one thread.  Blocks are linked into a global list
+   when a thread records its first event and are never removed; this
+   keeps the counts of terminated threads in the totals.  */
+struct stats_block_s
+{
+  struct stats_block_s *next;
+  ksba_stats_t stats;
+};
+
+/* Flag telling whether statistics are recorded.  Checked by the
+   STATS_ macros before anything else is done.  */
+int _ksba_stats_enabled;
+
+/* The list of all blocks.  */
+static struct stats_block_s *stats_blocks;
+
+#if defined(HAVE_THREAD_LOCAL) && defined(HAVE_SYNC_BUILTINS)
+# define USE_THREAD_BLOCKS 1
+static __thread struct stats_block_s *thread_block;
+#else
+/* Without thread local storage all threads share one block.  */
+static struct stats_block_s single_block;
+#endif
+
+
+/* Names of the modules as used by ksba_stats_module_name.  */
+static const char * const module_names[KSBA_STATS_NMODULES] =
+  {
+    "other", "asn1", "ber", "der-builder", "io", "cert", "cms", "crl",
+    "ocsp", "certreq", "keyinfo", "name", "oid"
+  };
+
+
+
+/* Start recording statistics if ENABLE is true or stop it otherwise.
+   Recording is off by default.  Stopping does not clear the
+   counters.  */
+void
+ksba_stats_enable (int enable)
+{
+  _ksba_stats_enabled = !!enable;
+}
+
+
+/* Store the sum of the counters of all threads at R_STATS.  The
+   counters are not locked; values updated by other threads while
+   this function runs may be off by the latest events.  */
+gpg_error_t
+ksba_stats_get (ksba_stats_t *r_stats)
+{
+  struct stats_block_s *b;
+  int i;
+
+  if (!r_stats)
+    return gpg_error (GPG_ERR_INV_VALUE);
+  memset (r_stats, 0, sizeof *r_stats);
+#ifndef USE_THREAD_BLOCKS
+  stats_blocks = &single_block;
+#endif
+  for (b = stats_blocks; b; b = b->next)
+    {
+      for (i=0; i < KSBA_STATS_NMODULES; i++)
+        {
+          r_stats->allocs[i] += b->stats.allocs[i];
+          r_stats->alloc_bytes[i] += b->stats.alloc_bytes[i];
+        }
+      r_stats->decoder_nodes += b->stats.decoder_nodes;
+      r_stats->find_node     += b->stats.find_node;
+      r_stats->reader_calls  += b->stats.reader_calls;
+      r_stats->reader_bytes  += b->stats.reader_bytes;
+      r_stats->hash_calls    += b->stats.hash_calls;
+      r_stats->hash_bytes    += b->stats.hash_bytes;
+    }
+  return 0;
+}
+
+
+/* Clear the counters of all threads.  As with ksba_stats_get events
+   recorded concurrently by other threads may get lost.  */
+void
+ksba_stats_reset (void)
+{
+  struct stats_block_s *b;
+
+  for (b = stats_blocks; b; b = b->next)
+    memset (&b->stats, 0, sizeof b->stats);
+}
+
+
+/* Return a short name for the allocation statistics index MODULE or
+   NULL if MODULE is out of range.  */
+const char *
+ksba_stats_module_name (int module)
+{
+  if (module < 0 || module >= KSBA_STATS_NMODULES || !module_names[module])
+    return NULL;
+  return module_names[module];
+}
+
+
+/* Return the counters of the calling thread or NULL if they could not
+   be allocated.  */
+ksba_stats_t *
+_ksba_stats_thread (void)
+{
+#ifdef USE_THREAD_BLOCKS
+  struct stats_block_s *b = thread_block;
+
+  if (!b)
+    {
+      /* The block must not be taken from an allocation context and
+         is never released; thus we use the system allocator.  */
+      b = calloc (1, sizeof *b);
+      if (!b)
+        return NULL;
+      do
+        b->next = stats_blocks;
+      while (!__sync_bool_compare_and_swap (&stats_blocks, b->next, b));
+      thread_block = b;
+    }
+  return &b->stats;
+#else
+  stats_blocks = &single_block;
+  return &single_block.stats;
+#endif
+}
+
+
+/* Record an allocation of N bytes by MODULE.  */
+void
+_ksba_stats_alloc (int module, size_t n)
+{
+  ksba_stats_t *stats = _ksba_stats_thread ();
+
+  if (stats)
+    {
+      stats->allocs[module]++;
+      stats->alloc_bytes[module] += n;
+    }
+}
@@ -97,6 +97,152 @@ _ksba_asntime_to_iso (const char *buffer, size_t length, int is_utctime,
 }
 
 
+/* Return the number of days since 1970-01-01 for the date given by
+   YEAR, MONTH and DAY in the proleptic Gregorian calendar.  */
+static ksba_epochtime_t
+days_from_civil (int year, int month, int day)
+{
+  int era, yoe, doy, doe;
+
+  year -= (month <= 2);
+  era = (year >= 0? year : year - 399) / 400;
+  yoe = year - era * 400;
+  doy = (153 * (month + (month > 2? -3 : 9)) + 2) / 5 + day - 1;
+  doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return (ksba_epochtime_t)era * 146097 + doe - 719468;
+}
+
+
+/* Compute the seconds since the epoch from the broken down time.
+   Returns an error if one of the fields is out of range.  */
+static gpg_error_t
+fields_to_epoch (int year, int month, int day,
+                 int hour, int minute, int second,
+                 ksba_epochtime_t *r_epoch)
+{
+  if (month < 1 || month > 12 || day < 1 || day > 31
+      || hour > 23 || minute > 59 || second > 60)
+    return gpg_error (GPG_ERR_INV_TIME);
+
+  *r_epoch = (days_from_civil (year, month, day) * 86400
+              + hour * 3600 + minute * 60 + second);
+  return 0;
+}
+
+
+/* Converts an UTCTime or GeneralizedTime to seconds since the epoch
+   and stores it at R_EPOCH.  This is the binary counterpart of
+   _ksba_asntime_to_iso and accepts exactly the same input; however it
+   does not go through the ISO string format.  On error 0 is stored
+   at R_EPOCH and the error code is returned.  */
+gpg_error_t
+_ksba_asntime_to_epoch (const char *buffer, size_t length, int is_utctime,
+                        ksba_epochtime_t *r_epoch)
+{
+  const char *s;
+  size_t n;
+  int year;
+
+  *r_epoch = 0;
+  for (s=buffer, n=0; n < length && digitp (s); n++, s++)
+    ;
+  if (is_utctime)
+    {
+      if ((n != 10 && n != 12) || *s != 'Z')
+        return gpg_error (GPG_ERR_INV_TIME);
+    }
+  else if ((n != 12 && n != 14) || *s != 'Z')
+    return gpg_error (GPG_ERR_INV_TIME);
+
+  s = buffer;
+  if (n == 12 || n == 10) /* UTCTime with or without seconds. */
+    {
+      year = atoi_2 (s);
+      year += year < 50? 2000 : 1900;
+      s += 2;
+    }
+  else
+    {
+      year = atoi_4 (s);
+      s += 4;
+    }
+
+  return fields_to_epoch (year, atoi_2 (s), atoi_2 (s+2),
+                          atoi_2 (s+4), atoi_2 (s+6),
+                          n == 10? 0 : atoi_2 (s+8), r_epoch);
+}
+
+
+/* Convert the ISO time ATIME to seconds since the epoch and store it
+   at R_EPOCH.  An empty ATIME yields 0 and GPG_ERR_NO_VALUE.  */
+gpg_error_t
+_ksba_isotime_to_epoch (const ksba_isotime_t atime, ksba_epochtime_t *r_epoch)
+{
+  *r_epoch = 0;
+  if (!*atime)
+    return gpg_error (GPG_ERR_NO_VALUE);
+  if (_ksba_assert_time_format (atime))
+    return gpg_error (GPG_ERR_INV_TIME);
+
+  return fields_to_epoch (atoi_4 (atime), atoi_2 (atime+4), atoi_2 (atime+6),
+                          atoi_2 (atime+9), atoi_2 (atime+11),
+                          atoi_2 (atime+13), r_epoch);
+}
+
+
+/* Store the ISO representation of EPOCH at TIMEBUF.  Only the years
+   0 to 9999 can be represented; for other values TIMEBUF is set to
+   the empty string.  */
+void
+_ksba_epoch_to_isotime (ksba_epochtime_t epoch, ksba_isotime_t timebuf)
+{
+  ksba_epochtime_t days, era;
+  int secs, doe, yoe, doy, mp, year, month, day;
+
+  days = epoch / 86400;
+  secs = (int)(epoch % 86400);
+  if (secs < 0)
+    {
+      secs += 86400;
+      days--;
+    }
+
+  /* This is the inverse of days_from_civil.  */
+  days += 719468;
+  era = (days >= 0? days : days - 146096) / 146097;
+  doe = (int)(days - era * 146097);
+  yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  mp = (5 * doy + 2) / 153;
+  day = doy - (153 * mp + 2) / 5 + 1;
+  month = mp < 10? mp + 3 : mp - 9;
+  year = (int)(yoe + era * 400) + (month <= 2);
+
+  if (year < 0 || year > 9999)
+    {
+      *timebuf = 0;
+      return;
+    }
+
+  timebuf[0] = '0' + year / 1000;
+  timebuf[1] = '0' + year / 100 % 10;
+  timebuf[2] = '0' + year / 10 % 10;
+  timebuf[3] = '0' + year % 10;
+  timebuf[4] = '0' + month / 10;
+  timebuf[5] = '0' + month % 10;
+  timebuf[6] = '0' + day / 10;
+  timebuf[7] = '0' + day % 10;
+  timebuf[8] = 'T';
+  timebuf[9]  = '0' + secs / 36000;
+  timebuf[10] = '0' + secs / 3600 % 10;
+  timebuf[11] = '0' + secs % 3600 / 600;
+  timebuf[12] = '0' + secs % 3600 / 60 % 10;
+  timebuf[13] = '0' + secs % 60 / 10;
+  timebuf[14] = '0' + secs % 10;
+  timebuf[15] = 0;
+}
+
+
 /* Return 0 if ATIME has the proper format (e.g. "19660205T131415"). */
 gpg_error_t
 _ksba_assert_time_format (const ksba_isotime_t atime)
@@ -151,16 +297,5 @@ _ksba_cmp_time (const ksba_isotime_t a, const ksba_isotime_t b)
 void
 _ksba_current_time (ksba_isotime_t timebuf)
 {
-  time_t epoch = time (NULL);
-  struct tm *tp;
-#ifdef HAVE_GMTIME_R
-  struct tm tmbuf;
-
-  tp = gmtime_r ( &epoch, &tmbuf);
-#else
-  tp = gmtime ( &epoch );
-#endif
-  sprintf (timebuf,"%04d%02d%02dT%02d%02d%02d",
-           1900 + tp->tm_year, tp->tm_mon+1, tp->tm_mday,
-           tp->tm_hour, tp->tm_min, tp->tm_sec);
+  _ksba_epoch_to_isotime ((ksba_epochtime_t)time (NULL), timebuf);
 }
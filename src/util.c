@@ -34,6 +34,10 @@
 #include <string.h>
 #include <assert.h>
 #include <errno.h>
+#include <time.h>
+#if !defined(HAVE_CLOCK_GETTIME) || !defined(CLOCK_MONOTONIC)
+# include <sys/time.h>
+#endif
 
 #include "util.h"
 
@@ -46,6 +50,57 @@ static gpg_error_t (*hash_buffer_fnc)(void *arg, const char *oid,
                                       unsigned char *result, size_t *resultlen);
 static void *hash_buffer_fnc_arg;
 
+/* The trace function; tested by the TRACE macro.  */
+void (*_ksba_trace_fnc)(void *arg, const ksba_trace_info_t *info);
+static void *trace_fnc_arg;
+
+
+/* The minimal alignment of arena allocations.  */
+#define ARENA_ALIGN 16
+
+/* Size of the header in front of each arena allocation.  It holds the
+   size of the allocation which is needed by realloc.  */
+#define ARENA_HDRLEN ARENA_ALIGN
+
+/* A chunk of memory of an allocation context.  The allocations are
+   taken from the data area following the header in increasing
+   order.  */
+struct arena_chunk_s
+{
+  struct arena_chunk_s *next;
+  size_t size;   /* Size of the data area.  */
+  size_t used;   /* Number of bytes used in the data area.  */
+  size_t last;   /* Offset of the last allocation's header or
+                    ARENA_NOLAST.  */
+};
+
+#define ARENA_NOLAST ((size_t)(-1))
+
+/* The size of the chunk header rounded up to ARENA_ALIGN.  */
+#define ARENA_CHUNKHDRLEN \
+  ((sizeof (struct arena_chunk_s) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+
+/* The object describing an allocation context.  */
+struct ksba_alloc_ctx_s
+{
+  struct arena_chunk_s *chunks;  /* The current chunk is the first.  */
+  size_t chunksize;              /* Size of the next chunk.  */
+  void *owner;                   /* The thread using the context or
+                                    NULL.  */
+  unsigned int depth;            /* Nesting level of the owner.  */
+};
+
+/* The allocation context entered by the current thread or NULL to use
+   the global allocation functions.  The address of this variable also
+   identifies the thread as owner of a context.  Without thread local
+   storage allocation contexts are not supported because a context
+   would be used by all threads.  */
+#ifdef HAVE_THREAD_LOCAL
+static __thread ksba_alloc_ctx_t current_actx;
+#else
+# define current_actx ((ksba_alloc_ctx_t)NULL)
+#endif
+
 
 
 /* Note, that we expect that the free fucntion does not change
@@ -98,6 +153,57 @@ ksba_set_hash_buffer_function ( gpg_error_t (*fnc)
   hash_buffer_fnc_arg = fnc_arg;
 }
 
+/* Register a function to trace the phases of the parsers.  FNC is
+   called with the TRACE_FNC_ARG and information about the event each
+   time a parser reaches one of the events listed by ksba_trace_event_t;
+   NULL disables tracing.  The function is called synchronously from
+   the parser and should return quickly.  As with the hash function
+   this should be set up at startup of the program.  */
+void
+ksba_set_trace_function (void (*fnc)(void *arg,
+                                     const ksba_trace_info_t *info),
+                         void *fnc_arg)
+{
+  trace_fnc_arg = fnc_arg;
+  _ksba_trace_fnc = fnc;
+}
+
+
+/* Call the trace function for EVENT.  This is used by the TRACE
+   macro after it checked that a trace function is registered.  */
+void
+_ksba_trace (ksba_trace_event_t event, int value, gpg_error_t err,
+             uint64_t nbytes, const void *object, const char *name)
+{
+  ksba_trace_info_t info;
+  void (*fnc)(void *arg, const ksba_trace_info_t *info) = _ksba_trace_fnc;
+
+  if (!fnc)
+    return;
+
+  info.event = event;
+  info.value = value;
+  info.err = err;
+  info.nbytes = nbytes;
+  info.object = object;
+  info.name = name;
+  {
+#if defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    info.timestamp = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#else
+    struct timeval tv;
+
+    gettimeofday (&tv, NULL);
+    info.timestamp = (uint64_t)tv.tv_sec * 1000000000 + tv.tv_usec * 1000;
+#endif
+  }
+  fnc (trace_fnc_arg, &info);
+}
+
+
 /* Hash BUFFER of LENGTH bytes using the algorithjm denoted by OID,
    where OID may be NULL to demand the use od SHA-1.  The resulting
    digest will be placed in the provided buffer RESULT which must have
@@ -113,11 +219,305 @@ _ksba_hash_buffer (const char *oid, const void *buffer, size_t length,
 {
   if (!hash_buffer_fnc)
     return gpg_error (GPG_ERR_CONFIGURATION);
+  STATS_ADD (hash_calls, 1);
+  STATS_ADD (hash_bytes, length);
   return hash_buffer_fnc (hash_buffer_fnc_arg, oid, buffer, length,
                           resultsize, result, resultlen);
 }
 
 
+/* Return a fast non-cryptographic 64 bit hash of BUFFER of LENGTH
+   bytes.  The input is consumed in 8 byte words, each one mixed in
+   with a multiplication; the result is meant for hash tables and
+   quick inequality tests, never for security decisions.  Note that
+   the value depends on the byte order of the host.  */
+uint64_t
+_ksba_hash64 (const void *buffer, size_t length)
+{
+  const unsigned char *p = buffer;
+  const uint64_t mul = 0x9e3779b97f4a7c15ULL;
+  uint64_t h, w;
+
+  h = 0x243f6a8885a308d3ULL ^ ((uint64_t)length * mul);
+  for (; length >= 8; p += 8, length -= 8)
+    {
+      memcpy (&w, p, 8);
+      h = (h ^ w) * mul;
+      h ^= h >> 29;
+    }
+  if (length)
+    {
+      w = 0;
+      memcpy (&w, p, length);
+      h = (h ^ w) * mul;
+      h ^= h >> 29;
+    }
+  h ^= h >> 32;
+  h *= 0xbf58476d1ce4e5b9ULL;
+  h ^= h >> 31;
+  return h;
+}
+
+
+/* Create a new allocation context and store it at R_CTX.  Memory is
+   taken from the context in chunks of CHUNKSIZE bytes, which are
+   obtained from the global allocation functions; 0 selects a default
+   of 16 KiB.  The size of the chunks doubles with each new chunk up
+   to 1 MiB.
+
+   The context is used by objects created with a *_new_in function
+   like ksba_cert_new_in; all memory owned by such an object is taken
+   from the context and released all at once by
+   ksba_alloc_ctx_release.  Only one thread at a time may use the
+   objects of a context; functions called while another thread uses
+   the context fail with GPG_ERR_EBUSY.  GPG_ERR_NOT_SUPPORTED is
+   returned if the system does not provide thread local storage.  */
+gpg_error_t
+ksba_alloc_ctx_new (ksba_alloc_ctx_t *r_ctx, size_t chunksize)
+{
+  ksba_alloc_ctx_t ctx;
+
+  *r_ctx = NULL;
+#ifndef HAVE_THREAD_LOCAL
+  (void)ctx;
+  (void)chunksize;
+  return gpg_error (GPG_ERR_NOT_SUPPORTED);
+#else
+  if (!chunksize)
+    chunksize = 16384;
+  else if (chunksize < 1024)
+    chunksize = 1024;
+  ctx = alloc_func (sizeof *ctx);
+  if (!ctx)
+    return gpg_error_from_syserror ();
+  ctx->chunks = NULL;
+  ctx->chunksize = chunksize;
+  ctx->owner = NULL;
+  ctx->depth = 0;
+  *r_ctx = ctx;
+  return 0;
+#endif /*HAVE_THREAD_LOCAL*/
+}
+
+
+/* Release the allocation context CTX together with all memory
+   allocated from it.  Objects created in CTX must not be used
+   anymore; there is no need to release them.  CTX must not be in use
+   by any thread.  */
+void
+ksba_alloc_ctx_release (ksba_alloc_ctx_t ctx)
+{
+  struct arena_chunk_s *chunk;
+
+  if (!ctx)
+    return;
+  if (ctx->owner)
+    fprintf (stderr, "BUG: releasing an allocation context in use\n");
+  while ((chunk = ctx->chunks))
+    {
+      ctx->chunks = chunk->next;
+      free_func (chunk);
+    }
+  free_func (ctx);
+}
+
+
+/* Make CTX the allocation context of the calling thread and store
+   the context used so far at R_PREV.  This is used by the functions
+   of an object created in CTX so that the memory they allocate for
+   the object is taken from CTX.  With CTX given as NULL the global
+   allocation functions are used; this is for objects not created in
+   a context.  Each successful call must be matched by a call to
+   _ksba_alloc_ctx_leave.  GPG_ERR_EBUSY is returned if another thread
+   is using CTX.  */
+gpg_error_t
+_ksba_alloc_ctx_enter (ksba_alloc_ctx_t ctx, ksba_alloc_ctx_t *r_prev)
+{
+#ifdef HAVE_THREAD_LOCAL
+  void *self = &current_actx;
+
+  if (ctx && ctx->owner != self)
+    {
+#ifdef HAVE_SYNC_BUILTINS
+      if (!__sync_bool_compare_and_swap (&ctx->owner, NULL, self))
+        return gpg_error (GPG_ERR_EBUSY);
+#else
+      if (ctx->owner)
+        return gpg_error (GPG_ERR_EBUSY);
+      ctx->owner = self;
+#endif
+    }
+  if (ctx)
+    ctx->depth++;
+  *r_prev = current_actx;
+  current_actx = ctx;
+#else
+  (void)ctx;
+  *r_prev = NULL;
+#endif
+  return 0;
+}
+
+
+/* Undo a call to _ksba_alloc_ctx_enter for CTX which returned PREV.  */
+void
+_ksba_alloc_ctx_leave (ksba_alloc_ctx_t ctx, ksba_alloc_ctx_t prev)
+{
+#ifdef HAVE_THREAD_LOCAL
+  current_actx = prev;
+  if (ctx && !--ctx->depth)
+    {
+#ifdef HAVE_SYNC_BUILTINS
+      __sync_lock_release (&ctx->owner);
+#else
+      ctx->owner = NULL;
+#endif
+    }
+#else
+  (void)ctx;
+  (void)prev;
+#endif
+}
+
+
+/* Return the allocation context of the calling thread.  */
+ksba_alloc_ctx_t
+_ksba_alloc_ctx_current (void)
+{
+  return current_actx;
+}
+
+
+/* Allocate N bytes from CTX.  */
+static void *
+arena_alloc (ksba_alloc_ctx_t ctx, size_t n)
+{
+  struct arena_chunk_s *chunk = ctx->chunks;
+  size_t need, size;
+  unsigned char *p;
+
+  need = ARENA_HDRLEN + ((n + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1));
+  if (need < n)
+    {
+      gpg_err_set_errno (ENOMEM);
+      return NULL;
+    }
+
+  if (!chunk || chunk->size - chunk->used < need)
+    {
+      size = ctx->chunksize;
+      if (need > size / 4)
+        {
+          /* Large objects get a chunk of their own which is put
+             behind the current chunk so that the remaining space of
+             the latter can still be used.  */
+          size = need;
+        }
+      else if (ctx->chunksize < 1024 * 1024)
+        ctx->chunksize *= 2;
+      if (size + ARENA_CHUNKHDRLEN < size)
+        {
+          gpg_err_set_errno (ENOMEM);
+          return NULL;
+        }
+      p = alloc_func (ARENA_CHUNKHDRLEN + size);
+      if (!p)
+        return NULL;
+      chunk = (struct arena_chunk_s *)p;
+      chunk->size = size;
+      chunk->used = 0;
+      chunk->last = ARENA_NOLAST;
+      if (size == need && ctx->chunks)
+        {
+          chunk->next = ctx->chunks->next;
+          ctx->chunks->next = chunk;
+        }
+      else
+        {
+          chunk->next = ctx->chunks;
+          ctx->chunks = chunk;
+        }
+    }
+
+  p = (unsigned char*)chunk + ARENA_CHUNKHDRLEN + chunk->used;
+  memcpy (p, &n, sizeof n);
+  chunk->last = chunk->used;
+  chunk->used += need;
+  return p + ARENA_HDRLEN;
+}
+
+
+/* Return the chunk of CTX holding the memory at P or NULL if P was
+   not allocated from CTX.  Only the address is compared; memory not
+   owned by CTX is never accessed.  */
+static struct arena_chunk_s *
+arena_find (ksba_alloc_ctx_t ctx, const void *p)
+{
+  struct arena_chunk_s *chunk;
+  const unsigned char *data;
+
+  for (chunk = ctx->chunks; chunk; chunk = chunk->next)
+    {
+      data = (const unsigned char *)chunk + ARENA_CHUNKHDRLEN;
+      if ((const unsigned char *)p > data
+          && (const unsigned char *)p < data + chunk->size)
+        return chunk;
+    }
+  return NULL;
+}
+
+
+/* Free the arena memory P which is in CHUNK.  The memory is only
+   reclaimed if it is the last allocation of CHUNK.  */
+static void
+arena_free (struct arena_chunk_s *chunk, void *p)
+{
+  unsigned char *data = (unsigned char *)chunk + ARENA_CHUNKHDRLEN;
+
+  if (chunk->last != ARENA_NOLAST
+      && (size_t)((unsigned char *)p - ARENA_HDRLEN - data) == chunk->last)
+    {
+      chunk->used = chunk->last;
+      chunk->last = ARENA_NOLAST;  /* Only one step back is possible.  */
+    }
+}
+
+
+/* Resize the memory P of CTX which is in CHUNK to N bytes.  */
+static void *
+arena_realloc (ksba_alloc_ctx_t ctx, struct arena_chunk_s *chunk,
+               void *p, size_t n)
+{
+  unsigned char *data = (unsigned char *)chunk + ARENA_CHUNKHDRLEN;
+  unsigned char *hdr = (unsigned char *)p - ARENA_HDRLEN;
+  size_t oldn, need;
+  void *newp;
+
+  memcpy (&oldn, hdr, sizeof oldn);
+  if (chunk->last != ARENA_NOLAST && (size_t)(hdr - data) == chunk->last)
+    {
+      /* This is the last allocation of the chunk; try to resize it
+         in place.  */
+      need = ARENA_HDRLEN + ((n + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1));
+      if (need >= n && chunk->size - chunk->last >= need)
+        {
+          memcpy (hdr, &n, sizeof n);
+          chunk->used = chunk->last + need;
+          return p;
+        }
+    }
+  if (n <= oldn)
+    {
+      memcpy (hdr, &n, sizeof n);
+      return p;
+    }
+  newp = arena_alloc (ctx, n);
+  if (newp)
+    memcpy (newp, p, oldn);
+  return newp;
+}
+
+
 /* Wrapper for the common memory allocation functions.  These are here
    so that we can add hooks.  The corresponding macros should be used.
    These macros are not named xfoo() because this name is commonly
@@ -127,6 +527,8 @@ _ksba_hash_buffer (const char *oid, const void *buffer, size_t length,
 void *
 ksba_malloc (size_t n )
 {
+  if (current_actx)
+    return arena_alloc (current_actx, n);
   return alloc_func (n);
 }
 
@@ -152,6 +554,16 @@ ksba_calloc (size_t n, size_t m )
 void *
 ksba_realloc (void *mem, size_t n)
 {
+  struct arena_chunk_s *chunk;
+
+  if (current_actx)
+    {
+      if (!mem)
+        return arena_alloc (current_actx, n);
+      chunk = arena_find (current_actx, mem);
+      if (chunk)
+        return arena_realloc (current_actx, chunk, mem, n);
+    }
   return realloc_func (mem, n );
 }
 
@@ -218,7 +630,13 @@ _ksba_reallocarray (void *a, size_t oldnmemb, size_t nmemb, size_t size)
 void
 ksba_free ( void *a )
 {
-  if (a)
+  struct arena_chunk_s *chunk;
+
+  if (!a)
+    return;
+  if (current_actx && (chunk = arena_find (current_actx, a)))
+    arena_free (chunk, a);
+  else
     free_func (a);
 }
 
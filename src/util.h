@@ -36,6 +36,7 @@
 #endif
 
 
+#include <string.h>
 #include "visibility.h"
 
 
@@ -44,6 +45,13 @@ gpg_error_t _ksba_hash_buffer (const char *oid,
                                size_t resultsize,
                                unsigned char *result, size_t *resultlen);
 
+uint64_t _ksba_hash64 (const void *buffer, size_t length);
+
+gpg_error_t _ksba_alloc_ctx_enter (ksba_alloc_ctx_t ctx,
+                                   ksba_alloc_ctx_t *r_prev);
+void _ksba_alloc_ctx_leave (ksba_alloc_ctx_t ctx, ksba_alloc_ctx_t prev);
+ksba_alloc_ctx_t _ksba_alloc_ctx_current (void);
+
 void *_ksba_reallocarray (void *a, size_t oldnmemb, size_t nmemb, size_t size);
 
 void *_ksba_xmalloc (size_t n );
@@ -51,16 +59,69 @@ void *_ksba_xcalloc (size_t n, size_t m );
 void *_ksba_xrealloc (void *p, size_t n);
 char *_ksba_xstrdup (const char *p);
 
-#define xtrymalloc(a)    ksba_malloc((a))
-#define xtrycalloc(a,b)  ksba_calloc((a),(b))
-#define xtryrealloc(a,b) ksba_realloc((a),(b))
-#define xtrystrdup(a)    ksba_strdup((a))
+/* Report a trace event if a trace function is registered.  */
+extern void (*_ksba_trace_fnc)(void *arg, const ksba_trace_info_t *info);
+void _ksba_trace (ksba_trace_event_t event, int value, gpg_error_t err,
+                  uint64_t nbytes, const void *object, const char *name);
+#define TRACE(event,value,err,nbytes,object,name) do {                  \
+    if (_ksba_trace_fnc)                                                \
+      _ksba_trace ((event), (value), (err), (nbytes), (object), (name)); \
+  } while (0)
+
+/*-- stats.c --*/
+extern int _ksba_stats_enabled;
+ksba_stats_t *_ksba_stats_thread (void);
+void _ksba_stats_alloc (int module, size_t n);
+
+/* Add N to the statistics counter FIELD of the calling thread.  */
+#define STATS_ADD(field,n) do {                                 \
+    if (_ksba_stats_enabled)                                    \
+      {                                                         \
+        ksba_stats_t *stats_ = _ksba_stats_thread ();           \
+        if (stats_)                                             \
+          stats_->field += (n);                                 \
+      }                                                         \
+  } while (0)
+
+/* The module to which the allocations of a source file are
+   accounted.  Source files define this before including this
+   header.  */
+#ifndef STATS_MODULE
+# define STATS_MODULE KSBA_STATS_MOD_OTHER
+#endif
+
+/* Account an allocation of N elements of M bytes to MODULE and
+   return N.  This is used by the allocation macros below so that
+   their arguments are evaluated only once; the element size of
+   xtrycalloc is evaluated twice, which is fine for a sizeof.  */
+static inline size_t
+stats_count (int module, size_t n, size_t m)
+{
+  if (_ksba_stats_enabled)
+    _ksba_stats_alloc (module, n * m);
+  return n;
+}
+
+static inline const char *
+stats_count_str (int module, const char *s)
+{
+  if (_ksba_stats_enabled)
+    _ksba_stats_alloc (module, strlen (s) + 1);
+  return s;
+}
+
+#define xtrymalloc(a)    ksba_malloc (stats_count (STATS_MODULE, (a), 1))
+#define xtrycalloc(a,b)  ksba_calloc (stats_count (STATS_MODULE, (a), (b)), \
+                                  (b))
+#define xtryrealloc(a,b) ksba_realloc ((a), stats_count (STATS_MODULE, (b), 1))
+#define xtrystrdup(a)    ksba_strdup (stats_count_str (STATS_MODULE, (a)))
 #define xfree(a)         ksba_free((a))
 
-#define xmalloc(a)       _ksba_xmalloc((a))
-#define xcalloc(a,b)     _ksba_xcalloc((a),(b))
-#define xrealloc(a,b)    _ksba_xrealloc((a),(b))
-#define xstrdup(a)       _ksba_xstrdup((a))
+#define xmalloc(a)       _ksba_xmalloc (stats_count (STATS_MODULE, (a), 1))
+#define xcalloc(a,b)     _ksba_xcalloc (stats_count (STATS_MODULE, (a), (b)), \
+                                    (b))
+#define xrealloc(a,b)    _ksba_xrealloc ((a), stats_count (STATS_MODULE, (b), 1))
+#define xstrdup(a)       _ksba_xstrdup (stats_count_str (STATS_MODULE, (a)))
 
 
 #define DIM(v) (sizeof(v)/sizeof((v)[0]))
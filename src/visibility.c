@@ -65,6 +65,15 @@ ksba_set_hash_buffer_function ( gpg_error_t (*fnc)
   _ksba_set_hash_buffer_function (fnc, fnc_arg);
 }
 
+
+void
+ksba_set_trace_function (void (*fnc)(void *arg,
+                                     const ksba_trace_info_t *info),
+                         void *fnc_arg)
+{
+  _ksba_set_trace_function (fnc, fnc_arg);
+}
+
 void *
 ksba_malloc (size_t n )
 {
@@ -96,6 +105,45 @@ ksba_free ( void *a )
     _ksba_free (a);
 }
 
+gpg_error_t
+ksba_alloc_ctx_new (ksba_alloc_ctx_t *r_ctx, size_t chunksize)
+{
+  return _ksba_alloc_ctx_new (r_ctx, chunksize);
+}
+
+void
+ksba_alloc_ctx_release (ksba_alloc_ctx_t ctx)
+{
+  _ksba_alloc_ctx_release (ctx);
+}
+
+
+
+/*-- stats.c --*/
+void
+ksba_stats_enable (int enable)
+{
+  _ksba_stats_enable (enable);
+}
+
+gpg_error_t
+ksba_stats_get (ksba_stats_t *r_stats)
+{
+  return _ksba_stats_get (r_stats);
+}
+
+void
+ksba_stats_reset (void)
+{
+  _ksba_stats_reset ();
+}
+
+const char *
+ksba_stats_module_name (int module)
+{
+  return _ksba_stats_module_name (module);
+}
+
 
 /*-- cert.c --*/
 gpg_error_t
@@ -105,6 +153,13 @@ ksba_cert_new (ksba_cert_t *acert)
 }
 
 
+gpg_error_t
+ksba_cert_new_in (ksba_alloc_ctx_t ctx, ksba_cert_t *acert)
+{
+  return _ksba_cert_new_in (ctx, acert);
+}
+
+
 void
 ksba_cert_ref (ksba_cert_t cert)
 {
@@ -136,6 +191,106 @@ ksba_cert_get_user_data (ksba_cert_t cert, const char *key,
 }
 
 
+gpg_error_t
+ksba_certindex_new (ksba_certindex_t *r_index)
+{
+  return _ksba_certindex_new (r_index);
+}
+
+
+void
+ksba_certindex_release (ksba_certindex_t index)
+{
+  _ksba_certindex_release (index);
+}
+
+
+size_t
+ksba_certindex_count (ksba_certindex_t index)
+{
+  return _ksba_certindex_count (index);
+}
+
+
+gpg_error_t
+ksba_certindex_add (ksba_certindex_t index, ksba_cert_t cert)
+{
+  return _ksba_certindex_add (index, cert);
+}
+
+
+gpg_error_t
+ksba_certindex_add_many (ksba_certindex_t index,
+                         ksba_cert_t *certs, size_t ncerts)
+{
+  return _ksba_certindex_add_many (index, certs, ncerts);
+}
+
+
+gpg_error_t
+ksba_certindex_find_subject (ksba_certindex_t index,
+                             const void *dn, size_t dnlen,
+                             int idx, ksba_cert_t *r_cert)
+{
+  return _ksba_certindex_find_subject (index, dn, dnlen, idx, r_cert);
+}
+
+
+gpg_error_t
+ksba_certindex_find_issuer_serial (ksba_certindex_t index,
+                                   const void *issuer, size_t issuerlen,
+                                   const void *serial, size_t seriallen,
+                                   int idx, ksba_cert_t *r_cert)
+{
+  return _ksba_certindex_find_issuer_serial (index, issuer, issuerlen,
+                                             serial, seriallen, idx, r_cert);
+}
+
+
+gpg_error_t
+ksba_certindex_find_subj_key_id (ksba_certindex_t index,
+                                 const void *keyid, size_t keyidlen,
+                                 int idx, ksba_cert_t *r_cert)
+{
+  return _ksba_certindex_find_subj_key_id (index, keyid, keyidlen,
+                                           idx, r_cert);
+}
+
+
+gpg_error_t
+ksba_certindex_find_auth_key_id (ksba_certindex_t index,
+                                 const void *keyid, size_t keyidlen,
+                                 int idx, ksba_cert_t *r_cert)
+{
+  return _ksba_certindex_find_auth_key_id (index, keyid, keyidlen,
+                                           idx, r_cert);
+}
+
+
+gpg_error_t
+ksba_certindex_find_issuer (ksba_certindex_t index, ksba_cert_t cert,
+                            int idx, ksba_cert_t *r_cert)
+{
+  return _ksba_certindex_find_issuer (index, cert, idx, r_cert);
+}
+
+
+gpg_error_t
+ksba_cert_snapshot_write (ksba_writer_t writer,
+                          ksba_cert_t *certs, size_t ncerts)
+{
+  return _ksba_cert_snapshot_write (writer, certs, ncerts);
+}
+
+
+gpg_error_t
+ksba_cert_snapshot_read (const void *buffer, size_t length,
+                         ksba_cert_t **r_certs, size_t *r_ncerts)
+{
+  return _ksba_cert_snapshot_read (buffer, length, r_certs, r_ncerts);
+}
+
+
 
 gpg_error_t
 ksba_cert_read_der (ksba_cert_t cert, ksba_reader_t reader)
@@ -171,6 +326,54 @@ ksba_cert_hash (ksba_cert_t cert,
 }
 
 
+gpg_error_t
+ksba_cert_get_ct_tbs (ksba_cert_t cert, unsigned char *buffer,
+                      size_t bufsize, size_t *r_length)
+{
+  return _ksba_cert_get_ct_tbs (cert, buffer, bufsize, r_length);
+}
+
+
+gpg_error_t
+ksba_cert_hash_ct_tbs (ksba_cert_t cert,
+                       void (*hasher)(void *, const void *, size_t length),
+                       void *hasher_arg)
+{
+  return _ksba_cert_hash_ct_tbs (cert, hasher, hasher_arg);
+}
+
+
+gpg_error_t
+ksba_cert_get_fingerprint (ksba_cert_t cert, const char *oid,
+                           const unsigned char **r_digest,
+                           size_t *r_digestlen)
+{
+  return _ksba_cert_get_fingerprint (cert, oid, r_digest, r_digestlen);
+}
+
+
+uint64_t
+ksba_cert_get_quickhash (ksba_cert_t cert)
+{
+  return _ksba_cert_get_quickhash (cert);
+}
+
+
+int
+ksba_cert_equal (ksba_cert_t a, ksba_cert_t b)
+{
+  return _ksba_cert_equal (a, b);
+}
+
+
+gpg_error_t
+ksba_cert_get_columns (ksba_cert_t *certs, size_t ncerts,
+                       unsigned int fields, ksba_cert_columns_t *columns)
+{
+  return _ksba_cert_get_columns (certs, ncerts, fields, columns);
+}
+
+
 const char *
 ksba_cert_get_digest_algo (ksba_cert_t cert)
 {
@@ -200,6 +403,14 @@ ksba_cert_get_validity (ksba_cert_t cert, int what,
 }
 
 
+gpg_error_t
+ksba_cert_get_validity_epoch (ksba_cert_t cert, int what,
+                              ksba_epochtime_t *r_time)
+{
+  return _ksba_cert_get_validity_epoch (cert, what, r_time);
+}
+
+
 char *
 ksba_cert_get_subject (ksba_cert_t cert, int idx)
 {
@@ -261,6 +472,32 @@ ksba_cert_get_ext_key_usages (ksba_cert_t cert, char **result)
 }
 
 
+gpg_error_t
+ksba_cert_iter_cert_policies (ksba_cert_t cert, ksba_oid_iter_t *r_iter)
+{
+  return _ksba_cert_iter_cert_policies (cert, r_iter);
+}
+
+
+gpg_error_t
+ksba_cert_iter_ext_key_usages (ksba_cert_t cert, ksba_oid_iter_t *r_iter)
+{
+  return _ksba_cert_iter_ext_key_usages (cert, r_iter);
+}
+
+
+gpg_error_t
+ksba_oid_iter_next (ksba_oid_iter_t *iter,
+                    const unsigned char **r_oid, size_t *r_oidlen,
+                    int *r_crit,
+                    const unsigned char **r_qualifiers,
+                    size_t *r_qualifierslen)
+{
+  return _ksba_oid_iter_next (iter, r_oid, r_oidlen, r_crit,
+                              r_qualifiers, r_qualifierslen);
+}
+
+
 gpg_error_t
 ksba_cert_get_crl_dist_point (ksba_cert_t cert, int idx,
                               ksba_name_t *r_distpoint,
@@ -310,6 +547,21 @@ ksba_cert_get_subject_info_access (ksba_cert_t cert, int idx,
 }
 
 
+gpg_error_t
+ksba_cert_get_alt_names (ksba_cert_t cert, int use_subject,
+                         ksba_name_iter_t *r_iter)
+{
+  return _ksba_cert_get_alt_names (cert, use_subject, r_iter);
+}
+
+
+gpg_error_t
+ksba_cert_match_hostname (ksba_cert_t cert, const char *hostname)
+{
+  return _ksba_cert_match_hostname (cert, hostname);
+}
+
+
 
 
 /*-- cms.c --*/
@@ -637,6 +889,15 @@ ksba_crl_get_update_times (ksba_crl_t crl,
 }
 
 
+gpg_error_t
+ksba_crl_get_update_times_epoch (ksba_crl_t crl,
+                                 ksba_epochtime_t *this_update,
+                                 ksba_epochtime_t *next_update)
+{
+  return _ksba_crl_get_update_times_epoch (crl, this_update, next_update);
+}
+
+
 gpg_error_t
 ksba_crl_get_item (ksba_crl_t crl,
                    ksba_sexp_t *r_serial,
@@ -816,6 +1077,20 @@ ksba_ocsp_get_status (ksba_ocsp_t ocsp, ksba_cert_t cert,
 }
 
 
+gpg_error_t
+ksba_ocsp_get_status_epoch (ksba_ocsp_t ocsp, ksba_cert_t cert,
+                            ksba_status_t *r_status,
+                            ksba_epochtime_t *r_this_update,
+                            ksba_epochtime_t *r_next_update,
+                            ksba_epochtime_t *r_revocation_time,
+                            ksba_crl_reason_t *r_reason)
+{
+  return _ksba_ocsp_get_status_epoch (ocsp, cert, r_status, r_this_update,
+                                      r_next_update, r_revocation_time,
+                                      r_reason);
+}
+
+
 gpg_error_t
 ksba_ocsp_get_extension (ksba_ocsp_t ocsp, ksba_cert_t cert,
                          int idx,
@@ -984,6 +1259,20 @@ ksba_reader_set_file (ksba_reader_t r, FILE *fp)
 }
 
 
+gpg_error_t
+ksba_reader_set_mmap (ksba_reader_t r, int fd)
+{
+  return _ksba_reader_set_mmap (r, fd);
+}
+
+
+gpg_error_t
+ksba_reader_open_file (ksba_reader_t r, const char *fname)
+{
+  return _ksba_reader_open_file (r, fname);
+}
+
+
 gpg_error_t
 ksba_reader_set_cb (ksba_reader_t r,
                     int (*cb)(void*,char *,size_t,size_t*),
@@ -993,6 +1282,13 @@ ksba_reader_set_cb (ksba_reader_t r,
 }
 
 
+gpg_error_t
+ksba_reader_set_base64 (ksba_reader_t r, unsigned int flags)
+{
+  return _ksba_reader_set_base64 (r, flags);
+}
+
+
 
 gpg_error_t
 ksba_reader_read (ksba_reader_t r,
@@ -1090,6 +1386,35 @@ ksba_writer_snatch_mem (ksba_writer_t w, size_t *nbytes)
 }
 
 
+gpg_error_t
+ksba_writer_set_mem_chunked (ksba_writer_t w, size_t chunk_size)
+{
+  return _ksba_writer_set_mem_chunked (w, chunk_size);
+}
+
+
+gpg_error_t
+ksba_writer_get_mem_iov (ksba_writer_t w,
+                         const ksba_iov_t **r_iov, size_t *r_niov)
+{
+  return _ksba_writer_get_mem_iov (w, r_iov, r_niov);
+}
+
+
+gpg_error_t
+ksba_writer_set_buffer (ksba_writer_t w, size_t size)
+{
+  return _ksba_writer_set_buffer (w, size);
+}
+
+
+gpg_error_t
+ksba_writer_flush (ksba_writer_t w)
+{
+  return _ksba_writer_flush (w);
+}
+
+
 gpg_error_t
 ksba_writer_set_filter (ksba_writer_t w,
                         gpg_error_t (*filter)(void*,
@@ -1101,6 +1426,33 @@ ksba_writer_set_filter (ksba_writer_t w,
 }
 
 
+gpg_error_t
+ksba_writer_add_filter (ksba_writer_t w,
+                        gpg_error_t (*filter)(void*,
+                                            const void *,size_t, size_t *,
+                                            void *, size_t, size_t *),
+                        void *filter_arg,
+                        size_t blocksize, unsigned int flags)
+{
+  return _ksba_writer_add_filter (w, filter, filter_arg, blocksize, flags);
+}
+
+
+gpg_error_t
+ksba_writer_set_filter_ring (ksba_writer_t w, int nbuffers)
+{
+  return _ksba_writer_set_filter_ring (w, nbuffers);
+}
+
+
+gpg_error_t
+ksba_writer_add_base64 (ksba_writer_t w, const char *label,
+                        unsigned int linelen, unsigned int flags)
+{
+  return _ksba_writer_add_base64 (w, label, linelen, flags);
+}
+
+
 
 gpg_error_t
 ksba_writer_write (ksba_writer_t w, const void *buffer, size_t length)
@@ -1109,6 +1461,13 @@ ksba_writer_write (ksba_writer_t w, const void *buffer, size_t length)
 }
 
 
+gpg_error_t
+ksba_writer_writev (ksba_writer_t w, const ksba_iov_t *iov, size_t niov)
+{
+  return _ksba_writer_writev (w, iov, niov);
+}
+
+
 gpg_error_t
 ksba_writer_write_octet_string (ksba_writer_t w,
                                 const void *buffer, size_t length,
@@ -1240,6 +1599,21 @@ ksba_name_get_uri (ksba_name_t name, int idx)
 }
 
 
+gpg_error_t
+ksba_name_iter_init (ksba_name_iter_t *iter, const void *der, size_t derlen)
+{
+  return _ksba_name_iter_init (iter, der, derlen);
+}
+
+
+gpg_error_t
+ksba_name_iter_next (ksba_name_iter_t *iter, ksba_gn_type_t *r_type,
+                     const unsigned char **r_value, size_t *r_valuelen)
+{
+  return _ksba_name_iter_next (iter, r_type, r_value, r_valuelen);
+}
+
+
 /*-- der-encoder.c --*/
 void
 ksba_der_release (ksba_der_t d)
@@ -1312,8 +1686,34 @@ ksba_der_add_end (ksba_der_t d)
   _ksba_der_add_end (d);
 }
 
+void
+ksba_der_add_slot (ksba_der_t d, int cls, int tag, unsigned int slot)
+{
+  _ksba_der_add_slot (d, cls, tag, slot);
+}
+
+gpg_error_t
+ksba_der_set_slot (ksba_der_t d, unsigned int slot,
+                   const void *value, size_t valuelen)
+{
+  return _ksba_der_set_slot (d, slot, value, valuelen);
+}
+
 gpg_error_t
 ksba_der_builder_get (ksba_der_t d, unsigned char **r_obj, size_t *r_objlen)
 {
   return _ksba_der_builder_get (d, r_obj, r_objlen);
 }
+
+gpg_error_t
+ksba_der_builder_write (ksba_der_t d, ksba_writer_t writer, size_t *r_objlen)
+{
+  return _ksba_der_builder_write (d, writer, r_objlen);
+}
+
+gpg_error_t
+ksba_der_builder_get_iov (ksba_der_t d,
+                          const ksba_iov_t **r_iov, size_t *r_niov)
+{
+  return _ksba_der_builder_get_iov (d, r_iov, r_niov);
+}
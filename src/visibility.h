@@ -34,8 +34,15 @@
 /* Redefine all public symbols.  */
 #define ksba_check_version                 _ksba_check_version
 #define ksba_set_hash_buffer_function      _ksba_set_hash_buffer_function
+#define ksba_set_trace_function            _ksba_set_trace_function
 #define ksba_set_malloc_hooks              _ksba_set_malloc_hooks
 #define ksba_free                          _ksba_free
+#define ksba_alloc_ctx_new                 _ksba_alloc_ctx_new
+#define ksba_alloc_ctx_release             _ksba_alloc_ctx_release
+#define ksba_stats_enable                  _ksba_stats_enable
+#define ksba_stats_get                     _ksba_stats_get
+#define ksba_stats_reset                   _ksba_stats_reset
+#define ksba_stats_module_name             _ksba_stats_module_name
 #define ksba_malloc                        _ksba_malloc
 #define ksba_calloc                        _ksba_calloc
 #define ksba_realloc                       _ksba_realloc
@@ -50,6 +57,9 @@
 #define ksba_cert_get_crl_dist_point       _ksba_cert_get_crl_dist_point
 #define ksba_cert_get_digest_algo          _ksba_cert_get_digest_algo
 #define ksba_cert_get_ext_key_usages       _ksba_cert_get_ext_key_usages
+#define ksba_cert_iter_cert_policies       _ksba_cert_iter_cert_policies
+#define ksba_cert_iter_ext_key_usages      _ksba_cert_iter_ext_key_usages
+#define ksba_oid_iter_next                 _ksba_oid_iter_next
 #define ksba_cert_get_extension            _ksba_cert_get_extension
 #define ksba_cert_get_image                _ksba_cert_get_image
 #define ksba_cert_get_issuer               _ksba_cert_get_issuer
@@ -59,20 +69,43 @@
 #define ksba_cert_get_sig_val              _ksba_cert_get_sig_val
 #define ksba_cert_get_subject              _ksba_cert_get_subject
 #define ksba_cert_get_validity             _ksba_cert_get_validity
+#define ksba_cert_get_validity_epoch       _ksba_cert_get_validity_epoch
 #define ksba_cert_hash                     _ksba_cert_hash
+#define ksba_cert_get_ct_tbs               _ksba_cert_get_ct_tbs
+#define ksba_cert_hash_ct_tbs              _ksba_cert_hash_ct_tbs
+#define ksba_cert_get_fingerprint          _ksba_cert_get_fingerprint
+#define ksba_cert_get_quickhash            _ksba_cert_get_quickhash
+#define ksba_cert_equal                    _ksba_cert_equal
+#define ksba_cert_get_columns              _ksba_cert_get_columns
 #define ksba_cert_init_from_mem            _ksba_cert_init_from_mem
 #define ksba_cert_is_ca                    _ksba_cert_is_ca
 #define ksba_cert_new                      _ksba_cert_new
+#define ksba_cert_new_in                   _ksba_cert_new_in
 #define ksba_cert_read_der                 _ksba_cert_read_der
 #define ksba_cert_ref                      _ksba_cert_ref
 #define ksba_cert_release                  _ksba_cert_release
 #define ksba_cert_get_authority_info_access \
                                            _ksba_cert_get_authority_info_access
 #define ksba_cert_get_subject_info_access  _ksba_cert_get_subject_info_access
+#define ksba_cert_get_alt_names            _ksba_cert_get_alt_names
+#define ksba_cert_match_hostname           _ksba_cert_match_hostname
 #define ksba_cert_get_subj_key_id          _ksba_cert_get_subj_key_id
 #define ksba_cert_set_user_data            _ksba_cert_set_user_data
 #define ksba_cert_get_user_data            _ksba_cert_get_user_data
 
+#define ksba_certindex_new                 _ksba_certindex_new
+#define ksba_certindex_release             _ksba_certindex_release
+#define ksba_certindex_count               _ksba_certindex_count
+#define ksba_certindex_add                 _ksba_certindex_add
+#define ksba_certindex_add_many            _ksba_certindex_add_many
+#define ksba_certindex_find_subject        _ksba_certindex_find_subject
+#define ksba_certindex_find_issuer_serial  _ksba_certindex_find_issuer_serial
+#define ksba_certindex_find_subj_key_id    _ksba_certindex_find_subj_key_id
+#define ksba_certindex_find_auth_key_id    _ksba_certindex_find_auth_key_id
+#define ksba_certindex_find_issuer         _ksba_certindex_find_issuer
+#define ksba_cert_snapshot_write           _ksba_cert_snapshot_write
+#define ksba_cert_snapshot_read            _ksba_cert_snapshot_read
+
 #define ksba_certreq_set_serial            _ksba_certreq_set_serial
 #define ksba_certreq_set_issuer            _ksba_certreq_set_issuer
 #define ksba_certreq_set_validity          _ksba_certreq_set_validity
@@ -124,6 +157,7 @@
 #define ksba_crl_get_item                  _ksba_crl_get_item
 #define ksba_crl_get_sig_val               _ksba_crl_get_sig_val
 #define ksba_crl_get_update_times          _ksba_crl_get_update_times
+#define ksba_crl_get_update_times_epoch    _ksba_crl_get_update_times_epoch
 #define ksba_crl_new                       _ksba_crl_new
 #define ksba_crl_parse                     _ksba_crl_parse
 #define ksba_crl_release                   _ksba_crl_release
@@ -135,6 +169,8 @@
 
 #define ksba_name_enum                     _ksba_name_enum
 #define ksba_name_get_uri                  _ksba_name_get_uri
+#define ksba_name_iter_init                _ksba_name_iter_init
+#define ksba_name_iter_next                _ksba_name_iter_next
 #define ksba_name_new                      _ksba_name_new
 #define ksba_name_ref                      _ksba_name_ref
 #define ksba_name_release                  _ksba_name_release
@@ -147,6 +183,7 @@
 #define ksba_ocsp_get_responder_id         _ksba_ocsp_get_responder_id
 #define ksba_ocsp_get_sig_val              _ksba_ocsp_get_sig_val
 #define ksba_ocsp_get_status               _ksba_ocsp_get_status
+#define ksba_ocsp_get_status_epoch         _ksba_ocsp_get_status_epoch
 #define ksba_ocsp_hash_request             _ksba_ocsp_hash_request
 #define ksba_ocsp_hash_response            _ksba_ocsp_hash_response
 #define ksba_ocsp_new                      _ksba_ocsp_new
@@ -175,6 +212,9 @@
 #define ksba_reader_set_fd                 _ksba_reader_set_fd
 #define ksba_reader_set_file               _ksba_reader_set_file
 #define ksba_reader_set_mem                _ksba_reader_set_mem
+#define ksba_reader_set_base64             _ksba_reader_set_base64
+#define ksba_reader_set_mmap               _ksba_reader_set_mmap
+#define ksba_reader_open_file              _ksba_reader_open_file
 #define ksba_reader_tell                   _ksba_reader_tell
 #define ksba_reader_unread                 _ksba_reader_unread
 
@@ -186,8 +226,16 @@
 #define ksba_writer_set_fd                 _ksba_writer_set_fd
 #define ksba_writer_set_file               _ksba_writer_set_file
 #define ksba_writer_set_filter             _ksba_writer_set_filter
+#define ksba_writer_add_filter             _ksba_writer_add_filter
+#define ksba_writer_set_filter_ring        _ksba_writer_set_filter_ring
+#define ksba_writer_add_base64             _ksba_writer_add_base64
 #define ksba_writer_set_mem                _ksba_writer_set_mem
 #define ksba_writer_snatch_mem             _ksba_writer_snatch_mem
+#define ksba_writer_set_mem_chunked        _ksba_writer_set_mem_chunked
+#define ksba_writer_get_mem_iov            _ksba_writer_get_mem_iov
+#define ksba_writer_set_buffer             _ksba_writer_set_buffer
+#define ksba_writer_flush                  _ksba_writer_flush
+#define ksba_writer_writev                 _ksba_writer_writev
 #define ksba_writer_tell                   _ksba_writer_tell
 #define ksba_writer_write                  _ksba_writer_write
 #define ksba_writer_write_octet_string     _ksba_writer_write_octet_string
@@ -203,7 +251,11 @@
 #define ksba_der_add_der                   _ksba_der_add_der
 #define ksba_der_add_tag                   _ksba_der_add_tag
 #define ksba_der_add_end                   _ksba_der_add_end
+#define ksba_der_add_slot                  _ksba_der_add_slot
+#define ksba_der_set_slot                  _ksba_der_set_slot
 #define ksba_der_builder_get               _ksba_der_builder_get
+#define ksba_der_builder_write             _ksba_der_builder_write
+#define ksba_der_builder_get_iov           _ksba_der_builder_get_iov
 
 
 /* Include the main header file to map the public symbols to the
@@ -242,8 +294,15 @@ int ksba_asn_delete_structure (void *dummy);
    exported name of the symbol.  */
 #undef ksba_check_version
 #undef ksba_set_hash_buffer_function
+#undef ksba_set_trace_function
 #undef ksba_set_malloc_hooks
 #undef ksba_free
+#undef ksba_alloc_ctx_new
+#undef ksba_alloc_ctx_release
+#undef ksba_stats_enable
+#undef ksba_stats_get
+#undef ksba_stats_reset
+#undef ksba_stats_module_name
 #undef ksba_malloc
 #undef ksba_calloc
 #undef ksba_realloc
@@ -258,6 +317,9 @@ int ksba_asn_delete_structure (void *dummy);
 #undef ksba_cert_get_crl_dist_point
 #undef ksba_cert_get_digest_algo
 #undef ksba_cert_get_ext_key_usages
+#undef ksba_cert_iter_cert_policies
+#undef ksba_cert_iter_ext_key_usages
+#undef ksba_oid_iter_next
 #undef ksba_cert_get_extension
 #undef ksba_cert_get_image
 #undef ksba_cert_get_issuer
@@ -267,19 +329,42 @@ int ksba_asn_delete_structure (void *dummy);
 #undef ksba_cert_get_sig_val
 #undef ksba_cert_get_subject
 #undef ksba_cert_get_validity
+#undef ksba_cert_get_validity_epoch
 #undef ksba_cert_hash
+#undef ksba_cert_get_ct_tbs
+#undef ksba_cert_hash_ct_tbs
+#undef ksba_cert_get_fingerprint
+#undef ksba_cert_get_quickhash
+#undef ksba_cert_equal
+#undef ksba_cert_get_columns
 #undef ksba_cert_init_from_mem
 #undef ksba_cert_is_ca
 #undef ksba_cert_new
+#undef ksba_cert_new_in
 #undef ksba_cert_read_der
 #undef ksba_cert_ref
 #undef ksba_cert_release
 #undef ksba_cert_get_authority_info_access
 #undef ksba_cert_get_subject_info_access
+#undef ksba_cert_get_alt_names
+#undef ksba_cert_match_hostname
 #undef ksba_cert_get_subj_key_id
 #undef ksba_cert_set_user_data
 #undef ksba_cert_get_user_data
 
+#undef ksba_certindex_new
+#undef ksba_certindex_release
+#undef ksba_certindex_count
+#undef ksba_certindex_add
+#undef ksba_certindex_add_many
+#undef ksba_certindex_find_subject
+#undef ksba_certindex_find_issuer_serial
+#undef ksba_certindex_find_subj_key_id
+#undef ksba_certindex_find_auth_key_id
+#undef ksba_certindex_find_issuer
+#undef ksba_cert_snapshot_write
+#undef ksba_cert_snapshot_read
+
 #undef ksba_certreq_set_serial
 #undef ksba_certreq_set_issuer
 #undef ksba_certreq_set_validity
@@ -331,6 +416,7 @@ int ksba_asn_delete_structure (void *dummy);
 #undef ksba_crl_get_item
 #undef ksba_crl_get_sig_val
 #undef ksba_crl_get_update_times
+#undef ksba_crl_get_update_times_epoch
 #undef ksba_crl_new
 #undef ksba_crl_parse
 #undef ksba_crl_release
@@ -342,6 +428,8 @@ int ksba_asn_delete_structure (void *dummy);
 
 #undef ksba_name_enum
 #undef ksba_name_get_uri
+#undef ksba_name_iter_init
+#undef ksba_name_iter_next
 #undef ksba_name_new
 #undef ksba_name_ref
 #undef ksba_name_release
@@ -354,6 +442,7 @@ int ksba_asn_delete_structure (void *dummy);
 #undef ksba_ocsp_get_responder_id
 #undef ksba_ocsp_get_sig_val
 #undef ksba_ocsp_get_status
+#undef ksba_ocsp_get_status_epoch
 #undef ksba_ocsp_hash_request
 #undef ksba_ocsp_hash_response
 #undef ksba_ocsp_new
@@ -382,6 +471,9 @@ int ksba_asn_delete_structure (void *dummy);
 #undef ksba_reader_set_fd
 #undef ksba_reader_set_file
 #undef ksba_reader_set_mem
+#undef ksba_reader_set_base64
+#undef ksba_reader_set_mmap
+#undef ksba_reader_open_file
 #undef ksba_reader_tell
 #undef ksba_reader_unread
 
@@ -393,8 +485,16 @@ int ksba_asn_delete_structure (void *dummy);
 #undef ksba_writer_set_fd
 #undef ksba_writer_set_file
 #undef ksba_writer_set_filter
+#undef ksba_writer_add_filter
+#undef ksba_writer_set_filter_ring
+#undef ksba_writer_add_base64
 #undef ksba_writer_set_mem
 #undef ksba_writer_snatch_mem
+#undef ksba_writer_set_mem_chunked
+#undef ksba_writer_get_mem_iov
+#undef ksba_writer_set_buffer
+#undef ksba_writer_flush
+#undef ksba_writer_writev
 #undef ksba_writer_tell
 #undef ksba_writer_write
 #undef ksba_writer_write_octet_string
@@ -410,15 +510,26 @@ int ksba_asn_delete_structure (void *dummy);
 #undef ksba_der_add_der
 #undef ksba_der_add_tag
 #undef ksba_der_add_end
+#undef ksba_der_add_slot
+#undef ksba_der_set_slot
 #undef ksba_der_builder_get
+#undef ksba_der_builder_write
+#undef ksba_der_builder_get_iov
 
 
 
 /* Mark all symbols.  */
 MARK_VISIBLE (ksba_check_version)
 MARK_VISIBLE (ksba_set_hash_buffer_function)
+MARK_VISIBLE (ksba_set_trace_function)
 MARK_VISIBLE (ksba_set_malloc_hooks)
 MARK_VISIBLE (ksba_free)
+MARK_VISIBLE (ksba_alloc_ctx_new)
+MARK_VISIBLE (ksba_alloc_ctx_release)
+MARK_VISIBLE (ksba_stats_enable)
+MARK_VISIBLE (ksba_stats_get)
+MARK_VISIBLE (ksba_stats_reset)
+MARK_VISIBLE (ksba_stats_module_name)
 MARK_VISIBLE (ksba_malloc)
 MARK_VISIBLE (ksba_calloc)
 MARK_VISIBLE (ksba_realloc)
@@ -434,6 +545,9 @@ MARK_VISIBLE (ksba_cert_get_cert_policies)
 MARK_VISIBLE (ksba_cert_get_crl_dist_point)
 MARK_VISIBLE (ksba_cert_get_digest_algo)
 MARK_VISIBLE (ksba_cert_get_ext_key_usages)
+MARK_VISIBLE (ksba_cert_iter_cert_policies)
+MARK_VISIBLE (ksba_cert_iter_ext_key_usages)
+MARK_VISIBLE (ksba_oid_iter_next)
 MARK_VISIBLE (ksba_cert_get_extension)
 MARK_VISIBLE (ksba_cert_get_image)
 MARK_VISIBLE (ksba_cert_get_issuer)
@@ -443,19 +557,42 @@ MARK_VISIBLE (ksba_cert_get_serial)
 MARK_VISIBLE (ksba_cert_get_sig_val)
 MARK_VISIBLE (ksba_cert_get_subject)
 MARK_VISIBLE (ksba_cert_get_validity)
+MARK_VISIBLE (ksba_cert_get_validity_epoch)
 MARK_VISIBLE (ksba_cert_hash)
+MARK_VISIBLE (ksba_cert_get_ct_tbs)
+MARK_VISIBLE (ksba_cert_hash_ct_tbs)
+MARK_VISIBLE (ksba_cert_get_fingerprint)
+MARK_VISIBLE (ksba_cert_get_quickhash)
+MARK_VISIBLE (ksba_cert_equal)
+MARK_VISIBLE (ksba_cert_get_columns)
 MARK_VISIBLE (ksba_cert_init_from_mem)
 MARK_VISIBLE (ksba_cert_is_ca)
 MARK_VISIBLE (ksba_cert_new)
+MARK_VISIBLE (ksba_cert_new_in)
 MARK_VISIBLE (ksba_cert_read_der)
 MARK_VISIBLE (ksba_cert_ref)
 MARK_VISIBLE (ksba_cert_release)
 MARK_VISIBLE (ksba_cert_get_authority_info_access)
 MARK_VISIBLE (ksba_cert_get_subject_info_access)
+MARK_VISIBLE (ksba_cert_get_alt_names)
+MARK_VISIBLE (ksba_cert_match_hostname)
 MARK_VISIBLE (ksba_cert_get_subj_key_id)
 MARK_VISIBLE (ksba_cert_set_user_data)
 MARK_VISIBLE (ksba_cert_get_user_data)
 
+MARK_VISIBLE (ksba_certindex_new)
+MARK_VISIBLE (ksba_certindex_release)
+MARK_VISIBLE (ksba_certindex_count)
+MARK_VISIBLE (ksba_certindex_add)
+MARK_VISIBLE (ksba_certindex_add_many)
+MARK_VISIBLE (ksba_certindex_find_subject)
+MARK_VISIBLE (ksba_certindex_find_issuer_serial)
+MARK_VISIBLE (ksba_certindex_find_subj_key_id)
+MARK_VISIBLE (ksba_certindex_find_auth_key_id)
+MARK_VISIBLE (ksba_certindex_find_issuer)
+MARK_VISIBLE (ksba_cert_snapshot_write)
+MARK_VISIBLE (ksba_cert_snapshot_read)
+
 MARK_VISIBLE (ksba_certreq_set_serial)
 MARK_VISIBLE (ksba_certreq_set_issuer)
 MARK_VISIBLE (ksba_certreq_set_validity)
@@ -507,6 +644,7 @@ MARK_VISIBLE (ksba_crl_get_issuer)
 MARK_VISIBLE (ksba_crl_get_item)
 MARK_VISIBLE (ksba_crl_get_sig_val)
 MARK_VISIBLE (ksba_crl_get_update_times)
+MARK_VISIBLE (ksba_crl_get_update_times_epoch)
 MARK_VISIBLE (ksba_crl_new)
 MARK_VISIBLE (ksba_crl_parse)
 MARK_VISIBLE (ksba_crl_release)
@@ -518,6 +656,8 @@ MARK_VISIBLE (ksba_crl_get_crl_number)
 
 MARK_VISIBLE (ksba_name_enum)
 MARK_VISIBLE (ksba_name_get_uri)
+MARK_VISIBLE (ksba_name_iter_init)
+MARK_VISIBLE (ksba_name_iter_next)
 MARK_VISIBLE (ksba_name_new)
 MARK_VISIBLE (ksba_name_ref)
 MARK_VISIBLE (ksba_name_release)
@@ -530,6 +670,7 @@ MARK_VISIBLE (ksba_ocsp_get_digest_algo)
 MARK_VISIBLE (ksba_ocsp_get_responder_id)
 MARK_VISIBLE (ksba_ocsp_get_sig_val)
 MARK_VISIBLE (ksba_ocsp_get_status)
+MARK_VISIBLE (ksba_ocsp_get_status_epoch)
 MARK_VISIBLE (ksba_ocsp_hash_request)
 MARK_VISIBLE (ksba_ocsp_hash_response)
 MARK_VISIBLE (ksba_ocsp_new)
@@ -558,6 +699,9 @@ MARK_VISIBLE (ksba_reader_set_cb)
 MARK_VISIBLE (ksba_reader_set_fd)
 MARK_VISIBLE (ksba_reader_set_file)
 MARK_VISIBLE (ksba_reader_set_mem)
+MARK_VISIBLE (ksba_reader_set_base64)
+MARK_VISIBLE (ksba_reader_set_mmap)
+MARK_VISIBLE (ksba_reader_open_file)
 MARK_VISIBLE (ksba_reader_tell)
 MARK_VISIBLE (ksba_reader_unread)
 
@@ -569,8 +713,16 @@ MARK_VISIBLE (ksba_writer_set_cb)
 MARK_VISIBLE (ksba_writer_set_fd)
 MARK_VISIBLE (ksba_writer_set_file)
 MARK_VISIBLE (ksba_writer_set_filter)
+MARK_VISIBLE (ksba_writer_add_filter)
+MARK_VISIBLE (ksba_writer_set_filter_ring)
+MARK_VISIBLE (ksba_writer_add_base64)
 MARK_VISIBLE (ksba_writer_set_mem)
 MARK_VISIBLE (ksba_writer_snatch_mem)
+MARK_VISIBLE (ksba_writer_set_mem_chunked)
+MARK_VISIBLE (ksba_writer_get_mem_iov)
+MARK_VISIBLE (ksba_writer_set_buffer)
+MARK_VISIBLE (ksba_writer_flush)
+MARK_VISIBLE (ksba_writer_writev)
 MARK_VISIBLE (ksba_writer_tell)
 MARK_VISIBLE (ksba_writer_write)
 MARK_VISIBLE (ksba_writer_write_octet_string)
@@ -586,7 +738,11 @@ MARK_VISIBLE (ksba_der_add_bts)
 MARK_VISIBLE (ksba_der_add_der)
 MARK_VISIBLE (ksba_der_add_tag)
 MARK_VISIBLE (ksba_der_add_end)
+MARK_VISIBLE (ksba_der_add_slot)
+MARK_VISIBLE (ksba_der_set_slot)
 MARK_VISIBLE (ksba_der_builder_get)
+MARK_VISIBLE (ksba_der_builder_write)
+MARK_VISIBLE (ksba_der_builder_get_iov)
 
 
 #  undef MARK_VISIBLE
@@ -34,6 +34,14 @@
 #include <string.h>
 #include <assert.h>
 #include <errno.h>
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif
+#ifdef HAVE_SYS_UIO_H
+# include <sys/uio.h>
+#endif
+#define STATS_MODULE KSBA_STATS_MOD_IO
+
 #include "util.h"
 
 #include "ksba.h"
@@ -41,6 +49,40 @@
 #include "asn1-func.h"
 #include "ber-help.h"
 
+static gpg_error_t flush_buffer (ksba_writer_t w);
+
+/* Release the list of chunks starting at CHUNK.  */
+static void
+release_chunks (struct writer_chunk_s *chunk)
+{
+  struct writer_chunk_s *tmp;
+
+  for (; chunk; chunk = tmp)
+    {
+      tmp = chunk->next;
+      xfree (chunk);
+    }
+}
+
+
+/* Release all filters of W.  */
+static void
+release_filters (ksba_writer_t w)
+{
+  int i;
+
+  for (i=0; i < w->nfilters; i++)
+    {
+      xfree (w->filters[i].buffer);
+      if (w->filters[i].release)
+        w->filters[i].release (w->filters[i].arg);
+    }
+  xfree (w->filters);
+  w->filters = NULL;
+  w->nfilters = 0;
+}
+
+
 /**
  * ksba_writer_new:
  *
@@ -64,13 +106,17 @@ ksba_writer_new (ksba_writer_t *r_w)
  * ksba_writer_release:
  * @w: Writer Object (or NULL)
  *
- * Release this object
+ * Release this object.  Data still held in the buffer set with
+ * ksba_writer_set_buffer is written out first; because errors can't
+ * be reported here, use ksba_writer_flush if they matter.
  **/
 void
 ksba_writer_release (ksba_writer_t w)
 {
   if (!w)
     return;
+  if (w->cbuflen)
+    flush_buffer (w);
   if (w->notify_cb)
     {
       void (*notify_fnc)(void*,ksba_writer_t) = w->notify_cb;
@@ -80,6 +126,11 @@ ksba_writer_release (ksba_writer_t w)
     }
   if (w->type == WRITER_TYPE_MEM)
     xfree (w->u.mem.buffer);
+  else if (w->type == WRITER_TYPE_CHUNKS)
+    release_chunks (w->u.chunks.first);
+  xfree (w->iov);
+  xfree (w->cbuf);
+  release_filters (w);
   xfree (w);
 }
 
@@ -230,18 +281,64 @@ ksba_writer_set_mem (ksba_writer_t w, size_t initial_size)
   return 0;
 }
 
+/* Merge all chunks of W into one so that the data can be accessed as
+   a contiguous buffer.  */
+static gpg_error_t
+flatten_chunks (ksba_writer_t w)
+{
+  struct writer_chunk_s *c, *newc;
+  size_t size;
+
+  if (w->u.chunks.first && w->u.chunks.first == w->u.chunks.cur)
+    return 0;  /* Already contiguous.  */
+
+  size = w->nwritten > w->u.chunks.chunksize? w->nwritten
+                                            : w->u.chunks.chunksize;
+  newc = xtrymalloc (sizeof *newc + size - 1);
+  if (!newc)
+    {
+      w->error = ENOMEM;
+      return gpg_error (GPG_ERR_ENOMEM);
+    }
+  newc->next = NULL;
+  newc->size = size;
+  newc->used = 0;
+  for (c = w->u.chunks.first; c; c = c->next)
+    {
+      memcpy (newc->data + newc->used, c->data, c->used);
+      newc->used += c->used;
+      if (c == w->u.chunks.cur)
+        break;
+    }
+  release_chunks (w->u.chunks.first);
+  w->u.chunks.first = w->u.chunks.cur = newc;
+  return 0;
+}
+
+
 /* Return the pointer to the memory and the size of it.  This pointer
    is valid as long as the writer object is valid and no write
    operations takes place (because they might reallocate the buffer).
    if NBYTES is not NULL, it will receive the number of bytes in this
-   buffer which is the same value ksba_writer_tell() returns.
+   buffer which is the same value ksba_writer_tell() returns.  For a
+   chunked memory writer the chunks are merged into one buffer first.
 
    In case of an error NULL is returned.
   */
 const void *
 ksba_writer_get_mem (ksba_writer_t w, size_t *nbytes)
 {
-  if (!w || w->type != WRITER_TYPE_MEM || w->error)
+  if (!w || w->error)
+    return NULL;
+  if (w->type == WRITER_TYPE_CHUNKS)
+    {
+      if (flatten_chunks (w))
+        return NULL;
+      if (nbytes)
+        *nbytes = w->nwritten;
+      return w->u.chunks.first->data;
+    }
+  if (w->type != WRITER_TYPE_MEM)
     return NULL;
   if (nbytes)
     *nbytes = w->nwritten;
@@ -260,19 +357,389 @@ ksba_writer_snatch_mem (ksba_writer_t w, size_t *nbytes)
 {
   void *p;
 
-  if (!w || w->type != WRITER_TYPE_MEM || w->error)
+  if (!w || w->error)
+    return NULL;
+  if (w->type == WRITER_TYPE_CHUNKS)
+    {
+      struct writer_chunk_s *c;
+      unsigned char *dst;
+
+      /* The chunks can't be passed to the caller; thus we need to
+         copy them into a new buffer.  */
+      p = dst = xtrymalloc (w->nwritten? w->nwritten : 1);
+      if (!p)
+        return NULL;
+      for (c = w->u.chunks.first; c; c = c->next)
+        {
+          memcpy (dst, c->data, c->used);
+          dst += c->used;
+          if (c == w->u.chunks.cur)
+            break;
+        }
+      release_chunks (w->u.chunks.first);
+      w->u.chunks.first = w->u.chunks.cur = NULL;
+    }
+  else if (w->type == WRITER_TYPE_MEM)
+    {
+      p = w->u.mem.buffer;
+      w->u.mem.buffer = NULL;
+    }
+  else
     return NULL;
   if (nbytes)
     *nbytes = w->nwritten;
-  p = w->u.mem.buffer;
-  w->u.mem.buffer = NULL;
   w->type = 0;
   w->nwritten = 0;
   return p;
 }
 
 
+/* Initialize the writer object W to write into a list of memory
+   chunks of CHUNK_SIZE bytes each; if CHUNK_SIZE is 0 a default size
+   is used.  In contrast to ksba_writer_set_mem the data is never
+   moved once written; this is useful for large objects which can then
+   be retrieved without copying using ksba_writer_get_mem_iov.  If W
+   is already a chunked memory writer its chunks are kept for reuse
+   and the written data is discarded.  */
+gpg_error_t
+ksba_writer_set_mem_chunked (ksba_writer_t w, size_t chunk_size)
+{
+  struct writer_chunk_s *c;
+
+  if (!w)
+    return gpg_error (GPG_ERR_INV_VALUE);
+  if (w->type == WRITER_TYPE_CHUNKS)
+    {
+      for (c = w->u.chunks.first; c; c = c->next)
+        c->used = 0;
+      w->u.chunks.cur = w->u.chunks.first;
+    }
+  else
+    {
+      if (w->type)
+        return gpg_error (GPG_ERR_CONFLICT);
+
+      w->u.chunks.first = w->u.chunks.cur = NULL;
+      w->u.chunks.chunksize = chunk_size? chunk_size : 65536;
+      w->type = WRITER_TYPE_CHUNKS;
+    }
+  w->error = 0;
+  w->nwritten = 0;
+
+  return 0;
+}
+
+
+/* Return the data written to the memory writer W as an array of
+   segments at R_IOV with the number of segments stored at R_NIOV.
+   For a writer initialized with ksba_writer_set_mem_chunked there is
+   one segment per chunk and nothing is copied.  The returned array
+   and the memory it describes are valid until the next write
+   operation or the release of W.  */
+gpg_error_t
+ksba_writer_get_mem_iov (ksba_writer_t w,
+                         const ksba_iov_t **r_iov, size_t *r_niov)
+{
+  struct writer_chunk_s *c;
+  size_t n;
+
+  if (!w || !r_iov || !r_niov)
+    return gpg_error (GPG_ERR_INV_VALUE);
+  *r_iov = NULL;
+  *r_niov = 0;
+  if (w->type != WRITER_TYPE_MEM && w->type != WRITER_TYPE_CHUNKS)
+    return gpg_error (GPG_ERR_CONFLICT);
+  if (w->error)
+    return gpg_error_from_errno (w->error);
+
+  if (w->type == WRITER_TYPE_MEM)
+    n = 1;
+  else
+    {
+      n = 0;
+      for (c = w->u.chunks.first; c; c = c->next)
+        {
+          n++;
+          if (c == w->u.chunks.cur)
+            break;
+        }
+    }
+
+  if (n > w->iovsize)
+    {
+      ksba_iov_t *tmp;
+
+      tmp = xtryrealloc (w->iov, n * sizeof *tmp);
+      if (!tmp)
+        return gpg_error_from_syserror ();
+      w->iov = tmp;
+      w->iovsize = n;
+    }
+
+  if (w->type == WRITER_TYPE_MEM)
+    {
+      w->iov[0].data = w->u.mem.buffer;
+      w->iov[0].len = w->nwritten;
+    }
+  else
+    {
+      n = 0;
+      for (c = w->u.chunks.first; c; c = c->next)
+        {
+          w->iov[n].data = c->data;
+          w->iov[n].len = c->used;
+          n++;
+          if (c == w->u.chunks.cur)
+            break;
+        }
+    }
+
+  *r_iov = w->iov;
+  *r_niov = n;
+  return 0;
+}
+
+
 
+/* Write all NIOV segments of IOV to the file descriptor of W.  Up to
+   16 segments are passed to the system with one call.  */
+static gpg_error_t
+fd_writev (ksba_writer_t w, const ksba_iov_t *iov, size_t niov)
+{
+  size_t idx = 0;  /* The current segment.  */
+  size_t off = 0;  /* The offset into the current segment.  */
+  ssize_t n;
+
+  while (idx < niov)
+    {
+      if (off == iov[idx].len)
+        {
+          idx++;
+          off = 0;
+          continue;
+        }
+#ifdef HAVE_WRITEV
+      {
+        struct iovec vec[16];
+        int nvec;
+
+        for (nvec=0; nvec < DIM (vec) && idx + nvec < niov; nvec++)
+          {
+            vec[nvec].iov_base = (char*)iov[idx+nvec].data + (nvec? 0:off);
+            vec[nvec].iov_len = iov[idx+nvec].len - (nvec? 0:off);
+          }
+        do
+          n = writev (w->u.fd, vec, nvec);
+        while (n == -1 && errno == EINTR);
+      }
+#else /*!HAVE_WRITEV*/
+      do
+        n = write (w->u.fd, (const char*)iov[idx].data + off,
+                   iov[idx].len - off);
+      while (n == -1 && errno == EINTR);
+#endif /*!HAVE_WRITEV*/
+      if (n == -1)
+        {
+          w->error = errno;
+          return gpg_error_from_errno (w->error);
+        }
+      if (!n)
+        {
+          /* Nothing written although data was pending; don't loop
+             forever.  */
+          w->error = EIO;
+          return gpg_error (GPG_ERR_EIO);
+        }
+
+      /* Skip the written bytes.  */
+      while (n)
+        {
+          if ((size_t)n < iov[idx].len - off)
+            {
+              off += n;
+              n = 0;
+            }
+          else
+            {
+              n -= iov[idx].len - off;
+              idx++;
+              off = 0;
+            }
+        }
+    }
+
+  return 0;
+}
+
+
+/* Pass the NIOV segments of IOV to the FD, FILE or CB writer W
+   without any buffering.  */
+static gpg_error_t
+sink_writev (ksba_writer_t w, const ksba_iov_t *iov, size_t niov)
+{
+  size_t i;
+
+  if (w->type == WRITER_TYPE_FD)
+    return fd_writev (w, iov, niov);
+
+  for (i=0; i < niov; i++)
+    {
+      if (!iov[i].len)
+        continue;
+      if (w->type == WRITER_TYPE_FILE)
+        {
+          if (fwrite (iov[i].data, iov[i].len, 1, w->u.file) != 1)
+            {
+              w->error = errno;
+              return gpg_error_from_errno (w->error);
+            }
+        }
+      else if (w->type == WRITER_TYPE_CB)
+        {
+          int err = w->u.cb.fnc (w->u.cb.value, iov[i].data, iov[i].len);
+          if (err)
+            return err;
+        }
+      else
+        return gpg_error (GPG_ERR_BUG);
+    }
+
+  return 0;
+}
+
+
+/* Write the NIOV segments of IOV to the FD, FILE or CB writer W
+   using the coalescing buffer.  Segments shorter than half of the
+   buffer are copied to the buffer; longer ones are passed to the
+   sink directly, together with the buffered data preceding them, so
+   that for a file descriptor a header and its payload end up in one
+   system call.  Buffered data is kept until the buffer is full or a
+   long segment needs to be written.  */
+static gpg_error_t
+buffered_writev (ksba_writer_t w, const ksba_iov_t *iov, size_t niov)
+{
+  ksba_iov_t out[16];
+  size_t nout = 0;
+  size_t segstart = 0;  /* Start of the buffered data not yet in OUT.  */
+  size_t i, len;
+  int small;
+  gpg_error_t err = 0;
+
+  for (i=0; i < niov; i++)
+    {
+      len = iov[i].len;
+      if (!len)
+        continue;
+      small = len < w->cbufsize / 2;
+
+      /* A long segment takes up to two slots (the buffered data
+         before it and the segment itself) and a later flush one more
+         for the remaining buffered data.  */
+      if (small? len > w->cbufsize - w->cbuflen : nout + 3 > DIM (out))
+        {
+          if (w->cbuflen > segstart)
+            {
+              out[nout].data = w->cbuf + segstart;
+              out[nout].len = w->cbuflen - segstart;
+              nout++;
+            }
+          err = sink_writev (w, out, nout);
+          nout = 0;
+          w->cbuflen = segstart = 0;
+          if (err)
+            return err;
+        }
+
+      if (small)
+        {
+          memcpy (w->cbuf + w->cbuflen, iov[i].data, len);
+          w->cbuflen += len;
+        }
+      else
+        {
+          if (w->cbuflen > segstart)
+            {
+              out[nout].data = w->cbuf + segstart;
+              out[nout].len = w->cbuflen - segstart;
+              nout++;
+              segstart = w->cbuflen;
+            }
+          out[nout++] = iov[i];
+        }
+    }
+
+  if (nout)
+    {
+      if (w->cbuflen > segstart)
+        {
+          out[nout].data = w->cbuf + segstart;
+          out[nout].len = w->cbuflen - segstart;
+          nout++;
+        }
+      err = sink_writev (w, out, nout);
+      w->cbuflen = 0;
+    }
+
+  return err;
+}
+
+
+/* Write out the data pending in the coalescing buffer of W.  */
+static gpg_error_t
+flush_buffer (ksba_writer_t w)
+{
+  ksba_iov_t iov;
+
+  if (!w->cbuflen)
+    return 0;
+
+  iov.data = w->cbuf;
+  iov.len = w->cbuflen;
+  w->cbuflen = 0;
+  return sink_writev (w, &iov, 1);
+}
+
+
+/* Let the FD, FILE or callback writer W collect small writes in a
+   buffer of SIZE bytes and pass them on in larger blocks; if SIZE is
+   0 a default size is used.  This is useful because the BER encoder
+   writes each tag and length as a separate item.  The pending data
+   must be written out with ksba_writer_flush before the underlying
+   file or stream is closed; ksba_writer_release writes it out as
+   well but can't report errors.  */
+gpg_error_t
+ksba_writer_set_buffer (ksba_writer_t w, size_t size)
+{
+  gpg_error_t err;
+
+  if (!w)
+    return gpg_error (GPG_ERR_INV_VALUE);
+  if (w->type != WRITER_TYPE_FD && w->type != WRITER_TYPE_FILE
+      && w->type != WRITER_TYPE_CB)
+    return gpg_error (GPG_ERR_CONFLICT);
+
+  err = flush_buffer (w);
+  if (err)
+    return err;
+
+  if (!size)
+    size = 8192;
+  if (size != w->cbufsize)
+    {
+      xfree (w->cbuf);
+      w->cbufsize = 0;
+      w->cbuf = xtrymalloc (size);
+      if (!w->cbuf)
+        return gpg_error_from_syserror ();
+      w->cbufsize = size;
+    }
+
+  return 0;
+}
+
+
+/* Replace all filters of W by FILTER; if FILTER is NULL all filters
+   are removed.  See ksba_writer_add_filter for details.  */
 gpg_error_t
 ksba_writer_set_filter (ksba_writer_t w,
                         gpg_error_t (*filter)(void*,
@@ -283,14 +750,343 @@ ksba_writer_set_filter (ksba_writer_t w,
   if (!w)
     return gpg_error (GPG_ERR_INV_VALUE);
 
-  w->filter = filter;
-  w->filter_arg = filter_arg;
+  release_filters (w);
+  if (!filter)
+    return 0;
+  return ksba_writer_add_filter (w, filter, filter_arg, 4096, 0);
+}
+
+
+/* Append FILTER to the chain of filters of W.  The data written to W
+   passes all filters in the order they have been added before it is
+   written out.  FILTER is called as
+
+     err = filter (FILTER_ARG, INBUF, INLEN, &NIN, OUTBUF, OUTSIZE, &NOUT)
+
+   and is expected to consume NIN bytes of INBUF and to store NOUT
+   bytes into OUTBUF.  OUTBUF has a size of BLOCKSIZE bytes; if
+   BLOCKSIZE is 0 a default size is used.  FLAGS may have these bits
+   set:
+
+   KSBA_FILTER_INPLACE - The filter produces as many bytes as it
+       consumes and may be called with OUTBUF being the same as
+       INBUF.  The output of the previous filter is then transformed
+       without another copy and no buffer is allocated for FILTER.
+
+   KSBA_FILTER_FLUSH - The filter wants to be called with INLEN
+       given as 0 by ksba_writer_flush so that it can emit pending
+       output.  It is called again until it returns no output.
+ */
+gpg_error_t
+ksba_writer_add_filter (ksba_writer_t w,
+                        gpg_error_t (*filter)(void*,
+                                            const void *,size_t, size_t *,
+                                            void *, size_t, size_t *),
+                        void *filter_arg,
+                        size_t blocksize, unsigned int flags)
+{
+  struct writer_filter_s *tmp, *f;
+
+  if (!w || !filter)
+    return gpg_error (GPG_ERR_INV_VALUE);
+  if ((flags & ~(KSBA_FILTER_INPLACE|KSBA_FILTER_FLUSH)))
+    return gpg_error (GPG_ERR_INV_FLAG);
+
+  tmp = xtryrealloc (w->filters, (w->nfilters + 1) * sizeof *tmp);
+  if (!tmp)
+    return gpg_error_from_syserror ();
+  w->filters = tmp;
+  f = w->filters + w->nfilters;
+  f->fnc = filter;
+  f->arg = filter_arg;
+  f->flags = flags;
+  f->bufsize = blocksize? blocksize : 16384;
+  f->buffer = NULL;
+  f->nbuffers = 1;
+  f->curbuf = 0;
+  f->release = NULL;
+
+  /* The first filter gets the caller's data which it may not modify;
+     thus it always needs a buffer.  */
+  if (!(flags & KSBA_FILTER_INPLACE) || !w->nfilters)
+    {
+      f->buffer = xtrymalloc (f->bufsize);
+      if (!f->buffer)
+        return gpg_error_from_syserror ();
+    }
+  w->nfilters++;
+
+  return 0;
+}
+
+
+/* Let the last filter of W which has an output buffer use a ring of
+   NBUFFERS buffers.  Each block of output is then stored in the next
+   buffer of the ring and stays valid until the filter has produced
+   NBUFFERS - 1 more blocks.  A callback writer may thus hand the
+   blocks to another thread for output without copying them, so that
+   the output of one block overlaps the filtering of the next.  The
+   callback needs to wait for that thread when it falls behind by
+   NBUFFERS - 1 blocks.  */
+gpg_error_t
+ksba_writer_set_filter_ring (ksba_writer_t w, int nbuffers)
+{
+  struct writer_filter_s *f;
+  unsigned char *p;
+  int i;
+
+  if (!w || nbuffers < 1 || nbuffers > 256)
+    return gpg_error (GPG_ERR_INV_VALUE);
+
+  for (i = w->nfilters - 1; i >= 0 && !w->filters[i].buffer; i--)
+    ;
+  if (i < 0)
+    return gpg_error (GPG_ERR_NO_DATA);  /* No filter.  */
+  f = w->filters + i;
+
+  p = xtryrealloc (f->buffer, nbuffers * f->bufsize);
+  if (!p)
+    return gpg_error_from_syserror ();
+  f->buffer = p;
+  f->nbuffers = nbuffers;
+  f->curbuf = 0;
+
   return 0;
 }
 
 
+/* The state of the base64 filter.  */
+struct base64_filter_s
+{
+  char *label;            /* The PEM label or NULL.  */
+  unsigned int linelen;
+  const char *eol;
+  size_t eollen;
+  int started;            /* Data has been written since the last flush.  */
+  unsigned int col;       /* Characters in the current line.  */
+  unsigned char pending[3]; /* Input bytes not yet encoded.  */
+  int npending;
+};
+
+static const char bintoasc[64] =
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+
+/* Encode the NBYTES (1 to 3) bytes at S to D with padding and return
+   the new value of D.  */
+static char *
+encode_group (char *d, const unsigned char *s, int nbytes)
+{
+  unsigned int quad;
+
+  quad = s[0] << 16;
+  if (nbytes > 1)
+    quad |= s[1] << 8;
+  if (nbytes > 2)
+    quad |= s[2];
+  d[0] = bintoasc[(quad >> 18) & 63];
+  d[1] = bintoasc[(quad >> 12) & 63];
+  d[2] = nbytes > 1? bintoasc[(quad >> 6) & 63] : '=';
+  d[3] = nbytes > 2? bintoasc[quad & 63] : '=';
+  return d + 4;
+}
+
+
+/* Write a PEM armor line of type WHAT for B to D.  */
+static char *
+pem_line (struct base64_filter_s *b, char *d, const char *what)
+{
+  d = stpcpy (d, "-----");
+  d = stpcpy (d, what);
+  d = stpcpy (d, b->label);
+  d = stpcpy (d, "-----");
+  return stpcpy (d, b->eol);
+}
+
+
+/* The filter function used by ksba_writer_add_base64.  */
+static gpg_error_t
+base64_filter (void *opaque, const void *inbuf, size_t inlen, size_t *nin,
+               void *outbuf, size_t outsize, size_t *nout)
+{
+  struct base64_filter_s *b = opaque;
+  const unsigned char *s = inbuf;
+  const unsigned char *send = s + inlen;
+  char *d = outbuf;
+  char *dend = d + outsize;
+  size_t armorlen, n;
+  unsigned int c;
+
+  *nin = *nout = 0;
+  armorlen = b->label? 5 + 9 + strlen (b->label) + 5 + b->eollen : 0;
+
+  if (!inlen)
+    {
+      /* Flush.  */
+      if (!b->started)
+        return 0;
+      if (outsize < armorlen + 4 + b->eollen)
+        return gpg_error (GPG_ERR_BUFFER_TOO_SHORT);
+      if (b->npending)
+        {
+          d = encode_group (d, b->pending, b->npending);
+          b->col += 4;
+          b->npending = 0;
+        }
+      if (b->col)
+        d = stpcpy (d, b->eol);
+      if (b->label)
+        d = pem_line (b, d, "END ");
+      b->col = 0;
+      b->started = 0;
+      *nout = d - (char*)outbuf;
+      return 0;
+    }
+
+  if (outsize < armorlen + 4 + b->eollen)
+    return gpg_error (GPG_ERR_BUFFER_TOO_SHORT);
+  if (!b->started)
+    {
+      if (b->label)
+        d = pem_line (b, d, "BEGIN ");
+      b->started = 1;
+    }
+
+  /* Complete a pending group.  */
+  if (b->npending)
+    {
+      while (b->npending < 3 && s < send)
+        b->pending[b->npending++] = *s++;
+      if (b->npending < 3)
+        goto leave;
+      d = encode_group (d, b->pending, 3);
+      b->npending = 0;
+      if ((b->col += 4) >= b->linelen)
+        {
+          d = stpcpy (d, b->eol);
+          b->col = 0;
+        }
+    }
+
+  for (;;)
+    {
+      /* Encode whole lines as long as they fit.  */
+      while (!b->col && send - s >= b->linelen / 4 * 3
+             && dend - d >= b->linelen + b->eollen)
+        {
+          for (n = b->linelen / 4; n; n--, s += 3, d += 4)
+            {
+              c = (s[0] << 16) | (s[1] << 8) | s[2];
+              d[0] = bintoasc[c >> 18];
+              d[1] = bintoasc[(c >> 12) & 63];
+              d[2] = bintoasc[(c >> 6) & 63];
+              d[3] = bintoasc[c & 63];
+            }
+          memcpy (d, b->eol, b->eollen);
+          d += b->eollen;
+        }
+
+      if (send - s < 3 || dend - d < 4 + b->eollen)
+        break;
+      d = encode_group (d, s, 3);
+      s += 3;
+      if ((b->col += 4) >= b->linelen)
+        {
+          d = stpcpy (d, b->eol);
+          b->col = 0;
+        }
+    }
+
+  /* Keep a rest of less than 3 bytes.  */
+  if (send - s < 3)
+    while (s < send)
+      b->pending[b->npending++] = *s++;
+
+ leave:
+  *nin = s - (const unsigned char*)inbuf;
+  *nout = d - (char*)outbuf;
+  return 0;
+}
+
+
+static void
+release_base64_filter (void *opaque)
+{
+  struct base64_filter_s *b = opaque;
+
+  if (b)
+    {
+      xfree (b->label);
+      xfree (b);
+    }
+}
+
+
+/* Append a filter to W which encodes the data in base64 with lines
+   of LINELEN characters; LINELEN must be a multiple of 4 and defaults
+   to 64.  If LABEL is not NULL the data is enclosed in PEM armor
+   lines using LABEL, for example "CERTIFICATE".  Lines are
+   terminated by LF or, with KSBA_BASE64_CRLF in FLAGS, by CR,LF.
+   The last partial group and the end line are written by
+   ksba_writer_flush; data written after that starts a new PEM
+   object.  */
+gpg_error_t
+ksba_writer_add_base64 (ksba_writer_t w, const char *label,
+                        unsigned int linelen, unsigned int flags)
+{
+  gpg_error_t err;
+  struct base64_filter_s *b;
+
+  if (!w || (linelen % 4) || (label && strlen (label) > 100))
+    return gpg_error (GPG_ERR_INV_VALUE);
+  if ((flags & ~KSBA_BASE64_CRLF))
+    return gpg_error (GPG_ERR_INV_FLAG);
+
+  b = xtrycalloc (1, sizeof *b);
+  if (!b)
+    return gpg_error_from_syserror ();
+  if (label)
+    {
+      b->label = xtrystrdup (label);
+      if (!b->label)
+        {
+          err = gpg_error_from_syserror ();
+          xfree (b);
+          return err;
+        }
+    }
+  b->linelen = linelen? linelen : 64;
+  b->eol = (flags & KSBA_BASE64_CRLF)? "\r\n" : "\n";
+  b->eollen = strlen (b->eol);
+
+  err = ksba_writer_add_filter (w, base64_filter, b, 0, KSBA_FILTER_FLUSH);
+  if (err)
+    {
+      release_base64_filter (b);
+      return err;
+    }
+  w->filters[w->nfilters-1].release = release_base64_filter;
+  return 0;
+}
+
+
+/* Return the output buffer for the next block of the filter F.  */
+static unsigned char *
+next_outbuf (struct writer_filter_s *f)
+{
+  unsigned char *p = f->buffer + f->curbuf * f->bufsize;
+
+  if (++f->curbuf == f->nbuffers)
+    f->curbuf = 0;
+  return p;
+}
+
+
 
 
+static gpg_error_t do_writer_writev (ksba_writer_t w,
+                                     const ksba_iov_t *iov, size_t niov);
+
 static gpg_error_t
 do_writer_write (ksba_writer_t w, const void *buffer, size_t length)
 {
@@ -309,11 +1105,11 @@ do_writer_write (ksba_writer_t w, const void *buffer, size_t length)
           size_t newsize = w->nwritten + length;
           char *p;
 
+          /* Grow the buffer geometrically so that the number of
+             copies stays linear in the size of the object.  */
+          if (newsize < 2 * w->u.mem.size)
+            newsize = 2 * w->u.mem.size;
           newsize = ((newsize + 4095)/4096)*4096;
-          if (newsize < 16384)
-            newsize += 4096;
-          else
-            newsize += 16384;
 
           p = xtryrealloc (w->u.mem.buffer, newsize);
           if (!p)
@@ -334,34 +1130,148 @@ do_writer_write (ksba_writer_t w, const void *buffer, size_t length)
       memcpy (w->u.mem.buffer + w->nwritten, buffer, length);
       w->nwritten += length;
     }
-  else if (w->type == WRITER_TYPE_FILE)
+  else if (w->type == WRITER_TYPE_CHUNKS)
     {
-      if (!length)
-        return 0;
+      struct writer_chunk_s *c = w->u.chunks.cur;
+      const unsigned char *p = buffer;
+      size_t n;
 
-      if ( fwrite (buffer, length, 1, w->u.file) == 1)
+      if (w->error == ENOMEM)
+        return gpg_error (GPG_ERR_ENOMEM);
+
+      while (length)
         {
-          w->nwritten += length;
+          if (!c || c->used == c->size)
+            {
+              if (c && c->next)
+                c = c->next;  /* Reuse a chunk.  */
+              else
+                {
+                  struct writer_chunk_s *newc;
+
+                  newc = xtrymalloc (sizeof *newc
+                                     + w->u.chunks.chunksize - 1);
+                  if (!newc)
+                    {
+                      w->error = ENOMEM;
+                      return gpg_error (GPG_ERR_ENOMEM);
+                    }
+                  newc->next = NULL;
+                  newc->size = w->u.chunks.chunksize;
+                  newc->used = 0;
+                  if (c)
+                    c->next = newc;
+                  else
+                    w->u.chunks.first = newc;
+                  c = newc;
+                }
+              w->u.chunks.cur = c;
+            }
+          n = c->size - c->used;
+          if (n > length)
+            n = length;
+          memcpy (c->data + c->used, p, n);
+          c->used += n;
+          p += n;
+          length -= n;
+          w->nwritten += n;
         }
+    }
+  else if (w->type == WRITER_TYPE_FD || w->type == WRITER_TYPE_FILE
+           || w->type == WRITER_TYPE_CB)
+    {
+      ksba_iov_t iov;
+
+      iov.data = buffer;
+      iov.len = length;
+      return do_writer_writev (w, &iov, 1);
+    }
+  else
+    return gpg_error (GPG_ERR_BUG);
+
+  return 0;
+}
+
+
+static gpg_error_t
+do_writer_writev (ksba_writer_t w, const ksba_iov_t *iov, size_t niov)
+{
+  gpg_error_t err;
+  size_t i;
+
+  if (w->type == WRITER_TYPE_FD || w->type == WRITER_TYPE_FILE
+      || w->type == WRITER_TYPE_CB)
+    {
+      if (w->cbuf)
+        err = buffered_writev (w, iov, niov);
       else
-        {
-          w->error = errno;
-          return gpg_error_from_errno (errno);
-        }
+        err = sink_writev (w, iov, niov);
+      if (err)
+        return err;
+      for (i=0; i < niov; i++)
+        w->nwritten += iov[i].len;
+      return 0;
     }
-  else if (w->type == WRITER_TYPE_CB)
+
+  for (i=0; i < niov; i++)
     {
-      int err = w->u.cb.fnc (w->u.cb.value, buffer, length);
+      err = do_writer_write (w, iov[i].data, iov[i].len);
       if (err)
         return err;
-      w->nwritten += length;
     }
-  else
-    return gpg_error (GPG_ERR_BUG);
+  return 0;
+}
+
+/* Pass LENGTH bytes of BUFFER through the filter STAGE and all
+   following filters of W.  For all stages but the first BUFFER is the
+   output buffer of the previous filter and thus may be modified.  */
+static gpg_error_t
+filter_write (ksba_writer_t w, int stage, const void *buffer, size_t length)
+{
+  struct writer_filter_s *f;
+  gpg_error_t err;
+  size_t nin, nout;
+  const unsigned char *p = buffer;
+
+  if (stage == w->nfilters)
+    return do_writer_write (w, buffer, length);
+
+  f = w->filters + stage;
+  while (length)
+    {
+      if (!f->buffer)
+        {
+          /* Transform the data in place.  */
+          err = f->fnc (f->arg, p, length, &nin,
+                        (unsigned char*)p, length, &nout);
+          if (err)
+            return err;
+          if (!nin || nin > length || nout != nin)
+            return gpg_error (GPG_ERR_BUG);
+          err = filter_write (w, stage+1, p, nout);
+        }
+      else
+        {
+          unsigned char *outbuf = f->buffer + f->curbuf * f->bufsize;
+
+          err = f->fnc (f->arg, p, length, &nin,
+                        outbuf, f->bufsize, &nout);
+          if (err)
+            return err;
+          if (nin > length || nout > f->bufsize || (!nin && !nout))
+            return gpg_error (GPG_ERR_BUG); /* tsss, someone else made an error */
+          err = nout? filter_write (w, stage+1, next_outbuf (f), nout) : 0;
+        }
+      if (err)
+        return err;
+      length -= nin;
+      p += nin;
+    }
 
   return 0;
 }
 
+
 /**
  * ksba_writer_write:
  * @w: Writer object
@@ -383,35 +1293,81 @@ ksba_writer_write (ksba_writer_t w, const void *buffer, size_t length)
   if (!buffer)
       return gpg_error (GPG_ERR_NOT_IMPLEMENTED);
 
-  if (w->filter)
+  if (w->nfilters)
+    err = filter_write (w, 0, buffer, length);
+  else
+    err = do_writer_write (w, buffer, length);
+
+  return err;
+}
+
+
+/* Write the NIOV segments described by IOV to W.  This has the same
+   effect as calling ksba_writer_write for each segment but a file
+   descriptor writer passes all segments to the system in one call.  */
+gpg_error_t
+ksba_writer_writev (ksba_writer_t w, const ksba_iov_t *iov, size_t niov)
+{
+  gpg_error_t err = 0;
+  size_t i;
+
+  if (!w || (niov && !iov))
+    return gpg_error (GPG_ERR_INV_VALUE);
+
+  if (w->nfilters)
     {
-      char outbuf[4096];
-      size_t nin, nout;
-      const char *p = buffer;
+      for (i=0; i < niov && !err; i++)
+        if (iov[i].len)
+          err = ksba_writer_write (w, iov[i].data, iov[i].len);
+    }
+  else
+    err = do_writer_writev (w, iov, niov);
 
-      while (length)
+  return err;
+}
+
+/* Write out all pending data of W.  Filters which asked for it with
+   KSBA_FILTER_FLUSH are called to emit their buffered output and the
+   buffer set with ksba_writer_set_buffer is written out.  Note that
+   for a FILE writer this does not flush the stdio stream.  */
+gpg_error_t
+ksba_writer_flush (ksba_writer_t w)
+{
+  gpg_error_t err;
+  struct writer_filter_s *f;
+  size_t nin, nout;
+  int stage;
+
+  if (!w)
+    return gpg_error (GPG_ERR_INV_VALUE);
+
+  for (stage=0; stage < w->nfilters; stage++)
+    {
+      f = w->filters + stage;
+      if (!(f->flags & KSBA_FILTER_FLUSH) || !f->buffer)
+        continue;
+      do
         {
-          err = w->filter (w->filter_arg, p, length, &nin,
-                           outbuf, sizeof (outbuf), &nout);
+          err = f->fnc (f->arg, NULL, 0, &nin,
+                        f->buffer + f->curbuf * f->bufsize, f->bufsize, &nout);
           if (err)
-            break;
-          if (nin > length || nout > sizeof (outbuf))
-            return gpg_error (GPG_ERR_BUG); /* tsss, someone else made an error */
-          err = do_writer_write (w, outbuf, nout);
-          if (err)
-            break;
-          length -= nin;
-          p += nin;
+            return err;
+          if (nin || nout > f->bufsize)
+            return gpg_error (GPG_ERR_BUG);
+          if (nout)
+            {
+              err = filter_write (w, stage+1, next_outbuf (f), nout);
+              if (err)
+                return err;
+            }
         }
-    }
-  else
-    {
-      err = do_writer_write (w, buffer, length);
+      while (nout);
     }
 
-  return err;
+  return flush_buffer (w);
 }
 
+
 /* Write LENGTH bytes of BUFFER to W while encoding it as an BER
    encoded octet string.  With FLUSH set to 1 the octet stream will be
    terminated.  If the entire octet string is available in BUFFER it
@@ -422,6 +1378,8 @@ ksba_writer_write_octet_string (ksba_writer_t w,
                                 const void *buffer, size_t length, int flush)
 {
   gpg_error_t err = 0;
+  unsigned char hdr[10];
+  ksba_iov_t iov[2];
 
   if (!w)
     return gpg_error (GPG_ERR_INV_VALUE);
@@ -437,10 +1395,13 @@ ksba_writer_write_octet_string (ksba_writer_t w,
           w->ndef_is_open = 1;
         }
 
-      err = _ksba_ber_write_tl (w, TYPE_OCTET_STRING,
-                                CLASS_UNIVERSAL, 0, length);
-      if (!err)
-        err = ksba_writer_write (w, buffer, length);
+      /* Write the header and the data in one go.  */
+      iov[0].data = hdr;
+      iov[0].len = _ksba_ber_encode_tl (hdr, TYPE_OCTET_STRING,
+                                        CLASS_UNIVERSAL, 0, length);
+      iov[1].data = buffer;
+      iov[1].len = length;
+      err = ksba_writer_writev (w, iov, 2);
     }
 
   if (!err && flush && w->ndef_is_open) /* write an end tag */
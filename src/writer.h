@@ -38,7 +38,36 @@ enum writer_type {
   WRITER_TYPE_FD,
   WRITER_TYPE_FILE,
   WRITER_TYPE_CB,
-  WRITER_TYPE_MEM
+  WRITER_TYPE_MEM,
+  WRITER_TYPE_CHUNKS
+};
+
+
+/* A chunk of memory as used by WRITER_TYPE_CHUNKS.  */
+struct writer_chunk_s
+{
+  struct writer_chunk_s *next;
+  size_t size;                   /* Allocated size of DATA.  */
+  size_t used;                   /* Used size of DATA.  */
+  unsigned char data[1];
+};
+
+
+/* A filter stage as added by ksba_writer_add_filter.  */
+struct writer_filter_s
+{
+  gpg_error_t (*fnc)(void*,
+                     const void *,size_t, size_t *,
+                     void *, size_t, size_t *);
+  void *arg;
+  unsigned int flags;
+  size_t bufsize;
+  unsigned char *buffer;  /* The output buffers; NULL if the filter
+                             works in place.  */
+  int nbuffers;           /* Number of buffers of BUFSIZE in BUFFER
+                             which are used as a ring.  */
+  int curbuf;             /* Index of the buffer to use next.  */
+  void (*release)(void*); /* If not NULL called to release ARG.  */
 };
 
 
@@ -48,10 +77,9 @@ struct ksba_writer_s {
   enum writer_type type;
   int ndef_is_open;
 
-  gpg_error_t (*filter)(void*,
-                      const void *,size_t, size_t *,
-                      void *, size_t, size_t *);
-  void *filter_arg;
+  struct writer_filter_s *filters; /* The filters in the order the
+                                      data passes them.  */
+  int nfilters;
 
   union {
     int fd;  /* for WRITER_TYPE_FD */
@@ -64,7 +92,20 @@ struct ksba_writer_s {
       unsigned char *buffer;
       size_t size;
     } mem;   /* for WRITER_TYPE_MEM */
+    struct {
+      struct writer_chunk_s *first;
+      struct writer_chunk_s *cur;  /* The chunk currently written to;
+                                      the chunks following it are
+                                      unused.  */
+      size_t chunksize;
+    } chunks;   /* for WRITER_TYPE_CHUNKS */
   } u;
+  ksba_iov_t *iov;   /* Array returned by ksba_writer_get_mem_iov.  */
+  size_t iovsize;    /* Allocated number of items in IOV.  */
+  unsigned char *cbuf; /* Coalescing buffer for WRITER_TYPE_FD, _FILE
+                          and _CB as set by ksba_writer_set_buffer.  */
+  size_t cbufsize;     /* Allocated size of CBUF.  */
+  size_t cbuflen;      /* Number of bytes pending in CBUF.  */
   void (*notify_cb)(void*,ksba_writer_t);
   void *notify_cb_value;
 };
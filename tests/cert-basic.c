@@ -16,12 +16,19 @@
  * You should have received a copy of the GNU General Public License
  * along with this program; if not, see <http://www.gnu.org/licenses/>.
  */
-
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 #include <errno.h>
+#include <ctype.h>
+#include <time.h>
+#ifdef HAVE_PTHREAD
+# include <pthread.h>
+#endif
 
 #include "../src/ksba.h"
 #define _KSBA_VISIBILITY_DEFAULT /*  */
@@ -54,6 +61,7 @@
 static int quiet;
 static int verbose;
 static int errorcount;
+static ksba_certindex_t certindex;
 
 
 static void
@@ -429,6 +437,907 @@ list_extensions (ksba_cert_t cert)
 }
 
 
+/* Check that the epoch and the ISO variants of the validity agree.  */
+static void
+check_validity_epoch (ksba_cert_t cert)
+{
+  gpg_error_t err;
+  ksba_isotime_t isot, tmp;
+  ksba_epochtime_t epoch;
+  time_t atime;
+  struct tm *tp;
+  int what;
+
+  for (what=0; what < 2; what++)
+    {
+      err = ksba_cert_get_validity (cert, what, isot);
+      if (!err)
+        {
+          err = ksba_cert_get_validity_epoch (cert, what, &epoch);
+          if (!*isot && gpg_err_code (err) == GPG_ERR_NO_VALUE)
+            continue;
+          if (!*isot && !err)
+            err = gpg_error (GPG_ERR_INV_TIME);  /* Time without ISO time. */
+        }
+      if (err)
+        {
+          fprintf (stderr, "%s:%d: ksba_cert_get_validity%s failed: %s\n",
+                   __FILE__, __LINE__, what? "(notAfter)":"(notBefore)",
+                   gpg_strerror (err));
+          errorcount++;
+          continue;
+        }
+      atime = (time_t)epoch;
+      if ((ksba_epochtime_t)atime != epoch || !(tp = gmtime (&atime)))
+        continue; /* Can't be represented on this system.  */
+      strftime (tmp, sizeof tmp, "%Y%m%dT%H%M%S", tp);
+      if (strcmp (tmp, isot))
+        {
+          fprintf (stderr, "%s:%d: epoch time mismatch: %s != %s\n",
+                   __FILE__, __LINE__, tmp, isot);
+          errorcount++;
+        }
+    }
+}
+
+
+/* Check that the GeneralNames iterator sees the same names as the
+   string based ksba_cert_get_subject.  The latter returns only
+   rfc822Name, dNSName and URI entries; thus each of these iterator
+   values is compared with the next string and all other types are
+   skipped.  */
+static void
+check_alt_names (ksba_cert_t cert)
+{
+  gpg_error_t err;
+  ksba_name_iter_t iter;
+  ksba_gn_type_t type;
+  const unsigned char *value;
+  size_t valuelen, n;
+  int idx = 0;
+  char *name;
+  char prefix[40];
+
+  err = ksba_cert_get_alt_names (cert, 1, &iter);
+  if (gpg_err_code (err) == GPG_ERR_NO_DATA)
+    ;
+  else if (err)
+    {
+      fprintf (stderr, "%s:%d: ksba_cert_get_alt_names failed: %s\n",
+               __FILE__, __LINE__, gpg_strerror (err));
+      errorcount++;
+      return;
+    }
+  else
+    {
+      while (!(err = ksba_name_iter_next (&iter, &type, &value, &valuelen)))
+        {
+          if (type == KSBA_GN_RFC822_NAME)
+            strcpy (prefix, "<");
+          else if (type == KSBA_GN_DNS_NAME)
+            snprintf (prefix, sizeof prefix, "(8:dns-name%u:",
+                      (unsigned int)valuelen);
+          else if (type == KSBA_GN_URI)
+            snprintf (prefix, sizeof prefix, "(3:uri%u:",
+                      (unsigned int)valuelen);
+          else
+            continue;
+
+          name = ksba_cert_get_subject (cert, ++idx);
+          n = strlen (prefix);
+          if (!name
+              || strlen (name) != n + valuelen + 1
+              || strncmp (name, prefix, n)
+              || memcmp (name + n, value, valuelen)
+              || name[n + valuelen] != (type == KSBA_GN_RFC822_NAME? '>':')'))
+            {
+              fprintf (stderr, "%s:%d: iterator name %d does not match"
+                       " '%s'\n", __FILE__, __LINE__, idx,
+                       name? name : "[none]");
+              errorcount++;
+            }
+          ksba_free (name);
+        }
+      if (gpg_err_code (err) != GPG_ERR_EOF)
+        {
+          fprintf (stderr, "%s:%d: ksba_name_iter_next failed: %s\n",
+                   __FILE__, __LINE__, gpg_strerror (err));
+          errorcount++;
+          return;
+        }
+    }
+
+  name = ksba_cert_get_subject (cert, ++idx);
+  if (name)
+    {
+      fprintf (stderr, "%s:%d: iterator missed name '%s'\n",
+               __FILE__, __LINE__, name);
+      errorcount++;
+      ksba_free (name);
+    }
+}
+
+
+/* Check that all dNSNames of CERT match via ksba_cert_match_hostname
+   and that malformed reference names are rejected.  */
+static void
+check_match_hostname (ksba_cert_t cert)
+{
+  static const char *bad_names[] = {
+    "*.example.org", "www.*.example.org", "w*w.example.org",
+    ".example.org", "www..example.org", "example.org..", ".", "", NULL
+  };
+  gpg_error_t err;
+  ksba_name_iter_t iter;
+  ksba_gn_type_t type;
+  const unsigned char *value;
+  size_t valuelen, i;
+  char name[256];
+  int n = 0;
+
+  err = ksba_cert_get_alt_names (cert, 1, &iter);
+  while (!err && !(err = ksba_name_iter_next (&iter, &type, &value,
+                                              &valuelen)))
+    {
+      if (type != KSBA_GN_DNS_NAME || valuelen + 4 > sizeof name
+          || memchr (value, 0, valuelen))
+        continue;
+      /* Use an uppercase variant and replace a leading wildcard.  */
+      i = 0;
+      if (valuelen > 2 && value[0] == '*' && value[1] == '.')
+        {
+          /* The wildcard name itself must not match.  */
+          memcpy (name, value, valuelen);
+          name[valuelen] = 0;
+          err = ksba_cert_match_hostname (cert, name);
+          if (gpg_err_code (err) != GPG_ERR_INV_VALUE)
+            {
+              fprintf (stderr, "%s:%d: wildcard `%s' accepted as hostname\n",
+                       __FILE__, __LINE__, name);
+              errorcount++;
+            }
+          err = 0;
+          strcpy (name, "wWw");
+          i = 3;
+          value++;
+          valuelen--;
+        }
+      for (; valuelen; valuelen--)
+        name[i++] = toupper (*value++);
+      name[i] = 0;
+      err = ksba_cert_match_hostname (cert, name);
+      if (err)
+        {
+          fprintf (stderr, "%s:%d: hostname `%s' does not match: %s\n",
+                   __FILE__, __LINE__, name, gpg_strerror (err));
+          errorcount++;
+          err = 0;
+        }
+      n++;
+    }
+
+  err = ksba_cert_match_hostname (cert, "no-such-host.invalid");
+  if (gpg_err_code (err) != (n? GPG_ERR_NOT_FOUND : GPG_ERR_NO_DATA))
+    {
+      fprintf (stderr, "%s:%d: ksba_cert_match_hostname returned: %s\n",
+               __FILE__, __LINE__, gpg_strerror (err));
+      errorcount++;
+    }
+
+  for (i=0; bad_names[i]; i++)
+    {
+      err = ksba_cert_match_hostname (cert, bad_names[i]);
+      if (gpg_err_code (err) != GPG_ERR_INV_VALUE)
+        {
+          fprintf (stderr, "%s:%d: bad hostname `%s' not rejected: %s\n",
+                   __FILE__, __LINE__, bad_names[i], gpg_strerror (err));
+          errorcount++;
+        }
+    }
+}
+
+
+/* Check that the OID iterators return the same items as the string
+   based functions.  */
+static void
+check_oid_iter (ksba_cert_t cert, int policies)
+{
+  gpg_error_t err, err2;
+  ksba_oid_iter_t iter;
+  const unsigned char *der, *qual;
+  size_t derlen, quallen;
+  int crit;
+  char *string, *oid, *p;
+
+  if (policies)
+    {
+      err = ksba_cert_get_cert_policies (cert, &string);
+      err2 = ksba_cert_iter_cert_policies (cert, &iter);
+    }
+  else
+    {
+      err = ksba_cert_get_ext_key_usages (cert, &string);
+      err2 = ksba_cert_iter_ext_key_usages (cert, &iter);
+    }
+  if (err || err2)
+    {
+      if (gpg_err_code (err) != gpg_err_code (err2))
+        {
+          fprintf (stderr, "%s:%d: iterator returned: %s\n",
+                   __FILE__, __LINE__, gpg_strerror (err2));
+          errorcount++;
+        }
+      if (!err)
+        xfree (string);
+      return;
+    }
+
+  p = string;
+  while (!(err = ksba_oid_iter_next (&iter, &der, &derlen, &crit,
+                                     &qual, &quallen)))
+    {
+      oid = ksba_oid_to_str (der, derlen);
+      fail_if_err (oid? 0 : gpg_error_from_syserror ());
+      if (strncmp (p, oid, strlen (oid))
+          || strncmp (p + strlen (oid), crit? ":C:":":N:", 3)
+          || (!policies && qual))
+        {
+          fprintf (stderr, "%s:%d: iterator mismatch at `%s'\n",
+                   __FILE__, __LINE__, oid);
+          errorcount++;
+        }
+      xfree (oid);
+      p = strchr (p, '\n');
+      p = p? p + 1 : "";
+    }
+  if (gpg_err_code (err) != GPG_ERR_EOF || *p)
+    {
+      fprintf (stderr, "%s:%d: iterator did not return all items: %s\n",
+               __FILE__, __LINE__, gpg_strerror (err));
+      errorcount++;
+    }
+  xfree (string);
+}
+
+
+static gpg_error_t
+my_hash_buffer (void *arg, const char *oid,
+                const void *buffer, size_t length, size_t resultsize,
+                unsigned char *result, size_t *resultlen)
+{
+  (void)arg; /* Not used.  */
+
+  if (oid && strcmp (oid, "1.3.14.3.2.26"))
+    return gpg_error (GPG_ERR_NOT_SUPPORTED); /* We only support SHA-1. */
+  if (resultsize < 20)
+    return gpg_error (GPG_ERR_BUFFER_TOO_SHORT);
+  sha1_hash_buffer ((char*)result, buffer, length);
+  *resultlen = 20;
+  return 0;
+}
+
+
+/* Check the cached fingerprint and the equality function.  */
+static void
+check_fingerprint (ksba_cert_t cert)
+{
+  gpg_error_t err;
+  const unsigned char *image, *digest, *digest2;
+  size_t imagelen, digestlen, digestlen2;
+  unsigned char sha1[20];
+  ksba_cert_t cert2;
+
+  image = ksba_cert_get_image (cert, &imagelen);
+  fail_if_err (image? 0 : gpg_error (GPG_ERR_NO_DATA));
+  sha1_hash_buffer ((char*)sha1, (const char*)image, imagelen);
+
+  err = ksba_cert_get_fingerprint (cert, NULL, &digest, &digestlen);
+  fail_if_err (err);
+  err = ksba_cert_get_fingerprint (cert, "1.3.14.3.2.26",
+                                   &digest2, &digestlen2);
+  fail_if_err (err);
+  if (digestlen != 20 || memcmp (digest, sha1, 20)
+      || digest2 != digest || digestlen2 != digestlen)
+    {
+      fprintf (stderr, "%s:%d: wrong fingerprint\n", __FILE__, __LINE__);
+      errorcount++;
+    }
+
+  err = ksba_cert_new (&cert2);
+  fail_if_err (err);
+  if (ksba_cert_equal (cert, cert2))
+    {
+      fprintf (stderr, "%s:%d: equal to an empty cert\n", __FILE__, __LINE__);
+      errorcount++;
+    }
+  err = ksba_cert_init_from_mem (cert2, image, imagelen);
+  fail_if_err (err);
+  if (!ksba_cert_equal (cert, cert2)
+      || ksba_cert_get_quickhash (cert) != ksba_cert_get_quickhash (cert2))
+    {
+      fprintf (stderr, "%s:%d: certificates not equal\n", __FILE__, __LINE__);
+      errorcount++;
+    }
+  ksba_cert_release (cert2);
+}
+
+
+#ifdef HAVE_PTHREAD
+/* State of the reader callback used to test concurrent use of an
+   allocation context.  */
+struct ctx_busy_s
+{
+  const unsigned char *image;
+  size_t imagelen;
+  size_t offset;
+  ksba_cert_t other;   /* A second certificate in the same context.  */
+  gpg_error_t err;     /* Result of the other thread.  */
+  int called;
+};
+
+
+/* Thread using the other certificate while the main thread is in
+   ksba_cert_read_der.  */
+static void *
+ctx_busy_thread (void *opaque)
+{
+  struct ctx_busy_s *cb = opaque;
+
+  cb->err = ksba_cert_set_user_data (cb->other, "foo", "bar", 3);
+  return NULL;
+}
+
+
+/* Reader callback which runs ctx_busy_thread on the first call.  */
+static int
+ctx_busy_cb (void *opaque, char *buffer, size_t count, size_t *nread)
+{
+  struct ctx_busy_s *cb = opaque;
+  pthread_t thread;
+
+  if (!cb->called++)
+    {
+      if (pthread_create (&thread, NULL, ctx_busy_thread, cb))
+        fail ("error creating thread");
+      pthread_join (thread, NULL);
+    }
+  if (cb->offset == cb->imagelen)
+    return -1;
+  if (count > cb->imagelen - cb->offset)
+    count = cb->imagelen - cb->offset;
+  memcpy (buffer, cb->image + cb->offset, count);
+  cb->offset += count;
+  *nread = count;
+  return 0;
+}
+#endif /*HAVE_PTHREAD*/
+
+
+/* Parse the image of CERT into certificates taken from an allocation
+   context.  */
+static void
+check_alloc_ctx (ksba_cert_t cert)
+{
+  gpg_error_t err;
+  ksba_alloc_ctx_t ctx;
+  const unsigned char *image, *digest;
+  size_t imagelen, digestlen;
+  ksba_cert_t cert2, cert3;
+  char *issuer, *issuer2;
+  ksba_reader_t r;
+#ifdef HAVE_PTHREAD
+  struct ctx_busy_s cb;
+  ksba_reader_t r2;
+#endif
+
+  image = ksba_cert_get_image (cert, &imagelen);
+  fail_if_err (image? 0 : gpg_error (GPG_ERR_NO_DATA));
+
+  /* Use a tiny chunk size so that several chunks are needed.  */
+  err = ksba_alloc_ctx_new (&ctx, 1024);
+  if (gpg_err_code (err) == GPG_ERR_NOT_SUPPORTED)
+    return;
+  fail_if_err (err);
+
+  /* A certificate in CTX; the strings it returns are not taken from
+     CTX.  */
+  err = ksba_cert_new_in (ctx, &cert2);
+  fail_if_err (err);
+  err = ksba_cert_init_from_mem (cert2, image, imagelen);
+  fail_if_err (err);
+  err = ksba_cert_get_fingerprint (cert2, NULL, &digest, &digestlen);
+  fail_if_err (err);
+  issuer = ksba_cert_get_issuer (cert, 0);
+  issuer2 = ksba_cert_get_issuer (cert2, 0);
+  if (!ksba_cert_equal (cert, cert2) || !issuer || !issuer2
+      || strcmp (issuer, issuer2))
+    {
+      fprintf (stderr, "%s:%d: certificates not equal\n", __FILE__, __LINE__);
+      errorcount++;
+    }
+  ksba_free (issuer);
+  ksba_free (issuer2);
+  ksba_cert_release (cert2);
+
+  /* A reader used by a certificate in CTX; the reader's unread buffer
+     must not be taken from CTX as the reader outlives CTX.  */
+  err = ksba_cert_new_in (ctx, &cert2);
+  fail_if_err (err);
+  err = ksba_reader_new (&r);
+  fail_if_err (err);
+  err = ksba_reader_set_mem (r, image, imagelen);
+  fail_if_err (err);
+  err = ksba_cert_read_der (cert2, r);
+  fail_if_err (err);
+  ksba_cert_release (cert2);
+
+  /* A certificate in CTX which is never released.  */
+  err = ksba_cert_new_in (ctx, &cert3);
+  fail_if_err (err);
+  err = ksba_cert_init_from_mem (cert3, image, imagelen);
+  fail_if_err (err);
+  issuer = ksba_cert_get_issuer (cert3, 0);
+  if (!issuer || !ksba_cert_equal (cert, cert3)
+      || ksba_cert_get_quickhash (cert) != ksba_cert_get_quickhash (cert3))
+    {
+      fprintf (stderr, "%s:%d: certificates not equal\n", __FILE__, __LINE__);
+      errorcount++;
+    }
+  ksba_free (issuer);
+
+#ifdef HAVE_PTHREAD
+  /* Another thread may not use CTX while it is in use.  */
+  memset (&cb, 0, sizeof cb);
+  cb.image = image;
+  cb.imagelen = imagelen;
+  cb.other = cert3;
+  err = ksba_cert_new_in (ctx, &cert2);
+  fail_if_err (err);
+  err = ksba_reader_new (&r2);
+  fail_if_err (err);
+  err = ksba_reader_set_cb (r2, ctx_busy_cb, &cb);
+  fail_if_err (err);
+  err = ksba_cert_read_der (cert2, r2);
+  fail_if_err (err);
+  ksba_reader_release (r2);
+  if (gpg_err_code (cb.err) != GPG_ERR_EBUSY)
+    {
+      fprintf (stderr, "%s:%d: concurrent use of a context not detected\n",
+               __FILE__, __LINE__);
+      errorcount++;
+    }
+  err = ksba_cert_set_user_data (cert3, "foo", "bar", 3);
+  fail_if_err (err);
+#endif
+
+  ksba_alloc_ctx_release (ctx);
+  ksba_reader_release (r);
+}
+
+
+/* Parse the image of CERT again with statistics enabled.  */
+static void
+check_stats (ksba_cert_t cert)
+{
+  gpg_error_t err;
+  ksba_stats_t stats;
+  const unsigned char *image, *digest;
+  size_t imagelen, digestlen;
+  ksba_cert_t cert2;
+  char *subject;
+  int i;
+
+  image = ksba_cert_get_image (cert, &imagelen);
+  fail_if_err (image? 0 : gpg_error (GPG_ERR_NO_DATA));
+
+  ksba_stats_reset ();
+  ksba_stats_enable (1);
+  err = ksba_cert_new (&cert2);
+  fail_if_err (err);
+  err = ksba_cert_init_from_mem (cert2, image, imagelen);
+  fail_if_err (err);
+  subject = ksba_cert_get_subject (cert2, 0);
+  err = ksba_cert_get_fingerprint (cert2, NULL, &digest, &digestlen);
+  fail_if_err (err);
+  ksba_stats_enable (0);
+  ksba_cert_release (cert2);
+  ksba_free (subject);
+
+  err = ksba_stats_get (&stats);
+  fail_if_err (err);
+  if (!stats.allocs[KSBA_STATS_MOD_CERT]
+      || stats.alloc_bytes[KSBA_STATS_MOD_BER] < imagelen
+      || !stats.allocs[KSBA_STATS_MOD_ASN1]
+      || !stats.decoder_nodes || !stats.find_node
+      || !stats.reader_calls || stats.reader_bytes < imagelen
+      || stats.hash_calls != 1 || stats.hash_bytes != imagelen)
+    {
+      fprintf (stderr, "%s:%d: unexpected statistics\n", __FILE__, __LINE__);
+      errorcount++;
+    }
+  if (verbose)
+    {
+      for (i=0; i < KSBA_STATS_NMODULES; i++)
+        if (stats.allocs[i])
+          printf ("  allocs....: %-12s %llu (%llu bytes)\n",
+                  ksba_stats_module_name (i),
+                  (unsigned long long)stats.allocs[i],
+                  (unsigned long long)stats.alloc_bytes[i]);
+      printf ("  nodes.....: %llu decoded, %llu lookups\n",
+              (unsigned long long)stats.decoder_nodes,
+              (unsigned long long)stats.find_node);
+      printf ("  reader....: %llu calls, %llu bytes\n",
+              (unsigned long long)stats.reader_calls,
+              (unsigned long long)stats.reader_bytes);
+    }
+
+  ksba_stats_reset ();
+  err = ksba_stats_get (&stats);
+  fail_if_err (err);
+  if (stats.allocs[KSBA_STATS_MOD_CERT] || stats.reader_calls)
+    {
+      fprintf (stderr, "%s:%d: statistics not reset\n", __FILE__, __LINE__);
+      errorcount++;
+    }
+}
+
+
+/* Add CERT to the global index and check the lookup functions.  */
+static void
+check_certindex (ksba_cert_t cert)
+{
+  gpg_error_t err;
+  ksba_cert_t cand;
+  ksba_sexp_t keyid;
+  const unsigned char *s;
+  size_t n, count;
+  char *subject, *issuer, *tmp;
+  int idx, found;
+
+  err = ksba_certindex_add (certindex, cert);
+  fail_if_err (err);
+  count = ksba_certindex_count (certindex);
+  err = ksba_certindex_add (certindex, cert);
+  fail_if_err (err);
+  if (ksba_certindex_count (certindex) != count)
+    {
+      fprintf (stderr, "%s:%d: certificate added twice\n", __FILE__, __LINE__);
+      errorcount++;
+    }
+
+  /* All issuer candidates must have a matching subject and a
+     self-signed certificate must find itself.  */
+  subject = ksba_cert_get_subject (cert, 0);
+  issuer = ksba_cert_get_issuer (cert, 0);
+  found = 0;
+  for (idx=0; !(err = ksba_certindex_find_issuer (certindex, cert,
+                                                  idx, &cand)); idx++)
+    {
+      tmp = ksba_cert_get_subject (cand, 0);
+      if (!tmp || !issuer || strcmp (tmp, issuer))
+        {
+          fprintf (stderr, "%s:%d: wrong issuer candidate\n",
+                   __FILE__, __LINE__);
+          errorcount++;
+        }
+      ksba_free (tmp);
+      if (ksba_cert_equal (cand, cert))
+        found = 1;
+    }
+  if (gpg_err_code (err) != GPG_ERR_EOF
+      && gpg_err_code (err) != GPG_ERR_NOT_FOUND)
+    fail_if_err (err);
+  if (subject && issuer && !strcmp (subject, issuer) && !found)
+    {
+      fprintf (stderr, "%s:%d: self-signed cert not found\n",
+               __FILE__, __LINE__);
+      errorcount++;
+    }
+  ksba_free (subject);
+  ksba_free (issuer);
+
+  if (!ksba_cert_get_subj_key_id (cert, NULL, &keyid))
+    {
+      n = strtoul ((const char *)keyid + 1, &tmp, 10);
+      s = (const unsigned char *)tmp + 1;
+      found = 0;
+      for (idx=0; !ksba_certindex_find_subj_key_id (certindex, s, n,
+                                                    idx, &cand); idx++)
+        if (ksba_cert_equal (cand, cert))
+          found = 1;
+      if (!found)
+        {
+          fprintf (stderr, "%s:%d: certificate not found by keyid\n",
+                   __FILE__, __LINE__);
+          errorcount++;
+        }
+      ksba_free (keyid);
+    }
+}
+
+
+/* Check that the columnar extraction agrees with the accessors.  */
+static void
+check_columns (ksba_cert_t cert)
+{
+  gpg_error_t err;
+  size_t serial_off, serial_len, n;
+  ksba_epochtime_t not_before, not_after, epoch;
+  uint64_t issuer_hash, subject_hash;
+  ksba_pkalgo_t pk_algo;
+  unsigned int pk_nbits, key_usage, usage;
+  int is_ca, pathlen, ca, plen;
+  gpg_error_t status;
+  ksba_cert_columns_t cols = { &serial_off, &serial_len,
+                               &not_before, &not_after,
+                               &issuer_hash, &subject_hash,
+                               &pk_algo, &pk_nbits, &is_ca, &pathlen,
+                               &key_usage, &status };
+  const unsigned char *image;
+  ksba_sexp_t serial;
+  const unsigned char *s;
+  char *endp;
+
+  err = ksba_cert_get_columns (&cert, 1, ~0u, &cols);
+  fail_if_err (err);
+  fail_if_err (status);
+
+  image = ksba_cert_get_image (cert, NULL);
+  serial = ksba_cert_get_serial (cert);
+  n = strtoul ((const char *)serial + 1, &endp, 10);
+  s = (const unsigned char *)endp + 1;
+  if (n != serial_len || memcmp (image + serial_off, s, n))
+    {
+      fprintf (stderr, "%s:%d: serial mismatch\n", __FILE__, __LINE__);
+      errorcount++;
+    }
+  ksba_free (serial);
+
+  fail_if_err (ksba_cert_get_validity_epoch (cert, 0, &epoch));
+  if (epoch != not_before)
+    {
+      fprintf (stderr, "%s:%d: notBefore mismatch\n", __FILE__, __LINE__);
+      errorcount++;
+    }
+  fail_if_err (ksba_cert_get_validity_epoch (cert, 1, &epoch));
+  if (epoch != not_after)
+    {
+      fprintf (stderr, "%s:%d: notAfter mismatch\n", __FILE__, __LINE__);
+      errorcount++;
+    }
+
+  fail_if_err (ksba_cert_is_ca (cert, &ca, &plen));
+  err = ksba_cert_get_key_usage (cert, &usage);
+  if (gpg_err_code (err) == GPG_ERR_NO_DATA)
+    usage = 0;
+  else
+    fail_if_err (err);
+  if (ca != is_ca || plen != pathlen || usage != key_usage)
+    {
+      fprintf (stderr, "%s:%d: constraints mismatch\n", __FILE__, __LINE__);
+      errorcount++;
+    }
+
+  if (pk_algo == KSBA_PKALGO_NONE || !pk_nbits)
+    {
+      fprintf (stderr, "%s:%d: no public key info\n", __FILE__, __LINE__);
+      errorcount++;
+    }
+  if (!quiet)
+    printf ("  columns...: algo=%d nbits=%u issuer=%016llx"
+            " subject=%016llx\n", pk_algo, pk_nbits,
+            (unsigned long long)issuer_hash,
+            (unsigned long long)subject_hash);
+}
+
+
+static void
+collect_hasher (void *arg, const void *buffer, size_t length)
+{
+  struct { unsigned char *buf; size_t len, size; } *c = arg;
+
+  if (c->len + length > c->size)
+    {
+      c->size = c->len + length + 1024;
+      c->buf = ksba_realloc (c->buf, c->size);
+      if (!c->buf)
+        fail ("out of core");
+    }
+  memcpy (c->buf + c->len, buffer, length);
+  c->len += length;
+}
+
+
+static void
+check_ct_tbs (ksba_cert_t cert)
+{
+  static const unsigned char ct_oid[] = /* 1.3.6.1.4.1.11129.2.4 */
+    { 0x06, 0x0a, 0x2b, 0x06, 0x01, 0x04, 0x01, 0xd6, 0x79, 0x02, 0x04 };
+  struct { unsigned char *buf; size_t len, size; } tbs = {NULL}, ct = {NULL};
+  unsigned char *buf;
+  size_t len, len2, n;
+  int has_ct;
+
+  fail_if_err (ksba_cert_hash (cert, 1, collect_hasher, &tbs));
+  fail_if_err (ksba_cert_get_ct_tbs (cert, NULL, 0, &len));
+  buf = xmalloc (len);
+  if (gpg_err_code (ksba_cert_get_ct_tbs (cert, buf, len - 1, &len2))
+      != GPG_ERR_BUFFER_TOO_SHORT)
+    {
+      fprintf (stderr, "%s:%d: short buffer not detected\n",
+               __FILE__, __LINE__);
+      errorcount++;
+    }
+  fail_if_err (ksba_cert_get_ct_tbs (cert, buf, len, &len2));
+  fail_if_err (ksba_cert_hash_ct_tbs (cert, collect_hasher, &ct));
+  if (len2 != len || ct.len != len || memcmp (ct.buf, buf, len))
+    {
+      fprintf (stderr, "%s:%d: CT TBS mismatch\n", __FILE__, __LINE__);
+      errorcount++;
+    }
+
+  has_ct = 0;
+  for (n=0; n + sizeof ct_oid <= tbs.len; n++)
+    if (!memcmp (tbs.buf + n, ct_oid, sizeof ct_oid))
+      has_ct = 1;
+  if (!has_ct && (len != tbs.len || memcmp (buf, tbs.buf, len)))
+    {
+      fprintf (stderr, "%s:%d: CT TBS differs from TBS\n", __FILE__, __LINE__);
+      errorcount++;
+    }
+  if (has_ct)
+    {
+      if (len >= tbs.len || buf[0] != 0x30)
+        {
+          fprintf (stderr, "%s:%d: CT extension not removed\n",
+                   __FILE__, __LINE__);
+          errorcount++;
+        }
+      for (n=0; n + sizeof ct_oid <= len; n++)
+        if (!memcmp (buf + n, ct_oid, sizeof ct_oid))
+          {
+            fprintf (stderr, "%s:%d: CT extension still present\n",
+                     __FILE__, __LINE__);
+            errorcount++;
+            break;
+          }
+      if (!quiet)
+        printf ("  CT TBS....: %u of %u bytes\n",
+                (unsigned int)len, (unsigned int)tbs.len);
+    }
+
+  xfree (buf);
+  xfree (tbs.buf);
+  xfree (ct.buf);
+}
+
+static void
+check_snapshot (ksba_cert_t cert)
+{
+  gpg_error_t err;
+  ksba_writer_t writer;
+  ksba_cert_t certs[2], *loaded;
+  size_t ncerts, buflen, i;
+  unsigned char *buf;
+  const char *oid, *oid2;
+  int crit, crit2, idx;
+  size_t off, off2, len, len2;
+  char *p1, *p2;
+
+  certs[0] = certs[1] = cert;
+  fail_if_err (ksba_writer_new (&writer));
+  fail_if_err (ksba_writer_set_mem (writer, 4096));
+  fail_if_err (ksba_cert_snapshot_write (writer, certs, 2));
+  buf = ksba_writer_snatch_mem (writer, &buflen);
+  fail_if_err (buf? 0 : gpg_error (GPG_ERR_ENOMEM));
+  ksba_writer_release (writer);
+
+  err = ksba_cert_snapshot_read (buf, buflen, &loaded, &ncerts);
+  fail_if_err (err);
+  if (ncerts != 2)
+    {
+      fprintf (stderr, "%s:%d: wrong number of certs in snapshot\n",
+               __FILE__, __LINE__);
+      errorcount++;
+    }
+  for (i=0; i < ncerts; i++)
+    {
+      if (!ksba_cert_equal (cert, loaded[i]))
+        {
+          fprintf (stderr, "%s:%d: snapshot image mismatch\n",
+                   __FILE__, __LINE__);
+          errorcount++;
+        }
+      p1 = ksba_cert_get_subject (cert, 0);
+      p2 = ksba_cert_get_subject (loaded[i], 0);
+      if (!p1 || !p2 || strcmp (p1, p2))
+        {
+          fprintf (stderr, "%s:%d: snapshot subject mismatch\n",
+                   __FILE__, __LINE__);
+          errorcount++;
+        }
+      ksba_free (p1);
+      ksba_free (p2);
+      for (idx=0; !(err = ksba_cert_get_extension (cert, idx, &oid, &crit,
+                                                   &off, &len)); idx++)
+        {
+          err = ksba_cert_get_extension (loaded[i], idx, &oid2, &crit2,
+                                         &off2, &len2);
+          fail_if_err (err);
+          if (strcmp (oid, oid2) || crit != crit2
+              || off != off2 || len != len2)
+            {
+              fprintf (stderr, "%s:%d: snapshot extension mismatch\n",
+                       __FILE__, __LINE__);
+              errorcount++;
+            }
+        }
+      if (gpg_err_code (err) != GPG_ERR_EOF
+          || (gpg_err_code (ksba_cert_get_extension (loaded[i], idx, NULL,
+                                                     NULL, NULL, NULL))
+              != GPG_ERR_EOF))
+        {
+          fprintf (stderr, "%s:%d: snapshot extension count mismatch\n",
+                   __FILE__, __LINE__);
+          errorcount++;
+        }
+      ksba_cert_release (loaded[i]);
+    }
+  ksba_free (loaded);
+
+  /* A modified byte must be detected.  */
+  buf[buflen - 20] ^= 1;
+  err = ksba_cert_snapshot_read (buf, buflen, &loaded, &ncerts);
+  if (gpg_err_code (err) != GPG_ERR_CHECKSUM)
+    {
+      fprintf (stderr, "%s:%d: corrupted snapshot not detected\n",
+               __FILE__, __LINE__);
+      errorcount++;
+    }
+  buf[buflen - 20] ^= 1;
+  buf[8]++;
+  err = ksba_cert_snapshot_read (buf, buflen, &loaded, &ncerts);
+  if (gpg_err_code (err) != GPG_ERR_UNKNOWN_VERSION)
+    {
+      fprintf (stderr, "%s:%d: wrong snapshot version not detected\n",
+               __FILE__, __LINE__);
+      errorcount++;
+    }
+  buf[8]--;
+
+  /* An unknown node type with a valid checksum must be rejected.  The
+     type of the first node follows the header with the version
+     string, the record length, the image and the node count.  */
+  {
+    size_t imagelen, payloadlen, start, pos;
+    unsigned long long h = 0xcbf29ce484222325ULL;
+
+    ksba_cert_get_image (cert, &imagelen);
+    start = 16 + ((buf[10] << 8) | buf[11]) + 4;
+    payloadlen = ((buf[start-4] << 24) | (buf[start-3] << 16)
+                  | (buf[start-2] << 8) | buf[start-1]);
+    pos = start + 4 + imagelen + 4;
+    buf[pos] = buf[pos+1] = buf[pos+2] = 0;
+    buf[pos+3] = 0xff;
+    for (i=0; i < payloadlen; i++)
+      {
+        h ^= buf[start + i];
+        h *= 0x100000001b3ULL;
+      }
+    for (i=0; i < 8; i++)
+      buf[start + payloadlen + i] = h >> (56 - 8 * i);
+    err = ksba_cert_snapshot_read (buf, buflen, &loaded, &ncerts);
+    if (gpg_err_code (err) != GPG_ERR_INV_OBJ)
+      {
+        fprintf (stderr, "%s:%d: invalid node type not detected: %s\n",
+                 __FILE__, __LINE__, gpg_strerror (err));
+        errorcount++;
+      }
+  }
+  ksba_free (buf);
+}
+
+
 static void
 one_file (const char *fname)
 {
@@ -511,6 +1420,13 @@ one_file (const char *fname)
       print_time (t);
       putchar ('\n');
     }
+  check_validity_epoch (cert);
+  check_alt_names (cert);
+  check_match_hostname (cert);
+  check_oid_iter (cert, 0);
+  check_oid_iter (cert, 1);
+  check_fingerprint (cert);
+
   oid = ksba_cert_get_digest_algo (cert);
   s = get_oid_desc (oid);
   if (!quiet)
@@ -613,6 +1529,13 @@ one_file (const char *fname)
 
   list_extensions (cert);
 
+  check_alloc_ctx (cert);
+  check_stats (cert);
+  check_certindex (cert);
+  check_columns (cert);
+  check_snapshot (cert);
+  check_ct_tbs (cert);
+
   ksba_cert_release (cert);
   err = ksba_cert_new (&cert);
   if (err)
@@ -655,6 +1578,8 @@ main (int argc, char **argv)
       argc--; argv++;
     }
 
+  ksba_set_hash_buffer_function (my_hash_buffer, NULL);
+  fail_if_err (ksba_certindex_new (&certindex));
 
   if (argc)
     {
@@ -687,6 +1612,7 @@ main (int argc, char **argv)
         "ed25519-rfc8410.crt",
         "ed25519-ossl-1.crt",
         "ed448-ossl-1.crt",
+        "ct-precert.crt",
         NULL
       };
       int idx;
@@ -707,5 +1633,6 @@ main (int argc, char **argv)
         }
     }
 
+  ksba_certindex_release (certindex);
   return !!errorcount;
 }
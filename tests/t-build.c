@@ -0,0 +1,415 @@
+/* t-build.c - Golden vector tests for the CMS and CSR builders
+ * Copyright (C) 2026 g10 Code GmbH
+ *
+ * This file is part of KSBA.
+ *
+ * KSBA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KSBA is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* All objects are built from fixed input and their encodings as well
+   as the data passed to the hash functions are compared with the
+   vectors in samples/build-vectors.txt.  The vectors have been created
+   with the tree based encoder used before Libksba 1.5.0; use --dump
+   to print the records of the current build.  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include <errno.h>
+
+#include "../src/ksba.h"
+
+#define PGM "t-build"
+
+#include "t-common.h"
+
+
+static int verbose;
+static int dump;
+static int errorcount;
+
+/* The expected records and the current position.  */
+static char *vectors;
+static char *vecptr;
+static int vecline;
+
+static const unsigned char rsakey[] =
+  "(10:public-key(3:rsa(1:n9:\x00\xc1\x02\x03\x04\x05\x06\x07\x08)"
+  "(1:e3:\x01\x00\x01)))";
+static const unsigned char rsasig[] = "(7:sig-val(3:rsa(1:s4:SIGN)))";
+static const unsigned char ecdsasig[] =
+  "(7:sig-val(5:ecdsa(1:r3:\x80\x01\x02)(1:s2:\x01\x02)))";
+
+
+/* Read the vectors file.  */
+static void
+read_vectors (void)
+{
+  char *fname = prepend_srcdir ("samples/build-vectors.txt");
+  FILE *fp;
+  size_t len = 0, n;
+
+  fp = fopen (fname, "r");
+  if (!fp)
+    {
+      fprintf (stderr, "%s:%d: can't open `%s': %s\n",
+               __FILE__, __LINE__, fname, strerror (errno));
+      exit (1);
+    }
+  vectors = NULL;
+  do
+    {
+      vectors = realloc (vectors, len + 8192 + 1);
+      if (!vectors)
+        fail ("out of core");
+      n = fread (vectors + len, 1, 8192, fp);
+      len += n;
+    }
+  while (n == 8192);
+  vectors[len] = 0;
+  fclose (fp);
+  xfree (fname);
+  vecptr = vectors;
+}
+
+
+/* Compare the record TAG with DATA of length LEN against the next
+   line of the vectors or print it in dump mode.  */
+static void
+record (const char *tag, const void *data, size_t len)
+{
+  const unsigned char *p = data;
+  char *line, *s;
+  size_t i;
+
+  line = xmalloc (strlen (tag) + 25 + 2 * len);
+  s = line + sprintf (line, "%s %u:", tag, (unsigned int)len);
+  for (i=0; i < len; i++, s += 2)
+    sprintf (s, "%02x", p[i]);
+
+  if (dump)
+    printf ("%s\n", line);
+  else
+    {
+      vecline++;
+      s = strchr (vecptr, '\n');
+      if (!s || (size_t)(s - vecptr) != strlen (line)
+          || strncmp (vecptr, line, s - vecptr))
+        {
+          fprintf (stderr, PGM": vector %d (%s) does not match\n",
+                   vecline, tag);
+          if (verbose)
+            fprintf (stderr, "  got: %s\n", line);
+          errorcount++;
+        }
+      if (s)
+        vecptr = s + 1;
+      else
+        vecptr += strlen (vecptr);
+    }
+  xfree (line);
+}
+
+
+static void
+hash_fnc (void *arg, const void *buffer, size_t length)
+{
+  record (arg, buffer, length);
+}
+
+
+static ksba_cert_t
+load_cert (const char *name)
+{
+  char *fname = prepend_srcdir (name);
+  FILE *fp;
+  ksba_reader_t r;
+  ksba_cert_t cert;
+
+  fp = fopen (fname, "rb");
+  if (!fp)
+    {
+      fprintf (stderr, "%s:%d: can't open `%s': %s\n",
+               __FILE__, __LINE__, fname, strerror (errno));
+      exit (1);
+    }
+  fail_if_err (ksba_reader_new (&r));
+  fail_if_err (ksba_reader_set_file (r, fp));
+  fail_if_err (ksba_cert_new (&cert));
+  fail_if_err (ksba_cert_read_der (cert, r));
+  ksba_reader_release (r);
+  fclose (fp);
+  xfree (fname);
+  return cert;
+}
+
+
+/* Build a certificate request with NEXTN extensions.  With CERTMODE
+   set a certificate is created instead; a value of 2 also sets an
+   issuer.  NOTBEFORE and NOTAFTER are optional.  */
+static void
+test_certreq (int certmode, int nextn,
+              const char *notbefore, const char *notafter)
+{
+  ksba_certreq_t cr;
+  ksba_writer_t w;
+  ksba_stop_reason_t stopreason;
+  const unsigned char *buf;
+  size_t len;
+  char big[300];
+  int i;
+
+  memset (big, 0x42, sizeof big);
+  fail_if_err (ksba_writer_new (&w));
+  fail_if_err (ksba_writer_set_mem (w, 1024));
+  fail_if_err (ksba_certreq_new (&cr));
+  fail_if_err (ksba_certreq_set_writer (cr, w));
+  ksba_certreq_set_hash_function (cr, hash_fnc, "crihash");
+  fail_if_err (ksba_certreq_add_subject (cr, "CN=Test User,O=Example,C=DE"));
+  if (nextn > 1)
+    fail_if_err (ksba_certreq_add_subject (cr, "<test@example.org>"));
+  fail_if_err (ksba_certreq_set_public_key (cr, rsakey));
+  for (i=0; i < nextn; i++)
+    fail_if_err (ksba_certreq_add_extension (cr, i? "2.5.29.15":"2.5.29.19",
+                                             i&1, big, i==2? 300: 5+i));
+  if (certmode)
+    {
+      fail_if_err (ksba_certreq_set_serial
+                   (cr, (const unsigned char *)"(3:\x00\x85\x02)"));
+      if (certmode > 1)
+        fail_if_err (ksba_certreq_set_issuer (cr, "CN=Issuer,O=Example"));
+      if (notbefore)
+        fail_if_err (ksba_certreq_set_validity (cr, 0, notbefore));
+      if (notafter)
+        fail_if_err (ksba_certreq_set_validity (cr, 1, notafter));
+      fail_if_err (ksba_certreq_set_siginfo
+                   (cr, (const unsigned char *)
+                    "(7:sig-val(3:rsa(1:s1:\x00)))"));
+    }
+  do
+    {
+      fail_if_err (ksba_certreq_build (cr, &stopreason));
+      if (stopreason == KSBA_SR_NEED_SIG)
+        fail_if_err (ksba_certreq_set_sig_val (cr, rsasig));
+    }
+  while (stopreason != KSBA_SR_READY);
+
+  buf = ksba_writer_get_mem (w, &len);
+  record ("certreq", buf, len);
+  ksba_certreq_release (cr);
+  ksba_writer_release (w);
+}
+
+
+/* Build a signed message for the signer CERT1 and the optional second
+   signer CERT2.  If ECDSA is set the first signature is an ECDSA
+   signature.  CAPS adds S/MIME capabilities.  SIGNTIME is the
+   optional signing time of the first signer.  */
+static void
+test_signed (ksba_cert_t cert1, ksba_cert_t cert2, int ecdsa, int caps,
+             const char *signtime)
+{
+  ksba_cms_t cms;
+  ksba_writer_t w;
+  ksba_stop_reason_t stopreason;
+  const unsigned char *buf;
+  size_t len;
+  char *digest, *oids;
+  size_t digestlen;
+  ksba_isotime_t t;
+  int i;
+
+  fail_if_err (ksba_writer_new (&w));
+  fail_if_err (ksba_writer_set_mem (w, 1024));
+  fail_if_err (ksba_cms_new (&cms));
+  fail_if_err (ksba_cms_set_reader_writer (cms, NULL, w));
+  ksba_cms_set_hash_function (cms, hash_fnc, "sahash");
+  fail_if_err (ksba_cms_set_content_type (cms, 0, KSBA_CT_SIGNED_DATA));
+  fail_if_err (ksba_cms_set_content_type (cms, 1, KSBA_CT_DATA));
+  fail_if_err (ksba_cms_add_digest_algo (cms, "2.16.840.1.101.3.4.2.1"));
+  fail_if_err (ksba_cms_add_signer (cms, cert1));
+  fail_if_err (ksba_cms_add_cert (cms, cert1));
+  if (cert2)
+    {
+      fail_if_err (ksba_cms_add_digest_algo (cms, "2.16.840.1.101.3.4.2.3"));
+      fail_if_err (ksba_cms_add_signer (cms, cert2));
+    }
+  if (caps)
+    {
+      fail_if_err (ksba_cms_add_smime_capability
+                   (cms, "2.16.840.1.101.3.4.1.2", NULL, 0));
+      fail_if_err (ksba_cms_add_smime_capability
+                   (cms, "1.2.840.113549.3.2",
+                    (const unsigned char *)"\x02\x01\x28", 3));
+      /* A duplicate is ignored.  */
+      fail_if_err (ksba_cms_add_smime_capability
+                   (cms, "2.16.840.1.101.3.4.1.2", NULL, 0));
+      fail_if_err (ksba_cms_add_smime_capability
+                   (cms, "1.2.840.113549.3.7", NULL, 0));
+    }
+  fail_if_err (ksba_cms_set_message_digest
+               (cms, 0, (const unsigned char *)
+                "0123456789abcdef0123456789abcdef", 32));
+  if (signtime)
+    fail_if_err (ksba_cms_set_signing_time (cms, 0, signtime));
+  if (cert2)
+    {
+      fail_if_err (ksba_cms_set_message_digest
+                   (cms, 1, (const unsigned char *)
+                    "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789"
+                    "abcdefghijklmnopqrstuvwxyz!!", 64));
+      fail_if_err (ksba_cms_set_signing_time (cms, 1, "20600102T030405"));
+    }
+
+  do
+    {
+      fail_if_err (ksba_cms_build (cms, &stopreason));
+      if (stopreason != KSBA_SR_NEED_SIG)
+        continue;
+      for (i=0; i < (cert2? 2 : 1); i++)
+        {
+          fail_if_err (ksba_cms_hash_signed_attrs (cms, i));
+          /* The attributes must be readable while building.  */
+          fail_if_err (ksba_cms_get_message_digest (cms, i,
+                                                    &digest, &digestlen));
+          record ("md", digest, digestlen);
+          xfree (digest);
+          fail_if_err (ksba_cms_get_signing_time (cms, i, t));
+          record ("st", t, strlen (t));
+          if (!ksba_cms_get_sigattr_oids (cms, i, "1.2.840.113549.1.9.3",
+                                          &oids))
+            {
+              record ("ct", oids, strlen (oids));
+              xfree (oids);
+            }
+          fail_if_err (ksba_cms_set_sig_val (cms, i, (ecdsa && !i)?
+                                             ecdsasig : rsasig));
+        }
+    }
+  while (stopreason != KSBA_SR_READY);
+
+  buf = ksba_writer_get_mem (w, &len);
+  record ("cms", buf, len);
+  ksba_cms_release (cms);
+  ksba_writer_release (w);
+}
+
+
+/* Build an enveloped message for the recipient CERT1 and the optional
+   second recipient CERT2.  */
+static void
+test_enveloped (ksba_cert_t cert1, ksba_cert_t cert2)
+{
+  ksba_cms_t cms;
+  ksba_writer_t w;
+  ksba_stop_reason_t stopreason;
+  const unsigned char *buf;
+  size_t len;
+
+  fail_if_err (ksba_writer_new (&w));
+  fail_if_err (ksba_writer_set_mem (w, 1024));
+  fail_if_err (ksba_cms_new (&cms));
+  fail_if_err (ksba_cms_set_reader_writer (cms, NULL, w));
+  fail_if_err (ksba_cms_set_content_type (cms, 0, KSBA_CT_ENVELOPED_DATA));
+  fail_if_err (ksba_cms_set_content_type (cms, 1, KSBA_CT_DATA));
+  fail_if_err (ksba_cms_set_content_enc_algo (cms, "2.16.840.1.101.3.4.1.2",
+                                              "0123456789abcdef", 16));
+  fail_if_err (ksba_cms_add_recipient (cms, cert1));
+  fail_if_err (ksba_cms_set_enc_val
+               (cms, 0, (const unsigned char *)
+                "(7:enc-val(3:rsa(1:a4:KEY!)))"));
+  if (cert2)
+    {
+      fail_if_err (ksba_cms_add_recipient (cms, cert2));
+      fail_if_err (ksba_cms_set_enc_val
+                   (cms, 1, (const unsigned char *)
+                    "(7:enc-val(3:rsa(1:a5:KEY2!)))"));
+    }
+  fail_if_err (ksba_cms_build (cms, &stopreason));
+  fail_if_err (ksba_cms_build (cms, &stopreason));
+  if (stopreason != KSBA_SR_BEGIN_DATA)
+    fail ("unexpected stop reason");
+
+  buf = ksba_writer_get_mem (w, &len);
+  record ("env", buf, len);
+  ksba_cms_release (cms);
+  ksba_writer_release (w);
+}
+
+
+int
+main (int argc, char **argv)
+{
+  ksba_cert_t rsa1, rsa2, ec;
+
+  if (argc)
+    {
+      argc--;  argv++;
+    }
+  if (argc && !strcmp (*argv, "--verbose"))
+    {
+      verbose = 1;
+      argc--; argv++;
+    }
+  if (argc && !strcmp (*argv, "--dump"))
+    {
+      dump = 1;
+      argc--; argv++;
+    }
+  if (argc)
+    {
+      fputs ("usage: "PGM" [--verbose] [--dump]\n", stderr);
+      return 1;
+    }
+
+  if (!dump)
+    read_vectors ();
+  rsa1 = load_cert ("samples/cert_g10code_test1.der");
+  rsa2 = load_cert ("samples/ov-user.crt");
+  ec = load_cert ("samples/secp256r1-sha384_cert.crt");
+
+  /* Certificate requests and certificates.  */
+  test_certreq (0, 0, NULL, NULL);
+  test_certreq (0, 1, NULL, NULL);
+  test_certreq (0, 3, NULL, NULL);
+  test_certreq (1, 0, NULL, NULL);
+  test_certreq (2, 2, "20200101T000000", "20550101T120000");
+  test_certreq (1, 3, "20600101T000000", NULL);
+
+  /* Signed data.  */
+  test_signed (rsa1, NULL, 0, 0, NULL);
+  test_signed (rsa1, NULL, 0, 1, "20210304T050607");
+  test_signed (rsa1, rsa2, 1, 1, "20210304T050607");
+  test_signed (rsa2, rsa1, 0, 0, "20510304T050607");
+  test_signed (ec, NULL, 1, 0, "20500101T000000");
+
+  /* Enveloped data.  */
+  test_enveloped (rsa1, NULL);
+  test_enveloped (rsa2, rsa1);
+
+  ksba_cert_release (rsa1);
+  ksba_cert_release (rsa2);
+  ksba_cert_release (ec);
+
+  if (!dump && *vecptr)
+    {
+      fprintf (stderr, PGM": more vectors than the %d records\n", vecline);
+      errorcount++;
+    }
+  free (vectors);
+
+  return !!errorcount;
+}
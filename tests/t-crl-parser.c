@@ -52,6 +52,123 @@ my_hasher (void *arg, const void *buffer, size_t length)
 }
 
 
+/* Record of the CRL parser states reported to the trace function.  */
+static struct {
+  int n;
+  int state[8];
+  uint64_t timestamp[8];
+  uint64_t nbytes[8];
+} crl_trace;
+
+static void
+my_tracer (void *arg, const ksba_trace_info_t *info)
+{
+  (void)arg;
+
+  if (verbose)
+    printf ("trace: event=%d value=%d err=%u nbytes=%llu name=%s\n",
+            info->event, info->value, (unsigned int)info->err,
+            (unsigned long long)info->nbytes,
+            info->name? info->name : "-");
+  if (info->event != KSBA_TRACE_CRL_STATE)
+    return;
+  if (info->err)
+    fail ("trace function called with an error");
+  if (crl_trace.n < sizeof crl_trace.state / sizeof *crl_trace.state)
+    {
+      crl_trace.state[crl_trace.n] = info->value;
+      crl_trace.timestamp[crl_trace.n] = info->timestamp;
+      crl_trace.nbytes[crl_trace.n] = info->nbytes;
+    }
+  crl_trace.n++;
+}
+
+
+/* Check that the trace function saw all states in order.  */
+static void
+check_trace (void)
+{
+  int i;
+
+  if (crl_trace.n != 4)
+    fail ("wrong number of CRL states traced");
+  for (i=0; i < crl_trace.n; i++)
+    {
+      if (crl_trace.state[i] != i)
+        fail ("CRL states not traced in order");
+      if (i && (crl_trace.timestamp[i] < crl_trace.timestamp[i-1]
+                || crl_trace.nbytes[i] <= crl_trace.nbytes[i-1]))
+        fail ("CRL trace timestamps or byte counts not increasing");
+    }
+}
+
+
+/* A minimal CRL without a nextUpdate field.  Its thisUpdate is
+   2002-01-14 07:00:28.  */
+static const unsigned char crl_no_next_update[] = {
+  0x30, 0x47, 0x30, 0x32, 0x30, 0x0d, 0x06, 0x09, 0x2a, 0x86, 0x48, 0x86,
+  0xf7, 0x0d, 0x01, 0x01, 0x0b, 0x05, 0x00, 0x30, 0x12, 0x31, 0x10, 0x30,
+  0x0e, 0x06, 0x03, 0x55, 0x04, 0x03, 0x0c, 0x07, 0x54, 0x65, 0x73, 0x74,
+  0x20, 0x43, 0x41, 0x17, 0x0d, 0x30, 0x32, 0x30, 0x31, 0x31, 0x34, 0x30,
+  0x37, 0x30, 0x30, 0x32, 0x38, 0x5a, 0x30, 0x0d, 0x06, 0x09, 0x2a, 0x86,
+  0x48, 0x86, 0xf7, 0x0d, 0x01, 0x01, 0x0b, 0x05, 0x00, 0x03, 0x02, 0x00,
+  0x00
+};
+
+
+/* Parse the CRL from reader R up to its list of entries and check
+   the values returned by ksba_crl_get_update_times_epoch.  If
+   EXPNEXT is -1 the CRL is expected to have no nextUpdate.  */
+static void
+check_update_times_epoch (const char *name, ksba_reader_t r,
+                          ksba_epochtime_t expthis, ksba_epochtime_t expnext)
+{
+  gpg_error_t err;
+  ksba_crl_t crl;
+  ksba_stop_reason_t stopreason;
+  ksba_epochtime_t this, next;
+
+  err = ksba_crl_new (&crl);
+  fail_if_err (err);
+  err = ksba_crl_set_reader (crl, r);
+  fail_if_err (err);
+
+  do
+    {
+      err = ksba_crl_parse (crl, &stopreason);
+      fail_if_err2 (name, err);
+    }
+  while (stopreason != KSBA_SR_BEGIN_ITEMS && stopreason != KSBA_SR_READY);
+  if (stopreason != KSBA_SR_BEGIN_ITEMS)
+    fail ("CRL parser did not stop at the items");
+
+  this = next = 0;
+  err = ksba_crl_get_update_times_epoch (crl, &this, &next);
+  if (expnext == (ksba_epochtime_t)(-1))
+    {
+      if (gpg_err_code (err) != GPG_ERR_NO_VALUE)
+        fail ("missing nextUpdate not reported");
+    }
+  else
+    {
+      fail_if_err2 (name, err);
+      if (next != expnext)
+        fail ("wrong nextUpdate epoch");
+    }
+  if (this != expthis)
+    fail ("wrong thisUpdate epoch");
+
+  /* Asking only for thisUpdate must succeed in either case.  */
+  this = 0;
+  err = ksba_crl_get_update_times_epoch (crl, &this, NULL);
+  fail_if_err2 (name, err);
+  if (this != expthis)
+    fail ("wrong thisUpdate epoch");
+
+  ksba_crl_release (crl);
+}
+
+
 /* Return the description for OID; if no description is available
    NULL is returned. */
 static const char *
@@ -146,6 +263,7 @@ one_file (const char *fname)
   if (hashlog)
     ksba_crl_set_hash_function (crl, my_hasher, hashlog);
 
+  memset (&crl_trace, 0, sizeof crl_trace);
   do
     {
       err = ksba_crl_parse (crl, &stopreason);
@@ -346,6 +464,7 @@ one_file (const char *fname)
     xfree (sigval);
   }
 
+  check_trace ();
 
   ksba_crl_release (crl);
   ksba_reader_release (r);
@@ -375,6 +494,8 @@ main (int argc, char **argv)
       argc--; argv++;
     }
 
+  ksba_set_trace_function (my_tracer, NULL);
+
   if (argc)
     {
       for (; argc; argc--, argv++)
@@ -402,6 +523,34 @@ main (int argc, char **argv)
           one_file (fname);
           xfree (fname);
         }
+
+      {
+        char *fname;
+        FILE *fp;
+        ksba_reader_t r;
+
+        fname = prepend_srcdir ("samples/crl_testpki_testpca.der");
+        fp = fopen (fname, "rb");
+        if (!fp)
+          {
+            fprintf (stderr, "%s:%d: can't open `%s': %s\n",
+                     __FILE__, __LINE__, fname, strerror (errno));
+            exit (1);
+          }
+        fail_if_err (ksba_reader_new (&r));
+        fail_if_err (ksba_reader_set_file (r, fp));
+        check_update_times_epoch (fname, r, 1010991628, 1013670028);
+        ksba_reader_release (r);
+        fclose (fp);
+        xfree (fname);
+
+        fail_if_err (ksba_reader_new (&r));
+        fail_if_err (ksba_reader_set_mem (r, crl_no_next_update,
+                                          sizeof crl_no_next_update));
+        check_update_times_epoch ("crl_no_next_update", r,
+                                  1010991628, (ksba_epochtime_t)(-1));
+        ksba_reader_release (r);
+      }
     }
 
   return 0;
@@ -172,9 +172,360 @@ test_der_builder (void)
 }
 
 
+/* Build the same object as the template in test_der_template but
+ * without using slots.  */
+static void
+build_reference (ksba_der_t d, const unsigned char *serial, size_t seriallen,
+                 const unsigned char *subject, size_t subjectlen,
+                 unsigned char **r_der, size_t *r_derlen)
+{
+  gpg_error_t err;
+
+  ksba_der_builder_reset (d);
+  ksba_der_add_tag (d, KSBA_CLASS_UNIVERSAL, KSBA_TYPE_SEQUENCE);
+  ksba_der_add_tag (d, KSBA_CLASS_CONTEXT, 0);
+  ksba_der_add_int (d, "\x02", 1, 0);
+  ksba_der_add_end (d);
+  ksba_der_add_ptr (d, KSBA_CLASS_UNIVERSAL, KSBA_TYPE_INTEGER,
+                    (void*)serial, seriallen);
+  ksba_der_add_tag (d, KSBA_CLASS_UNIVERSAL, KSBA_TYPE_SEQUENCE);
+  ksba_der_add_oid (d, "1.2.840.113549.1.1.11");
+  ksba_der_add_ptr (d, KSBA_CLASS_UNIVERSAL, KSBA_TYPE_NULL, NULL, 0);
+  ksba_der_add_end (d);
+  ksba_der_add_der (d, subject, subjectlen);
+  ksba_der_add_tag (d, KSBA_CLASS_CONTEXT, 3);
+  ksba_der_add_tag (d, KSBA_CLASS_UNIVERSAL, KSBA_TYPE_SEQUENCE);
+  ksba_der_add_oid (d, "2.5.29.19");
+  ksba_der_add_ptr (d, KSBA_CLASS_UNIVERSAL, KSBA_TYPE_OCTET_STRING,
+                    (void*)serial, seriallen);
+  ksba_der_add_end (d);
+  ksba_der_add_end (d);
+  ksba_der_add_end (d);
+  err = ksba_der_builder_get (d, r_der, r_derlen);
+  fail_if_err (err);
+}
+
+
+static void
+test_der_template (void)
+{
+  gpg_error_t err;
+  ksba_der_t d, ref;
+  unsigned char *der, *refder;
+  size_t derlen, refderlen;
+  unsigned char serial[20], subject[300];
+  int i;
+
+  d = ksba_der_builder_new (0);
+  ref = ksba_der_builder_new (0);
+  if (!d || !ref)
+    fail ("error creating new DER builder");
+
+  ksba_der_add_tag (d, KSBA_CLASS_UNIVERSAL, KSBA_TYPE_SEQUENCE);
+  ksba_der_add_tag (d, KSBA_CLASS_CONTEXT, 0);
+  ksba_der_add_int (d, "\x02", 1, 0);
+  ksba_der_add_end (d);
+  ksba_der_add_slot (d, KSBA_CLASS_UNIVERSAL, KSBA_TYPE_INTEGER, 1);
+  ksba_der_add_tag (d, KSBA_CLASS_UNIVERSAL, KSBA_TYPE_SEQUENCE);
+  ksba_der_add_oid (d, "1.2.840.113549.1.1.11");
+  ksba_der_add_ptr (d, KSBA_CLASS_UNIVERSAL, KSBA_TYPE_NULL, NULL, 0);
+  ksba_der_add_end (d);
+  ksba_der_add_slot (d, 0, 0, 2);
+  ksba_der_add_tag (d, KSBA_CLASS_CONTEXT, 3);
+  ksba_der_add_tag (d, KSBA_CLASS_UNIVERSAL, KSBA_TYPE_SEQUENCE);
+  ksba_der_add_oid (d, "2.5.29.19");
+  ksba_der_add_slot (d, KSBA_CLASS_UNIVERSAL, KSBA_TYPE_OCTET_STRING, 1);
+  ksba_der_add_end (d);
+  ksba_der_add_end (d);
+  ksba_der_add_end (d);
+
+  /* All slots must be set.  */
+  err = ksba_der_set_slot (d, 1, "\x01", 1);
+  fail_if_err (err);
+  err = ksba_der_builder_get (d, &der, &derlen);
+  if (gpg_err_code (err) != GPG_ERR_MISSING_VALUE)
+    fail ("missing slot value not detected");
+  err = ksba_der_set_slot (d, 3, "\x01", 1);
+  if (gpg_err_code (err) != GPG_ERR_NOT_FOUND)
+    fail ("unknown slot not detected");
+
+  /* Create objects with values of different sizes so that the length
+   * headers change.  */
+  for (i=0; i < 4; i++)
+    {
+      size_t seriallen = i? 20 : 1;
+      size_t subjectlen = (i & 1)? 300 : 20;
+
+      memset (serial, 0x11 * (i+1), sizeof serial);
+      memset (subject, 'a' + i, sizeof subject);
+      subject[0] = 0x30;
+      if (subjectlen < 128)
+        subject[1] = subjectlen - 2;
+      else
+        {
+          subject[1] = 0x82;
+          subject[2] = (subjectlen - 4) >> 8;
+          subject[3] = (subjectlen - 4);
+        }
+
+      fail_if_err (ksba_der_set_slot (d, 1, serial, seriallen));
+      fail_if_err (ksba_der_set_slot (d, 2, subject, subjectlen));
+      err = ksba_der_builder_get (d, &der, &derlen);
+      fail_if_err (err);
+      build_reference (ref, serial, seriallen, subject, subjectlen,
+                       &refder, &refderlen);
+      if (derlen != refderlen || memcmp (der, refder, derlen))
+        fail ("bad encoding");
+      xfree (der);
+      xfree (refder);
+    }
+
+  ksba_der_release (d);
+  ksba_der_release (ref);
+}
+
+
+static void
+test_der_streaming (void)
+{
+  gpg_error_t err;
+  ksba_der_t d;
+  ksba_writer_t w;
+  unsigned char *der, *payload, *p;
+  const unsigned char *wder;
+  size_t derlen, wderlen, objlen, niov, n, i;
+  const ksba_iov_t *iov;
+  int found;
+
+  payload = xmalloc (300000);
+  memset (payload, 0x5a, 300000);
+
+  d = ksba_der_builder_new (0);
+  if (!d)
+    fail ("error creating new DER builder");
+  ksba_der_add_tag (d, KSBA_CLASS_UNIVERSAL, KSBA_TYPE_SEQUENCE);
+  ksba_der_add_oid (d, "1.2.3.4");
+  ksba_der_add_tag (d, KSBA_CLASS_CONTEXT, 0);
+  ksba_der_add_tag (d, KSBA_CLASS_ENCAPSULATE, KSBA_TYPE_BIT_STRING);
+  ksba_der_add_ptr (d, KSBA_CLASS_UNIVERSAL, KSBA_TYPE_OCTET_STRING,
+                    payload, 300000);
+  ksba_der_add_end (d);
+  ksba_der_add_end (d);
+  ksba_der_add_int (d, "\x2a", 1, 0);
+  ksba_der_add_end (d);
+
+  err = ksba_der_builder_get (d, &der, &derlen);
+  fail_if_err (err);
+
+  err = ksba_writer_new (&w);
+  fail_if_err (err);
+  err = ksba_writer_set_mem (w, 1024);
+  fail_if_err (err);
+  err = ksba_der_builder_write (d, w, &objlen);
+  fail_if_err (err);
+  wder = ksba_writer_get_mem (w, &wderlen);
+  if (objlen != derlen || wderlen != derlen || memcmp (wder, der, derlen))
+    fail ("bad encoding written to writer");
+  ksba_writer_release (w);
+
+  err = ksba_der_builder_get_iov (d, &iov, &niov);
+  fail_if_err (err);
+  for (n=i=0; i < niov; i++)
+    n += iov[i].len;
+  if (n != derlen)
+    fail ("bad length of iov");
+  p = xmalloc (n);
+  for (found=0, n=i=0; i < niov; i++)
+    {
+      memcpy (p + n, iov[i].data, iov[i].len);
+      n += iov[i].len;
+      if (iov[i].data == payload)
+        found = 1;
+    }
+  if (memcmp (p, der, derlen))
+    fail ("bad encoding in iov");
+  if (!found)
+    fail ("payload has been copied");
+  if (verbose)
+    printf ("iov with %u segments\n", (unsigned int)niov);
+  xfree (p);
+
+  xfree (der);
+  ksba_der_release (d);
+  xfree (payload);
+}
+
+
+/* Counter for the allocations done by libksba.  */
+static unsigned long alloc_count;
+
+static void *
+count_malloc (size_t n)
+{
+  alloc_count++;
+  return malloc (n);
+}
+
+static void *
+count_realloc (void *p, size_t n)
+{
+  alloc_count++;
+  return realloc (p, n);
+}
+
+
+/* Build an object similar to an OCSP request into D.  */
+static void
+build_sample_object (ksba_der_t d, int variant)
+{
+  static unsigned char hash[20], serial[16];
+  int i;
+
+  ksba_der_add_tag (d, KSBA_CLASS_UNIVERSAL, KSBA_TYPE_SEQUENCE);
+  ksba_der_add_tag (d, KSBA_CLASS_UNIVERSAL, KSBA_TYPE_SEQUENCE);
+  ksba_der_add_tag (d, KSBA_CLASS_UNIVERSAL, KSBA_TYPE_SEQUENCE);
+  for (i=0; i < 3; i++)
+    {
+      serial[0] = variant + i;
+      ksba_der_add_tag (d, KSBA_CLASS_UNIVERSAL, KSBA_TYPE_SEQUENCE);
+      ksba_der_add_tag (d, KSBA_CLASS_UNIVERSAL, KSBA_TYPE_SEQUENCE);
+      ksba_der_add_tag (d, KSBA_CLASS_UNIVERSAL, KSBA_TYPE_SEQUENCE);
+      ksba_der_add_oid (d, "1.3.14.3.2.26");
+      ksba_der_add_ptr (d, KSBA_CLASS_UNIVERSAL, KSBA_TYPE_NULL, NULL, 0);
+      ksba_der_add_end (d);
+      ksba_der_add_val (d, KSBA_CLASS_UNIVERSAL, KSBA_TYPE_OCTET_STRING,
+                        hash, sizeof hash);
+      ksba_der_add_val (d, KSBA_CLASS_UNIVERSAL, KSBA_TYPE_OCTET_STRING,
+                        hash, sizeof hash);
+      ksba_der_add_int (d, serial, sizeof serial, 1);
+      ksba_der_add_end (d);
+      ksba_der_add_end (d);
+    }
+  ksba_der_add_end (d);
+  ksba_der_add_tag (d, KSBA_CLASS_CONTEXT, 2);
+  ksba_der_add_tag (d, KSBA_CLASS_UNIVERSAL, KSBA_TYPE_SEQUENCE);
+  ksba_der_add_tag (d, KSBA_CLASS_UNIVERSAL, KSBA_TYPE_SEQUENCE);
+  ksba_der_add_oid (d, "1.3.6.1.5.5.7.48.1.2");
+  ksba_der_add_tag (d, KSBA_CLASS_ENCAPSULATE, KSBA_TYPE_OCTET_STRING);
+  ksba_der_add_val (d, KSBA_CLASS_UNIVERSAL, KSBA_TYPE_OCTET_STRING,
+                    serial, sizeof serial);
+  ksba_der_add_end (d);
+  ksba_der_add_end (d);
+  ksba_der_add_end (d);
+  ksba_der_add_end (d);
+  ksba_der_add_end (d);
+  ksba_der_add_bts (d, hash, sizeof hash, 0);
+  ksba_der_add_end (d);
+}
+
+
+/* Check that building objects with a reused builder does not
+ * allocate memory once the builder is warm.  */
+static void
+test_der_reuse (void)
+{
+  gpg_error_t err;
+  ksba_der_t d;
+  unsigned char *der, *der2;
+  size_t derlen, der2len, niov;
+  const ksba_iov_t *iov;
+  unsigned long count;
+  int i;
+
+  d = ksba_der_builder_new (0);
+  if (!d)
+    fail ("error creating new DER builder");
+
+  build_sample_object (d, 0);
+  err = ksba_der_builder_get (d, &der, &derlen);
+  fail_if_err (err);
+  err = ksba_der_builder_get_iov (d, &iov, &niov);
+  fail_if_err (err);
+
+  count = alloc_count;
+  for (i=0; i < 10; i++)
+    {
+      ksba_der_builder_reset (d);
+      build_sample_object (d, 0);
+      err = ksba_der_builder_get_iov (d, &iov, &niov);
+      fail_if_err (err);
+    }
+  if (alloc_count != count)
+    fail ("memory allocated by a warm builder");
+
+  /* An error must not have an effect after a reset.  */
+  ksba_der_builder_reset (d);
+  build_sample_object (d, 0);
+  ksba_der_add_oid (d, "1.2.3.4.5.6.7.8.9.10.11.12.13.14.15.16.17.18.19");
+  if (!ksba_der_builder_get (d, &der2, &der2len))
+    fail ("bad object not detected");
+
+  ksba_der_builder_reset (d);
+  build_sample_object (d, 0);
+  err = ksba_der_builder_get (d, &der2, &der2len);
+  fail_if_err (err);
+  if (der2len != derlen || memcmp (der, der2, derlen))
+    fail ("different object after reset");
+  xfree (der2);
+
+  xfree (der);
+  ksba_der_release (d);
+}
+
+
+/* Print the time and the number of allocations for building
+ * objects with a new builder and with a reused builder.  */
+static void
+run_benchmark (int iterations)
+{
+  gpg_error_t err;
+  ksba_der_t d;
+  unsigned char *der;
+  size_t derlen;
+  unsigned long count;
+  clock_t start;
+  int i;
+
+  count = alloc_count;
+  start = clock ();
+  for (i=0; i < iterations; i++)
+    {
+      d = ksba_der_builder_new (0);
+      build_sample_object (d, i);
+      err = ksba_der_builder_get (d, &der, &derlen);
+      fail_if_err (err);
+      xfree (der);
+      ksba_der_release (d);
+    }
+  printf ("new builder:    %8.3f us/object  %5.1f allocs/object\n",
+          (double)(clock () - start) * 1e6 / CLOCKS_PER_SEC / iterations,
+          (double)(alloc_count - count) / iterations);
+
+  d = ksba_der_builder_new (0);
+  count = alloc_count;
+  start = clock ();
+  for (i=0; i < iterations; i++)
+    {
+      ksba_der_builder_reset (d);
+      build_sample_object (d, i);
+      err = ksba_der_builder_get (d, &der, &derlen);
+      fail_if_err (err);
+      xfree (der);
+    }
+  printf ("reused builder: %8.3f us/object  %5.1f allocs/object\n",
+          (double)(clock () - start) * 1e6 / CLOCKS_PER_SEC / iterations,
+          (double)(alloc_count - count) / iterations);
+  ksba_der_release (d);
+}
+
+
 int
 main (int argc, char **argv)
 {
+  int bench = 0;
+
+  ksba_set_malloc_hooks (count_malloc, count_realloc, free);
+
   if (argc)
     {
       argc--;  argv++;
@@ -186,15 +537,27 @@ main (int argc, char **argv)
       argc--; argv++;
     }
 
+  if (argc && !strcmp (*argv, "--bench"))
+    {
+      bench = 1;
+      argc--; argv++;
+    }
 
-  if (!argc)
+  if (bench && !argc)
+    {
+      run_benchmark (100000);
+    }
+  else if (!argc)
     {
       test_der_encoding ();
       test_der_builder ();
+      test_der_template ();
+      test_der_streaming ();
+      test_der_reuse ();
     }
   else
     {
-      fputs ("usage: "PGM"\n", stderr);
+      fputs ("usage: "PGM" [--verbose] [--bench]\n", stderr);
       return 1;
     }
 
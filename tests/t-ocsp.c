@@ -356,6 +356,201 @@ my_hash_buffer (void *arg, const char *oid,
 
 
 
+/* Prepend the DER header for an object with TAG to the LENGTH bytes
+   at BUF and return the new length.  BUF must have room for four
+   more bytes.  */
+static size_t
+der_wrap (unsigned char *buf, size_t length, int tag)
+{
+  size_t nhdr = length < 128? 2 : length < 256? 3 : 4;
+
+  memmove (buf + nhdr, buf, length);
+  buf[0] = tag;
+  if (nhdr == 2)
+    buf[1] = length;
+  else if (nhdr == 3)
+    {
+      buf[1] = 0x81;
+      buf[2] = length;
+    }
+  else
+    {
+      buf[1] = 0x82;
+      buf[2] = length >> 8;
+      buf[3] = length;
+    }
+  return nhdr + length;
+}
+
+
+/* Append the DER object with TAG and the LENGTH bytes at VALUE to
+   BUF at offset OFF and return the new offset.  */
+static size_t
+der_add (unsigned char *buf, size_t off, int tag,
+         const void *value, size_t length)
+{
+  memcpy (buf + off, value, length);
+  return off + der_wrap (buf + off, length, tag);
+}
+
+
+/* Build an unsigned OCSP response for the CertID at CERTID.  If
+   REVOKED is set the certificate is reported as revoked at
+   2002-01-01 00:00:00, otherwise as good.  The response has a
+   thisUpdate of 2002-01-14 07:00:28 and, if WITH_NEXT is set, a
+   nextUpdate of 2002-02-14 07:00:28.  The caller must free the
+   result.  */
+static unsigned char *
+build_response (const unsigned char *certid, size_t certidlen,
+                int revoked, int with_next, size_t *r_length)
+{
+  static const char this_update[] = "20020114070028Z";
+  static const char next_update[] = "20020214070028Z";
+  static const char revocation_time[] = "20020101000000Z";
+  static const unsigned char oid_ocsp_basic[] = {
+    0x2b, 0x06, 0x01, 0x05, 0x05, 0x07, 0x30, 0x01, 0x01 };
+  static const unsigned char sigalgo[] = {
+    0x30, 0x0d, 0x06, 0x09, 0x2a, 0x86, 0x48, 0x86, 0xf7, 0x0d,
+    0x01, 0x01, 0x05, 0x05, 0x00 };
+  static const unsigned char sigval[] = { 0x00, 0x00 };
+  static const unsigned char status_ok[] = { 0x00 };
+  unsigned char keyid[20];
+  unsigned char single[512], tmp[512], data[1024], *rsp;
+  size_t n, m, len;
+
+  /* SingleResponse.  */
+  memcpy (single, certid, certidlen);
+  n = certidlen;
+  if (revoked)
+    {
+      m = der_add (tmp, 0, 0x18, revocation_time, 15);
+      n = der_add (single, n, 0xa1, tmp, m);
+    }
+  else
+    n = der_add (single, n, 0x80, "", 0);
+  n = der_add (single, n, 0x18, this_update, 15);
+  if (with_next)
+    {
+      m = der_add (tmp, 0, 0x18, next_update, 15);
+      n = der_add (single, n, 0xa0, tmp, m);
+    }
+  n = der_wrap (single, n, 0x30);
+
+  /* ResponseData with the responderID given by key.  */
+  memset (keyid, 0x42, sizeof keyid);
+  m = der_add (tmp, 0, 0x04, keyid, sizeof keyid);
+  len = der_add (data, 0, 0xa2, tmp, m);
+  len = der_add (data, len, 0x18, this_update, 15);
+  len = der_add (data, len, 0x30, single, n);
+  len = der_wrap (data, len, 0x30);
+
+  /* BasicOCSPResponse with a dummy signature.  */
+  memcpy (data + len, sigalgo, sizeof sigalgo);
+  len += sizeof sigalgo;
+  len = der_add (data, len, 0x03, sigval, sizeof sigval);
+  len = der_wrap (data, len, 0x30);
+
+  /* OCSPResponse.  */
+  rsp = xmalloc (len + 64);
+  len = der_wrap (data, len, 0x04);
+  n = der_add (tmp, 0, 0x06, oid_ocsp_basic, sizeof oid_ocsp_basic);
+  memcpy (tmp + n, data, len);
+  n = der_wrap (tmp, n + len, 0x30);
+  m = der_add (rsp, 0, 0x0a, status_ok, 1);
+  m = der_add (rsp, m, 0xa0, tmp, n);
+  m = der_wrap (rsp, m, 0x30);
+
+  *r_length = m;
+  return rsp;
+}
+
+
+/* Check ksba_ocsp_get_status_epoch using responses for the
+   certificate in CERT_FNAME issued by the one in ISSUER_CERT_FNAME.  */
+static void
+check_status_epoch (const char *cert_fname, const char *issuer_cert_fname)
+{
+  static const unsigned char sha1_algo[] = {
+    0x30, 0x09, 0x06, 0x05, 0x2b, 0x0e, 0x03, 0x02, 0x1a, 0x05, 0x00 };
+  gpg_error_t err;
+  ksba_cert_t cert = get_one_cert (cert_fname);
+  ksba_cert_t issuer_cert = get_one_cert (issuer_cert_fname);
+  ksba_ocsp_t ocsp;
+  ksba_ocsp_response_status_t response_status;
+  ksba_status_t status;
+  ksba_epochtime_t this_update, next_update, revocation_time;
+  unsigned char *request, *response;
+  size_t requestlen, responselen, n;
+  const unsigned char *certid = NULL;
+
+  err = ksba_ocsp_new (&ocsp);
+  fail_if_err (err);
+  err = ksba_ocsp_add_target (ocsp, cert, issuer_cert);
+  fail_if_err (err);
+  ksba_cert_release (issuer_cert);
+  err = ksba_ocsp_build_request (ocsp, &request, &requestlen);
+  fail_if_err (err);
+
+  /* The CertID is the sequence starting with the SHA-1 algorithm
+     identifier.  */
+  for (n=2; n + sizeof sha1_algo <= requestlen; n++)
+    if (!memcmp (request + n, sha1_algo, sizeof sha1_algo)
+        && request[n-2] == 0x30)
+      {
+        certid = request + n - 2;
+        break;
+      }
+  if (!certid)
+    fail ("CertID not found in request");
+
+  /* A good certificate without a nextUpdate.  */
+  response = build_response (certid, certid[1] + 2, 0, 0, &responselen);
+  err = ksba_ocsp_parse_response (ocsp, response, responselen,
+                                  &response_status);
+  fail_if_err (err);
+  xfree (response);
+  if (response_status != KSBA_OCSP_RSPSTATUS_SUCCESS)
+    fail ("unexpected response status");
+  err = ksba_ocsp_get_status_epoch (ocsp, cert, &status, &this_update,
+                                    &next_update, &revocation_time, NULL);
+  if (gpg_err_code (err) != GPG_ERR_NO_VALUE)
+    fail ("missing times not reported");
+  if (status != KSBA_STATUS_GOOD)
+    fail ("wrong certificate status");
+  if (this_update != 1010991628 || next_update || revocation_time)
+    fail ("wrong times for a good certificate");
+  this_update = 0;
+  err = ksba_ocsp_get_status_epoch (ocsp, cert, &status, &this_update,
+                                    NULL, NULL, NULL);
+  fail_if_err (err);
+  if (this_update != 1010991628)
+    fail ("wrong thisUpdate epoch");
+
+  /* A revoked certificate with a nextUpdate.  */
+  response = build_response (certid, certid[1] + 2, 1, 1, &responselen);
+  err = ksba_ocsp_parse_response (ocsp, response, responselen,
+                                  &response_status);
+  fail_if_err (err);
+  xfree (response);
+  if (response_status != KSBA_OCSP_RSPSTATUS_SUCCESS)
+    fail ("unexpected response status");
+  err = ksba_ocsp_get_status_epoch (ocsp, cert, &status, &this_update,
+                                    &next_update, &revocation_time, NULL);
+  fail_if_err (err);
+  if (status != KSBA_STATUS_REVOKED)
+    fail ("wrong certificate status");
+  if (this_update != 1010991628 || next_update != 1013670028
+      || revocation_time != 1009843200)
+    fail ("wrong times for a revoked certificate");
+
+  xfree (request);
+  ksba_cert_release (cert);
+  ksba_ocsp_release (ocsp);
+}
+
+
+
+
 /* ( printf "POST / HTTP/1.0\r\nContent-Type: application/ocsp-request\r\nContent-Length: `wc -c <a.req | tr -d ' '`\r\n\r\n"; cat a.req ) |  nc -v ocsp.openvalidation.org 8088   | sed '1,/^\r$/d' >a.rsp
 
     Openvalidation test reponders:
@@ -464,6 +659,7 @@ main (int argc, char **argv)
           f1 = prepend_srcdir (files[idx].cert_fname);
           f2 = prepend_srcdir (files[idx].issuer_cert_fname);
           one_request (f1, f2);
+          check_status_epoch (f1, f2);
           xfree (f2);
           xfree (f1);
         }
@@ -184,6 +184,209 @@ test_mem(const char* path)
   close (fd);
 }
 
+void
+test_mmap (const char *path)
+{
+  gpg_error_t err;
+  ksba_reader_t reader;
+  ksba_cert_t cert;
+  int fd, mode;
+  char buffer[16];
+  size_t nread;
+
+  for (mode=0; mode < 2; mode++)
+    {
+      err = ksba_reader_new (&reader);
+      fail_if_err (err);
+      if (!mode)
+        {
+          err = ksba_reader_open_file (reader, path);
+          fail_if_err (err);
+        }
+      else
+        {
+          /* The fd is not needed after mapping.  */
+          fd = open (path, O_RDONLY);
+          if (fd < 0)
+            fail ("open() failed");
+          err = ksba_reader_set_mmap (reader, fd);
+          fail_if_err (err);
+          close (fd);
+        }
+
+      err = ksba_cert_new (&cert);
+      fail_if_err (err);
+      err = ksba_cert_read_der (cert, reader);
+      fail_if_err (err);
+      ksba_cert_release (cert);
+
+      err = ksba_reader_read (reader, buffer, sizeof buffer, &nread);
+      if (gpg_err_code (err) != GPG_ERR_EOF)
+        fail ("no EOF after the certificate");
+      ksba_reader_release (reader);
+    }
+
+  err = ksba_reader_new (&reader);
+  fail_if_err (err);
+  err = ksba_reader_open_file (reader, "no-such-file");
+  if (gpg_err_code (err) != GPG_ERR_ENOENT)
+    fail ("opening a non-existing file did not fail");
+  ksba_reader_release (reader);
+}
+
+
+/* Read the file FNAME into a new buffer and return its length at
+   R_LENGTH.  */
+static unsigned char *
+read_file (const char *fname, size_t *r_length)
+{
+  FILE *fp;
+  unsigned char *buf;
+  size_t n;
+
+  fp = fopen (fname, "rb");
+  if (!fp)
+    fail ("error opening file");
+  buf = xmalloc (100000);
+  n = fread (buf, 1, 100000, fp);
+  fclose (fp);
+  *r_length = n;
+  return buf;
+}
+
+
+/* Append LENGTH bytes of DATA base64 encoded to P with lines of
+   LINELEN characters ended by EOL.  Returns the new end of P.  */
+static char *
+base64_encode (char *p, const unsigned char *data, size_t length,
+               int linelen, const char *eol)
+{
+  static const char bintoasc[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  unsigned int quad;
+  size_t i;
+  int col = 0;
+
+  for (i=0; i < length; i += 3)
+    {
+      quad = data[i] << 16;
+      if (i+1 < length)
+        quad |= data[i+1] << 8;
+      if (i+2 < length)
+        quad |= data[i+2];
+      *p++ = bintoasc[(quad >> 18) & 63];
+      *p++ = bintoasc[(quad >> 12) & 63];
+      *p++ = i+1 < length? bintoasc[(quad >> 6) & 63] : '=';
+      *p++ = i+2 < length? bintoasc[quad & 63] : '=';
+      col += 4;
+      if (col >= linelen)
+        {
+          p = stpcpy (p, eol);
+          col = 0;
+        }
+    }
+  if (col)
+    p = stpcpy (p, eol);
+  return p;
+}
+
+
+/* Check that the certificates from a PEM bundle and from a plain
+   base64 body decode to the DER files.  */
+static void
+test_base64 (void)
+{
+  static const char *names[2] = {
+    "samples/cert_g10code_test1.der", "samples/cert_dfn_pca01.der"
+  };
+  gpg_error_t err;
+  unsigned char *der[2];
+  size_t derlen[2];
+  char *text, *p;
+  ksba_reader_t reader;
+  ksba_cert_t cert;
+  const unsigned char *image;
+  size_t imagelen;
+  int i, pem;
+
+  for (i=0; i < 2; i++)
+    {
+      char *fname = prepend_srcdir (names[i]);
+      der[i] = read_file (fname, &derlen[i]);
+      free (fname);
+    }
+  text = xmalloc (2 * (derlen[0] + derlen[1]) + 1000);
+
+  for (pem=0; pem < 2; pem++)
+    {
+      p = text;
+      if (pem)
+        {
+          /* A bundle with some text between the objects.  */
+          p = stpcpy (p, "Subject: test\r\n\r\n-----BEGIN CERTIFICATE-----\r\n");
+          p = base64_encode (p, der[0], derlen[0], 64, "\r\n");
+          p = stpcpy (p, "-----END CERTIFICATE-----\r\n"
+                      "--- some text\n-----BEGIN CERTIFICATE-----\n");
+          p = base64_encode (p, der[1], derlen[1], 76, "\n");
+          p = stpcpy (p, "-----END CERTIFICATE-----\n");
+        }
+      else
+        {
+          /* A MIME body followed by a boundary.  */
+          p = base64_encode (p, der[0], derlen[0], 76, "\n");
+          p = stpcpy (p, "\n--boundary--\n");
+        }
+
+      err = ksba_reader_new (&reader);
+      fail_if_err (err);
+      err = ksba_reader_set_mem (reader, text, p - text);
+      fail_if_err (err);
+      err = ksba_reader_set_base64 (reader, pem? KSBA_BASE64_PEM : 0);
+      fail_if_err (err);
+
+      for (i=0; i < 1 + pem; i++)
+        {
+          err = ksba_cert_new (&cert);
+          fail_if_err (err);
+          err = ksba_cert_read_der (cert, reader);
+          fail_if_err (err);
+          image = ksba_cert_get_image (cert, &imagelen);
+          if (!image || imagelen != derlen[i]
+              || memcmp (image, der[i], imagelen))
+            fail ("base64 decoded certificate does not match");
+          ksba_cert_release (cert);
+        }
+
+      err = ksba_cert_new (&cert);
+      fail_if_err (err);
+      err = ksba_cert_read_der (cert, reader);
+      if (!err)
+        fail ("data after the last certificate");
+      ksba_cert_release (cert);
+      ksba_reader_release (reader);
+    }
+
+  /* An invalid character.  */
+  err = ksba_reader_new (&reader);
+  fail_if_err (err);
+  err = ksba_reader_set_mem (reader, "MIIB*AAA", 8);
+  fail_if_err (err);
+  err = ksba_reader_set_base64 (reader, 0);
+  fail_if_err (err);
+  err = ksba_cert_new (&cert);
+  fail_if_err (err);
+  err = ksba_cert_read_der (cert, reader);
+  if (!err)
+    fail ("invalid base64 not detected");
+  ksba_cert_release (cert);
+  ksba_reader_release (reader);
+
+  xfree (text);
+  for (i=0; i < 2; i++)
+    xfree (der[i]);
+}
+
+
 int
 main (int argc, char **argv)
 {
@@ -194,7 +397,10 @@ main (int argc, char **argv)
       test_fd (fname);
       test_file (fname);
       test_mem (fname);
+      test_mmap (fname);
       free(fname);
+
+      test_base64 ();
     }
   else
     {
@@ -204,6 +410,7 @@ main (int argc, char **argv)
           test_fd (argv[i]);
           test_file (argv[i]);
           test_mem (argv[i]);
+          test_mmap (argv[i]);
         }
     }
 
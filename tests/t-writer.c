@@ -0,0 +1,1014 @@
+/* t-writer.c - Tests for the writer object
+ * Copyright (C) 2026 g10 Code GmbH
+ *
+ * This file is part of KSBA.
+ *
+ * KSBA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KSBA is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#ifdef HAVE_PTHREAD
+# include <pthread.h>
+#endif
+
+#include "../src/ksba.h"
+
+#define PGM "t-writer"
+
+#define DIM(v) (sizeof(v)/sizeof((v)[0]))
+
+#include "t-common.h"
+
+
+static int verbose;
+
+/* Number of calls to the allocation functions.  */
+static unsigned int alloc_count;
+
+
+static void *
+count_malloc (size_t n)
+{
+  alloc_count++;
+  return malloc (n);
+}
+
+static void *
+count_realloc (void *p, size_t n)
+{
+  alloc_count++;
+  return realloc (p, n);
+}
+
+
+/* Fill BUFFER of LENGTH with a pattern depending on the offset.  */
+static void
+fill_pattern (unsigned char *buffer, size_t length, size_t offset)
+{
+  size_t i;
+
+  for (i=0; i < length; i++)
+    buffer[i] = (offset + i) * 7 + ((offset + i) >> 8);
+}
+
+
+/* Write NBYTES in pieces of varying length to W and store a copy of
+   the data at EXPECTED.  */
+static void
+write_pattern (ksba_writer_t w, unsigned char *expected, size_t nbytes)
+{
+  gpg_error_t err;
+  size_t off, n;
+  int i;
+
+  fill_pattern (expected, nbytes, 0);
+  for (off=0, i=0; off < nbytes; off += n, i++)
+    {
+      n = (i % 5) == 4? 1500 : (i % 7) + 1;
+      if (n > nbytes - off)
+        n = nbytes - off;
+      err = ksba_writer_write (w, expected + off, n);
+      fail_if_err (err);
+    }
+}
+
+
+/* Check that the segments of IOV/NIOV have EXPECTED as content.  */
+static void
+check_iov (const ksba_iov_t *iov, size_t niov,
+           const unsigned char *expected, size_t nbytes)
+{
+  size_t i, off;
+
+  for (i=off=0; i < niov; i++)
+    {
+      if (off + iov[i].len > nbytes
+          || memcmp (iov[i].data, expected + off, iov[i].len))
+        fail ("segment does not match the written data");
+      off += iov[i].len;
+    }
+  if (off != nbytes)
+    fail ("segments have a wrong total length");
+}
+
+
+/* The memory writer needs to grow its buffer geometrically.  */
+static void
+test_mem_growth (void)
+{
+  gpg_error_t err;
+  ksba_writer_t w;
+  const unsigned char *p;
+  size_t n, i;
+  unsigned int count;
+  unsigned char c;
+
+  err = ksba_writer_new (&w);
+  fail_if_err (err);
+  err = ksba_writer_set_mem (w, 16);
+  fail_if_err (err);
+
+  count = alloc_count;
+  for (i=0; i < 1000000; i++)
+    {
+      c = i;
+      err = ksba_writer_write (w, &c, 1);
+      fail_if_err (err);
+    }
+  count = alloc_count - count;
+  if (verbose)
+    printf ("mem writer: %u reallocations for %zu bytes\n", count, i);
+  if (count > 20)
+    fail ("memory writer does not grow geometrically");
+
+  p = ksba_writer_get_mem (w, &n);
+  if (!p || n != 1000000)
+    fail ("bad length of memory writer");
+  for (i=0; i < n; i++)
+    if (p[i] != (unsigned char)i)
+      fail ("bad content of memory writer");
+
+  ksba_writer_release (w);
+}
+
+
+static void
+test_mem_chunked (void)
+{
+  gpg_error_t err;
+  ksba_writer_t w;
+  unsigned char *expected;
+  const ksba_iov_t *iov;
+  size_t niov, n, nbytes = 100000;
+  const unsigned char *p;
+  unsigned char *buf;
+  unsigned int count;
+
+  expected = xmalloc (nbytes);
+
+  err = ksba_writer_new (&w);
+  fail_if_err (err);
+  err = ksba_writer_set_mem_chunked (w, 4096);
+  fail_if_err (err);
+  err = ksba_writer_set_mem (w, 0);
+  if (gpg_err_code (err) != GPG_ERR_CONFLICT)
+    fail ("set_mem on a chunked writer did not fail");
+
+  /* Nothing written yet.  */
+  err = ksba_writer_get_mem_iov (w, &iov, &niov);
+  fail_if_err (err);
+  if (niov)
+    fail ("empty writer returned segments");
+
+  write_pattern (w, expected, nbytes);
+  if (ksba_writer_tell (w) != nbytes)
+    fail ("bad length of chunked writer");
+  err = ksba_writer_get_mem_iov (w, &iov, &niov);
+  fail_if_err (err);
+  if (niov != (nbytes + 4095) / 4096)
+    fail ("unexpected number of segments");
+  check_iov (iov, niov, expected, nbytes);
+
+  /* Reuse the chunks; the same data must not allocate anything.  */
+  err = ksba_writer_set_mem_chunked (w, 0);
+  fail_if_err (err);
+  count = alloc_count;
+  write_pattern (w, expected, nbytes);
+  err = ksba_writer_get_mem_iov (w, &iov, &niov);
+  fail_if_err (err);
+  if (alloc_count != count)
+    fail ("reused chunked writer allocated memory");
+  check_iov (iov, niov, expected, nbytes);
+
+  /* Get a contiguous buffer and continue writing.  */
+  p = ksba_writer_get_mem (w, &n);
+  if (!p || n != nbytes || memcmp (p, expected, nbytes))
+    fail ("bad contiguous buffer from chunked writer");
+  err = ksba_writer_write (w, "tail", 4);
+  fail_if_err (err);
+  err = ksba_writer_get_mem_iov (w, &iov, &niov);
+  fail_if_err (err);
+  if (niov != 2 || iov[0].data != p || iov[0].len != nbytes
+      || iov[1].len != 4 || memcmp (iov[1].data, "tail", 4))
+    fail ("bad segments after get_mem");
+
+  buf = ksba_writer_snatch_mem (w, &n);
+  if (!buf || n != nbytes + 4 || memcmp (buf, expected, nbytes))
+    fail ("bad buffer from snatch_mem");
+  xfree (buf);
+  err = ksba_writer_write (w, "x", 1);
+  if (!err)
+    fail ("writing to a snatched writer did not fail");
+
+  ksba_writer_release (w);
+
+  /* The segments of a plain memory writer.  */
+  err = ksba_writer_new (&w);
+  fail_if_err (err);
+  err = ksba_writer_set_mem (w, 0);
+  fail_if_err (err);
+  write_pattern (w, expected, nbytes);
+  err = ksba_writer_get_mem_iov (w, &iov, &niov);
+  fail_if_err (err);
+  if (niov != 1)
+    fail ("memory writer returned more than one segment");
+  check_iov (iov, niov, expected, nbytes);
+  ksba_writer_release (w);
+
+  xfree (expected);
+}
+
+
+/* Callback collecting the written data.  */
+struct collect_s
+{
+  unsigned char *buffer;
+  size_t length;
+  unsigned int ncalls;
+};
+
+static int
+collect_cb (void *opaque, const void *buffer, size_t length)
+{
+  struct collect_s *c = opaque;
+
+  memcpy (c->buffer + c->length, buffer, length);
+  c->length += length;
+  c->ncalls++;
+  return 0;
+}
+
+
+/* Small writes to a buffered writer need to be coalesced.  */
+static void
+test_buffered (void)
+{
+  gpg_error_t err;
+  ksba_writer_t w;
+  unsigned char *expected;
+  size_t nbytes = 100000;
+  struct collect_s coll;
+  ksba_iov_t iov[3];
+  unsigned int ncalls;
+
+  expected = xmalloc (nbytes + 20000);
+  coll.buffer = xmalloc (nbytes + 20010);
+  coll.length = 0;
+  coll.ncalls = 0;
+
+  err = ksba_writer_new (&w);
+  fail_if_err (err);
+  err = ksba_writer_set_buffer (w, 4096);
+  if (gpg_err_code (err) != GPG_ERR_CONFLICT)
+    fail ("set_buffer on an uninitialized writer did not fail");
+  err = ksba_writer_set_cb (w, collect_cb, &coll);
+  fail_if_err (err);
+  err = ksba_writer_set_buffer (w, 4096);
+  fail_if_err (err);
+
+  write_pattern (w, expected, nbytes);
+  if (ksba_writer_tell (w) != nbytes)
+    fail ("bad length of buffered writer");
+  err = ksba_writer_flush (w);
+  fail_if_err (err);
+  if (verbose)
+    printf ("buffered writer: %u calls for %zu bytes\n", coll.ncalls, nbytes);
+  if (coll.ncalls > nbytes / 2048 + 1)
+    fail ("small writes were not coalesced");
+  if (coll.length != nbytes || memcmp (coll.buffer, expected, nbytes))
+    fail ("bad content of buffered writer");
+
+  /* A vector with a large segment between two small ones.  The
+     large segment is passed on directly.  */
+  fill_pattern (expected + nbytes, 20000, nbytes);
+  iov[0].data = expected + nbytes;
+  iov[0].len = 10;
+  iov[1].data = expected + nbytes + 10;
+  iov[1].len = 19980;
+  iov[2].data = expected + nbytes + 19990;
+  iov[2].len = 10;
+  ncalls = coll.ncalls;
+  err = ksba_writer_writev (w, iov, 3);
+  fail_if_err (err);
+  if (coll.ncalls - ncalls != 3)
+    fail ("unexpected number of calls for writev");
+  err = ksba_writer_flush (w);
+  fail_if_err (err);
+  if (coll.ncalls - ncalls != 3)
+    fail ("flush wrote data after writev");
+  if (coll.length != nbytes + 20000
+      || memcmp (coll.buffer, expected, nbytes + 20000))
+    fail ("bad content after writev");
+
+  /* Releasing the writer writes out the buffered data.  */
+  err = ksba_writer_write (w, expected, 10);
+  fail_if_err (err);
+  if (coll.length != nbytes + 20000)
+    fail ("small write was not buffered");
+  ksba_writer_release (w);
+  if (coll.length != nbytes + 20010
+      || memcmp (coll.buffer + nbytes + 20000, expected, 10))
+    fail ("buffered data lost on release");
+  xfree (coll.buffer);
+  xfree (expected);
+}
+
+
+/* Writing to a file descriptor.  */
+static void
+test_fd (void)
+{
+  gpg_error_t err;
+  ksba_writer_t w;
+  unsigned char *expected, *buffer;
+  size_t nbytes = 250000;
+  ksba_iov_t iov[40];
+  size_t i, off;
+  FILE *fp;
+  int fd, pass;
+
+  expected = xmalloc (nbytes);
+  buffer = xmalloc (nbytes);
+
+  /* Pass 0 is unbuffered, the others use a buffer of 8k.  Pass 2
+     alternates short segments with segments long enough to bypass
+     the buffer.  */
+  for (pass=0; pass < 3; pass++)
+    {
+      fp = tmpfile ();
+      if (!fp)
+        fail ("tmpfile failed");
+      fd = fileno (fp);
+
+      err = ksba_writer_new (&w);
+      fail_if_err (err);
+      err = ksba_writer_set_fd (w, fd);
+      fail_if_err (err);
+      if (pass)
+        {
+          err = ksba_writer_set_buffer (w, 0);
+          fail_if_err (err);
+        }
+
+      write_pattern (w, expected, nbytes/2);
+      /* Pass more segments than done with one system call.  */
+      fill_pattern (expected + nbytes/2, nbytes/2, nbytes/2);
+      for (i=off=0; i < DIM (iov); i++)
+        {
+          iov[i].data = expected + nbytes/2 + off;
+          if (i + 1 == DIM (iov))
+            iov[i].len = nbytes/2 - off;
+          else if (pass == 2)
+            iov[i].len = (i & 1)? 5000 : 10;
+          else
+            iov[i].len = (i % 3) * 1000 + 1;
+          off += iov[i].len;
+        }
+      err = ksba_writer_writev (w, iov, DIM (iov));
+      fail_if_err (err);
+      err = ksba_writer_flush (w);
+      fail_if_err (err);
+      if (ksba_writer_tell (w) != nbytes)
+        fail ("bad length of fd writer");
+      ksba_writer_release (w);
+
+      if (lseek (fd, 0, SEEK_SET)
+          || read (fd, buffer, nbytes) != nbytes
+          || memcmp (buffer, expected, nbytes))
+        fail ("bad content written to the fd");
+      fclose (fp);
+    }
+
+  xfree (buffer);
+  xfree (expected);
+}
+
+
+/* Filter to convert the data to hex.  */
+static gpg_error_t
+hex_filter (void *opaque, const void *inbuf, size_t inlen, size_t *nin,
+            void *outbuf, size_t outsize, size_t *nout)
+{
+  const unsigned char *s = inbuf;
+  char *d = outbuf;
+  size_t n;
+
+  (void)opaque;
+  n = inlen < outsize / 2? inlen : outsize / 2;
+  *nin = n;
+  *nout = 2 * n;
+  for (; n; n--, s++, d += 2)
+    {
+      d[0] = "0123456789abcdef"[*s >> 4];
+      d[1] = "0123456789abcdef"[*s & 15];
+    }
+  return 0;
+}
+
+
+/* Size preserving filter which counts calls not done in place.  */
+static gpg_error_t
+xor_filter (void *opaque, const void *inbuf, size_t inlen, size_t *nin,
+            void *outbuf, size_t outsize, size_t *nout)
+{
+  unsigned int *notinplace = opaque;
+  const unsigned char *s = inbuf;
+  unsigned char *d = outbuf;
+  size_t n;
+
+  if (inbuf != outbuf)
+    (*notinplace)++;
+  n = inlen < outsize? inlen : outsize;
+  *nin = *nout = n;
+  for (; n; n--)
+    *d++ = *s++ ^ 0x20;
+  return 0;
+}
+
+
+/* Filter which passes the data on in groups of 3 bytes and keeps
+   the remainder until it is flushed.  */
+struct group_s
+{
+  unsigned char pending[3];
+  size_t npending;
+};
+
+static gpg_error_t
+group_filter (void *opaque, const void *inbuf, size_t inlen, size_t *nin,
+              void *outbuf, size_t outsize, size_t *nout)
+{
+  struct group_s *g = opaque;
+  const unsigned char *s = inbuf;
+  unsigned char *d = outbuf;
+
+  *nin = *nout = 0;
+  if (!inlen)  /* Flush.  */
+    {
+      memcpy (d, g->pending, g->npending);
+      *nout = g->npending;
+      g->npending = 0;
+      return 0;
+    }
+  while (*nin < inlen && *nout + 3 <= outsize)
+    {
+      g->pending[g->npending++] = s[(*nin)++];
+      if (g->npending == 3)
+        {
+          memcpy (d + *nout, g->pending, 3);
+          *nout += 3;
+          g->npending = 0;
+        }
+    }
+  return 0;
+}
+
+
+/* A chain of filters with an in-place and a flushing one.  */
+static void
+test_filters (void)
+{
+  gpg_error_t err;
+  ksba_writer_t w;
+  unsigned char *expected, *hex;
+  const unsigned char *p;
+  size_t nbytes = 10001;
+  size_t n, i;
+  unsigned int notinplace = 0;
+  struct group_s group;
+
+  expected = xmalloc (nbytes);
+  hex = xmalloc (2 * nbytes);
+  group.npending = 0;
+
+  err = ksba_writer_new (&w);
+  fail_if_err (err);
+  err = ksba_writer_set_mem (w, 0);
+  fail_if_err (err);
+  err = ksba_writer_add_filter (w, hex_filter, NULL, 100, 0);
+  fail_if_err (err);
+  err = ksba_writer_add_filter (w, xor_filter, &notinplace, 0,
+                                KSBA_FILTER_INPLACE);
+  fail_if_err (err);
+  err = ksba_writer_add_filter (w, group_filter, &group, 50,
+                                KSBA_FILTER_FLUSH);
+  fail_if_err (err);
+
+  write_pattern (w, expected, nbytes);
+  for (i=0; i < nbytes; i++)
+    {
+      hex[2*i]   = "0123456789abcdef"[expected[i] >> 4] ^ 0x20;
+      hex[2*i+1] = "0123456789abcdef"[expected[i] & 15] ^ 0x20;
+    }
+  if (notinplace)
+    fail ("in-place filter got a separate output buffer");
+
+  p = ksba_writer_get_mem (w, &n);
+  if (!p || n != (2 * nbytes) / 3 * 3 || memcmp (p, hex, n))
+    fail ("bad output of the filter chain");
+  err = ksba_writer_flush (w);
+  fail_if_err (err);
+  p = ksba_writer_get_mem (w, &n);
+  if (!p || n != 2 * nbytes || memcmp (p, hex, n))
+    fail ("bad output of the filter chain after flush");
+
+  /* Removing the filters.  */
+  err = ksba_writer_set_filter (w, NULL, NULL);
+  fail_if_err (err);
+  err = ksba_writer_write (w, "x", 1);
+  fail_if_err (err);
+  p = ksba_writer_get_mem (w, &n);
+  if (!p || n != 2 * nbytes + 1 || p[n-1] != 'x')
+    fail ("filter not removed");
+
+  ksba_writer_release (w);
+  xfree (hex);
+  xfree (expected);
+}
+
+
+/* Callback checking that the blocks of a filter ring stay valid.  */
+struct ring_check_s
+{
+  const unsigned char *expected;
+  size_t offset;
+  const unsigned char *blocks[3];
+  size_t offsets[3];
+  size_t lengths[3];
+  unsigned int nblocks;
+};
+
+static int
+ring_check_cb (void *opaque, const void *buffer, size_t length)
+{
+  struct ring_check_s *rc = opaque;
+  int i;
+
+  i = rc->nblocks++ % 3;
+  rc->blocks[i] = buffer;
+  rc->offsets[i] = rc->offset;
+  rc->lengths[i] = length;
+  rc->offset += length;
+
+  /* The last 3 blocks must still be intact.  */
+  for (i=0; i < 3 && i < rc->nblocks; i++)
+    if (memcmp (rc->blocks[i], rc->expected + rc->offsets[i],
+                rc->lengths[i]))
+      fail ("block of filter ring overwritten");
+  return 0;
+}
+
+
+/* Filter which copies the data.  */
+static gpg_error_t
+copy_filter (void *opaque, const void *inbuf, size_t inlen, size_t *nin,
+             void *outbuf, size_t outsize, size_t *nout)
+{
+  size_t n;
+
+  (void)opaque;
+  n = inlen < outsize? inlen : outsize;
+  memcpy (outbuf, inbuf, n);
+  *nin = *nout = n;
+  return 0;
+}
+
+
+static void
+test_filter_ring (void)
+{
+  gpg_error_t err;
+  ksba_writer_t w;
+  unsigned char *expected, *xored;
+  size_t nbytes = 10000;
+  size_t i;
+  struct ring_check_s rc;
+  unsigned int notinplace = 0;
+
+  expected = xmalloc (nbytes);
+  xored = xmalloc (nbytes);
+  fill_pattern (expected, nbytes, 0);
+  for (i=0; i < nbytes; i++)
+    xored[i] = expected[i] ^ 0x20;
+  memset (&rc, 0, sizeof rc);
+  rc.expected = xored;
+
+  err = ksba_writer_new (&w);
+  fail_if_err (err);
+  err = ksba_writer_set_cb (w, ring_check_cb, &rc);
+  fail_if_err (err);
+  err = ksba_writer_set_filter_ring (w, 3);
+  if (gpg_err_code (err) != GPG_ERR_NO_DATA)
+    fail ("set_filter_ring without a filter did not fail");
+  err = ksba_writer_add_filter (w, copy_filter, NULL, 512, 0);
+  fail_if_err (err);
+  err = ksba_writer_add_filter (w, xor_filter, &notinplace, 0,
+                                KSBA_FILTER_INPLACE);
+  fail_if_err (err);
+  err = ksba_writer_set_filter_ring (w, 3);
+  fail_if_err (err);
+
+  err = ksba_writer_write (w, expected, nbytes);
+  fail_if_err (err);
+  if (notinplace)
+    fail ("in-place filter got a separate output buffer");
+  if (rc.nblocks != (nbytes + 511) / 512 || rc.offset != nbytes)
+    fail ("unexpected number of blocks");
+  ksba_writer_release (w);
+
+  xfree (xored);
+  xfree (expected);
+}
+
+
+/* Write STRING to a new writer with a base64 filter and compare the
+   output with EXPECTED.  */
+static void
+check_base64 (const char *string, const char *label, unsigned int linelen,
+              unsigned int flags, const char *expected)
+{
+  gpg_error_t err;
+  ksba_writer_t w;
+  const char *p;
+  size_t n, i;
+
+  err = ksba_writer_new (&w);
+  fail_if_err (err);
+  err = ksba_writer_set_mem (w, 0);
+  fail_if_err (err);
+  err = ksba_writer_add_base64 (w, label, linelen, flags);
+  fail_if_err (err);
+  /* Write byte by byte to test the pending data.  */
+  for (i=0; string[i]; i++)
+    {
+      err = ksba_writer_write (w, string + i, 1);
+      fail_if_err (err);
+    }
+  err = ksba_writer_flush (w);
+  fail_if_err (err);
+  p = ksba_writer_get_mem (w, &n);
+  if (!p || n != strlen (expected) || memcmp (p, expected, n))
+    {
+      if (verbose && p)
+        printf ("got '%.*s'\n", (int)n, p);
+      fail ("base64 filter output does not match");
+    }
+  ksba_writer_release (w);
+}
+
+
+/* Callback to read the data from a writer.  */
+static int
+writer_mem_cb (void *opaque, char *buffer, size_t count, size_t *nread)
+{
+  ksba_iov_t *iov = opaque;
+
+  if (!buffer)
+    return -1;
+  if (!iov->len)
+    return gpg_error (GPG_ERR_EOF);
+  if (count > iov->len)
+    count = iov->len;
+  memcpy (buffer, iov->data, count);
+  iov->data = (const char*)iov->data + count;
+  iov->len -= count;
+  *nread = count;
+  return 0;
+}
+
+
+static void
+test_base64 (void)
+{
+  gpg_error_t err;
+  ksba_writer_t w;
+  ksba_reader_t r;
+  unsigned char *expected, *buffer;
+  size_t nbytes = 100000;
+  size_t n, nread;
+  ksba_iov_t iov;
+
+  check_base64 ("", NULL, 0, 0, "");
+  check_base64 ("f", NULL, 0, 0, "Zg==\n");
+  check_base64 ("fo", NULL, 0, 0, "Zm8=\n");
+  check_base64 ("foo", NULL, 0, 0, "Zm9v\n");
+  check_base64 ("foobar", NULL, 0, 0, "Zm9vYmFy\n");
+  check_base64 ("foobar", NULL, 8, 0, "Zm9vYmFy\n");
+  check_base64 ("foobarf", NULL, 4, KSBA_BASE64_CRLF,
+                "Zm9v\r\nYmFy\r\nZg==\r\n");
+  check_base64 ("fooba", "TEST", 0, 0,
+                "-----BEGIN TEST-----\nZm9vYmE=\n-----END TEST-----\n");
+
+  /* Encode a larger amount of data and decode it with a reader.  */
+  expected = xmalloc (nbytes);
+  buffer = xmalloc (nbytes);
+  err = ksba_writer_new (&w);
+  fail_if_err (err);
+  err = ksba_writer_set_mem (w, 0);
+  fail_if_err (err);
+  err = ksba_writer_add_base64 (w, "DATA", 76, KSBA_BASE64_CRLF);
+  fail_if_err (err);
+  write_pattern (w, expected, nbytes);
+  err = ksba_writer_flush (w);
+  fail_if_err (err);
+  iov.data = ksba_writer_get_mem (w, &iov.len);
+  if (!iov.data)
+    fail ("no data from base64 writer");
+
+  err = ksba_reader_new (&r);
+  fail_if_err (err);
+  err = ksba_reader_set_cb (r, writer_mem_cb, &iov);
+  fail_if_err (err);
+  err = ksba_reader_set_base64 (r, KSBA_BASE64_PEM);
+  fail_if_err (err);
+  for (n=0; n < nbytes; n += nread)
+    {
+      err = ksba_reader_read (r, (char*)buffer + n, nbytes - n, &nread);
+      fail_if_err (err);
+    }
+  if (memcmp (buffer, expected, nbytes))
+    fail ("base64 round trip failed");
+  ksba_reader_release (r);
+  ksba_writer_release (w);
+
+  xfree (buffer);
+  xfree (expected);
+}
+
+
+/* Return the elapsed time in seconds.  The process time would not
+   show the gain from an output thread.  */
+static double
+wall_clock (void)
+{
+#ifdef HAVE_CLOCK_GETTIME
+  struct timespec ts;
+
+  if (!clock_gettime (CLOCK_MONOTONIC, &ts))
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+  return (double)clock () / CLOCKS_PER_SEC;
+}
+
+
+#ifdef HAVE_PTHREAD
+/* The number of buffers in the filter ring of the benchmark.  */
+#define RING_SIZE 4
+
+/* State shared by the callback of the ring benchmark and its output
+   thread.  NQUEUED counts the blocks handed to the thread and NDONE
+   the blocks it has written.  */
+struct ring_out_s
+{
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  const void *blocks[RING_SIZE];
+  size_t lengths[RING_SIZE];
+  unsigned int nqueued;
+  unsigned int ndone;
+  int eof;
+  int fd;
+  int failed;
+};
+
+
+/* Output thread of the ring benchmark.  */
+static void *
+ring_out_thread (void *opaque)
+{
+  struct ring_out_s *ro = opaque;
+  const void *block;
+  size_t length;
+
+  pthread_mutex_lock (&ro->lock);
+  for (;;)
+    {
+      while (ro->ndone == ro->nqueued && !ro->eof)
+        pthread_cond_wait (&ro->cond, &ro->lock);
+      if (ro->ndone == ro->nqueued)
+        break;
+      block = ro->blocks[ro->ndone % RING_SIZE];
+      length = ro->lengths[ro->ndone % RING_SIZE];
+      pthread_mutex_unlock (&ro->lock);
+
+      if (write (ro->fd, block, length) != length)
+        ro->failed = 1;
+
+      pthread_mutex_lock (&ro->lock);
+      ro->ndone++;
+      pthread_cond_broadcast (&ro->cond);
+    }
+  pthread_mutex_unlock (&ro->lock);
+  return NULL;
+}
+
+
+/* Writer callback of the ring benchmark.  The block stays valid
+   until the filter has produced RING_SIZE - 1 more blocks; thus we
+   only need to wait for the output thread if it is that far
+   behind.  */
+static int
+ring_out_cb (void *opaque, const void *buffer, size_t length)
+{
+  struct ring_out_s *ro = opaque;
+
+  pthread_mutex_lock (&ro->lock);
+  while (ro->nqueued - ro->ndone >= RING_SIZE - 1)
+    pthread_cond_wait (&ro->cond, &ro->lock);
+  ro->blocks[ro->nqueued % RING_SIZE] = buffer;
+  ro->lengths[ro->nqueued % RING_SIZE] = length;
+  ro->nqueued++;
+  pthread_cond_broadcast (&ro->cond);
+  pthread_mutex_unlock (&ro->lock);
+  return 0;
+}
+#endif /*HAVE_PTHREAD*/
+
+
+/* Print the throughput of a writer with a filter which stands for
+   an encryption filter.  MBYTES of content are written as an octet
+   string to /dev/null.  */
+static void
+run_benchmark (size_t mbytes)
+{
+  static struct {
+    const char *desc;
+    size_t blocksize;
+    int chain;
+  } modes[] = {
+    { "no filter                  ", 1,       0 },
+    { "set_filter (4k)            ", 0,       0 },
+    { "add_filter (64k)           ", 65536,   0 },
+    { "add_filter + in-place (64k)", 65536,   1 },
+    { "add_filter + ring (4x64k)  ", 65536,   3 },
+    { "base64                     ", 1,       2 }
+  };
+  gpg_error_t err;
+  ksba_writer_t w;
+  unsigned char *chunk;
+  size_t chunklen = 1024*1024;
+  size_t i;
+  unsigned int notinplace = 0;
+  double start, secs;
+  int fd, mode;
+#ifdef HAVE_PTHREAD
+  struct ring_out_s ro;
+  pthread_t thread;
+#endif
+
+  chunk = xmalloc (chunklen);
+  fill_pattern (chunk, chunklen, 0);
+  fd = open ("/dev/null", O_WRONLY);
+  if (fd == -1)
+    fail ("error opening /dev/null");
+
+  for (mode=0; mode < DIM (modes); mode++)
+    {
+#ifndef HAVE_PTHREAD
+      if (modes[mode].chain == 3)
+        continue;
+#endif
+      err = ksba_writer_new (&w);
+      fail_if_err (err);
+      if (modes[mode].chain == 3)
+        {
+#ifdef HAVE_PTHREAD
+          memset (&ro, 0, sizeof ro);
+          pthread_mutex_init (&ro.lock, NULL);
+          pthread_cond_init (&ro.cond, NULL);
+          ro.fd = fd;
+          if (pthread_create (&thread, NULL, ring_out_thread, &ro))
+            fail ("error creating output thread");
+          err = ksba_writer_set_cb (w, ring_out_cb, &ro);
+#endif
+        }
+      else
+        {
+          err = ksba_writer_set_fd (w, fd);
+          if (!err)
+            err = ksba_writer_set_buffer (w, 65536);
+        }
+      fail_if_err (err);
+      if (!modes[mode].blocksize)
+        err = ksba_writer_set_filter (w, copy_filter, NULL);
+      else if (modes[mode].blocksize > 1)
+        err = ksba_writer_add_filter (w, copy_filter, NULL,
+                                      modes[mode].blocksize, 0);
+      else if (modes[mode].chain == 2)
+        err = ksba_writer_add_base64 (w, NULL, 0, 0);
+      fail_if_err (err);
+      if (modes[mode].chain == 1)
+        {
+          err = ksba_writer_add_filter (w, xor_filter, &notinplace, 0,
+                                        KSBA_FILTER_INPLACE);
+          fail_if_err (err);
+        }
+      else if (modes[mode].chain == 3)
+        {
+          err = ksba_writer_set_filter_ring (w, RING_SIZE);
+          fail_if_err (err);
+        }
+
+      start = wall_clock ();
+      for (i=0; i < mbytes; i++)
+        {
+          err = ksba_writer_write_octet_string (w, chunk, chunklen, 0);
+          fail_if_err (err);
+        }
+      err = ksba_writer_write_octet_string (w, NULL, 0, 1);
+      fail_if_err (err);
+      err = ksba_writer_flush (w);
+      fail_if_err (err);
+#ifdef HAVE_PTHREAD
+      if (modes[mode].chain == 3)
+        {
+          pthread_mutex_lock (&ro.lock);
+          ro.eof = 1;
+          pthread_cond_broadcast (&ro.cond);
+          pthread_mutex_unlock (&ro.lock);
+          pthread_join (thread, NULL);
+          pthread_cond_destroy (&ro.cond);
+          pthread_mutex_destroy (&ro.lock);
+          if (ro.failed)
+            fail ("error writing to /dev/null");
+        }
+#endif
+      secs = wall_clock () - start;
+      printf ("%s %8.1f MB/s\n", modes[mode].desc,
+              secs > 0? mbytes / secs : 0.0);
+      ksba_writer_release (w);
+    }
+
+  close (fd);
+  xfree (chunk);
+}
+
+
+
+int
+main (int argc, char **argv)
+{
+  int bench = 0;
+
+  ksba_set_malloc_hooks (count_malloc, count_realloc, free);
+
+  if (argc)
+    {
+      argc--;  argv++;
+    }
+
+  if (argc && !strcmp (*argv, "--verbose"))
+    {
+      verbose = 1;
+      argc--; argv++;
+    }
+
+  if (argc && !strcmp (*argv, "--bench"))
+    {
+      bench = 1;
+      argc--; argv++;
+    }
+
+  if (bench && argc <= 1)
+    {
+      run_benchmark (argc? strtoul (*argv, NULL, 10) : 256);
+    }
+  else if (!argc)
+    {
+      test_mem_growth ();
+      test_mem_chunked ();
+      test_buffered ();
+      test_fd ();
+      test_filters ();
+      test_filter_ring ();
+      test_base64 ();
+    }
+  else
+    {
+      fputs ("usage: "PGM" [--verbose] [--bench [MBYTES]]\n", stderr);
+      return 1;
+    }
+
+  return 0;
+}